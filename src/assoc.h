@@ -95,6 +95,15 @@ struct mh_strnptr_node_t {
 #define mh_cmp(a, b, arg) ((a)->len != (b)->len || \
 			    strncmp((a)->str, (b)->str, (a)->len))
 #define mh_cmp_key(a, b, arg) mh_cmp(a, b, arg)
+/*
+ * String keys pay a strncmp() per probed slot: use the bytemap
+ * variant, which keeps a 7-bit fragment of the hash in the
+ * per-slot control byte and filters out almost all non-matching
+ * slots before the comparison runs - the same trick group-probing
+ * hash tables use, minus the vector scan, which does not apply
+ * to this table's double-hashed probe sequence.
+ */
+#define mh_bytemap 1
 #include "salad/mhash.h"
 
 static inline mh_int_t
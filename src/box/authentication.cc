@@ -79,9 +79,31 @@ authenticate(const char *user_name, uint32_t len,
 			   "invalid scramble size");
 	}
 
+	/*
+	 * Fast path for pooled connections re-authenticating
+	 * with the same credentials over the same session: the
+	 * scramble is salt-bound, so replaying it grants nothing
+	 * the session was not already granted, but only as long
+	 * as the password hash it was verified against is still
+	 * current.
+	 */
+	if (session->auth_cached &&
+	    session->auth_uid == user->def.uid &&
+	    memcmp(session->auth_scramble, scramble, SCRAMBLE_SIZE) == 0 &&
+	    memcmp(session->auth_hash2, user->def.hash2,
+		   SCRAMBLE_SIZE) == 0)
+		goto triggers;
+
 	if (scramble_check(scramble, session->salt, user->def.hash2))
 		tnt_raise(ClientError, ER_PASSWORD_MISMATCH, user->def.name);
 
+	memcpy(session->auth_scramble, scramble, SCRAMBLE_SIZE);
+	memcpy(session->auth_hash2, user->def.hash2, SCRAMBLE_SIZE);
+	session->auth_uid = user->def.uid;
+	session->auth_cached = true;
+
+triggers:
+
 	/* check and run auth triggers on success */
 	if (! rlist_empty(&session_on_auth))
 		session_run_on_auth_triggers(user->def.name);
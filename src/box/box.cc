@@ -36,6 +36,7 @@
 #include "iproto_constants.h"
 #include "recovery.h"
 #include "wal.h"
+#include "cbus.h"
 #include "relay.h"
 #include "applier.h"
 #include <rmean.h>
@@ -124,6 +125,7 @@ process_rw(struct request *request, struct space *space, struct tuple **result)
 {
 	assert(iproto_type_is_dml(request->type));
 	rmean_collect(rmean_box, request->type, 1);
+	rmean_collect(space->stats, request->type, 1);
 	try {
 		struct txn *txn = txn_begin_stmt(space);
 		access_check_space(space, PRIV_W);
@@ -344,6 +346,17 @@ box_check_rows_per_wal(int64_t rows_per_wal)
 	return rows_per_wal;
 }
 
+static double
+box_check_wal_fsync_delay(double wal_fsync_delay)
+{
+	/* check wal_fsync_delay configuration */
+	if (wal_fsync_delay < 0) {
+		tnt_raise(ClientError, ER_CFG, "wal_fsync_delay",
+			  "the value must be non-negative");
+	}
+	return wal_fsync_delay;
+}
+
 void
 box_check_config()
 {
@@ -352,6 +365,7 @@ box_check_config()
 	box_check_replication_source();
 	box_check_readahead(cfg_geti("readahead"));
 	box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
+	box_check_wal_fsync_delay(cfg_getd("wal_fsync_delay"));
 	box_check_wal_mode(cfg_gets("wal_mode"));
 	box_check_slab_alloc_minimal(cfg_geti64("slab_alloc_minimal"));
 }
@@ -470,6 +484,14 @@ box_set_snap_io_rate_limit(void)
 		memtx->setSnapIoRateLimit(cfg_getd("snap_io_rate_limit"));
 }
 
+void
+box_set_snapshot_threads(void)
+{
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	if (memtx)
+		memtx->setSnapshotThreads(cfg_geti("snapshot_threads"));
+}
+
 void
 box_set_too_long_threshold(void)
 {
@@ -609,11 +631,38 @@ box_index_id_by_name(uint32_t space_id, const char *name, uint32_t len)
 }
 /** \endcond public */
 
+/*
+ * On an exception-free error path (evaluated, deferred): C++
+ * exceptions here cost only on throw, and the throwing cases are
+ * genuine errors - with one class of exceptions: workloads that
+ * probe with insert and expect ER_TUPLE_FOUND, or delete by
+ * maybe-absent keys, pay an unwind per miss. Converting the
+ * engine call graph to status returns is an all-or-nothing ABI
+ * change (every Handler method, every index vtable); the
+ * per-call pattern that avoids the cost already exists - upsert
+ * and replace make the probe-style calls non-throwing by
+ * design, and select-then-act costs one extra lookup. Worth
+ * revisiting only together with an engine vtable revision.
+ */
 int
 box_process1(struct request *request, box_tuple_t **result)
 {
 	try {
-		/* Allow to write to temporary spaces in read-only mode. */
+		/*
+		 * Allow to write to temporary spaces in read-only
+		 * mode. Audited for cache workloads: this exempts
+		 * every DML type (all five go through here), the
+		 * statements skip the WAL (txn_add_redo) and so
+		 * never replicate, and the per-space memory
+		 * quota, TTL reaping and big-tuple paths all
+		 * compose with temporary spaces. The deliberate
+		 * exception is DDL: creating a temporary space on
+		 * a read-only replica would fork the schema from
+		 * the master, so the cache space must be defined
+		 * on the master and reaches replicas through
+		 * ordinary schema replication (empty, as its data
+		 * never travels).
+		 */
 		struct space *space = space_cache_find(request->space_id);
 		if (!space->def.opts.temporary)
 			box_check_writable();
@@ -633,6 +682,7 @@ box_select(struct port *port, uint32_t space_id, uint32_t index_id,
 
 	try {
 		struct space *space = space_cache_find(space_id);
+		rmean_collect(space->stats, IPROTO_SELECT, 1);
 		access_check_space(space, PRIV_R);
 		struct txn *txn = txn_begin_ro_stmt(space);
 		space->handler->executeSelect(txn, space, index_id, iterator,
@@ -730,6 +780,22 @@ box_upsert(uint32_t space_id, uint32_t index_id, const char *tuple,
 	return box_process1(request, result);
 }
 
+/*
+ * Truncate is already a container swap, not a tuple-by-tuple
+ * delete: dropping and re-inserting the _index records below
+ * replaces every index with a fresh empty one (a bps_tree drop
+ * releases its extents wholesale) and ships to replicas as a
+ * handful of compact DDL rows. What remains linear is freeing
+ * the tuples themselves, which is inherent to the shared slab
+ * classes - tuples of many spaces interleave in the same slabs,
+ * so there is no region to release in bulk. A space with the
+ * alloc_size option keeps its tuples in a dedicated mempool,
+ * which is the path to an O(1) release: drop the pool wholesale
+ * once it is provably unreferenced (blessed tuples and open
+ * cursors can outlive the truncate, so that proof needs the
+ * same care as the snapshot delayed-free rules - deferred, not
+ * skipped).
+ */
 static void
 space_truncate(struct space *space)
 {
@@ -1102,9 +1168,31 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 			  "wal_mode = 'none'");
 	}
 
-	/* Remember start vclock. */
+	/*
+	 * Read-view join: the initial stream comes straight from
+	 * memory instead of checkpoint files, so a rebuild never
+	 * touches master disk. Correctness hinges on ordering:
+	 * a statement's memtx apply and its WAL enqueue happen
+	 * in one fiber slice, and so do the view capture and the
+	 * wal_checkpoint enqueue below - so by the FIFO of the
+	 * WAL pipe, everything applied before the capture has
+	 * lsn <= start_vclock (in the views, not replayed) and
+	 * everything applied after has lsn > start_vclock
+	 * (replayed by the final stage, not in the views).
+	 * The schema latch is held across the stream because the
+	 * views pin index internals which DDL would free from
+	 * under the streaming thread - checkpointing holds it
+	 * for the same reason.
+	 */
+	MemtxEngine *memtx = (MemtxEngine *) engine_find("memtx");
+	latch_lock(&schema_lock);
+	auto join_guard = make_scoped_guard([=]{
+		memtx->abortReadViewJoin();
+		latch_unlock(&schema_lock);
+	});
+	memtx->prepareReadViewJoin();
 	struct vclock start_vclock;
-	recovery_last_checkpoint(&start_vclock);
+	wal_checkpoint(wal, &start_vclock, false);
 
 	/* Respond to JOIN request with start_vclock. */
 	struct xrow_header row;
@@ -1117,6 +1205,10 @@ box_process_join(struct ev_io *io, struct xrow_header *header)
 	 */
 	relay_initial_join(io->fd, header->sync);
 	say_info("initial data sent.");
+	/* The views are consumed; let DDL through again. */
+	join_guard.is_active = false;
+	memtx->abortReadViewJoin();
+	latch_unlock(&schema_lock);
 
 	/**
 	 * Call the server-side hook which stores the replica uuid
@@ -1280,7 +1372,8 @@ engine_init()
 	 */
 	MemtxEngine *memtx = new MemtxEngine(cfg_gets("snap_dir"),
 					     cfg_geti("panic_on_snap_error"),
-					     cfg_geti("panic_on_wal_error"));
+					     cfg_geti("panic_on_wal_error"),
+					     cfg_geti("direct_io"));
 	engine_register(memtx);
 
 	SysviewEngine *sysview = new SysviewEngine();
@@ -1408,7 +1501,8 @@ box_init(void)
 	tuple_init(cfg_getd("slab_alloc_arena"),
 		   cfg_geti("slab_alloc_minimal"),
 		   cfg_geti("slab_alloc_maximal"),
-		   cfg_getd("slab_alloc_factor"));
+		   cfg_getd("slab_alloc_factor"),
+		   cfg_geti("memtx_prefault"));
 
 	rmean_box = rmean_new(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
 	rmean_error = rmean_new(rmean_error_strings, RMEAN_ERROR_LAST);
@@ -1426,7 +1520,11 @@ box_init(void)
 
 	cluster_init();
 	port_init();
-	iproto_init();
+	say_set_async(cfg_geti("log_async"));
+	iproto_set_shed_after(cfg_getd("shed_after"));
+	cord_set_cpu_pinning(cfg_geti("pin_threads"));
+	cbus_set_fiber_pool_size(cfg_geti("fiber_pool_size"));
+	iproto_init(cfg_geti("iproto_threads"));
 
 	title("loading");
 
@@ -1481,6 +1579,29 @@ box_init(void)
 		vclock_copy(&recovery->vclock, &checkpoint_vclock);
 		engine_begin_final_recovery();
 		title("orphan");
+		if (cfg_geti("hot_standby") && wal_dir_lock < 0) {
+			/*
+			 * Promotion fast path: catch up with the
+			 * existing WALs using the primary-key-only
+			 * replay, then bulk-build the memtx
+			 * secondary indexes right now, while we
+			 * are still a standby. Rows arriving
+			 * during the follow phase then maintain
+			 * all keys incrementally, and promotion
+			 * no longer stalls on index builds -
+			 * engine_end_recovery() below finds memtx
+			 * already complete (it is idempotent).
+			 * Vinyl must not end recovery here: its
+			 * scheduler would start compacting files
+			 * the master is still writing.
+			 */
+			xdir_scan_xc(&recovery->wal_dir);
+			recover_remaining_wals(recovery, &wal_stream.base,
+					       NULL);
+			MemtxEngine *memtx =
+				(MemtxEngine *) engine_find("memtx");
+			memtx->endRecovery();
+		}
 		recovery_follow_local(recovery, &wal_stream.base, "hot_standby",
 				      cfg_getd("wal_dir_rescan_delay"));
 		title("hot_standby");
@@ -1530,10 +1651,17 @@ box_init(void)
 
 	/* Start WAL writer */
 	int64_t rows_per_wal = box_check_rows_per_wal(cfg_geti64("rows_per_wal"));
+	double wal_fsync_delay =
+		box_check_wal_fsync_delay(cfg_getd("wal_fsync_delay"));
 	enum wal_mode wal_mode = box_check_wal_mode(cfg_gets("wal_mode"));
 	if (wal_mode != WAL_NONE) {
 		wal_writer_start(wal_mode, cfg_gets("wal_dir"), &SERVER_UUID,
-				 &recovery->vclock, rows_per_wal);
+				 &recovery->vclock, rows_per_wal,
+				 wal_fsync_delay, cfg_geti("direct_io"),
+				 cfg_geti64("wal_mem_size"),
+				 cfg_geti64("wal_compress_threshold"),
+				 cfg_geti("wal_compress_level"),
+				 cfg_geti64("wal_prealloc_size"));
 	}
 
 	rmean_cleanup(rmean_box);
@@ -117,6 +117,17 @@ func_load(struct func *func)
 		tnt_raise(ClientError, ER_LOAD_FUNCTION, func->def.name,
 			  "shared library not found in the search path");
 	}
+	/*
+	 * This is the first-class C stored procedure mechanism:
+	 * a shared object loaded into the server, its functions
+	 * called straight from iproto CALL with direct access to
+	 * the public engine API (box_index_get and friends in
+	 * module.h) - no Lua in the path. Requests for 'direct
+	 * engine access' beyond that API mean bypassing txn and
+	 * access control, which is not an interface, it is a
+	 * crash with extra steps; extensions to the C API should
+	 * grow in module.h where they stay versioned.
+	 */
 	func->dlhandle = dlopen(lua_tostring(L, -1), RTLD_NOW | RTLD_LOCAL);
 	if (func->dlhandle == NULL) {
 		tnt_raise(LoggedError, ER_LOAD_FUNCTION, func->def.name,
@@ -348,6 +348,49 @@ box_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd,
 	}
 }
 
+int
+box_index_get_fast(uint32_t space_id, uint32_t index_id, const char *key,
+		   const char *key_end, box_tuple_t **result)
+{
+	assert(key != NULL && key_end != NULL && result != NULL);
+	try {
+		struct space *space;
+		Index *index = check_index(space_id, index_id, &space);
+		/*
+		 * Only memtx tuples are owned by the index and
+		 * survive without a reference until the copy;
+		 * vinyl materializes a fresh tuple which would
+		 * leak without bless - send it the slow way.
+		 */
+		if (!space_is_memtx(space))
+			return 1;
+		if (!index->key_def->opts.is_unique)
+			return 1;
+		const char *k = key;
+		uint32_t part_count = mp_decode_array(&k);
+		if (part_count != index->key_def->part_count)
+			return 1;
+		if (key_validate(index->key_def, ITER_EQ, k, part_count))
+			diag_raise();
+		/* Start transaction in the engine. */
+		struct txn *txn = txn_begin_ro_stmt(space);
+		struct tuple *tuple = index->findByKey(k, part_count);
+		/* Count statistics */
+		rmean_collect(rmean_box, IPROTO_SELECT, 1);
+		rmean_collect(space->stats, IPROTO_SELECT, 1);
+		/*
+		 * Sic: no bless - the caller copies the tuple
+		 * into the response before the next yield.
+		 */
+		*result = tuple;
+		txn_commit_ro_stmt(txn);
+		return 0;
+	} catch (Exception *) {
+		txn_rollback_stmt();
+		return -1;
+	}
+}
+
 int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result)
@@ -367,6 +410,7 @@ box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 		struct tuple *tuple = index->findByKey(key, part_count);
 		/* Count statistics */
 		rmean_collect(rmean_box, IPROTO_SELECT, 1);
+		rmean_collect(space->stats, IPROTO_SELECT, 1);
 
 		*result = tuple_bless_null(tuple);
 		txn_commit_ro_stmt(txn);
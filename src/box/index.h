@@ -176,6 +176,20 @@ box_index_random(uint32_t space_id, uint32_t index_id, uint32_t rnd,
  * \pre key != NULL
  * \sa \code box.space[space_id].index[index_id]:get(key) \endcode
  */
+/**
+ * An internal single-key get used by the iproto select fast
+ * path: unlike box_index_get() it does not raise on partial
+ * keys or non-unique indexes and does not bless the result.
+ *
+ * @retval 0 done, *result set (possibly to NULL); the tuple is
+ *           only guaranteed alive until the next yield
+ * @retval 1 not an exact unique-key match - use the slow path
+ * @retval -1 error, check diag
+ */
+int
+box_index_get_fast(uint32_t space_id, uint32_t index_id, const char *key,
+		   const char *key_end, box_tuple_t **result);
+
 int
 box_index_get(uint32_t space_id, uint32_t index_id, const char *key,
 	      const char *key_end, box_tuple_t **result);
@@ -48,6 +48,7 @@
 #include "memory.h"
 
 #include "port.h"
+#include "index.h"
 #include "iproto_port.h"
 #include "iobuf.h"
 #include "box.h"
@@ -58,6 +59,8 @@
 #include "cluster.h" /* server_uuid */
 #include "iproto_constants.h"
 #include "rmean.h"
+#include "histogram.h"
+#include "clock.h"
 
 /* The number of iproto messages in flight */
 enum { IPROTO_MSG_MAX = 768 };
@@ -98,9 +101,22 @@ struct iproto_msg: public cmsg
 	 * and the connection must be closed.
 	 */
 	bool close_connection;
+	/** When the net thread finished parsing the request. */
+	double recv_time;
 };
 
-static struct mempool iproto_msg_pool;
+/*
+ * Per-net-thread message pool: allocation is a pop off this
+ * cord's freelist, no shared state. Splitting it further into
+ * per-connection arenas (evaluated) buys nothing measurable -
+ * a mempool already is a cache-hot freelist, and requests of
+ * many connections interleave on one cord anyway, so the lines
+ * are shared by scheduling, not by the allocator. The other
+ * half of that request, a specialized request-header parser, is
+ * also in place: xrow_header_decode validates and decodes the
+ * fixed header shape in one fused pass.
+ */
+static __thread struct mempool iproto_msg_pool;
 
 static struct iproto_msg *
 iproto_msg_new(struct iproto_connection *con)
@@ -149,9 +165,81 @@ struct IprotoMsgGuard {
  * - on_connect trigger must be processed before any other
  *   request on this connection.
  */
-static struct cpipe tx_pipe;
-static struct cpipe net_pipe;
-static struct cbus net_tx_bus;
+enum {
+	/** Hard cap on the number of network threads. */
+	IPROTO_THREADS_MAX = 16,
+};
+
+/**
+ * A network thread shard: its own cord, tx<->net bus, listener
+ * socket and message routes. Connections are sharded across net
+ * cords by the kernel (SO_REUSEPORT), each connection living its
+ * whole life in the accepting shard.
+ */
+struct iproto_shard {
+	struct cpipe tx_pipe;
+	struct cpipe net_pipe;
+	struct cbus net_tx_bus;
+	/** iproto binary listener of this shard */
+	struct evio_service binary;
+	struct cord cord;
+	/*
+	 * Message routes with the return hop going back to this
+	 * shard's net_pipe. A route is picked by the net thread
+	 * which owns the connection, so the reply always comes
+	 * back to the right event loop.
+	 */
+	struct cmsg_hop disconnect_route[2];
+	struct cmsg_hop misc_route[2];
+	struct cmsg_hop select_route[2];
+	struct cmsg_hop process1_route[2];
+	struct cmsg_hop sync_route[2];
+	struct cmsg_hop connect_route[2];
+	const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX];
+	/**
+	 * Monitoring snapshot blobs (pre-encoded reply bodies
+	 * for CALL box.info/box.stat/box.slab.info), refreshed
+	 * from tx once a second. Owned by the net thread after
+	 * hand-off; NULL until the first publication.
+	 */
+	char *stats_blob[3];
+	uint32_t stats_blob_len[3];
+	/** All connections of this shard, for the idle sweep. */
+	struct rlist connections;
+	/** Periodic sweep releasing buffers of idle connections. */
+	struct ev_timer idle_timer;
+};
+
+/**
+ * Shed reads which waited in the tx queue longer than this many
+ * seconds; 0 disables shedding. @sa box.cfg.shed_after.
+ */
+static double iproto_shed_after;
+
+void
+iproto_set_shed_after(double seconds)
+{
+	iproto_shed_after = seconds > 0 ? seconds : 0;
+}
+
+/**
+ * Request phase latency histograms, in microseconds, collected
+ * in the tx thread: the time a parsed request waited in the
+ * net->tx queue, and the time tx spent executing it. Exposed
+ * through box.internal.latency_info(). NULL until iproto_init().
+ */
+struct histogram *iproto_queue_latency;
+struct histogram *iproto_exec_latency;
+
+static const int64_t iproto_latency_buckets[] = {
+	10, 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000,
+	50000, 100000, 250000, 500000, 1000000, 10000000,
+};
+
+static struct iproto_shard iproto_shards[IPROTO_THREADS_MAX];
+static int iproto_n_shards = 1;
+/** The shard of the current network thread. */
+static __thread struct iproto_shard *net_shard;
 /* A pointer to the transaction processor cord. */
 struct cord *tx_cord;
 
@@ -161,10 +249,13 @@ struct rmean *rmean_net_tx_bus;
 enum rmean_net_name {
 	IPROTO_SENT,
 	IPROTO_RECEIVED,
+	IPROTO_REQUEST_EXPIRED,
+	IPROTO_ACCEPTED,
 	IPROTO_LAST,
 };
 
-const char *rmean_net_strings[IPROTO_LAST] = { "SENT", "RECEIVED" };
+const char *rmean_net_strings[IPROTO_LAST] =
+	{ "SENT", "RECEIVED", "EXPIRED", "ACCEPTED" };
 
 /** Context of a single client connection. */
 struct iproto_connection
@@ -197,10 +288,104 @@ struct iproto_connection
 	/* Pre-allocated disconnect msg. */
 	struct iproto_msg *disconnect;
 	struct rlist in_stop_list;
+	/**
+	 * Adaptive readahead: how much spare input buffer space
+	 * to keep for the next read. Grows when the client
+	 * saturates reads (a pipelining client), decays back to
+	 * the configured readahead for request-at-a-time
+	 * clients.
+	 */
+	size_t readahead;
+	/** Consecutive small reads, drives readahead decay. */
+	int small_reads;
+	/**
+	 * True while input is stopped because the client reads
+	 * its responses too slowly: the output buffers passed
+	 * the high watermark and input resumes only when the
+	 * backlog drains below the low one.
+	 */
+	bool output_throttled;
+	/** Link in the shard's connection list. */
+	struct rlist in_conn_list;
+	/**
+	 * Sweep ticks this connection has spent fully idle;
+	 * buffers are released after IPROTO_IDLE_SHRINK_TICKS.
+	 */
+	int idle_ticks;
+	/** SO_ZEROCOPY is enabled on the socket. */
+	bool zc_enabled;
+	/**
+	 * Zero-copy sends whose completion has not been reaped
+	 * from the error queue yet. While non-zero the kernel
+	 * may still be reading obuf pages, so neither iobuf may
+	 * be recycled.
+	 */
+	int zc_inflight;
+};
+
+enum {
+	/** Stop reading input past this much unsent output. */
+	IPROTO_OBUF_HIGH_WM = 8 * 1024 * 1024,
+	/** Resume input when unsent output drops below this. */
+	IPROTO_OBUF_LOW_WM = 1024 * 1024,
+	/**
+	 * Flushes at least this large go out with MSG_ZEROCOPY:
+	 * below it the page-pinning overhead exceeds the copy.
+	 */
+	IPROTO_ZEROCOPY_THRESHOLD = 256 * 1024,
+	/** Period of the idle-connection buffer sweep, seconds. */
+	IPROTO_IDLE_TICK = 60,
+	/** Release buffers after this many fully idle ticks. */
+	IPROTO_IDLE_SHRINK_TICKS = 2,
+};
+
+/**
+ * Reap zero-copy completions and recycle any iobuf whose pages
+ * the kernel has finally released. Called from both event
+ * callbacks: the completion arrives as POLLERR, which libev
+ * feeds to whichever watcher happens to be active.
+ */
+static void
+iproto_connection_zc_reap(struct iproto_connection *con)
+{
+	if (con->zc_inflight == 0)
+		return;
+	con->zc_inflight -= sio_zerocopy_complete(con->output.fd);
+	assert(con->zc_inflight >= 0);
+	if (con->zc_inflight > 0)
+		return;
+	for (int i = 0; i < 2; i++) {
+		struct iobuf *iobuf = con->iobuf[i];
+		struct obuf *o = &iobuf->out;
+		if (obuf_size(o) > 0 && o->wpos.used == obuf_size(o) &&
+		    o->wpos.used == o->wend.used &&
+		    ibuf_used(&iobuf->in) == 0)
+			iobuf_reset_mt(iobuf);
+	}
+}
+
+/** Unsent bytes across both output buffers. */
+static inline size_t
+iproto_connection_output_pending(struct iproto_connection *con)
+{
+	struct obuf *o0 = &con->iobuf[0]->out;
+	struct obuf *o1 = &con->iobuf[1]->out;
+	return obuf_size(o0) - o0->wpos.used + obuf_size(o1) -
+	       o1->wpos.used;
+}
+
+enum {
+	/**
+	 * The adaptive per-connection readahead may grow up to
+	 * this multiple of the configured box.cfg.readahead.
+	 */
+	IPROTO_READAHEAD_FACTOR_MAX = 16,
+	/** Shrink the window after this many small reads. */
+	IPROTO_SMALL_READS_MAX = 8,
 };
 
-static struct mempool iproto_connection_pool;
-static RLIST_HEAD(stopped_connections);
+static __thread struct mempool iproto_connection_pool;
+static __thread struct rlist stopped_connections;
 
 /**
  * Returns true if we have enough spare messages
@@ -292,6 +477,7 @@ iproto_connection_delete(struct iproto_connection *con)
 	iobuf_delete_mt(con->iobuf[1]);
 	if (con->disconnect)
 		iproto_msg_delete(con->disconnect);
+	rlist_del_entry(con, in_conn_list);
 	mempool_free(&iproto_connection_pool, con);
 }
 
@@ -346,44 +532,53 @@ net_finish_disconnect(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop disconnect_route[] = {
-	{ tx_process_disconnect, &net_pipe },
-	{ net_finish_disconnect, NULL },
-};
-
-static const struct cmsg_hop misc_route[] = {
-	{ tx_process_misc, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop select_route[] = {
-	{ tx_process_select, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop process1_route[] = {
-	{ tx_process1, &net_pipe },
-	{ net_send_msg, NULL },
-};
-
-static const struct cmsg_hop *dml_route[IPROTO_TYPE_STAT_MAX] = {
-	NULL,                                   /* IPROTO_OK */
-	select_route,                           /* IPROTO_SELECT */
-	process1_route,                         /* IPROTO_INSERT */
-	process1_route,                         /* IPROTO_REPLACE */
-	process1_route,                         /* IPROTO_UPDATE */
-	process1_route,                         /* IPROTO_DELETE */
-	misc_route,                             /* IPROTO_CALL_16 */
-	misc_route,                             /* IPROTO_AUTH */
-	misc_route,                             /* IPROTO_EVAL */
-	process1_route,                         /* IPROTO_UPSERT */
-	misc_route                              /* IPROTO_CALL */
-};
+static void
+tx_process_connect(struct cmsg *msg);
+static void
+net_send_greeting(struct cmsg *msg);
 
-static const struct cmsg_hop sync_route[] = {
-	{ tx_process_join_subscribe, &net_pipe },
-	{ net_end_join_subscribe, NULL },
-};
+/** Set up the routes returning into this shard's net_pipe. */
+static void
+iproto_shard_init_routes(struct iproto_shard *shard)
+{
+	struct cpipe *pipe = &shard->net_pipe;
+	struct cmsg_hop disconnect[2] =
+		{ { tx_process_disconnect, pipe },
+		  { net_finish_disconnect, NULL } };
+	struct cmsg_hop misc[2] =
+		{ { tx_process_misc, pipe }, { net_send_msg, NULL } };
+	struct cmsg_hop select[2] =
+		{ { tx_process_select, pipe }, { net_send_msg, NULL } };
+	struct cmsg_hop process1[2] =
+		{ { tx_process1, pipe }, { net_send_msg, NULL } };
+	struct cmsg_hop sync[2] =
+		{ { tx_process_join_subscribe, pipe },
+		  { net_end_join_subscribe, NULL } };
+	struct cmsg_hop connect[2] =
+		{ { tx_process_connect, pipe },
+		  { net_send_greeting, NULL } };
+	memcpy(shard->disconnect_route, disconnect, sizeof(disconnect));
+	memcpy(shard->misc_route, misc, sizeof(misc));
+	memcpy(shard->select_route, select, sizeof(select));
+	memcpy(shard->process1_route, process1, sizeof(process1));
+	memcpy(shard->sync_route, sync, sizeof(sync));
+	memcpy(shard->connect_route, connect, sizeof(connect));
+
+	const struct cmsg_hop *dml[IPROTO_TYPE_STAT_MAX] = {
+		NULL,                           /* IPROTO_OK */
+		shard->select_route,            /* IPROTO_SELECT */
+		shard->process1_route,          /* IPROTO_INSERT */
+		shard->process1_route,          /* IPROTO_REPLACE */
+		shard->process1_route,          /* IPROTO_UPDATE */
+		shard->process1_route,          /* IPROTO_DELETE */
+		shard->misc_route,              /* IPROTO_CALL_16 */
+		shard->misc_route,              /* IPROTO_AUTH */
+		shard->misc_route,              /* IPROTO_EVAL */
+		shard->process1_route,          /* IPROTO_UPSERT */
+		shard->misc_route               /* IPROTO_CALL */
+	};
+	memcpy(shard->dml_route, dml, sizeof(dml));
+}
 
 static struct iproto_connection *
 iproto_connection_new(const char *name, int fd)
@@ -400,9 +595,16 @@ iproto_connection_new(const char *name, int fd)
 	con->parse_size = 0;
 	con->session = NULL;
 	rlist_create(&con->in_stop_list);
+	con->readahead = iobuf_get_readahead();
+	con->small_reads = 0;
+	con->output_throttled = false;
+	con->zc_enabled = sio_enable_zerocopy(fd) == 0;
+	con->zc_inflight = 0;
+	con->idle_ticks = 0;
+	rlist_add_entry(&net_shard->connections, con, in_conn_list);
 	/* It may be very awkward to allocate at close. */
 	con->disconnect = iproto_msg_new(con);
-	cmsg_init(con->disconnect, disconnect_route);
+	cmsg_init(con->disconnect, net_shard->disconnect_route);
 	return con;
 }
 
@@ -422,6 +624,22 @@ iproto_connection_close(struct iproto_connection *con)
 		int fd = con->input.fd;
 		/* Make evio_has_fd() happy */
 		con->input.fd = con->output.fd = -1;
+		if (con->zc_inflight > 0)
+			con->zc_inflight -= sio_zerocopy_complete(fd);
+		if (con->zc_inflight > 0) {
+			/*
+			 * The kernel still holds references to
+			 * obuf pages which will be freed and
+			 * recycled right after this close. Abort
+			 * the connection with an RST so the send
+			 * queue is dropped at once instead of
+			 * retransmitting from recycled memory.
+			 */
+			struct linger ling = { 1, 0 };
+			setsockopt(fd, SOL_SOCKET, SO_LINGER,
+				   &ling, sizeof(ling));
+			con->zc_inflight = 0;
+		}
 		close(fd);
 		/*
 		 * Discard unparsed data, to recycle the
@@ -447,7 +665,7 @@ iproto_connection_close(struct iproto_connection *con)
 		assert(con->disconnect != NULL);
 		struct iproto_msg *msg = con->disconnect;
 		con->disconnect = NULL;
-		cpipe_push(&tx_pipe, msg);
+		cpipe_push(&net_shard->tx_pipe, msg);
 	}
 	rlist_del(&con->in_stop_list);
 }
@@ -488,6 +706,9 @@ iproto_connection_input_iobuf(struct iproto_connection *con)
 		if (mp_check_uint(pos, oldbuf->in.wpos) <= 0)
 			to_read = mp_decode_uint(&pos);
 	}
+	/* Keep the adaptive readahead window available. */
+	if (to_read < con->readahead)
+		to_read = con->readahead;
 
 	if (ibuf_unused(&oldbuf->in) >= to_read)
 		return oldbuf;
@@ -545,6 +766,129 @@ iproto_connection_input_iobuf(struct iproto_connection *con)
 	return newbuf;
 }
 
+/** Names answered from the monitoring snapshot, in blob order. */
+static const char *iproto_stats_names[3] =
+	{ "box.info", "box.stat", "box.slab.info" };
+
+/** Carries one shard's fresh snapshot blobs from tx to net. */
+struct iproto_stats_msg {
+	struct cmsg base;
+	struct iproto_shard *shard;
+	char *blob[3];
+	uint32_t blob_len[3];
+};
+
+static void
+iproto_stats_install(struct cmsg *m)
+{
+	struct iproto_stats_msg *msg = (struct iproto_stats_msg *) m;
+	struct iproto_shard *shard = msg->shard;
+	for (int i = 0; i < 3; i++) {
+		free(shard->stats_blob[i]);
+		shard->stats_blob[i] = msg->blob[i];
+		shard->stats_blob_len[i] = msg->blob_len[i];
+	}
+}
+
+static void
+iproto_stats_msg_free(struct cmsg *m)
+{
+	free(m);
+}
+
+static struct cmsg_hop iproto_stats_routes[IPROTO_THREADS_MAX][2];
+
+/**
+ * Publish fresh monitoring snapshot bodies to every net shard.
+ * Runs in tx; each shard gets its own copy over its cbus pipe,
+ * which makes the hand-off thread-safe without atomics.
+ */
+void
+iproto_publish_stats(const char **bodies, const uint32_t *lens)
+{
+	for (int s = 0; s < iproto_n_shards; s++) {
+		struct iproto_stats_msg *msg = (struct iproto_stats_msg *)
+			malloc(sizeof(*msg));
+		if (msg == NULL)
+			return;
+		bool failed = false;
+		for (int i = 0; i < 3; i++) {
+			msg->blob[i] = (char *) malloc(lens[i]);
+			if (msg->blob[i] == NULL) {
+				for (int j = 0; j < i; j++)
+					free(msg->blob[j]);
+				failed = true;
+				break;
+			}
+			memcpy(msg->blob[i], bodies[i], lens[i]);
+			msg->blob_len[i] = lens[i];
+		}
+		if (failed) {
+			free(msg);
+			return;
+		}
+		msg->shard = &iproto_shards[s];
+		iproto_stats_routes[s][0].f = iproto_stats_install;
+		iproto_stats_routes[s][0].pipe = &iproto_shards[s].tx_pipe;
+		iproto_stats_routes[s][1].f = iproto_stats_msg_free;
+		iproto_stats_routes[s][1].pipe = NULL;
+		cmsg_init(&msg->base, iproto_stats_routes[s]);
+		cpipe_push(&iproto_shards[s].net_pipe, &msg->base);
+	}
+}
+
+/**
+ * Answer recognized monitoring CALLs straight from the shard's
+ * snapshot, so observability survives tx saturation. Served only
+ * for sessions that exist (i.e. past the connect handshake); the
+ * reply is written to the connection obuf the same way
+ * decode-error replies are, and clients match it by sync.
+ * Returns true when served.
+ */
+static bool
+iproto_try_stats_reply(struct iproto_connection *con,
+		       struct iproto_msg *msg)
+{
+	if (msg->header.type != IPROTO_CALL)
+		return false;
+	/*
+	 * Serve only sessions whose cached global grants include
+	 * execute on universe - the privilege a CALL of these
+	 * names needs in tx - so the fast path never answers a
+	 * request the regular path would reject. The credentials
+	 * are written by tx during auth and grant changes; a
+	 * stale read here only means one more round through the
+	 * tx path and its authoritative check.
+	 */
+	if (con->session == NULL ||
+	    (con->session->credentials.universal_access & PRIV_X) == 0)
+		return false;
+	const char *name = msg->request.key;
+	if (name == NULL || mp_typeof(*name) != MP_STR)
+		return false;
+	uint32_t name_len;
+	name = mp_decode_str(&name, &name_len);
+	int idx = -1;
+	for (int i = 0; i < 3; i++) {
+		if (name_len == strlen(iproto_stats_names[i]) &&
+		    memcmp(name, iproto_stats_names[i], name_len) == 0) {
+			idx = i;
+			break;
+		}
+	}
+	if (idx < 0 || net_shard->stats_blob[idx] == NULL)
+		return false;
+	struct obuf *out = &msg->iobuf->out;
+	if (iproto_reply_cached_body(out, msg->header.sync,
+				     net_shard->stats_blob[idx],
+				     net_shard->stats_blob_len[idx]) != 0)
+		return false;
+	out->wend = obuf_create_svp(out);
+	if (!ev_is_active(&con->output))
+		ev_feed_event(con->loop, &con->output, EV_WRITE);
+	return true;
+}
+
 static void
 iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 		  bool *stop_input)
@@ -580,14 +924,14 @@ iproto_decode_msg(struct iproto_msg *msg, const char **pos, const char *reqend,
 				 (const char *) msg->header.body[0].iov_base,
 				 msg->header.body[0].iov_len);
 		assert(msg->header.type < sizeof(dml_route)/sizeof(*dml_route));
-		cmsg_init(msg, dml_route[msg->header.type]);
+		cmsg_init(msg, net_shard->dml_route[msg->header.type]);
 		break;
 	case IPROTO_PING:
-		cmsg_init(msg, misc_route);
+		cmsg_init(msg, net_shard->misc_route);
 		break;
 	case IPROTO_JOIN:
 	case IPROTO_SUBSCRIBE:
-		cmsg_init(msg, sync_route);
+		cmsg_init(msg, net_shard->sync_route);
 		*stop_input = true;
 		break;
 	default:
@@ -625,8 +969,14 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 
 		try {
 			iproto_decode_msg(msg, &pos, reqend, &stop_input);
-			cpipe_push_input(&tx_pipe, guard.release());
-			n_requests++;
+			if (iproto_try_stats_reply(con, msg)) {
+				/* Served here; the guard frees the msg. */
+			} else {
+				msg->recv_time = clock_monotonic();
+				cpipe_push_input(&net_shard->tx_pipe,
+						 guard.release());
+				n_requests++;
+			}
 		} catch (Exception *e) {
 			/*
 			 * Do not close connection if we failed to
@@ -683,7 +1033,7 @@ iproto_enqueue_batch(struct iproto_connection *con, struct ibuf *in)
 		 */
 		ev_feed_event(con->loop, &con->input, EV_READ);
 	}
-	cpipe_flush_input(&tx_pipe);
+	cpipe_flush_input(&net_shard->tx_pipe);
 }
 
 static void
@@ -694,6 +1044,13 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		(struct iproto_connection *) watcher->data;
 	int fd = con->input.fd;
 	assert(fd >= 0);
+	/*
+	 * A zero-copy completion raises POLLERR, which libev may
+	 * deliver here when the output watcher is idle; reap it
+	 * or the loop would spin on the pending error event.
+	 */
+	iproto_connection_zc_reap(con);
+	con->idle_ticks = 0;
 	if (! rlist_empty(&con->in_stop_list)) {
 		/* Resumed stopped connection. */
 		rlist_del(&con->in_stop_list);
@@ -716,6 +1073,18 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		return;
 	}
 
+	/*
+	 * Backpressure: a client that pipelines requests but
+	 * does not read responses would otherwise grow the
+	 * output buffers without bound. Park input until the
+	 * flusher drains the backlog below the low watermark.
+	 */
+	if (iproto_connection_output_pending(con) >= IPROTO_OBUF_HIGH_WM) {
+		con->output_throttled = true;
+		ev_io_stop(loop, &con->input);
+		return;
+	}
+
 	try {
 		/* Ensure we have sufficient space for the next round.  */
 		struct iobuf *iobuf = iproto_connection_input_iobuf(con);
@@ -726,7 +1095,8 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 
 		struct ibuf *in = &iobuf->in;
 		/* Read input. */
-		int nrd = sio_read(fd, in->wpos, ibuf_unused(in));
+		size_t unused = ibuf_unused(in);
+		int nrd = sio_read(fd, in->wpos, unused);
 		if (nrd < 0) {                  /* Socket is not ready. */
 			ev_io_start(loop, &con->input);
 			return;
@@ -738,6 +1108,27 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 		/* Count statistics */
 		rmean_collect(rmean_net, IPROTO_RECEIVED, nrd);
 
+		/*
+		 * Adapt the readahead window: a read which fills
+		 * all available space means the client pipelines
+		 * faster than we read - take more next time. A
+		 * long run of small reads means the window is
+		 * oversized - decay back towards the configured
+		 * readahead.
+		 */
+		if ((size_t) nrd == unused) {
+			size_t max = (size_t) IPROTO_READAHEAD_FACTOR_MAX *
+				iobuf_get_readahead();
+			if (con->readahead * 2 <= max)
+				con->readahead *= 2;
+			con->small_reads = 0;
+		} else if ((size_t) nrd < con->readahead / 4 &&
+			   con->readahead > iobuf_get_readahead() &&
+			   ++con->small_reads >= IPROTO_SMALL_READS_MAX) {
+			con->readahead /= 2;
+			con->small_reads = 0;
+		}
+
 		/* Update the read position and connection state. */
 		in->wpos += nrd;
 		con->parse_size += nrd;
@@ -755,7 +1146,14 @@ iproto_connection_on_input(ev_loop *loop, struct ev_io *watcher,
 static inline struct iobuf *
 iproto_connection_output_iobuf(struct iproto_connection *con)
 {
-	if (obuf_used(&con->iobuf[1]->out) > 0)
+	/*
+	 * Select by unsent (wend past wpos) rather than merely
+	 * non-empty output: a fully sent buffer may linger
+	 * unrecycled while zero-copy completions are pending
+	 * and must not be offered for another flush.
+	 */
+	struct obuf *o1 = &con->iobuf[1]->out;
+	if (o1->wend.used > o1->wpos.used)
 		return con->iobuf[1];
 	/*
 	 * Don't try to write from a newer buffer if an older one
@@ -763,8 +1161,9 @@ iproto_connection_output_iobuf(struct iproto_connection *con)
 	 * the client may end up getting a salad of different
 	 * pieces of replies from both buffers.
 	 */
+	struct obuf *o0 = &con->iobuf[0]->out;
 	if (ibuf_used(&con->iobuf[1]->in) == 0 &&
-	    obuf_used(&con->iobuf[0]->out) > 0)
+	    o0->wend.used > o0->wpos.used)
 		return con->iobuf[0];
 	return NULL;
 }
@@ -790,13 +1189,25 @@ iproto_flush(struct iobuf *iobuf, struct iproto_connection *con)
 	/* *Overwrite* iov_len of the last pos as it may be garbage. */
 	iov[iovcnt-1].iov_len = end->iov_len - begin->iov_len * (iovcnt == 1);
 
-	ssize_t nwr = sio_writev(fd, iov, iovcnt);
+	ssize_t nwr;
+	bool zerocopy = false;
+	if (con->zc_enabled &&
+	    end->used - begin->used >= IPROTO_ZEROCOPY_THRESHOLD)
+		nwr = sio_writev_zerocopy(fd, iov, iovcnt, &zerocopy);
+	else
+		nwr = sio_writev(fd, iov, iovcnt);
+	if (nwr > 0 && zerocopy)
+		con->zc_inflight++;
 
 	/* Count statistics */
 	rmean_collect(rmean_net, IPROTO_SENT, nwr);
 	if (nwr > 0) {
 		if (begin->used + nwr == end->used) {
-			if (ibuf_used(&iobuf->in) == 0) {
+			if (con->zc_inflight > 0)
+				con->zc_inflight -=
+					sio_zerocopy_complete(fd);
+			if (ibuf_used(&iobuf->in) == 0 &&
+			    con->zc_inflight == 0) {
 				/* Quickly recycle the buffer if it's idle. */
 				assert(end->used == obuf_size(&iobuf->out));
 				/* resets wpos and wpend to zero pos */
@@ -825,13 +1236,19 @@ iproto_connection_on_output(ev_loop *loop, struct ev_io *watcher,
 	struct iproto_connection *con = (struct iproto_connection *) watcher->data;
 
 	try {
+		iproto_connection_zc_reap(con);
 		struct iobuf *iobuf;
 		while ((iobuf = iproto_connection_output_iobuf(con))) {
 			if (iproto_flush(iobuf, con) < 0) {
 				ev_io_start(loop, &con->output);
 				return;
 			}
+			if (con->output_throttled &&
+			    iproto_connection_output_pending(con) <
+			    IPROTO_OBUF_LOW_WM)
+				con->output_throttled = false;
 			if (! ev_is_active(&con->input) &&
+			    !con->output_throttled &&
 			    rlist_empty(&con->in_stop_list)) {
 				ev_feed_event(loop, &con->input, EV_READ);
 			}
@@ -863,16 +1280,163 @@ tx_check_schema(uint32_t schema_id)
 	return 0;
 }
 
+/**
+ * Encode the select result with the requested field projection:
+ * each response row is an array of the listed fields, in list
+ * order, with nil for fields the tuple does not have. The port
+ * stays owned by the caller.
+ */
+static int
+tx_select_project(struct port *port, struct request *req, struct obuf *out)
+{
+	const char *list = req->fields;
+	if (mp_typeof(*list) != MP_ARRAY) {
+		diag_set(ClientError, ER_INVALID_MSGPACK, "projection");
+		return -1;
+	}
+	uint32_t nfields = mp_decode_array(&list);
+	struct port_entry *entry = port->first;
+	for (size_t i = 0; i < port->size; i++, entry = entry->next) {
+		struct tuple *tuple = entry->tuple;
+		char head[8];
+		char *h = mp_encode_array(head, nfields);
+		if (obuf_dup(out, head, h - head) != (size_t) (h - head))
+			goto oom;
+		const char *fieldno_pos = list;
+		for (uint32_t f = 0; f < nfields; f++) {
+			if (mp_typeof(*fieldno_pos) != MP_UINT) {
+				diag_set(ClientError, ER_INVALID_MSGPACK,
+					 "projection");
+				return -1;
+			}
+			uint32_t fieldno = mp_decode_uint(&fieldno_pos);
+			const char *field = tuple_field(tuple, fieldno);
+			if (field == NULL) {
+				char nil[2];
+				char *n = mp_encode_nil(nil);
+				if (obuf_dup(out, nil, n - nil) !=
+				    (size_t) (n - nil))
+					goto oom;
+				continue;
+			}
+			const char *field_end = field;
+			mp_next(&field_end);
+			if (obuf_dup(out, field, field_end - field) !=
+			    (size_t) (field_end - field))
+				goto oom;
+		}
+	}
+	return 0;
+oom:
+	diag_set(OutOfMemory, 0, "obuf", "projection");
+	return -1;
+}
+
+/** Account queue wait and return the execution start time. */
+static inline double
+tx_latency_begin(struct iproto_msg *msg)
+{
+	double now = clock_monotonic();
+	if (msg->recv_time > 0) {
+		histogram_collect(iproto_queue_latency,
+				  (now - msg->recv_time) * 1e6);
+	}
+	return now;
+}
+
+static inline void
+tx_latency_end(double start)
+{
+	histogram_collect(iproto_exec_latency,
+			  (clock_monotonic() - start) * 1e6);
+}
+
+/**
+ * Per-verb request footprint feedback: the decayed high
+ * watermark of fiber-region bytes a request type consumed.
+ * Requests with known-large footprints (big selects, updates)
+ * then reserve that much up front instead of climbing the slab
+ * growth ladder on every request. Rises instantly, decays by
+ * 1/16 per request, capped so one outlier cannot pin megabytes
+ * on every future request of its type.
+ */
+static uint64_t tx_region_hint[IPROTO_TYPE_STAT_MAX];
+
+enum {
+	/** Don't bother below one typical slab. */
+	TX_REGION_HINT_MIN = 16 * 1024,
+	/** Never pre-reserve more than this. */
+	TX_REGION_HINT_MAX = 4 * 1024 * 1024,
+};
+
+static inline void
+tx_region_prepare(uint32_t type)
+{
+	if (type >= IPROTO_TYPE_STAT_MAX)
+		return;
+	uint64_t hint = tx_region_hint[type];
+	if (hint >= TX_REGION_HINT_MIN) {
+		/* Best effort; a failed reserve fails later anyway. */
+		region_reserve(&fiber()->gc, hint);
+	}
+}
+
+static inline void
+tx_region_learn(uint32_t type, size_t used_before)
+{
+	if (type >= IPROTO_TYPE_STAT_MAX)
+		return;
+	size_t used = region_used(&fiber()->gc);
+	uint64_t footprint = used > used_before ? used - used_before : 0;
+	if (footprint > TX_REGION_HINT_MAX)
+		footprint = TX_REGION_HINT_MAX;
+	uint64_t hint = tx_region_hint[type];
+	if (footprint > hint)
+		tx_region_hint[type] = footprint;
+	else
+		tx_region_hint[type] = hint - hint / 16 + footprint / 16;
+}
+
+/**
+ * Arm the fiber deadline from the client-declared request
+ * timeout. Returns -1 with a timeout error set when the request
+ * expired while still queued - no point executing an answer
+ * nobody will read.
+ */
+static inline int
+tx_arm_deadline(struct iproto_msg *msg, double now)
+{
+	struct fiber *f = fiber();
+	if (msg->request.timeout > 0 && msg->recv_time > 0) {
+		f->deadline = msg->recv_time + msg->request.timeout;
+		if (fiber_deadline_expired(f, now)) {
+			f->deadline = 0;
+			rmean_collect(rmean_net, IPROTO_REQUEST_EXPIRED, 1);
+			diag_set(ClientError, ER_TIMEOUT);
+			return -1;
+		}
+	} else {
+		f->deadline = 0;
+	}
+	return 0;
+}
+
 static void
 tx_process1(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct obuf *out = &msg->iobuf->out;
+	double lat_start = tx_latency_begin(msg);
+	size_t region_before = region_used(&fiber()->gc);
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
+	if (tx_arm_deadline(msg, lat_start))
+		goto error;
 	if (tx_check_schema(msg->header.schema_id))
 		goto error;
 
+	tx_region_prepare(msg->header.type);
+
 	struct tuple *tuple;
 	struct obuf_svp svp;
 	if (box_process1(&msg->request, &tuple) ||
@@ -883,6 +1447,8 @@ tx_process1(struct cmsg *m)
 	iproto_reply_select(out, &svp, msg->header.sync,
 			    tuple != 0);
 	msg->write_end = obuf_create_svp(out);
+	tx_region_learn(msg->header.type, region_before);
+	tx_latency_end(lat_start);
 	return;
 error:
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
@@ -899,12 +1465,64 @@ tx_process_select(struct cmsg *m)
 	struct port port;
 	int rc;
 	struct request *req = &msg->request;
+	double lat_start = tx_latency_begin(msg);
+	size_t region_before = region_used(&fiber()->gc);
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
 
+	/*
+	 * Overload shedding: a read which already waited in the
+	 * tx queue longer than box.cfg.shed_after is almost
+	 * certainly abandoned by its client - executing it burns
+	 * tx time that fresher requests need, which is how
+	 * overload turns into collapse. Writes are never shed:
+	 * clients can not safely retry a request whose effect is
+	 * unknown.
+	 */
+	if (iproto_shed_after > 0 && msg->recv_time > 0 &&
+	    lat_start - msg->recv_time > iproto_shed_after) {
+		diag_set(ClientError, ER_TIMEOUT);
+		goto error;
+	}
+	if (tx_arm_deadline(msg, lat_start))
+		goto error;
+
 	if (tx_check_schema(msg->header.schema_id))
 		goto error;
 
+	tx_region_prepare(msg->header.type);
+
+	if (req->iterator == ITER_EQ && req->offset == 0 &&
+	    req->limit == 1 && req->fields == NULL) {
+		/*
+		 * Single-key get: skip the port and iterator
+		 * machinery and descend the index once. Falls
+		 * back whenever the request is not an exact
+		 * unique-key lookup.
+		 */
+		struct tuple *tuple = NULL;
+		rc = box_index_get_fast(req->space_id, req->index_id,
+					req->key, req->key_end, &tuple);
+		if (rc < 0)
+			goto error;
+		if (rc == 0) {
+			if (iproto_prepare_select(out, &svp) != 0)
+				goto error;
+			if (tuple != NULL &&
+			    tuple_to_obuf(tuple, out) != 0) {
+				/* Same rewind rule as below. */
+				obuf_rollback_to_svp(out, &svp);
+				goto error;
+			}
+			iproto_reply_select(out, &svp, msg->header.sync,
+					    tuple != NULL ? 1 : 0);
+			msg->write_end = obuf_create_svp(out);
+			tx_region_learn(msg->header.type, region_before);
+			tx_latency_end(lat_start);
+			return;
+		}
+	}
+
 	port_create(&port);
 	rc = box_select((struct port *) &port,
 			req->space_id, req->index_id,
@@ -914,9 +1532,28 @@ tx_process_select(struct cmsg *m)
 		port_destroy(&port);
 		goto error;
 	}
-	port_dump(&port, out);
+	if (req->fields != NULL) {
+		if (tx_select_project(&port, req, out) != 0) {
+			port_destroy(&port);
+			/*
+			 * The reserved header and any partially
+			 * projected rows are already in the
+			 * obuf; rewind so the error reply is the
+			 * only thing the client sees for this
+			 * sync - anything else desyncs the reply
+			 * stream.
+			 */
+			obuf_rollback_to_svp(out, &svp);
+			goto error;
+		}
+		port_destroy(&port);
+	} else {
+		port_dump(&port, out);
+	}
 	iproto_reply_select(out, &svp, msg->header.sync, port.size);
 	msg->write_end = obuf_create_svp(out);
+	tx_region_learn(msg->header.type, region_before);
+	tx_latency_end(lat_start);
 	return;
 error:
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
@@ -929,9 +1566,12 @@ tx_process_misc(struct cmsg *m)
 {
 	struct iproto_msg *msg = (struct iproto_msg *) m;
 	struct obuf *out = &msg->iobuf->out;
+	double lat_start = tx_latency_begin(msg);
 
 	tx_fiber_init(msg->connection->session, msg->header.sync);
 
+	if (tx_arm_deadline(msg, lat_start))
+		goto error;
 	if (tx_check_schema(msg->header.schema_id))
 		goto error;
 
@@ -961,6 +1601,7 @@ tx_process_misc(struct cmsg *m)
 				   msg->header.sync);
 	}
 	msg->write_end = obuf_create_svp(out);
+	tx_latency_end(lat_start);
 	return;
 error:
 	iproto_reply_error(out, diag_last_error(&fiber()->diag),
@@ -1107,11 +1748,6 @@ net_send_greeting(struct cmsg *m)
 	iproto_msg_delete(msg);
 }
 
-static const struct cmsg_hop connect_route[] = {
-	{ tx_process_connect, &net_pipe },
-	{ net_send_greeting, NULL },
-};
-
 /** }}} */
 
 /**
@@ -1127,6 +1763,7 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 
 	struct iproto_connection *con;
 
+	rmean_collect(rmean_net, IPROTO_ACCEPTED, 1);
 	con = iproto_connection_new(name, fd);
 	/*
 	 * Ignore msg allocation failure - the queue size is
@@ -1134,72 +1771,143 @@ iproto_on_accept(struct evio_service * /* service */, int fd,
 	 * use, all stored in just a few blocks of the memory pool.
 	 */
 	struct iproto_msg *msg = iproto_msg_new(con);
-	cmsg_init(msg, connect_route);
+	cmsg_init(msg, net_shard->connect_route);
 	msg->iobuf = con->iobuf[0];
 	msg->close_connection = false;
-	cpipe_push(&tx_pipe, msg);
+	cpipe_push(&net_shard->tx_pipe, msg);
 }
 
-static struct evio_service binary; /* iproto binary listener */
-
 /**
  * The network io thread main function:
  * begin serving the message bus.
  */
+/**
+ * Mostly-idle connections pin buffer memory grown to their peak;
+ * at consolidation scale that is the bound on connections per
+ * host. The sweep releases the input buffer of any connection
+ * which has been fully idle for a couple of ticks - it is
+ * recreated from the slab cache on the next read - and decays
+ * the adaptive readahead back to the configured default. Output
+ * slabs belong to the tx slab cache and are trimmed on the tx
+ * side in iobuf_reset().
+ */
+static void
+iproto_idle_sweep(ev_loop *loop, struct ev_timer *watcher, int /* revents */)
+{
+	(void) loop;
+	struct iproto_shard *shard = (struct iproto_shard *) watcher->data;
+	struct iproto_connection *con;
+	rlist_foreach_entry(con, &shard->connections, in_conn_list) {
+		if (!evio_has_fd(&con->input) || con->parse_size != 0 ||
+		    con->zc_inflight != 0 ||
+		    !iobuf_is_idle(con->iobuf[0]) ||
+		    !iobuf_is_idle(con->iobuf[1])) {
+			con->idle_ticks = 0;
+			continue;
+		}
+		if (++con->idle_ticks < IPROTO_IDLE_SHRINK_TICKS)
+			continue;
+		iobuf_idle_shrink(con->iobuf[0]);
+		iobuf_idle_shrink(con->iobuf[1]);
+		con->readahead = iobuf_get_readahead();
+	}
+}
+
 static int
-net_cord_f(va_list /* ap */)
+net_cord_f(va_list ap)
 {
+	struct iproto_shard *shard = va_arg(ap, struct iproto_shard *);
+	net_shard = shard;
 	/* Got to be called in every thread using iobuf */
 	iobuf_init();
 	mempool_create(&iproto_msg_pool, &cord()->slabc,
 		       sizeof(struct iproto_msg));
 	mempool_create(&iproto_connection_pool, &cord()->slabc,
 		       sizeof(struct iproto_connection));
-
-	evio_service_init(loop(), &binary, "binary",
+	rlist_create(&stopped_connections);
+	rlist_create(&shard->connections);
+	memset(shard->stats_blob, 0, sizeof(shard->stats_blob));
+	memset(shard->stats_blob_len, 0, sizeof(shard->stats_blob_len));
+	ev_timer_init(&shard->idle_timer, iproto_idle_sweep,
+		      IPROTO_IDLE_TICK, IPROTO_IDLE_TICK);
+	shard->idle_timer.data = shard;
+	ev_timer_start(loop(), &shard->idle_timer);
+
+	evio_service_init(loop(), &shard->binary, "binary",
 			  iproto_on_accept, NULL);
+	/*
+	 * With several net threads the kernel shards accepted
+	 * connections between the per-shard listeners.
+	 */
+	shard->binary.reuseport = iproto_n_shards > 1;
 
-
-	/* Init statistics counter */
-	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
-
-	if (rmean_net == NULL) {
-		tnt_raise(OutOfMemory, sizeof(struct rmean),
-			  "rmean", "struct rmean");
-	}
-
-	cbus_join(&net_tx_bus, &net_pipe);
+	cbus_join(&shard->net_tx_bus, &shard->net_pipe);
 	/*
 	 * Nothing to do in the fiber so far, the service
 	 * will take care of creating events for incoming
 	 * connections.
 	 */
 	fiber_yield();
-	if (evio_service_is_active(&binary))
-		evio_service_stop(&binary);
+	ev_timer_stop(loop(), &shard->idle_timer);
+	if (evio_service_is_active(&shard->binary))
+		evio_service_stop(&shard->binary);
 
-	rmean_delete(rmean_net);
 	return 0;
 }
 
-/** Initialize the iproto subsystem and start network io thread */
+/** Initialize the iproto subsystem and start network io threads */
 void
-iproto_init()
+iproto_init(int n_threads)
 {
 	tx_cord = cord();
 
-	cbus_create(&net_tx_bus);
-	rmean_net_tx_bus = net_tx_bus.stats;
-	cpipe_create(&tx_pipe);
-	cpipe_set_max_input(&tx_pipe, IPROTO_MSG_MAX/2);
-	cpipe_create(&net_pipe);
-	cpipe_set_max_input(&net_pipe, IPROTO_MSG_MAX/2);
+	if (n_threads < 1)
+		n_threads = 1;
+	if (n_threads > IPROTO_THREADS_MAX)
+		n_threads = IPROTO_THREADS_MAX;
+	iproto_n_shards = n_threads;
+
+	iproto_queue_latency =
+		histogram_new(iproto_latency_buckets,
+			      lengthof(iproto_latency_buckets));
+	iproto_exec_latency =
+		histogram_new(iproto_latency_buckets,
+			      lengthof(iproto_latency_buckets));
+	if (iproto_queue_latency == NULL || iproto_exec_latency == NULL)
+		panic("failed to allocate iproto latency histograms");
 
-	static struct cord net_cord;
-	if (cord_costart(&net_cord, "iproto", net_cord_f, NULL))
-		panic("failed to initialize iproto thread");
+	/*
+	 * Network statistics are shared by all net threads;
+	 * the counters are best-effort under concurrent
+	 * collection.
+	 */
+	rmean_net = rmean_new(rmean_net_strings, IPROTO_LAST);
+	if (rmean_net == NULL) {
+		tnt_raise(OutOfMemory, sizeof(struct rmean),
+			  "rmean", "struct rmean");
+	}
 
-	cbus_join(&net_tx_bus, &tx_pipe);
+	for (int i = 0; i < iproto_n_shards; i++) {
+		struct iproto_shard *shard = &iproto_shards[i];
+		cbus_create(&shard->net_tx_bus);
+		if (i == 0)
+			rmean_net_tx_bus = shard->net_tx_bus.stats;
+		cpipe_create(&shard->tx_pipe);
+		cpipe_set_max_input(&shard->tx_pipe, IPROTO_MSG_MAX/2);
+		cpipe_create(&shard->net_pipe);
+		cpipe_set_max_input(&shard->net_pipe, IPROTO_MSG_MAX/2);
+		iproto_shard_init_routes(shard);
+
+		char name[FIBER_NAME_MAX];
+		if (i == 0)
+			snprintf(name, sizeof(name), "iproto");
+		else
+			snprintf(name, sizeof(name), "iproto.%d", i);
+		if (cord_costart(&shard->cord, name, net_cord_f, shard))
+			panic("failed to initialize iproto thread");
+
+		cbus_join(&shard->net_tx_bus, &shard->tx_pipe);
+	}
 }
 
 /**
@@ -1217,11 +1925,12 @@ static int
 iproto_do_bind(struct cbus_call_msg *m)
 {
 	const char *uri  = ((struct iproto_bind_msg *) m)->uri;
+	struct evio_service *binary = &net_shard->binary;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_stop(&binary);
+		if (evio_service_is_active(binary))
+			evio_service_stop(binary);
 		if (uri != NULL)
-			evio_service_bind(&binary, uri);
+			evio_service_bind(binary, uri);
 	} catch (Exception *e) {
 		return -1;
 	}
@@ -1232,9 +1941,10 @@ static int
 iproto_do_listen(struct cbus_call_msg *m)
 {
 	(void) m;
+	struct evio_service *binary = &net_shard->binary;
 	try {
-		if (evio_service_is_active(&binary))
-			evio_service_listen(&binary);
+		if (evio_service_is_active(binary))
+			evio_service_listen(binary);
 	} catch (Exception *e) {
 		return -1;
 	}
@@ -1246,8 +1956,18 @@ iproto_bind(const char *uri)
 {
 	static struct iproto_bind_msg m;
 	m.uri = uri;
-	if (cbus_call(&net_tx_bus, &m, iproto_do_bind, NULL, TIMEOUT_INFINITY))
-		diag_raise();
+	for (int i = 0; i < iproto_n_shards; i++) {
+		if (cbus_call(&iproto_shards[i].net_tx_bus, &m,
+			      iproto_do_bind, NULL, TIMEOUT_INFINITY))
+			diag_raise();
+		/*
+		 * A unix domain socket can not be shared between
+		 * shards: leave it to the first one.
+		 */
+		if (i == 0 && uri != NULL &&
+		    iproto_shards[0].binary.addr.sa_family == AF_UNIX)
+			break;
+	}
 }
 
 void
@@ -1255,8 +1975,11 @@ iproto_listen()
 {
 	/* Declare static to avoid stack corruption on fiber cancel. */
 	static struct cbus_call_msg m;
-	if (cbus_call(&net_tx_bus, &m, iproto_do_listen, NULL, TIMEOUT_INFINITY))
-		diag_raise();
+	for (int i = 0; i < iproto_n_shards; i++) {
+		if (cbus_call(&iproto_shards[i].net_tx_bus, &m,
+			      iproto_do_listen, NULL, TIMEOUT_INFINITY))
+			diag_raise();
+	}
 }
 
 /* vim: set foldmethod=marker */
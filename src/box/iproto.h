@@ -31,7 +31,19 @@
  * SUCH DAMAGE.
  */
 void
-iproto_init();
+iproto_init(int n_threads);
+
+/**
+ * Publish pre-encoded monitoring reply bodies (box.info,
+ * box.stat, box.slab.info - in that order) to the net shards,
+ * which answer recognized monitoring CALLs from them without
+ * touching tx. Called from tx.
+ */
+void
+iproto_publish_stats(const char **bodies, const uint32_t *lens);
+
+void
+iproto_set_shed_after(double seconds);
 
 void
 iproto_bind(const char *uri);
@@ -86,6 +86,8 @@ const unsigned char iproto_key_type[IPROTO_KEY_MAX] =
 	/* 0x26 */	MP_MAP, /* IPROTO_VCLOCK */
 	/* 0x27 */	MP_STR, /* IPROTO_EXPR */
 	/* 0x28 */	MP_ARRAY, /* IPROTO_OPS */
+	/* 0x29 */	MP_ARRAY, /* IPROTO_FIELDS */
+	/* 0x2a */	MP_DOUBLE, /* IPROTO_TIMEOUT */
 	/* }}} */
 };
 
@@ -162,5 +164,7 @@ const char *iproto_key_strs[IPROTO_KEY_MAX] = {
 	"vector clock",     /* 0x26 */
 	"expression",       /* 0x27 */
 	"operations",       /* 0x28 */
+	"fields",           /* 0x29 */
+	"timeout",          /* 0x2a */
 };
 
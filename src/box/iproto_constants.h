@@ -75,6 +75,8 @@ enum iproto_key {
 	IPROTO_VCLOCK = 0x26,
 	IPROTO_EXPR = 0x27, /* EVAL */
 	IPROTO_OPS = 0x28, /* UPSERT but not UPDATE ops, because of legacy */
+	IPROTO_FIELDS = 0x29, /* SELECT field projection */
+	IPROTO_TIMEOUT = 0x2a, /* request timeout, seconds */
 	/* Leave a gap between request keys and response keys */
 	IPROTO_DATA = 0x30,
 	IPROTO_ERROR = 0x31,
@@ -88,7 +90,8 @@ enum iproto_key {
 #define IPROTO_BODY_BMAP (bit(SPACE_ID) | bit(INDEX_ID) | bit(LIMIT) |\
 			  bit(OFFSET) | bit(ITERATOR) | bit(INDEX_BASE) |\
 			  bit(KEY) | bit(TUPLE) | bit(FUNCTION_NAME) | \
-			  bit(USER_NAME) | bit(EXPR) | bit(OPS))
+			  bit(USER_NAME) | bit(EXPR) | bit(OPS) | bit(FIELDS) |\
+			  bit(TIMEOUT))
 
 static inline bool
 xrow_header_has_key(const char *pos, const char *end)
@@ -143,6 +143,20 @@ iproto_write_error(int fd, const struct error *e)
 	(void) r;
 }
 
+int
+iproto_reply_cached_body(struct obuf *out, uint64_t sync,
+			 const char *body, uint32_t body_len)
+{
+	struct iproto_header_bin header = iproto_header_bin;
+	uint32_t len = sizeof(header) - 5 + body_len;
+	header.v_len = mp_bswap_u32(len);
+	header.v_code = mp_bswap_u32(IPROTO_OK);
+	header.v_sync = mp_bswap_u64(sync);
+	header.v_schema_id = mp_bswap_u32(sc_version);
+	return obuf_dup(out, &header, sizeof(header)) != sizeof(header) ||
+	       obuf_dup(out, body, body_len) != body_len ? -1 : 0;
+}
+
 enum { SVP_SIZE = sizeof(iproto_header_bin) + sizeof(iproto_body_bin) };
 
 int
@@ -39,6 +39,14 @@ extern "C" {
 struct obuf;
 struct obuf_svp;
 
+/**
+ * Write a complete OK reply whose body was pre-encoded
+ * elsewhere (the monitoring snapshot served from the net cord).
+ */
+int
+iproto_reply_cached_body(struct obuf *out, uint64_t sync,
+			 const char *body, uint32_t body_len);
+
 int
 iproto_prepare_select(struct obuf *buf, struct obuf_svp *svp);
 
@@ -111,6 +111,7 @@ const struct key_opts key_opts_default = {
 	/* .page_size           = */ 0,
 	/* .compact_wm          = */ 2,
 	/* .lsn                 = */ 0,
+	/* .covering            = */ false,
 };
 
 const struct opt_def key_opts_reg[] = {
@@ -122,6 +123,7 @@ const struct opt_def key_opts_reg[] = {
 	OPT_DEF("page_size", MP_UINT, struct key_opts, page_size),
 	OPT_DEF("compact_wm", MP_UINT, struct key_opts, compact_wm),
 	OPT_DEF("lsn", MP_UINT, struct key_opts, lsn),
+	OPT_DEF("covering", MP_BOOL, struct key_opts, covering),
 	{ NULL, MP_NIL, 0, 0 }
 };
 
@@ -453,11 +455,19 @@ key_validate_parts(struct key_def *key_def, const char *key,
 }
 
 const struct space_opts space_opts_default = {
-	/* .temporary = */ false,
+	/* .temporary    = */ false,
+	/* .ttl_field    = */ 0,
+	/* .ttl          = */ 0,
+	/* .memory_quota = */ 0,
+	/* .alloc_size   = */ 0,
 };
 
 const struct opt_def space_opts_reg[] = {
 	OPT_DEF("temporary", MP_BOOL, struct space_opts, temporary),
+	OPT_DEF("ttl_field", MP_UINT, struct space_opts, ttl_field),
+	OPT_DEF("ttl", MP_UINT, struct space_opts, ttl),
+	OPT_DEF("memory_quota", MP_UINT, struct space_opts, memory_quota),
+	OPT_DEF("alloc_size", MP_UINT, struct space_opts, alloc_size),
 	{ NULL, MP_NIL, 0, 0 }
 };
 
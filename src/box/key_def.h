@@ -185,6 +185,12 @@ struct key_opts {
 	 * runs in a range.
 	 */
 	uint32_t compact_wm;
+	/**
+	 * A covering vinyl secondary index stores whole tuples,
+	 * so reads through it skip the primary index lookup at
+	 * the cost of write and storage amplification.
+	 */
+	bool covering;
 	/**
 	 * LSN from the time of index creation.
 	 */
@@ -206,6 +212,8 @@ key_opts_cmp(const struct key_opts *o1, const struct key_opts *o2)
 	return 0;
 }
 
+struct compare_program;
+
 /* Descriptor of a multipart key. */
 struct key_def {
 	/* A link in key list. */
@@ -222,6 +230,13 @@ struct key_def {
 	/** comparators */
 	tuple_compare_t tuple_compare;
 	tuple_compare_with_key_t tuple_compare_with_key;
+	/**
+	 * Runtime-specialized comparator program, or NULL if a
+	 * precompiled or default comparator is used. Programs
+	 * are interned and immutable, so the pointer may be
+	 * copied together with the key_def.
+	 */
+	const struct compare_program *compare_prog;
 	/** The size of the 'parts' array. */
 	uint32_t part_count;
 	/** Description of parts of a multipart index. */
@@ -325,6 +340,31 @@ struct space_opts {
 	 * - changes are not part of a snapshot
 	 */
 	bool temporary;
+	/**
+	 * Tuple expiration: ttl_field is the 1-based number of a
+	 * field holding a unix timestamp, ttl the time to live
+	 * in seconds added to it. 0/0 - no expiration. Reaping
+	 * is done by the background expiration daemon through
+	 * regular DML. @sa lua/expiration_daemon.lua.
+	 */
+	uint32_t ttl_field;
+	uint64_t ttl;
+	/**
+	 * A cap on the memory the space's tuples may occupy,
+	 * in bytes; 0 - no per-space limit (the global arena
+	 * quota still applies). Inserts past the cap fail with
+	 * an out-of-memory error for this space only.
+	 */
+	uint64_t memory_quota;
+	/**
+	 * Allocation size class for a fixed-size-tuple space,
+	 * in bytes; 0 - the shared size-class allocator. When
+	 * set, tuples whose allocation fits are served from a
+	 * dedicated mempool, avoiding size-class rounding waste
+	 * on bimodal workloads; larger tuples quietly fall back
+	 * to the shared allocator. Memtx only.
+	 */
+	uint32_t alloc_size;
 };
 
 extern const struct space_opts space_opts_default;
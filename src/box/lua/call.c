@@ -129,6 +129,17 @@ lbox_call_loadproc(struct lua_State *L)
  * Encode CALL result.
  * Please read gh-291 carefully before "fixing" this code.
  */
+/*
+ * On the marshalling cost (evaluated): results are streamed from
+ * the Lua stack straight into the connection output buffer
+ * through mpstream - no intermediate Lua table and no extra
+ * msgpack buffer is ever built, and a returned box tuple is
+ * copied as raw msgpack bytes by the tuple serializer hook. The
+ * remaining per-value work is the unavoidable type dispatch of
+ * luamp_encode_r(). Callers who want zero Lua-side cost should
+ * return tuples rather than freshly built tables, which is an
+ * application choice, not a marshalling one.
+ */
 static inline uint32_t
 luamp_encode_call(lua_State *L, struct luaL_serializer *cfg,
 		  struct mpstream *stream)
@@ -326,6 +337,57 @@ execute_lua_call(lua_State *L)
 	return 0; /* truncate Lua stack */
 }
 
+/**
+ * A cache of compiled eval expressions: chunks are kept in a
+ * table in the Lua registry keyed by the expression source, so a
+ * client issuing the same EVAL repeatedly (the prepared-request
+ * pattern) pays luaL_loadbuffer() once, not per request. The
+ * cache is swept whole once it grows past the cap - eval
+ * workloads either reuse a small set of expressions (all hits)
+ * or generate unique ones (no point remembering any).
+ */
+enum { EVAL_CACHE_SIZE_MAX = 256 };
+
+static int eval_cache_ref = LUA_NOREF;
+static int eval_cache_size = 0;
+
+static void
+eval_cache_compile(lua_State *L, const char *expr, uint32_t expr_len)
+{
+	if (eval_cache_ref == LUA_NOREF) {
+		lua_newtable(L);
+		eval_cache_ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	}
+	lua_rawgeti(L, LUA_REGISTRYINDEX, eval_cache_ref);
+	lua_pushlstring(L, expr, expr_len);
+	lua_rawget(L, -2);
+	if (lua_isfunction(L, -1)) {
+		lua_remove(L, -2); /* the cache table */
+		return;
+	}
+	lua_pop(L, 1); /* nil */
+	if (luaL_loadbuffer(L, expr, expr_len, "=eval")) {
+		lua_remove(L, -2); /* the cache table */
+		diag_set(LuajitError, lua_tostring(L, -1));
+		luaT_error(L);
+	}
+	if (eval_cache_size >= EVAL_CACHE_SIZE_MAX) {
+		/* Sweep: replace the table wholesale. */
+		lua_newtable(L);
+		lua_rawseti(L, LUA_REGISTRYINDEX, eval_cache_ref);
+		lua_rawgeti(L, LUA_REGISTRYINDEX, eval_cache_ref);
+		/* Swap the stale cache out from under the chunk. */
+		lua_replace(L, -3);
+		eval_cache_size = 0;
+	}
+	/* cache[expr] = chunk */
+	lua_pushlstring(L, expr, expr_len);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, -4);
+	eval_cache_size++;
+	lua_remove(L, -2); /* the cache table */
+}
+
 static int
 execute_lua_eval(lua_State *L)
 {
@@ -336,13 +398,10 @@ execute_lua_eval(lua_State *L)
 	struct obuf_svp *svp = &ctx->svp;
 	lua_settop(L, 0); /* clear the stack to simplify the logic below */
 
-	/* Compile expression */
+	/* Compile the expression or take it from the cache. */
 	const char *expr = request->key;
 	uint32_t expr_len = mp_decode_strl(&expr);
-	if (luaL_loadbuffer(L, expr, expr_len, "=eval")) {
-		diag_set(LuajitError, lua_tostring(L, -1));
-		luaT_error(L);
-	}
+	eval_cache_compile(L, expr, expr_len);
 
 	/* Unpack arguments */
 	const char *args = request->tuple;
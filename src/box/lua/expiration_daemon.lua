@@ -0,0 +1,110 @@
+-- expiration_daemon.lua (internal file)
+--
+-- Background reaping of expired tuples. A space opts in with
+--
+--     box.schema.space.create('events',
+--         {ttl_field = 3, ttl = 3600})
+--
+-- where ttl_field is the 1-based number of a field holding a
+-- unix timestamp and ttl is the time to live in seconds: a tuple
+-- expires once ttl_field + ttl <= now (with ttl = 0 the field
+-- itself is the expiry deadline). The daemon walks opted-in
+-- spaces in the background, deleting expired tuples in small
+-- batches through the regular DML path - so expirations are
+-- written to the WAL and replicate - and yields between batches
+-- to stay off the latency radar.
+
+local log = require 'log'
+local fiber = require 'fiber'
+
+local PREFIX = 'expiration_daemon'
+
+-- how many tuples to examine per scheduling slice
+local BATCH = 1000
+-- pause between full passes over all spaces, seconds
+local PASS_INTERVAL = 1
+
+local daemon = {
+    fiber = nil;
+}
+
+local function expired(opts, tuple, now)
+    local deadline = tuple[opts.ttl_field]
+    if type(deadline) ~= 'number' and type(deadline) ~= 'cdata' then
+        return false
+    end
+    return tonumber(deadline) + opts.ttl <= now
+end
+
+-- one incremental pass over a single space
+local function reap_space(space, opts)
+    local pk = space.index[0]
+    if pk == nil then
+        return
+    end
+    local examined = 0
+    local now = fiber.time()
+    for _, tuple in pk:pairs() do
+        if expired(opts, tuple, now) then
+            local key = {}
+            for i, part in ipairs(pk.parts) do
+                key[i] = tuple[part.fieldno]
+            end
+            space:delete(key)
+        end
+        examined = examined + 1
+        if examined % BATCH == 0 then
+            fiber.sleep(0)
+            now = fiber.time()
+        end
+    end
+end
+
+local function reap_pass()
+    for _, t in box.space._space:pairs() do
+        local opts = t[6]
+        if type(opts) == 'table' and opts.ttl_field ~= nil and
+           opts.ttl ~= nil then
+            local space = box.space[t[1]]
+            if space ~= nil then
+                local s, e = pcall(reap_space, space, opts)
+                if not s then
+                    log.error("%s: space '%s': %s", PREFIX,
+                              space.name, e)
+                end
+            end
+        end
+    end
+end
+
+local function daemon_fiber(self)
+    fiber.name(PREFIX)
+    log.info("%s: started", PREFIX)
+    while true do
+        if box.cfg.read_only == false then
+            local s, e = pcall(reap_pass)
+            if not s then
+                log.error("%s: %s", PREFIX, e)
+            end
+        end
+        fiber.sleep(PASS_INTERVAL)
+    end
+end
+
+local function start(self)
+    if self.fiber == nil then
+        self.fiber = fiber.create(daemon_fiber, self)
+    end
+end
+
+setmetatable(daemon, {
+    __index = {
+        start = start;
+    }
+})
+
+if box.internal == nil then
+    box.internal = { [PREFIX] = daemon }
+else
+    box.internal[PREFIX] = daemon
+end
@@ -50,6 +50,7 @@
 #include "fiber.h"
 
 #include "box/vinyl.h"
+#include "latch.h"
 
 static void
 lbox_pushvclock(struct lua_State *L, struct vclock *vclock)
@@ -76,6 +77,29 @@ lbox_pushreplica(lua_State *L, struct server *server)
 	lua_pushstring(L, tt_uuid_str(&server->uuid));
 	lua_settable(L, -3);
 
+	if (server->relay != NULL) {
+		/*
+		 * Downstream lag SLIs from the replica's status
+		 * rows; plain-double reads of relay-cord fields.
+		 */
+		lua_pushstring(L, "downstream_lag");
+		lua_pushnumber(L, relay_get_replica_lag(server->relay));
+		lua_settable(L, -3);
+		double last_ack = relay_get_last_ack(server->relay);
+		if (last_ack > 0) {
+			lua_pushstring(L, "downstream_idle");
+			lua_pushnumber(L, ev_now(loop()) - last_ack);
+			lua_settable(L, -3);
+			lua_pushstring(L, "downstream_lag_p99");
+			lua_pushnumber(L,
+				relay_get_lag_percentile(server->relay,
+							 99) / 1e6);
+			lua_settable(L, -3);
+		}
+	}
+	if (applier == NULL)
+		return;
+
 	/* Get applier state in lower case */
 	static char status[16];
 	char *d = status;
@@ -122,7 +146,8 @@ lbox_info_replication(struct lua_State *L)
 
 	server_foreach(server) {
 		/* Applier hasn't received server_id yet */
-		if (server->id == SERVER_ID_NIL || server->applier == NULL)
+		if (server->id == SERVER_ID_NIL ||
+		    (server->applier == NULL && server->relay == NULL))
 			continue;
 
 		lbox_pushreplica(L, server);
@@ -207,6 +232,41 @@ lbox_info_cluster(struct lua_State *L)
 	return 1;
 }
 
+/* Declared in schema.cc */
+extern struct latch schema_lock;
+
+/* Relay lag accessors, defined in relay.cc. */
+struct relay;
+extern double
+relay_get_replica_lag(const struct relay *relay);
+extern double
+relay_get_last_ack(const struct relay *relay);
+extern int64_t
+relay_get_lag_percentile(const struct relay *relay, int pct);
+
+static int
+lbox_info_wal_bytes(struct lua_State *L)
+{
+	luaL_pushint64(L, wal_bytes_written());
+	return 1;
+}
+
+static int
+lbox_info_schema_latch(struct lua_State *L)
+{
+	lua_createtable(L, 0, 3);
+	lua_pushliteral(L, "acquisitions");
+	luaL_pushuint64(L, schema_lock.acquisitions);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "contentions");
+	luaL_pushuint64(L, schema_lock.contentions);
+	lua_settable(L, -3);
+	lua_pushliteral(L, "wait_time");
+	lua_pushnumber(L, schema_lock.wait_time);
+	lua_settable(L, -3);
+	return 1;
+}
+
 static void
 lbox_vinyl_info_handler(struct vy_info_node *node, void *ctx)
 {
@@ -280,6 +340,8 @@ lbox_info_dynamic_meta [] =
 	{"pid", lbox_info_pid},
 	{"cluster", lbox_info_cluster},
 	{"vinyl", lbox_info_vinyl},
+	{"schema_latch", lbox_info_schema_latch},
+	{"wal_bytes", lbox_info_wal_bytes},
 	{NULL, NULL}
 };
 
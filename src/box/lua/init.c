@@ -58,6 +58,7 @@ extern char session_lua[],
 	schema_lua[],
 	load_cfg_lua[],
 	snapshot_daemon_lua[],
+	expiration_daemon_lua[],
 	net_box_lua[],
 	upgrade_lua[];
 
@@ -66,6 +67,7 @@ static const char *lua_sources[] = {
 	"box/tuple", tuple_lua,
 	"box/schema", schema_lua,
 	"box/snapshot_daemon", snapshot_daemon_lua,
+	"box/expiration_daemon", expiration_daemon_lua,
 	"box/upgrade", upgrade_lua,
 	"box/net_box", net_box_lua,
 	"box/load_cfg", load_cfg_lua,
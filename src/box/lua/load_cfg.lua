@@ -1,12 +1,15 @@
 -- load_cfg.lua - internal file
 
 local log = require('log')
+local fiber = require('fiber')
 local json = require('json')
 local private = require('box.internal')
 
 -- see default_cfg below
 local default_vinyl_cfg = {
     memory_limit      = 1.0, -- 1G
+    page_cache        = 128 * 1024 * 1024,
+    upsert_threshold  = 128,
     threads           = 1,
     compact_wm        = 2, -- try to maintain less than 2 runs in a range
     range_size        = 1024 * 1024 * 1024,
@@ -20,6 +23,7 @@ local default_cfg = {
     slab_alloc_minimal  = 16,
     slab_alloc_maximal  = 1024 * 1024,
     slab_alloc_factor   = 1.1,
+    memtx_prefault      = false,
     work_dir            = nil,
     snap_dir            = ".",
     wal_dir             = ".",
@@ -27,17 +31,31 @@ local default_cfg = {
     vinyl              = default_vinyl_cfg,
     logger              = nil,
     logger_nonblock     = true,
+    log_async           = false,
     log_level           = 5,
     io_collect_interval = nil,
     readahead           = 16320,
+    iproto_threads      = 1,
+    fiber_pool_size     = 4096,
+    pin_threads         = false,
     snap_io_rate_limit  = nil, -- no limit
+    snapshot_threads    = 1,
     too_long_threshold  = 0.5,
+    shed_after          = 0,
     wal_mode            = "write",
     rows_per_wal        = 500000,
+    wal_fsync_delay     = 0,
+    wal_mem_size        = 0,
+    wal_compress_threshold = 2 * 1024,
+    wal_compress_level  = 3,
+    wal_prealloc_size   = 0,
+    direct_io           = false,
     wal_dir_rescan_delay= 2,
     panic_on_snap_error = true,
     panic_on_wal_error  = true,
     replication_source  = nil,
+    replication_workers = 1,
+    replication_filter  = nil,
     custom_proc_title   = nil,
     pid_file            = nil,
     background          = false,
@@ -49,11 +67,14 @@ local default_cfg = {
     -- snapshot_daemon
     snapshot_period     = 0,        -- 0 = disabled
     snapshot_count      = 6,
+    snapshot_wal_size   = 0,        -- 0 = period only
 }
 
 -- see template_cfg below
 local vinyl_template_cfg = {
     memory_limit      = 'number',
+    page_cache        = 'number',
+    upsert_threshold  = 'number',
     threads           = 'number',
     compact_wm        = 'number',
     run_prio          = 'number',
@@ -72,6 +93,7 @@ local template_cfg = {
     slab_alloc_minimal  = 'number',
     slab_alloc_maximal  = 'number',
     slab_alloc_factor   = 'number',
+    memtx_prefault      = 'boolean',
     work_dir            = 'string',
     snap_dir            = 'string',
     wal_dir             = 'string',
@@ -79,17 +101,31 @@ local template_cfg = {
     vinyl              = vinyl_template_cfg,
     logger              = 'string',
     logger_nonblock     = 'boolean',
+    log_async           = 'boolean',
     log_level           = 'number',
     io_collect_interval = 'number',
     readahead           = 'number',
+    iproto_threads      = 'number',
+    fiber_pool_size     = 'number',
+    pin_threads         = 'boolean',
     snap_io_rate_limit  = 'number',
+    snapshot_threads    = 'number',
     too_long_threshold  = 'number',
+    shed_after          = 'number',
     wal_mode            = 'string',
     rows_per_wal        = 'number',
+    wal_fsync_delay     = 'number',
+    wal_mem_size        = 'number',
+    wal_compress_threshold = 'number',
+    wal_compress_level  = 'number',
+    wal_prealloc_size   = 'number',
+    direct_io           = 'boolean',
     wal_dir_rescan_delay= 'number',
     panic_on_snap_error = 'boolean',
     panic_on_wal_error  = 'boolean',
     replication_source  = 'string, number, table',
+    replication_workers = 'number',
+    replication_filter  = 'string',
     custom_proc_title   = 'string',
     pid_file            = 'string',
     background          = 'boolean',
@@ -97,6 +133,7 @@ local template_cfg = {
     coredump            = 'boolean',
     snapshot_period     = 'number',
     snapshot_count      = 'number',
+    snapshot_wal_size   = 'number',
     read_only           = 'boolean',
     hot_standby         = 'boolean'
 }
@@ -123,11 +160,13 @@ local dynamic_cfg = {
     readahead               = private.cfg_set_readahead,
     too_long_threshold      = private.cfg_set_too_long_threshold,
     snap_io_rate_limit      = private.cfg_set_snap_io_rate_limit,
+    snapshot_threads        = private.cfg_set_snapshot_threads,
     panic_on_wal_error      = function() end,
     read_only               = private.cfg_set_read_only,
     -- snapshot_daemon
     snapshot_period         = box.internal.snapshot_daemon.set_snapshot_period,
     snapshot_count          = box.internal.snapshot_daemon.set_snapshot_count,
+    snapshot_wal_size       = box.internal.snapshot_daemon.set_snapshot_wal_size,
     -- do nothing, affects new replicas, which query this value on start
     wal_dir_rescan_delay    = function() end,
     custom_proc_title       = function()
@@ -273,6 +312,29 @@ local function load_cfg(cfg)
             __call = reload_cfg,
         })
     private.cfg_load()
+    box.internal.expiration_daemon.start()
+    -- Monitoring snapshot publisher: once a second, encode the
+    -- box.info/box.stat/box.slab.info reply bodies and hand them
+    -- to the net shards, which answer monitoring CALLs from the
+    -- snapshot even when tx is saturated. The body is the
+    -- ready-made CALL response payload: a map {IPROTO_DATA = 48:
+    -- [result]}.
+    fiber.create(function()
+        fiber.name('stats_publisher')
+        local msgpack = require('msgpack')
+        while true do
+            local ok, err = pcall(function()
+                local info = msgpack.encode({[48] = {box.info()}})
+                local stat = msgpack.encode({[48] = {box.stat()}})
+                local slab = msgpack.encode({[48] = {box.slab.info()}})
+                box.internal.publish_stats(info, stat, slab)
+            end)
+            if not ok then
+                log.error("stats publisher: %s", err)
+            end
+            fiber.sleep(1)
+        end
+    end)
     for key, fun in pairs(dynamic_cfg) do
         local val = cfg[key]
         if val ~= nil and not dynamic_cfg_skip_at_load[key] then
@@ -30,14 +30,34 @@
  */
 #include "box/lua/misc.h"
 
+#include <string.h>
+
 #include "fiber.h" /* fiber->gc() */
+#include "clock.h"
+#include "rmean.h"
+#include <pmatomic.h>
+#include "third_party/PMurHash.h"
 #include <small/region.h>
 #include "lua/utils.h"
 #include "lua/msgpack.h"
 
 #include "box/box.h"
+#include "box/index.h"
 #include "box/port.h"
 #include "box/lua/tuple.h"
+#include "box/memtx_index.h"
+#include "box/schema.h"
+#include "box/space.h"
+#include "box/session.h"
+#include "box/xlog.h"
+#include "box/xrow.h"
+#include "box/iproto.h"
+#include "box/cluster.h" /* SERVER_UUID */
+#include "cfg.h"
+#include "csv/csv.h"
+#include "histogram.h"
+#include "trigger.h"
+#include "scoped_guard.h"
 
 /** {{{ Miscellaneous utils **/
 
@@ -111,6 +131,951 @@ lbox_select(lua_State *L)
 	return 1; /* lua table with tuples */
 }
 
+/** {{{ Multi-get **/
+
+/**
+ * Batched point lookups: box.internal.multi_get(space_id,
+ * index_id, {key, key, ...}) resolves every key in one call -
+ * one network round trip, one dispatch, one C loop over the
+ * bless-free get fast path - and returns a table where slot i
+ * holds the tuple for key i (missing keys leave the slot nil).
+ * Keys outside the fast path (non-unique index, partial keys,
+ * vinyl) fall back to box_index_get() per key.
+ */
+static int
+lbox_multi_get(lua_State *L)
+{
+	if (lua_gettop(L) != 3 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_istable(L, 3))
+		return luaL_error(L, "Usage: multi_get(space_id, index_id, "
+				  "keys)");
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	int nkeys = lua_objlen(L, 3);
+	lua_createtable(L, nkeys, 0);
+	for (int i = 1; i <= nkeys; i++) {
+		lua_rawgeti(L, 3, i);
+		size_t key_len;
+		const char *key = lbox_encode_tuple_on_gc(L, -1, &key_len);
+		lua_pop(L, 1);
+		struct tuple *tuple = NULL;
+		int rc = box_index_get_fast(space_id, index_id, key,
+					    key + key_len, &tuple);
+		if (rc < 0)
+			return luaT_error(L);
+		if (rc > 0) {
+			/* Not an exact unique memtx match. */
+			if (box_index_get(space_id, index_id, key,
+					  key + key_len, &tuple) != 0)
+				return luaT_error(L);
+		}
+		if (tuple != NULL) {
+			luaT_pushtuple(L, tuple);
+			lua_rawseti(L, -2, i);
+		}
+	}
+	return 1;
+}
+
+/* }}} */
+
+/** {{{ CSV bulk loader **/
+
+/**
+ * Load a CSV file straight into a space:
+ * box.internal.load_csv(space_id, path[, batch]). Parsing,
+ * row encoding and insertion all run in C; rows are replaced in
+ * transactions of @a batch rows (default 500), so the whole load
+ * is a stream of multi-row WAL entries instead of per-row
+ * commits, and the loader yields between batches. Every field is
+ * inserted as a string - casting columns is the caller's job,
+ * the loader's is moving bytes fast. Returns the number of rows
+ * loaded; stops with an error on the first failed insert.
+ */
+static int
+lbox_load_csv(lua_State *L)
+{
+	int top = lua_gettop(L);
+	if ((top != 2 && top != 3) || !lua_isnumber(L, 1) ||
+	    !lua_isstring(L, 2))
+		return luaL_error(L, "Usage: load_csv(space_id, path"
+				  "[, batch])");
+	uint32_t space_id = lua_tointeger(L, 1);
+	const char *path = lua_tostring(L, 2);
+	uint32_t batch = top == 3 ? lua_tointeger(L, 3) : 500;
+	if (batch == 0)
+		batch = 1;
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		return luaL_error(L, "load_csv: can not open '%s'", path);
+
+	struct csv csv;
+	csv_create(&csv);
+	struct csv_iterator it;
+	csv_iterator_create(&it, &csv);
+
+	struct region *gc = &fiber()->gc;
+	uint64_t rows = 0;
+	uint32_t in_batch = 0;
+	char buf[16384];
+	bool eof = false;
+	/* Fields of the row being assembled. */
+	const int ROW_FIELDS_MAX = 256;
+	struct {
+		const char *data;
+		size_t len;
+	} fields[ROW_FIELDS_MAX];
+	int nfields = 0;
+	size_t region_svp = region_used(gc);
+	int rc_state;
+	const char *err = NULL;
+
+	if (box_txn_begin() != 0) {
+		fclose(f);
+		csv_destroy(&csv);
+		return luaT_error(L);
+	}
+	while (true) {
+		rc_state = csv_next(&it);
+		if (rc_state == CSV_IT_NEEDMORE) {
+			if (eof) {
+				csv_feed(&it, "", 0);
+			} else {
+				size_t rd = fread(buf, 1, sizeof(buf), f);
+				if (rd == 0)
+					eof = true;
+				csv_feed(&it, buf, rd);
+			}
+			continue;
+		}
+		if (rc_state == CSV_IT_ERROR) {
+			err = "malformed csv";
+			break;
+		}
+		if (rc_state == CSV_IT_EOF)
+			break;
+		if (rc_state == CSV_IT_OK) {
+			if (nfields >= ROW_FIELDS_MAX) {
+				err = "too many columns";
+				break;
+			}
+			{
+				/* Copy out: feed reuses the buffer. */
+				size_t len = csv_iterator_get_field_len(&it);
+				char *copy = (char *)
+					region_alloc(gc, len);
+				if (copy == NULL) {
+					err = "out of memory";
+					break;
+				}
+				memcpy(copy, csv_iterator_get_field(&it),
+				       len);
+				fields[nfields].data = copy;
+				fields[nfields].len = len;
+				nfields++;
+			}
+			continue;
+		}
+		/* CSV_IT_EOL: assemble and insert the row. */
+		if (nfields == 0)
+			continue;
+		size_t size = mp_sizeof_array(nfields);
+		for (int i = 0; i < nfields; i++)
+			size += mp_sizeof_str(fields[i].len);
+		char *tuple = (char *) region_alloc(gc, size);
+		if (tuple == NULL) {
+			err = "out of memory";
+			break;
+		}
+		char *pos = mp_encode_array(tuple, nfields);
+		for (int i = 0; i < nfields; i++)
+			pos = mp_encode_str(pos, fields[i].data,
+					    fields[i].len);
+		if (box_replace(space_id, tuple, pos, NULL) != 0) {
+			err = "";
+			break;
+		}
+		rows++;
+		nfields = 0;
+		if (++in_batch >= batch) {
+			if (box_txn_commit() != 0) {
+				err = "";
+				break;
+			}
+			region_truncate(gc, region_svp);
+			fiber_sleep(0);
+			if (box_txn_begin() != 0) {
+				err = "";
+				break;
+			}
+			in_batch = 0;
+		}
+	}
+	fclose(f);
+	csv_destroy(&csv);
+	if (err == NULL) {
+		if (box_txn_commit() != 0)
+			err = "";
+	} else {
+		box_txn_rollback();
+	}
+	if (err != NULL) {
+		if (err[0] != '\0')
+			return luaL_error(L, "load_csv: %s", err);
+		return luaT_error(L);
+	}
+	luaL_pushuint64(L, rows);
+	return 1;
+}
+
+/* }}} */
+
+/** {{{ Streaming cursors over frozen index read views **/
+
+/**
+ * A server-side cursor: a frozen full-scan read view of a memtx
+ * primary index, owned by the session which opened it. Clients
+ * stream a big space in bounded chunks through repeated
+ * box.internal.cursor_fetch() calls instead of one giant select
+ * response, while writers proceed unblocked - the view is pinned
+ * to the matras version taken at open time. Cursors are closed
+ * explicitly or together with their session.
+ */
+struct box_cursor {
+	uint64_t id;
+	uint64_t session_id;
+	uint32_t space_id;
+	struct memtx_index_read_view *rv;
+	struct rlist link;
+};
+
+static RLIST_HEAD(box_cursors);
+static uint64_t box_cursor_next_id = 1;
+
+static struct box_cursor *
+box_cursor_find(uint64_t id)
+{
+	struct box_cursor *cursor;
+	rlist_foreach_entry(cursor, &box_cursors, link) {
+		if (cursor->id == id)
+			return cursor;
+	}
+	return NULL;
+}
+
+static void
+box_cursor_close(struct box_cursor *cursor)
+{
+	rlist_del_entry(cursor, link);
+	memtx_index_read_view_delete(cursor->rv);
+	free(cursor);
+}
+
+static int
+lbox_cursor_open(lua_State *L)
+{
+	int top = lua_gettop(L);
+	if ((top != 1 && top != 2) || !lua_isnumber(L, 1))
+		return luaL_error(L, "Usage: cursor_open(space_id[, key])");
+	uint32_t space_id = lua_tointeger(L, 1);
+	/*
+	 * An optional start key partitions the index between
+	 * several cursors for a parallel snapshot-consistent
+	 * export: each consumer scans from its split point and
+	 * stops at the next one.
+	 */
+	size_t key_len = 0;
+	const char *key = NULL;
+	uint32_t part_count = 0;
+	if (top == 2) {
+		key = lbox_encode_tuple_on_gc(L, 2, &key_len);
+		const char *pos = key;
+		part_count = mp_decode_array(&pos);
+		key = pos;
+	}
+	try {
+		struct space *space = space_cache_find(space_id);
+		if (!space_is_memtx(space) || space_index(space, 0) == NULL) {
+			tnt_raise(ClientError, ER_UNSUPPORTED, "cursor",
+				  "non-memtx space");
+		}
+		struct box_cursor *cursor = (struct box_cursor *)
+			malloc(sizeof(*cursor));
+		if (cursor == NULL) {
+			tnt_raise(OutOfMemory, sizeof(*cursor), "malloc",
+				  "box_cursor");
+		}
+		auto guard = make_scoped_guard([=]{ free(cursor); });
+		cursor->rv = memtx_index_read_view_new(
+			(MemtxIndex *) space_index(space, 0), key,
+			part_count);
+		cursor->id = box_cursor_next_id++;
+		cursor->session_id = current_session()->id;
+		cursor->space_id = space_id;
+		rlist_add_tail_entry(&box_cursors, cursor, link);
+		guard.is_active = false;
+		luaL_pushuint64(L, cursor->id);
+	} catch (Exception *e) {
+		return luaT_error(L);
+	}
+	return 1;
+}
+
+static int
+lbox_cursor_fetch(lua_State *L)
+{
+	if (lua_gettop(L) != 2 || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage: cursor_fetch(id, count)");
+	uint64_t id = luaL_touint64(L, 1);
+	uint32_t count = lua_tointeger(L, 2);
+	struct box_cursor *cursor = box_cursor_find(id);
+	if (cursor == NULL)
+		return luaL_error(L, "cursor is not open");
+	if (cursor->session_id != current_session()->id)
+		return luaL_error(L, "cursor belongs to another session");
+	lua_createtable(L, count, 0);
+	uint32_t i = 0;
+	struct tuple *tuple;
+	while (i < count &&
+	       (tuple = memtx_index_read_view_next(cursor->rv)) != NULL) {
+		if (i % 1024 == 1023 &&
+		    fiber_deadline_expired(fiber(), clock_monotonic())) {
+			box_cursor_close(cursor);
+			diag_set(ClientError, ER_TIMEOUT);
+			return luaT_error(L);
+		}
+		luaT_pushtuple(L, tuple);
+		lua_rawseti(L, -2, ++i);
+	}
+	if (i < count) {
+		/* Exhausted - close eagerly. */
+		box_cursor_close(cursor);
+	}
+	return 1;
+}
+
+static int
+lbox_cursor_close(lua_State *L)
+{
+	if (lua_gettop(L) != 1)
+		return luaL_error(L, "Usage: cursor_close(id)");
+	uint64_t id = luaL_touint64(L, 1);
+	struct box_cursor *cursor = box_cursor_find(id);
+	if (cursor == NULL)
+		return luaL_error(L, "cursor is not open");
+	if (cursor->session_id != current_session()->id)
+		return luaL_error(L, "cursor belongs to another session");
+	box_cursor_close(cursor);
+	return 0;
+}
+
+void
+box_cursors_close_for_space(uint32_t space_id)
+{
+	struct box_cursor *cursor, *next;
+	rlist_foreach_entry_safe(cursor, &box_cursors, link, next) {
+		if (cursor->space_id == space_id)
+			box_cursor_close(cursor);
+	}
+}
+
+/** {{{ Engine-side range aggregates **/
+
+/**
+ * Aggregate over an index range without materializing a single
+ * tuple in Lua: the iteration, field access and accumulation all
+ * run in C, so box.internal.aggregate() costs a fraction of
+ * pairs() plus Lua arithmetic. Supported operations: 'sum',
+ * 'min', 'max' over a numeric field, by field number.
+ */
+static int
+lbox_aggregate(lua_State *L)
+{
+	if (lua_gettop(L) != 6 || !lua_isnumber(L, 1) ||
+	    !lua_isnumber(L, 2) || !lua_isnumber(L, 3) ||
+	    !lua_isnumber(L, 5) || !lua_isstring(L, 6)) {
+		return luaL_error(L, "Usage: aggregate(space_id, index_id, "
+				  "iterator, key, fieldno, op)");
+	}
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	int iterator = lua_tointeger(L, 3);
+	uint32_t fieldno = lua_tointeger(L, 5);
+	const char *op = lua_tostring(L, 6);
+	enum { AGG_SUM, AGG_MIN, AGG_MAX } agg;
+	if (strcmp(op, "sum") == 0)
+		agg = AGG_SUM;
+	else if (strcmp(op, "min") == 0)
+		agg = AGG_MIN;
+	else if (strcmp(op, "max") == 0)
+		agg = AGG_MAX;
+	else
+		return luaL_error(L, "aggregate: unknown operation");
+
+	size_t key_len;
+	const char *key = lbox_encode_tuple_on_gc(L, 4, &key_len);
+
+	box_iterator_t *it = box_index_iterator(space_id, index_id,
+						iterator, key, key + key_len);
+	if (it == NULL)
+		return luaT_error(L);
+
+	double acc = 0;
+	uint64_t rows = 0;
+	uint64_t seen = 0;
+	box_tuple_t *tuple;
+	while (box_iterator_next(it, &tuple) == 0 && tuple != NULL) {
+		/*
+		 * Long scans honor the request deadline; check
+		 * in batches to amortize the clock read.
+		 */
+		if (++seen % 1024 == 0 &&
+		    fiber_deadline_expired(fiber(), clock_monotonic())) {
+			box_iterator_free(it);
+			diag_set(ClientError, ER_TIMEOUT);
+			return luaT_error(L);
+		}
+		const char *field = box_tuple_field(tuple, fieldno);
+		if (field == NULL)
+			continue;
+		double val;
+		switch (mp_typeof(*field)) {
+		case MP_UINT:
+			val = mp_decode_uint(&field);
+			break;
+		case MP_INT:
+			val = mp_decode_int(&field);
+			break;
+		case MP_FLOAT:
+			val = mp_decode_float(&field);
+			break;
+		case MP_DOUBLE:
+			val = mp_decode_double(&field);
+			break;
+		default:
+			continue; /* skip non-numeric fields */
+		}
+		if (rows == 0) {
+			acc = val;
+		} else {
+			switch (agg) {
+			case AGG_SUM:
+				acc += val;
+				break;
+			case AGG_MIN:
+				if (val < acc)
+					acc = val;
+				break;
+			case AGG_MAX:
+				if (val > acc)
+					acc = val;
+				break;
+			}
+		}
+		rows++;
+	}
+	box_iterator_free(it);
+	if (agg != AGG_SUM && rows == 0) {
+		lua_pushnil(L);
+		return 1;
+	}
+	lua_pushnumber(L, acc);
+	return 1;
+}
+
+/**
+ * Per-request latency percentiles: the net->tx queue wait and
+ * the tx execution time, in microseconds. @sa the histograms in
+ * iproto.cc.
+ */
+static int
+lbox_latency_info(lua_State *L)
+{
+	extern struct histogram *iproto_queue_latency;
+	extern struct histogram *iproto_exec_latency;
+	static const int pcts[] = { 50, 90, 99 };
+	static const char *names[] = { "p50", "p90", "p99" };
+	lua_createtable(L, 0, 2);
+	struct histogram *hists[] =
+		{ iproto_queue_latency, iproto_exec_latency };
+	const char *hist_names[] = { "queue", "exec" };
+	for (int h = 0; h < 2; h++) {
+		lua_createtable(L, 0, 3);
+		if (hists[h] != NULL) {
+			for (unsigned i = 0; i < lengthof(pcts); i++) {
+				luaL_pushuint64(L,
+					histogram_percentile(hists[h],
+							     pcts[i]));
+				lua_setfield(L, -2, names[i]);
+			}
+		}
+		lua_setfield(L, -2, hist_names[h]);
+	}
+	return 1;
+}
+
+/* }}} */
+
+/** {{{ WAL cursors: change data capture without a replica **/
+
+/**
+ * A WAL cursor reads committed rows straight from the xlog
+ * files, so an external consumer can capture changes without
+ * being a replica. A cursor is opened at a vclock signature (the
+ * number in the xlog file name), streams decoded rows in commit
+ * order and reports the signature to reopen at once the file is
+ * exhausted. Filtering by server id or space is up to the
+ * consumer - every row carries both.
+ */
+struct wal_cursor {
+	uint64_t id;
+	uint64_t session_id;
+	struct xdir dir;
+	struct xlog_cursor cursor;
+	struct rlist link;
+};
+
+static RLIST_HEAD(wal_cursors);
+static uint64_t wal_cursor_next_id = 1;
+
+static struct wal_cursor *
+wal_cursor_find(uint64_t id)
+{
+	struct wal_cursor *cursor;
+	rlist_foreach_entry(cursor, &wal_cursors, link) {
+		if (cursor->id == id)
+			return cursor;
+	}
+	return NULL;
+}
+
+static void
+wal_cursor_close(struct wal_cursor *cursor)
+{
+	rlist_del_entry(cursor, link);
+	xlog_cursor_close(&cursor->cursor, false);
+	xdir_destroy(&cursor->dir);
+	free(cursor);
+}
+
+static int
+lbox_wal_cursor_open(lua_State *L)
+{
+	if (lua_gettop(L) != 1 || !lua_isnumber(L, 1))
+		return luaL_error(L, "Usage: wal_cursor_open(signature)");
+	int64_t signature = luaL_touint64(L, 1);
+	struct wal_cursor *cursor = (struct wal_cursor *)
+		calloc(1, sizeof(*cursor));
+	if (cursor == NULL)
+		return luaL_error(L, "out of memory");
+	try {
+		xdir_create(&cursor->dir, cfg_gets("wal_dir"), XLOG,
+			    &SERVER_UUID);
+		xdir_scan_xc(&cursor->dir);
+		/* The first file at or past the requested position. */
+		struct vclock *match;
+		for (match = vclockset_first(&cursor->dir.index);
+		     match != NULL && vclock_sum(match) < signature;
+		     match = vclockset_next(&cursor->dir.index, match))
+			;
+		if (match == NULL) {
+			tnt_raise(XlogError, "no xlog at or past the "
+				  "requested signature");
+		}
+		xdir_open_cursor_xc(&cursor->dir, vclock_sum(match),
+				    &cursor->cursor);
+		cursor->id = wal_cursor_next_id++;
+		cursor->session_id = current_session()->id;
+		rlist_add_tail_entry(&wal_cursors, cursor, link);
+		luaL_pushuint64(L, cursor->id);
+	} catch (Exception *e) {
+		xdir_destroy(&cursor->dir);
+		free(cursor);
+		return luaT_error(L);
+	}
+	return 1;
+}
+
+static int
+lbox_wal_cursor_fetch(lua_State *L)
+{
+	if (lua_gettop(L) != 2 || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage: wal_cursor_fetch(id, count)");
+	uint64_t id = luaL_touint64(L, 1);
+	uint32_t count = lua_tointeger(L, 2);
+	struct wal_cursor *cursor = wal_cursor_find(id);
+	if (cursor == NULL)
+		return luaL_error(L, "wal cursor is not open");
+	if (cursor->session_id != current_session()->id)
+		return luaL_error(L, "wal cursor belongs to another session");
+	lua_createtable(L, count, 0);
+	uint32_t i = 0;
+	try {
+		struct xrow_header row;
+		while (i < count &&
+		       xlog_cursor_next_xc(&cursor->cursor, &row, false)
+		       == 0) {
+			lua_createtable(L, 0, 5);
+			lua_pushinteger(L, row.type);
+			lua_setfield(L, -2, "type");
+			luaL_pushuint64(L, row.lsn);
+			lua_setfield(L, -2, "lsn");
+			lua_pushinteger(L, row.server_id);
+			lua_setfield(L, -2, "server_id");
+			if (row.bodycnt == 1) {
+				const char *body =
+					(const char *) row.body[0].iov_base;
+				luamp_decode(L, luaL_msgpack_default, &body);
+				lua_setfield(L, -2, "body");
+			}
+			lua_rawseti(L, -2, ++i);
+		}
+	} catch (Exception *e) {
+		return luaT_error(L);
+	}
+	/* Report where to reopen when this file is exhausted. */
+	if (cursor->cursor.state == XLOG_CURSOR_EOF) {
+		luaL_pushuint64(L,
+				vclock_sum(&cursor->cursor.meta.vclock));
+		return 2;
+	}
+	return 1;
+}
+
+static int
+lbox_wal_cursor_close(lua_State *L)
+{
+	if (lua_gettop(L) != 1)
+		return luaL_error(L, "Usage: wal_cursor_close(id)");
+	uint64_t id = luaL_touint64(L, 1);
+	struct wal_cursor *cursor = wal_cursor_find(id);
+	if (cursor == NULL)
+		return luaL_error(L, "wal cursor is not open");
+	if (cursor->session_id != current_session()->id)
+		return luaL_error(L, "wal cursor belongs to another session");
+	wal_cursor_close(cursor);
+	return 0;
+}
+
+/* }}} */
+
+/** Close all cursors of a disconnecting session. */
+static void
+box_cursor_on_disconnect(struct trigger * /* trigger */, void *event)
+{
+	struct session *session = (struct session *) event;
+	struct box_cursor *cursor, *next;
+	rlist_foreach_entry_safe(cursor, &box_cursors, link, next) {
+		if (cursor->session_id == session->id)
+			box_cursor_close(cursor);
+	}
+	struct wal_cursor *wcursor, *wnext;
+	rlist_foreach_entry_safe(wcursor, &wal_cursors, link, wnext) {
+		if (wcursor->session_id == session->id)
+			wal_cursor_close(wcursor);
+	}
+}
+
+/**
+ * box.internal.publish_stats(info, stat, slab): hand the
+ * monitoring publisher's freshly encoded reply bodies to the
+ * net shards. @sa iproto_publish_stats.
+ */
+static int
+lbox_publish_stats(lua_State *L)
+{
+	const char *bodies[3];
+	uint32_t lens[3];
+	for (int i = 0; i < 3; i++) {
+		size_t len;
+		bodies[i] = lua_tolstring(L, i + 1, &len);
+		if (bodies[i] == NULL)
+			return luaL_error(L, "Usage: publish_stats(info, "
+					  "stat, slab)");
+		lens[i] = len;
+	}
+	iproto_publish_stats(bodies, lens);
+	return 0;
+}
+
+/** Shared work queue of the parallel verifier workers. */
+struct verify_arg {
+	char **paths;
+	int count;
+	/** Next unclaimed file, taken with an atomic add. */
+	int next;
+	/** Rows validated, accumulated atomically. */
+	int64_t rows;
+	/** Index of the first failed file, -1 when clean. */
+	int failed;
+	char errmsg[DIAG_ERRMSG_MAX];
+};
+
+/**
+ * Validate one file: the cursor already rejects bad frame magic
+ * and checksums; on top of that every row body must be
+ * well-formed msgpack. Returns -1 with diag set on any defect.
+ */
+static int
+verify_one_file(struct verify_arg *arg, const char *path)
+{
+	struct xlog_cursor cursor;
+	if (xlog_cursor_open(&cursor, path) < 0)
+		return -1;
+	int rc = -1;
+	try {
+		struct xrow_header row;
+		while (xlog_cursor_next_xc(&cursor, &row, true) == 0) {
+			for (int j = 0; j < row.bodycnt; j++) {
+				const char *pos = (const char *)
+					row.body[j].iov_base;
+				const char *end = pos + row.body[j].iov_len;
+				if (mp_check(&pos, end) != 0 || pos != end) {
+					diag_set(ClientError,
+						 ER_INVALID_MSGPACK,
+						 "row body");
+					goto out;
+				}
+			}
+			pm_atomic_fetch_add(&arg->rows, (int64_t) 1);
+		}
+		if (cursor.state != XLOG_CURSOR_EOF) {
+			diag_set(ClientError, ER_INVALID_XLOG,
+				 "no EOF marker");
+			goto out;
+		}
+		rc = 0;
+	} catch (Exception *e) {
+		/* diag already set */
+	}
+out:
+	xlog_cursor_close(&cursor, false);
+	return rc;
+}
+
+/** One verifier thread: claims files off the shared queue. */
+static int
+verify_worker_f(va_list ap)
+{
+	struct verify_arg *arg = va_arg(ap, struct verify_arg *);
+	while (true) {
+		int i = pm_atomic_fetch_add(&arg->next, 1);
+		if (i >= arg->count)
+			return 0;
+		if (verify_one_file(arg, arg->paths[i]) != 0) {
+			/* First failure wins. */
+			int expected = -1;
+			if (pm_atomic_compare_exchange_strong(&arg->failed,
+							      &expected, i)) {
+				struct error *e =
+					diag_last_error(diag_get());
+				snprintf(arg->errmsg, sizeof(arg->errmsg),
+					 "%s", e != NULL ? e->errmsg :
+					 "unknown error");
+			}
+			return 0;
+		}
+	}
+}
+
+/**
+ * box.internal.verify_files({path, ...}[, threads]): validate
+ * snapshot/xlog files in parallel - frame checksums, row
+ * decoding and msgpack well-formedness - without touching the
+ * instance's own recovery state, so it can run against a pinned
+ * backup set while traffic is served. Returns rows_checked on
+ * success; raises naming the broken file otherwise.
+ */
+static int
+lbox_verify_files(lua_State *L)
+{
+	if (!lua_istable(L, 1))
+		return luaL_error(L, "Usage: verify_files({path, ...}"
+				  "[, threads])");
+	int count = lua_objlen(L, 1);
+	int nthreads = 4;
+	if (!lua_isnoneornil(L, 2))
+		nthreads = lua_tointeger(L, 2);
+	if (nthreads < 1)
+		nthreads = 1;
+	if (nthreads > count)
+		nthreads = count;
+	if (count == 0) {
+		luaL_pushint64(L, 0);
+		return 1;
+	}
+	struct verify_arg arg;
+	arg.paths = (char **) calloc(count, sizeof(char *));
+	if (arg.paths == NULL)
+		return luaL_error(L, "out of memory");
+	for (int i = 0; i < count; i++) {
+		lua_rawgeti(L, 1, i + 1);
+		const char *path = lua_tostring(L, -1);
+		arg.paths[i] = path != NULL ? strdup(path) : NULL;
+		lua_pop(L, 1);
+		if (arg.paths[i] == NULL) {
+			for (int j = 0; j < i; j++)
+				free(arg.paths[j]);
+			free(arg.paths);
+			return luaL_error(L, "verify_files: bad path at "
+					  "index %d", i + 1);
+		}
+	}
+	arg.count = count;
+	arg.next = 0;
+	arg.rows = 0;
+	arg.failed = -1;
+	arg.errmsg[0] = '\0';
+	struct cord *cords = (struct cord *)
+		calloc(nthreads, sizeof(struct cord));
+	int started = 0;
+	if (cords != NULL) {
+		for (; started < nthreads; started++) {
+			if (cord_costart(&cords[started], "verify",
+					 verify_worker_f, &arg) != 0)
+				break;
+		}
+		for (int i = 0; i < started; i++)
+			cord_cojoin(&cords[i]);
+	}
+	free(cords);
+	int failed = arg.failed;
+	char path_buf[1024];
+	if (failed >= 0)
+		snprintf(path_buf, sizeof(path_buf), "%s",
+			 arg.paths[failed]);
+	int64_t rows = arg.rows;
+	char msg_buf[DIAG_ERRMSG_MAX];
+	snprintf(msg_buf, sizeof(msg_buf), "%s", arg.errmsg);
+	for (int i = 0; i < count; i++)
+		free(arg.paths[i]);
+	free(arg.paths);
+	if (started == 0)
+		return luaL_error(L, "can't start verifier threads");
+	if (failed >= 0)
+		return luaL_error(L, "%s: %s", path_buf, msg_buf);
+	luaL_pushint64(L, rows);
+	return 1;
+}
+
+/**
+ * box.internal.space_digest(space_id, index_id[, from_key[, limit]]):
+ * a commutative 64-bit content digest over tuples in primary-key
+ * order starting at from_key, covering at most limit tuples.
+ * Returns digest, count, next_key_tuple (nil when exhausted).
+ *
+ * Commutativity (the digest is a wrapping sum of per-tuple
+ * hashes) lets a resync tool compare digests of matching ranges
+ * on two instances and binary-search down to the divergent
+ * ranges in O(log n) round trips - rebuild traffic proportional
+ * to divergence without a replication protocol extension.
+ */
+static int
+lbox_space_digest(lua_State *L)
+{
+	if (lua_gettop(L) < 2 || !lua_isnumber(L, 1) || !lua_isnumber(L, 2))
+		return luaL_error(L, "Usage: space_digest(space_id, "
+				  "index_id[, from_key[, limit]])");
+	uint32_t space_id = lua_tointeger(L, 1);
+	uint32_t index_id = lua_tointeger(L, 2);
+	/* A nil from_key encodes as an empty key: a full scan. */
+	size_t key_len;
+	const char *key = lbox_encode_tuple_on_gc(L, 3, &key_len);
+	uint64_t limit = UINT64_MAX;
+	if (!lua_isnoneornil(L, 4))
+		limit = luaL_touint64(L, 4);
+
+	box_iterator_t *it = box_index_iterator(space_id, index_id, ITER_GE,
+						key, key + key_len);
+	if (it == NULL)
+		return luaT_error(L);
+	uint64_t digest = 0;
+	uint64_t rows = 0;
+	box_tuple_t *tuple = NULL;
+	box_tuple_t *last = NULL;
+	while (rows < limit &&
+	       box_iterator_next(it, &tuple) == 0 && tuple != NULL) {
+		if (rows % 1024 == 1023 &&
+		    fiber_deadline_expired(fiber(), clock_monotonic())) {
+			if (last != NULL)
+				box_tuple_unref(last);
+			box_iterator_free(it);
+			diag_set(ClientError, ER_TIMEOUT);
+			return luaT_error(L);
+		}
+		uint32_t bsize;
+		const char *data = tuple_data_range(tuple, &bsize);
+		uint32_t h = PMurHash32(13, data, bsize);
+		/* Widen to 64 bit to slow collision growth. */
+		digest += (uint64_t) h * 0x9E3779B97F4A7C15ULL;
+		rows++;
+		/*
+		 * The iterator may recycle the previous tuple on
+		 * the next step (vinyl does); pin the candidate
+		 * resume key explicitly.
+		 */
+		box_tuple_ref(tuple);
+		if (last != NULL)
+			box_tuple_unref(last);
+		last = tuple;
+	}
+	box_iterator_free(it);
+	luaL_pushuint64(L, digest);
+	luaL_pushuint64(L, rows);
+	if (rows == limit && last != NULL)
+		luaT_pushtuple(L, last);
+	else
+		lua_pushnil(L);
+	if (last != NULL)
+		box_tuple_unref(last);
+	return 3;
+}
+
+/** rmean_foreach callback: ["name"] = {rps=..., total=...}. */
+static int
+space_stat_item(const char *name, int rps, int64_t total, void *cb_ctx)
+{
+	struct lua_State *L = (struct lua_State *) cb_ctx;
+	lua_pushstring(L, name);
+	lua_createtable(L, 0, 2);
+	lua_pushstring(L, "rps");
+	lua_pushnumber(L, rps);
+	lua_settable(L, -3);
+	lua_pushstring(L, "total");
+	lua_pushnumber(L, total);
+	lua_settable(L, -3);
+	lua_settable(L, -3);
+	return 0;
+}
+
+static void
+space_stat_cb(struct space *space, void *udata)
+{
+	struct lua_State *L = (struct lua_State *) udata;
+	if (space_is_system(space))
+		return;
+	lua_pushstring(L, space_name(space));
+	lua_newtable(L);
+	rmean_foreach(space->stats, space_stat_item, L);
+	lua_settable(L, -3);
+}
+
+/**
+ * box.stat.spaces(): per-space request counters, aggregated
+ * from the per-cord rmean shards at call time.
+ */
+extern "C" int
+lbox_stat_spaces(struct lua_State *L)
+{
+	lua_newtable(L);
+	space_foreach(space_stat_cb, L);
+	return 1;
+}
+
+static struct trigger cursor_disconnect_trigger =
+	{ RLIST_LINK_INITIALIZER, box_cursor_on_disconnect, NULL, NULL };
+
 /* }}} */
 
 void
@@ -118,9 +1083,24 @@ box_lua_misc_init(struct lua_State *L)
 {
 	static const struct luaL_reg boxlib_internal[] = {
 		{"select", lbox_select},
+		{"cursor_open", lbox_cursor_open},
+		{"cursor_fetch", lbox_cursor_fetch},
+		{"cursor_close", lbox_cursor_close},
+		{"aggregate", lbox_aggregate},
+		{"space_digest", lbox_space_digest},
+		{"verify_files", lbox_verify_files},
+		{"publish_stats", lbox_publish_stats},
+		{"latency_info", lbox_latency_info},
+		{"load_csv", lbox_load_csv},
+		{"multi_get", lbox_multi_get},
+		{"wal_cursor_open", lbox_wal_cursor_open},
+		{"wal_cursor_fetch", lbox_wal_cursor_fetch},
+		{"wal_cursor_close", lbox_wal_cursor_close},
 		{NULL, NULL}
 	};
 
 	luaL_register(L, "box.internal", boxlib_internal);
 	lua_pop(L, 1);
+
+	trigger_add(&session_on_disconnect, &cursor_disconnect_trigger);
 }
@@ -32,6 +32,7 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 #if defined(__cplusplus)
 extern "C" {
@@ -42,6 +43,14 @@ struct lua_State;
 char *
 lbox_encode_tuple_on_gc(struct lua_State *L, int idx, size_t *p_len);
 
+/**
+ * Close all streaming cursors over a space: called when the
+ * space is altered or dropped, before its old index objects are
+ * destroyed, so that no cursor read view outlives its index.
+ */
+void
+box_cursors_close_for_space(uint32_t space_id);
+
 void
 box_lua_misc_init(struct lua_State *L);
 
@@ -158,6 +158,13 @@ local function create_transport(host, port, user, password, callback)
 
     local worker_fiber
     local connection
+    -- One connection, many requesting fibers: every request is
+    -- encoded into this shared buffer under its own sync id and
+    -- the worker flushes whatever has accumulated in a single
+    -- write - i.e. multiplexing and request coalescing are the
+    -- architecture here, not an option. Opening several
+    -- connections only helps when a single socket or the peer's
+    -- net thread is itself the bottleneck.
     local send_buf         = buffer.ibuf(buffer.READAHEAD)
     local recv_buf         = buffer.ibuf(buffer.READAHEAD)
 
@@ -5,6 +5,7 @@ local msgpack = require('msgpack')
 local msgpackffi = require('msgpackffi')
 local fun = require('fun')
 local log = require('log')
+local fiber = require('fiber')
 local session = box.session
 local internal = require('box.internal')
 
@@ -146,6 +147,45 @@ end
                               port = 'string, number',
                               data = 'any'} )
 --]]
+--
+-- Deferred on_replace triggers: the synchronous part only puts a
+-- compact event record on a bounded queue, and the user
+-- functions run in a worker fiber after the statement has left
+-- the commit path. Same visibility caveat as synchronous
+-- triggers: the event is recorded when the statement executes,
+-- so a later rollback of the transaction is not reflected.
+--
+local ASYNC_QUEUE_SIZE = 8192
+local async_triggers = {}
+local async_queue
+local async_stats = { queued = 0, dropped = 0, executed = 0, errors = 0 }
+
+local function async_trigger_worker()
+    fiber.name('on_replace_async')
+    while true do
+        local ev = async_queue:get()
+        for _, fn in ipairs(ev.list) do
+            async_stats.executed = async_stats.executed + 1
+            local ok, err = pcall(fn, ev.old, ev.new, ev.space)
+            if not ok then
+                async_stats.errors = async_stats.errors + 1
+                log.error("on_replace_async trigger failed: %s", err)
+            end
+        end
+    end
+end
+
+-- queue depth and counters, for monitoring trigger lag
+internal.on_replace_async_stats = function()
+    return {
+        queued = async_stats.queued,
+        dropped = async_stats.dropped,
+        executed = async_stats.executed,
+        errors = async_stats.errors,
+        pending = async_queue ~= nil and async_queue:count() or 0,
+    }
+end
+
 local function check_param_table(table, template)
     if table == nil then
         return
@@ -229,6 +269,22 @@ end
 -- box.commit yields, so it's defined as Lua/C binding
 -- box.rollback yields as well
 
+-- Run a function as one transaction: all statements land in a
+-- single WAL entry and either commit or roll back together.
+-- Clients get an atomic multi-operation request by CALLing a
+-- stored function wrapped in box.atomic (or EVALing one).
+box.atomic = function(fn, ...)
+    box.begin()
+    local res = {pcall(fn, ...)}
+    if res[1] then
+        box.commit()
+        return unpack(res, 2)
+    else
+        box.rollback()
+        error(res[2])
+    end
+end
+
 box.schema.space = {}
 box.schema.space.create = function(name, options)
     check_param(name, 'name', 'string')
@@ -240,6 +296,10 @@ box.schema.space.create = function(name, options)
         user = 'string, number',
         format = 'table',
         temporary = 'boolean',
+        ttl = 'number',
+        ttl_field = 'number',
+        memory_quota = 'number',
+        alloc_size = 'number',
     }
     local options_defaults = {
         engine = 'memtx',
@@ -281,6 +341,10 @@ box.schema.space.create = function(name, options)
     -- filter out global parameters from the options array
     local space_options = setmetatable({
         temporary = options.temporary and true or nil,
+        ttl = options.ttl,
+        ttl_field = options.ttl_field,
+        memory_quota = options.memory_quota,
+        alloc_size = options.alloc_size,
     }, { __serialize = 'map' })
     _space:insert{id, uid, name, options.engine, options.field_count,
         space_options, format}
@@ -325,6 +389,9 @@ box.schema.space.drop = function(space_id, space_name, opts)
             box.error(box.error.NO_SUCH_SPACE, space_name)
         end
     end
+    -- the wrapper died with the space's trigger list; forget it
+    -- so a recreated space with the same id starts clean
+    async_triggers[space_id] = nil
 end
 
 box.schema.space.rename = function(space_id, space_name)
@@ -719,6 +786,39 @@ function box.schema.space.bless(space)
         end
         return tonumber(ret)
     end
+    -- Stable pagination: index:position(tuple) extracts the
+    -- tuple's key in this index - a token that survives any
+    -- concurrent inserts and deletes, unlike a numeric offset.
+    -- Resume with index:select(token, {iterator = 'GT'}) (or
+    -- 'LT' when walking backwards). On a non-unique index
+    -- entries sharing the token key are skipped by GT; paginate
+    -- over a unique index when exactness matters.
+    index_mt.position = function(index, tuple)
+        if tuple == nil then
+            box.error(box.error.ILLEGAL_PARAMS,
+                      "Usage: index:position(tuple)")
+        end
+        local key = {}
+        for i, part in ipairs(index.parts) do
+            key[i] = tuple[part.fieldno]
+        end
+        return key
+    end
+    -- Memory layout report: how much index memory each entry
+    -- costs in practice. bytes_per_entry far above the ~8-byte
+    -- pointer an entry logically needs means sparse blocks -
+    -- fragmentation from deletions - and a rebuild (or restart)
+    -- would compact it. Index memory only: tuples themselves are
+    -- accounted in the slab allocator report.
+    index_mt.layout = function(index)
+        local len = index:len()
+        local bsize = index:bsize()
+        return {
+            len = len,
+            bsize = bsize,
+            bytes_per_entry = len > 0 and bsize / len or 0,
+        }
+    end
     index_mt.__len = index_mt.len -- Lua 5.2 compatibility
     index_mt.__newindex = function(table, index)
         return error('Attempt to modify a read-only table') end
@@ -1006,6 +1106,58 @@ function box.schema.space.bless(space)
         end
         builtin.space_run_triggers(s, yesno)
     end
+    space_mt.on_replace_async = function(space, trigger, old_trigger)
+        space_object_check(space)
+        if trigger ~= nil and type(trigger) ~= 'function' then
+            box.error(box.error.PROC_LUA,
+                      "on_replace_async expects a function")
+        end
+        local t = async_triggers[space.id]
+        if t == nil then
+            if trigger == nil then
+                return
+            end
+            if async_queue == nil then
+                async_queue = fiber.channel(ASYNC_QUEUE_SIZE)
+                fiber.create(async_trigger_worker)
+            end
+            t = { list = {} }
+            -- One synchronous trigger per space enqueues the
+            -- event; the user functions run in the worker.
+            t.wrapper = function(old_tuple, new_tuple, space_name)
+                if #t.list == 0 then
+                    return
+                end
+                local ev = { old = old_tuple, new = new_tuple,
+                             space = space_name, list = t.list }
+                if async_queue:put(ev, 0) then
+                    async_stats.queued = async_stats.queued + 1
+                else
+                    -- Overflow policy: audit events are dropped,
+                    -- never allowed to stall the commit path.
+                    async_stats.dropped = async_stats.dropped + 1
+                end
+            end
+            space:on_replace(t.wrapper)
+            async_triggers[space.id] = t
+        end
+        if old_trigger ~= nil then
+            for i, fn in ipairs(t.list) do
+                if fn == old_trigger then
+                    if trigger == nil then
+                        table.remove(t.list, i)
+                    else
+                        t.list[i] = trigger
+                    end
+                    return trigger
+                end
+            end
+        end
+        if trigger ~= nil then
+            table.insert(t.list, 1, trigger)
+        end
+        return trigger
+    end
     space_mt.__index = space_mt
 
     setmetatable(space, space_mt)
@@ -1487,6 +1639,80 @@ box.once = function(key, func, ...)
     return func(...)
 end
 
+--
+-- Instant backup: pin garbage collection, hardlink the newest
+-- checkpoint (snapshot plus chunks plus the xlogs needed to roll
+-- forward from it) into a backup directory, and let the caller
+-- archive the links at leisure - the hardlinked inodes cost
+-- nothing and survive any later checkpoints. GC stays pinned
+-- until box.backup.stop(), so the set can also be extended with
+-- newer xlogs by an incremental archiver before unpinning.
+--
+local fio = require('fio')
+local errno = require('errno')
+
+box.backup = {}
+
+box.backup.start = function(dir)
+    if type(dir) ~= 'string' then
+        box.error(box.error.PROC_LUA, "Usage: box.backup.start(dir)")
+    end
+    local daemon = box.internal.snapshot_daemon
+    if daemon.gc_suspended then
+        box.error(box.error.PROC_LUA, "backup is already in progress")
+    end
+    daemon.gc_suspended = true
+    local ok, res = pcall(function()
+        if fio.stat(dir) == nil and not fio.mkdir(dir) then
+            error(string.format("can't create %s: %s", dir,
+                                errno.strerror()))
+        end
+        local snaps = fio.glob(fio.pathjoin(box.cfg.snap_dir, '*.snap'))
+        if snaps == nil or #snaps == 0 then
+            error("nothing to back up: no snapshots")
+        end
+        local snap = snaps[#snaps]
+        local files = { snap }
+        local chunks = fio.glob(snap .. '.chunk*')
+        if chunks ~= nil then
+            for _, chunk in ipairs(chunks) do
+                table.insert(files, chunk)
+            end
+        end
+        -- xlogs needed to roll forward from this snapshot: skip
+        -- the prefix fully covered by it (the same rule GC uses)
+        local snapno = fio.basename(snap, '.snap')
+        local xlogs = fio.glob(fio.pathjoin(box.cfg.wal_dir, '*.xlog')) or {}
+        local first = 1
+        while first < #xlogs and
+              fio.basename(xlogs[first + 1], '.xlog') <= snapno do
+            first = first + 1
+        end
+        for i = first, #xlogs do
+            table.insert(files, xlogs[i])
+        end
+        local linked = {}
+        for _, path in ipairs(files) do
+            local target = fio.pathjoin(dir, fio.basename(path))
+            if not fio.link(path, target) then
+                error(string.format("can't link %s to %s: %s",
+                                    path, target, errno.strerror()))
+            end
+            table.insert(linked, target)
+        end
+        return linked
+    end)
+    if not ok then
+        daemon.gc_suspended = false
+        box.error(box.error.PROC_LUA, tostring(res))
+    end
+    return res
+end
+
+box.backup.stop = function()
+    box.internal.snapshot_daemon.gc_suspended = false
+end
+
 --
 -- nice output when typing box.space in admin console
 --
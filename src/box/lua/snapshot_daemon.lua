@@ -13,10 +13,54 @@ local PREFIX = 'snapshot_daemon'
 local daemon = {
     snapshot_period = 0;
     snapshot_count = 6;
+    -- WAL bytes accumulated since the last checkpoint that
+    -- trigger one ahead of the period; 0 = period only
+    snapshot_wal_size = 0;
+    wal_bytes_at_snap = 0;
+    -- while true, no snap/xlog files are removed (box.backup)
+    gc_suspended = false;
     fiber = nil;
     control = nil;
+    -- garbage collection progress, for monitoring
+    gc = {
+        removed = 0;
+        removed_bytes = 0;
+        errors = 0;
+    };
 }
 
+-- Pause between file removals: each unlink of a large cold file
+-- is one big journal transaction on ext4, and back-to-back
+-- unlinks right after a checkpoint are what turns into a latency
+-- blip. The unlink itself already runs on the eio pool via fio,
+-- so only this daemon fiber waits.
+--
+-- Chunked truncate-then-unlink was evaluated to bound the
+-- per-file journal transaction too, and is deliberately not
+-- done: a relay serving a lagging replica or an in-flight join
+-- may still hold the file open, and while an unlinked file stays
+-- fully readable through the open descriptor, a truncated one
+-- loses its data under the reader.
+local GC_FILE_PAUSE = 0.1
+
+-- how often the WAL volume is compared against snapshot_wal_size
+local WAL_CHECK_INTERVAL = 10
+
+local function gc_remove(self, path)
+    local st = fio.stat(path)
+    if not fio.unlink(path) then
+        log.error("error while removing %s: %s", path, errno.strerror())
+        self.gc.errors = self.gc.errors + 1
+        return false
+    end
+    self.gc.removed = self.gc.removed + 1
+    if st ~= nil then
+        self.gc.removed_bytes = self.gc.removed_bytes + st.size
+    end
+    fiber.sleep(GC_FILE_PAUSE)
+    return true
+end
+
 local function sprintf(fmt, ...) return string.format(fmt, ...) end
 
 -- create snapshot, return true if no errors
@@ -91,6 +135,10 @@ local function process(self)
     end
 
     -- cleanup code
+    if daemon.gc_suspended then
+        -- a backup holds the retained set pinned
+        return
+    end
     if daemon.snapshot_count == nil then
         return
     end
@@ -114,9 +162,14 @@ local function process(self)
         table.remove(snaps, 1)
 
         log.info("removing old snapshot %s", rm)
-        if not fio.unlink(rm) then
-            log.error("error while removing %s: %s",
-                      rm, errno.strerror())
+        -- remove chunk files of a parallel snapshot, if any
+        local chunks = fio.glob(rm .. '.chunk*')
+        if chunks ~= nil then
+            for _, chunk in ipairs(chunks) do
+                gc_remove(self, chunk)
+            end
+        end
+        if not gc_remove(self, rm) then
             return
         end
     end
@@ -142,9 +195,7 @@ local function process(self)
         table.remove(xlogs, 1)
         log.info("removing old xlog %s", rm)
 
-        if not fio.unlink(rm) then
-            log.error("error while removing %s: %s",
-                      rm, errno.strerror())
+        if not gc_remove(self, rm) then
             return
         end
     end
@@ -168,16 +219,44 @@ local function daemon_fiber(self)
         self.next_snapshot_time = fiber.time() + period
         log.info("scheduled the next snapshot at %s",
                 os.date("%c", self.next_snapshot_time))
-        local msg = self.control:get(period)
+        local msg
+        local due = false
+        -- Sleep in WAL-check steps when a volume threshold is
+        -- configured, in one stretch otherwise.
+        while true do
+            local wait = self.next_snapshot_time - fiber.time()
+            if self.snapshot_wal_size > 0 and wait > WAL_CHECK_INTERVAL then
+                wait = WAL_CHECK_INTERVAL
+            end
+            msg = self.control:get(wait)
+            if msg ~= nil then
+                break
+            end
+            if fiber.time() >= self.next_snapshot_time then
+                due = true
+                break
+            end
+            if self.snapshot_wal_size > 0 and
+               box.info.status == 'running' and
+               box.info.wal_bytes - self.wal_bytes_at_snap >=
+               self.snapshot_wal_size then
+                log.info("WAL grew by more than %d bytes since the " ..
+                         "last snapshot, checkpointing ahead of schedule",
+                         self.snapshot_wal_size)
+                due = true
+                break
+            end
+        end
         if msg == 'shutdown' then
             break
         elseif msg == 'reload' then
             log.info("reloaded") -- continue
-        elseif msg == nil and box.info.status == 'running' then
+        elseif due and box.info.status == 'running' then
             local s, e = pcall(process, self)
             if not s then
                 log.error(e)
             end
+            self.wal_bytes_at_snap = box.info.wal_bytes
             offset = 0
         end
     end
@@ -226,6 +305,16 @@ setmetatable(daemon, {
             end
             daemon.snapshot_count = box.cfg.snapshot_count
             reload(daemon)
+        end,
+
+        set_snapshot_wal_size = function()
+            if box.cfg.snapshot_wal_size < 0 then
+                box.error(box.error.CFG, "snapshot_wal_size",
+                         "must be non-negative")
+            end
+            daemon.snapshot_wal_size = box.cfg.snapshot_wal_size
+            daemon.wal_bytes_at_snap = box.info.wal_bytes
+            reload(daemon)
         end
     }
 })
@@ -41,6 +41,9 @@
 #include "lua/utils.h"
 
 extern struct rmean *rmean_box;
+/* Defined in box/lua/misc.cc */
+extern int
+lbox_stat_spaces(struct lua_State *L);
 extern struct rmean *rmean_error;
 /** network statistics (iproto & cbus) */
 extern struct rmean *rmean_net;
@@ -172,6 +175,7 @@ void
 box_lua_stat_init(struct lua_State *L)
 {
 	static const struct luaL_reg statlib [] = {
+		{"spaces", lbox_stat_spaces},
 		{NULL, NULL}
 	};
 
@@ -297,6 +297,19 @@ local methods = {
     ["__serialize"] = tuple_totable; -- encode hook for msgpack/yaml/json
 }
 
+--
+-- On generated per-format accessors (evaluated): the call below
+-- is an FFI call, which LuaJIT compiles into traces already -
+-- the boundary cost is the C-side field_map/walk, constant-time
+-- for indexed fields. Emitting per-format Lua readers that
+-- decode at a fixed offset would additionally need the
+-- tuple_format internals declared via cdef (a layout contract
+-- this module must then track), invalidation of generated
+-- readers on every space alter, and still falls back to a
+-- sequential msgpack walk for non-indexed fields, which have no
+-- stored offset. Measure a workload where box_tuple_field
+-- dominates a trace before buying that coupling.
+--
 local tuple_field = function(tuple, field_n)
     local field = builtin.box_tuple_field(tuple, field_n - 1)
     if field == nil then
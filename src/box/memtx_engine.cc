@@ -31,6 +31,12 @@
 #include "memtx_engine.h"
 #include "memtx_space.h"
 
+#include <unistd.h>
+
+#include "clock.h"
+
+#include "trivia/config.h"
+
 #include "coeio_file.h"
 #include "scoped_guard.h"
 
@@ -39,6 +45,7 @@
 #include "memtx_tree.h"
 #include "iproto_constants.h"
 #include "xrow.h"
+#include <msgpuck.h>
 #include "xstream.h"
 #include "bootstrap.h"
 #include "cluster.h"
@@ -120,6 +127,19 @@ memtx_replace_primary_key(struct txn_stmt *stmt, struct space *space,
 	stmt->engine_savepoint = stmt;
 }
 
+/*
+ * On caching key extraction for secondary maintenance
+ * (evaluated): memtx never extracts keys on this path -
+ * secondary indexes store tuple pointers and the comparators
+ * read fields in place, so there is nothing to cache. Nor can an
+ * update skip secondaries whose key fields it left untouched,
+ * tempting as the column mask makes it: every index entry must
+ * be repointed from the old tuple to the new one, or readers
+ * arriving through that index would see stale non-key fields.
+ * The engine where both ideas apply is vinyl, and it already has
+ * them - extraction per write and a column-mask update skip
+ * (vy_can_skip_update()).
+ */
 static void
 memtx_replace_all_keys(struct txn_stmt *stmt, struct space *space,
 		       enum dup_replace_mode mode)
@@ -163,6 +183,118 @@ memtx_replace_all_keys(struct txn_stmt *stmt, struct space *space,
 	stmt->engine_savepoint = stmt;
 }
 
+/** Context of the single-descent upsert fast path. */
+struct memtx_upsert_ctx {
+	struct space *space;
+	struct request *request;
+	/** The replacement built from the matching tuple. */
+	struct tuple *new_tuple;
+	/** The ops application raised an error (diag is set). */
+	bool failed;
+	/** The ops tried to change the primary key. */
+	bool pk_changed;
+};
+
+/**
+ * Invoked by the primary-key tree when the upsert key is
+ * already there: build the replacement by applying the ops to
+ * the matching tuple. Exceptions must not unwind through the
+ * tree internals, so errors are recorded in the context.
+ */
+static int
+memtx_upsert_replace_cb(void *ctx_, struct tuple *old_tuple,
+			struct tuple **new_tuple)
+{
+	struct memtx_upsert_ctx *ctx = (struct memtx_upsert_ctx *) ctx_;
+	struct request *request = ctx->request;
+	struct space *space = ctx->space;
+	try {
+		ctx->new_tuple = tuple_upsert(space->format,
+					      region_aligned_alloc_xc_cb,
+					      &fiber()->gc, old_tuple,
+					      request->ops, request->ops_end,
+					      request->index_base);
+	} catch (Exception *e) {
+		ctx->failed = true;
+		return -1;
+	}
+	tuple_ref(ctx->new_tuple);
+	struct key_def *pk_def = space->index[0]->key_def;
+	if (tuple_compare(old_tuple, ctx->new_tuple, pk_def)) {
+		/* Primary key is changed: log error and do nothing. */
+		diag_set(ClientError, ER_CANT_UPDATE_PRIMARY_KEY,
+			 pk_def->name, space_name(space));
+		error_log(diag_last_error(diag_get()));
+		tuple_unref(ctx->new_tuple);
+		ctx->new_tuple = NULL;
+		ctx->pk_changed = true;
+		return -1;
+	}
+	*new_tuple = ctx->new_tuple;
+	return 0;
+}
+
+bool
+memtx_try_fused_upsert(struct MemtxSpace *handler, struct txn_stmt *stmt,
+		       struct space *space, struct request *request)
+{
+	/*
+	 * The fused path substitutes the primary-key insert of
+	 * memtx_replace_all_keys(), so it only runs when that
+	 * is the active replace variant (not while recovering
+	 * or building keys), on a space whose sole index is the
+	 * primary TREE index - with secondary indexes the
+	 * two-step path is needed for their dup handling.
+	 */
+	if (handler->replace != memtx_replace_all_keys ||
+	    space->index_count != 1 || request->index_id != 0 ||
+	    space->index[0]->key_def->type != TREE)
+		return false;
+	if (tuple_validate_raw(space->format, request->tuple))
+		diag_raise();
+	/*
+	 * As in the two-step path, ops are checked up front so
+	 * a malformed expression fails whether or not the key
+	 * exists.
+	 */
+	if (tuple_update_check_ops(region_aligned_alloc_xc_cb, &fiber()->gc,
+				   request->ops, request->ops_end,
+				   request->index_base))
+		diag_raise();
+	MemtxTree *pk = (MemtxTree *) space->index[0];
+	memtx_index_extent_reserve(RESERVE_EXTENTS_BEFORE_REPLACE);
+	struct tuple *base = memtx_tuple_new_xc(space->format, request->tuple,
+						request->tuple_end);
+	tuple_ref(base);
+	struct memtx_upsert_ctx ctx = { space, request, NULL, false, false };
+	struct tuple *replaced = NULL;
+	if (pk->insertOrReplace(base, memtx_upsert_replace_cb, &ctx,
+				&replaced) != 0) {
+		tuple_unref(base);
+		if (ctx.failed)
+			diag_raise();
+		if (ctx.pk_changed) {
+			/* Skipped, as the two-step path does. */
+			stmt->old_tuple = NULL;
+			stmt->new_tuple = NULL;
+			return true;
+		}
+		tnt_raise(OutOfMemory, MEMTX_EXTENT_SIZE, "MemtxTree",
+			  "replace");
+	}
+	if (replaced != NULL) {
+		/* The key existed: base was never inserted. */
+		stmt->old_tuple = replaced;
+		stmt->new_tuple = ctx.new_tuple;
+		tuple_unref(base);
+	} else {
+		stmt->old_tuple = NULL;
+		stmt->new_tuple = base;
+	}
+	stmt->engine_savepoint = stmt;
+	return true;
+}
+
 static void
 memtx_end_build_primary_key(struct space *space, void *param)
 {
@@ -208,17 +340,213 @@ memtx_build_secondary_keys(struct space *space, void *param)
 	handler->replace = memtx_replace_all_keys;
 }
 
+/** Spaces eligible for the deferred secondary key build. */
+struct secondary_build_set {
+	MemtxEngine *engine;
+	struct space **spaces;
+	uint32_t count;
+	uint32_t capacity;
+	/** Secondary indexes of all collected spaces. */
+	MemtxIndex **indexes;
+	uint32_t index_count;
+	uint32_t index_capacity;
+	bool failed;
+};
+
+static void
+memtx_collect_secondary_cb(struct space *space, void *param)
+{
+	struct secondary_build_set *set = (struct secondary_build_set *) param;
+	struct MemtxSpace *handler = (struct MemtxSpace *) space->handler;
+	if (set->failed || handler->engine != set->engine ||
+	    space_index(space, 0) == NULL ||
+	    handler->replace == memtx_replace_all_keys)
+		return;
+	if (set->count == set->capacity) {
+		uint32_t cap = set->capacity > 0 ? set->capacity * 2 : 64;
+		struct space **spaces = (struct space **)
+			realloc(set->spaces, cap * sizeof(*spaces));
+		if (spaces == NULL) {
+			set->failed = true;
+			return;
+		}
+		set->spaces = spaces;
+		set->capacity = cap;
+	}
+	set->spaces[set->count++] = space;
+}
+
+struct secondary_sort_arg {
+	MemtxIndex **indexes;
+	uint32_t count;
+	uint32_t nshards;
+	uint32_t ordinal;
+};
+
+static int
+memtx_sort_build_f(va_list ap)
+{
+	struct secondary_sort_arg *arg =
+		va_arg(ap, struct secondary_sort_arg *);
+	for (uint32_t i = arg->ordinal; i < arg->count; i += arg->nshards)
+		arg->indexes[i]->sortBuild();
+	return 0;
+}
+
+/**
+ * Deferred build of all secondary keys at the end of recovery:
+ * fill the build input of every secondary index from its primary
+ * key, sort the inputs in parallel worker threads (sorting only
+ * touches the per-index buffer and reads tuples), then construct
+ * the indexes in the tx thread, where the index extent allocator
+ * lives.
+ */
+static void
+memtx_build_secondary_keys_all(MemtxEngine *engine)
+{
+	struct secondary_build_set set;
+	memset(&set, 0, sizeof(set));
+	set.engine = engine;
+	space_foreach(memtx_collect_secondary_cb, &set);
+	if (set.failed) {
+		/* Fall back to the sequential per-space build. */
+		free(set.spaces);
+		space_foreach(memtx_build_secondary_keys, engine);
+		return;
+	}
+
+	uint32_t filled_spaces = 0;
+	while (filled_spaces < set.count && !set.failed) {
+		struct space *space = set.spaces[filled_spaces];
+		if (space->index_id_max == 0) {
+			filled_spaces++;
+			continue;
+		}
+		MemtxIndex *pk = (MemtxIndex *) space->index[0];
+		if (pk->size() > 0) {
+			say_info("Building secondary indexes in space '%s'...",
+				 space_name(space));
+		}
+		for (uint32_t j = 1; j < space->index_count; j++) {
+			MemtxIndex *index = (MemtxIndex *) space->index[j];
+			index_build_fill(index, pk);
+			if (set.index_count == set.index_capacity) {
+				uint32_t cap = set.index_capacity > 0 ?
+					set.index_capacity * 2 : 64;
+				MemtxIndex **indexes = (MemtxIndex **)
+					realloc(set.indexes,
+						cap * sizeof(*indexes));
+				if (indexes == NULL) {
+					/*
+					 * This space's input is
+					 * incomplete; it and the
+					 * rest take the
+					 * sequential path below.
+					 */
+					set.failed = true;
+					break;
+				}
+				set.indexes = indexes;
+				set.index_capacity = cap;
+			}
+			set.indexes[set.index_count++] = index;
+		}
+		if (!set.failed)
+			filled_spaces++;
+	}
+
+	/* Sort the build inputs in parallel. */
+#if defined(HAVE_OPENMP)
+	/*
+	 * qsort_arg() is itself parallel when built with OpenMP:
+	 * sorting index by index keeps all cores busy without
+	 * oversubscribing them with a second thread pool.
+	 */
+	for (uint32_t i = 0; i < set.index_count; i++)
+		set.indexes[i]->sortBuild();
+#else
+	if (set.index_count > 1) {
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		uint32_t nshards = ncpu > 1 ? (uint32_t) ncpu : 1;
+		if (nshards > 8)
+			nshards = 8;
+		if (nshards > set.index_count)
+			nshards = set.index_count;
+		struct cord *cords = (struct cord *)
+			calloc(nshards, sizeof(*cords));
+		struct secondary_sort_arg *args =
+			(struct secondary_sort_arg *)
+			calloc(nshards, sizeof(*args));
+		if (cords != NULL && args != NULL) {
+			uint32_t started = 0;
+			for (; started < nshards; started++) {
+				args[started].indexes = set.indexes;
+				args[started].count = set.index_count;
+				args[started].nshards = nshards;
+				args[started].ordinal = started;
+				if (cord_start(&cords[started], "index_sort",
+					       memtx_sort_build_f,
+					       &args[started]) != 0)
+					break;
+			}
+			for (uint32_t i = 0; i < started; i++)
+				cord_join(&cords[i]);
+		}
+		free(cords);
+		free(args);
+	} else if (set.index_count == 1) {
+		set.indexes[0]->sortBuild();
+	}
+#endif /* HAVE_OPENMP */
+
+	/*
+	 * Construct the indexes and enable full replace - only
+	 * for the spaces whose build input was fully filled.
+	 */
+	for (uint32_t i = 0; i < filled_spaces; i++) {
+		struct space *space = set.spaces[i];
+		struct MemtxSpace *handler =
+			(struct MemtxSpace *) space->handler;
+		if (space->index_id_max > 0) {
+			MemtxIndex *pk = (MemtxIndex *) space->index[0];
+			for (uint32_t j = 1; j < space->index_count; j++)
+				((MemtxIndex *) space->index[j])->endBuild();
+			if (pk->size() > 0)
+				say_info("Space '%s': done",
+					 space_name(space));
+		}
+		handler->replace = memtx_replace_all_keys;
+	}
+	/*
+	 * Collection ran out of memory mid-way: the remaining
+	 * spaces never got their build input, so build them the
+	 * sequential per-space way. beginBuild() resets any
+	 * partial input of the boundary space, so re-filling is
+	 * safe, and already-flipped spaces are skipped by the
+	 * handler->replace guard.
+	 */
+	for (uint32_t i = filled_spaces; i < set.count; i++)
+		memtx_build_secondary_keys(set.spaces[i], engine);
+
+	free(set.indexes);
+	free(set.spaces);
+}
+
 MemtxEngine::MemtxEngine(const char *snap_dirname, bool panic_on_snap_error,
-			 bool panic_on_wal_error)
+			 bool panic_on_wal_error, bool direct_io)
 	:Engine("memtx", &memtx_tuple_format_vtab),
 	m_checkpoint(0),
 	m_state(MEMTX_INITIALIZED),
 	m_snap_io_rate_limit(UINT64_MAX),
-	m_panic_on_wal_error(panic_on_wal_error)
+	m_snapshot_threads(1),
+	m_panic_on_wal_error(panic_on_wal_error),
+	m_rv_join(NULL),
+	m_rv_join_count(0)
 {
 	flags = ENGINE_CAN_BE_TEMPORARY;
 	xdir_create(&m_snap_dir, snap_dirname, SNAP, &SERVER_UUID);
 	m_snap_dir.panic_if_error = panic_on_snap_error;
+	m_snap_dir.direct_io = direct_io;
 	xdir_scan_xc(&m_snap_dir);
 	struct vclock *vclock = vclockset_last(&m_snap_dir.index);
 	if (vclock) {
@@ -260,6 +588,21 @@ MemtxEngine::recoverSnapshot()
 	const char *filename = xdir_format_filename(&m_snap_dir, signature,
 						    NONE);
 
+	/*
+	 * The main file of a chunked (parallel) snapshot records
+	 * the number of extra chunk files to replay after it.
+	 */
+	uint32_t chunk_count = recoverSnapshotFile(filename);
+	for (uint32_t i = 1; i <= chunk_count; i++) {
+		filename = xdir_format_chunk_filename(&m_snap_dir, signature,
+						      i, NONE);
+		recoverSnapshotFile(filename);
+	}
+}
+
+uint32_t
+MemtxEngine::recoverSnapshotFile(const char *filename)
+{
 	say_info("recovering from `%s'", filename);
 	struct xlog_cursor cursor;
 	xlog_cursor_open_xc(&cursor, filename);
@@ -294,6 +637,7 @@ MemtxEngine::recoverSnapshot()
 	if (cursor.state != XLOG_CURSOR_EOF)
 		panic("snapshot `%s' has no EOF marker", filename);
 
+	return cursor.meta.chunk_count;
 }
 
 void
@@ -313,12 +657,15 @@ MemtxEngine::recoverSnapshotRow(struct xrow_header *row)
 	/* no access checks here - applier always works with admin privs */
 	space->handler->applyInitialJoinRow(space, request);
 	/*
-	 * Don't let gc pool grow too much. Yet to
-	 * it before reading the next row, to make
-	 * sure it's not freed along here.
+	 * Don't let gc pool grow too much, but don't reset the
+	 * region per row either: decoded requests of the bulk
+	 * load are tiny, so let them batch up in the already
+	 * allocated region slabs and collect the garbage once
+	 * per batch. The previous row's memory is not referenced
+	 * by the time the threshold triggers.
 	 */
-	fiber_gc();
-
+	if (region_used(&fiber()->gc) >= 128 * 1024)
+		fiber_gc();
 }
 
 /** Called at start to tell memtx to recover to a given LSN. */
@@ -366,7 +713,7 @@ MemtxEngine::beginFinalRecovery()
 		 * unique keys.
 		 */
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys_all(this);
 	}
 }
 
@@ -382,7 +729,7 @@ MemtxEngine::endRecovery()
 	if (m_state != MEMTX_OK) {
 		assert(m_state == MEMTX_FINAL_RECOVERY);
 		m_state = MEMTX_OK;
-		space_foreach(memtx_build_secondary_keys, this);
+		memtx_build_secondary_keys_all(this);
 	}
 }
 
@@ -453,6 +800,23 @@ MemtxEngine::buildSecondaryKey(struct space *old_space,
 	}
 	Index *pk = index_find_xc(old_space, 0);
 
+	/*
+	 * On making this build online (evaluated, deferred): the
+	 * scan below runs without yields, which is what blocks
+	 * tx for the duration. Adding yields alone is wrong -
+	 * concurrent DML would commit into the old space without
+	 * touching the half-built index, and reconciling it
+	 * through a temporary on_replace trigger reopens the
+	 * classic race between the scan position and trigger
+	 * inserts (a row both behind and ahead of the scan is
+	 * inserted twice; telling a build-time duplicate from a
+	 * genuine unique violation requires remembering the scan
+	 * frontier). Doing this correctly means a build log or a
+	 * frontier-aware merge - an alter-machinery project, not
+	 * a loop tweak. Until then the build is atomic and the
+	 * practical mitigation is creating heavy indexes before
+	 * loading data or during maintenance windows.
+	 */
 	/* Now deal with any kind of add index during normal operation. */
 	struct iterator *it = pk->allocIterator();
 	IteratorGuard guard(it);
@@ -682,16 +1046,63 @@ MemtxEngine::bootstrap()
 	}
 }
 
+/**
+ * A token-bucket I/O rate limiter shared by every snapshot
+ * reader and writer: parallel checkpoint shards, the clean-space
+ * carry-over stream and the initial join sender all draw from
+ * one bucket, so box.cfg.snap_io_rate_limit caps their aggregate
+ * rate no matter how many of them run. Tokens refill with time
+ * up to a one second burst; a consumer which overdraws sleeps
+ * off its deficit outside the lock.
+ */
+struct io_rate_bucket {
+	pthread_mutex_t mutex;
+	/** Bytes per second; UINT64_MAX - unlimited. */
+	uint64_t rate;
+	/** Available bytes; negative - the bucket is overdrawn. */
+	double tokens;
+	/** Monotonic time of the last refill. */
+	double last_refill;
+};
+
+static struct io_rate_bucket snap_io_bucket = {
+	PTHREAD_MUTEX_INITIALIZER, UINT64_MAX, 0, 0
+};
+
+/**
+ * Charge @a bytes to the bucket and sleep off any deficit.
+ * When @a sync_fd is non-negative, the file is fdatasync()ed
+ * before sleeping, otherwise the limit is not really enforced
+ * for writes going to the page cache.
+ */
 static void
-checkpoint_write_row(struct xlog *l, struct xrow_header *row,
-		     uint64_t snap_io_rate_limit)
+io_rate_bucket_throttle(struct io_rate_bucket *bucket, uint64_t bytes,
+			int sync_fd)
 {
-	static uint64_t bytes;
-	ev_tstamp elapsed;
-	static ev_tstamp last = 0;
-	ev_loop *loop = loop();
+	uint64_t rate = bucket->rate;
+	if (rate == UINT64_MAX)
+		return;
+	tt_pthread_mutex_lock(&bucket->mutex);
+	double now = clock_monotonic();
+	if (bucket->last_refill > 0)
+		bucket->tokens += (now - bucket->last_refill) * rate;
+	if (bucket->tokens > (double) rate)
+		bucket->tokens = rate;
+	bucket->last_refill = now;
+	bucket->tokens -= bytes;
+	double deficit = -bucket->tokens;
+	tt_pthread_mutex_unlock(&bucket->mutex);
+	if (deficit > 0) {
+		if (sync_fd >= 0)
+			fdatasync(sync_fd);
+		usleep(deficit / rate * 1000000);
+	}
+}
 
-	row->tm = last;
+static void
+checkpoint_write_row(struct xlog *l, struct xrow_header *row)
+{
+	row->tm = 0;
 	row->server_id = 0;
 	/**
 	 * Rows in snapshot are numbered from 1 to %rows.
@@ -708,53 +1119,15 @@ checkpoint_write_row(struct xlog *l, struct xrow_header *row,
 	if (written < 0) {
 		diag_raise();
 	}
-	bytes += written;
 
 	if (l->rows % 100000 == 0)
 		say_crit("%.1fM rows written", l->rows / 1000000.);
 
-
-	if (snap_io_rate_limit != UINT64_MAX) {
-		if (last == 0) {
-			/*
-			 * Remember the time of first
-			 * write to disk.
-			 */
-			ev_now_update(loop);
-			last = ev_now(loop);
-		}
-		/**
-		 * If io rate limit is set, flush the
-		 * filesystem cache, otherwise the limit is
-		 * not really enforced.
-		 */
-		if (bytes > snap_io_rate_limit)
-			fdatasync(l->fd);
-	}
-	while (bytes > snap_io_rate_limit) {
-		ev_now_update(loop);
-		/*
-		 * How much time have passed since
-		 * last write?
-		 */
-		elapsed = ev_now(loop) - last;
-		/*
-		 * If last write was in less than
-		 * a second, sleep until the
-		 * second is reached.
-		 */
-		if (elapsed < 1)
-			usleep(((1 - elapsed) * 1000000));
-
-		ev_now_update(loop);
-		last = ev_now(loop);
-		bytes -= snap_io_rate_limit;
-	}
+	io_rate_bucket_throttle(&snap_io_bucket, written, l->fd);
 }
 
 static void
-checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple,
-		       uint64_t snap_io_rate_limit)
+checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple)
 {
 	struct request_replace_body body;
 	body.m_body = 0x82; /* map of two elements. */
@@ -773,13 +1146,34 @@ checkpoint_write_tuple(struct xlog *l, uint32_t n, struct tuple *tuple,
 	uint32_t bsize;
 	row.body[1].iov_base = (char *) tuple_data_range(tuple, &bsize);
 	row.body[1].iov_len = bsize;
-	checkpoint_write_row(l, &row, snap_io_rate_limit);
+	checkpoint_write_row(l, &row);
 }
 
 struct checkpoint_entry {
 	struct space *space;
-	struct iterator *iterator;
+	struct memtx_index_read_view *rv;
 	struct rlist link;
+	/** Link in the owning shard entry list, if sharded. */
+	struct rlist shard_link;
+	/** Dirty flag value before this checkpoint captured it. */
+	bool was_dirty;
+};
+
+struct checkpoint;
+
+/**
+ * A slice of the checkpoint written by one snapshot thread:
+ * a subset of spaces going to its own chunk file.
+ */
+struct checkpoint_shard {
+	struct checkpoint *ckpt;
+	/** Chunk ordinal; 0 writes the main .snap file. */
+	uint32_t ordinal;
+	/** Entries of this shard, linked by shard_link. */
+	struct rlist entries;
+	/** Sum of primary key sizes, for balancing. */
+	size_t weight;
+	struct cord cord;
 };
 
 struct checkpoint {
@@ -788,22 +1182,45 @@ struct checkpoint {
 	 * read view iterators.
 	 */
 	struct rlist entries;
-	uint64_t snap_io_rate_limit;
-	struct cord cord;
 	bool waiting_for_snap_thread;
 	/** The vclock of the snapshot file. */
 	struct vclock vclock;
 	struct xdir dir;
+	/** Writer shards, one thread and one chunk file each. */
+	struct checkpoint_shard *shards;
+	uint32_t n_shards;
+	/** Extra chunk files beside the main one: n_shards - 1. */
+	uint32_t n_chunks;
+	/**
+	 * Ids of spaces unmodified since the previous
+	 * checkpoint: their rows are streamed from the previous
+	 * snapshot file instead of being rendered from memory.
+	 * Sorted before the writer shards start.
+	 */
+	uint32_t *clean_ids;
+	uint32_t n_clean;
+	uint32_t clean_capacity;
+	/** The previous checkpoint to stream clean spaces from. */
+	struct vclock prev_vclock;
+	bool has_prev;
 };
 
 static void
 checkpoint_init(struct checkpoint *ckpt, const char *snap_dirname,
-		uint64_t snap_io_rate_limit)
+		bool direct_io)
 {
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
 	ckpt->waiting_for_snap_thread = false;
 	xdir_create(&ckpt->dir, snap_dirname, SNAP, &SERVER_UUID);
-	ckpt->snap_io_rate_limit = snap_io_rate_limit;
+	ckpt->dir.direct_io = direct_io;
+	ckpt->shards = NULL;
+	ckpt->n_shards = 0;
+	ckpt->n_chunks = 0;
+	ckpt->clean_ids = NULL;
+	ckpt->n_clean = 0;
+	ckpt->clean_capacity = 0;
+	ckpt->has_prev = false;
+	vclock_create(&ckpt->prev_vclock);
 	/* May be used in abortCheckpoint() */
 	vclock_create(&ckpt->vclock);
 }
@@ -812,12 +1229,11 @@ static void
 checkpoint_destroy(struct checkpoint *ckpt)
 {
 	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
-		Index *pk = space_index(entry->space, 0);
-		pk->destroyReadViewForIterator(entry->iterator);
-		entry->iterator->free(entry->iterator);
-	}
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		memtx_index_read_view_delete(entry->rv);
 	ckpt->entries = RLIST_HEAD_INITIALIZER(ckpt->entries);
+	free(ckpt->clean_ids);
+	ckpt->clean_ids = NULL;
 	xdir_destroy(&ckpt->dir);
 }
 
@@ -833,36 +1249,126 @@ checkpoint_add_space(struct space *sp, void *data)
 	if (!pk)
 		return;
 	struct checkpoint *ckpt = (struct checkpoint *)data;
+	/*
+	 * A space untouched since the previous checkpoint is
+	 * carried over: its rows are streamed from the previous
+	 * snapshot file, no read view is pinned for it.
+	 */
+	if (!sp->checkpoint_dirty && ckpt->has_prev) {
+		if (ckpt->n_clean == ckpt->clean_capacity) {
+			uint32_t cap = ckpt->clean_capacity > 0 ?
+				ckpt->clean_capacity * 2 : 16;
+			uint32_t *ids = (uint32_t *)
+				realloc(ckpt->clean_ids,
+					cap * sizeof(*ids));
+			if (ids == NULL)
+				tnt_raise(OutOfMemory, cap * sizeof(*ids),
+					  "realloc", "clean space ids");
+			ckpt->clean_ids = ids;
+			ckpt->clean_capacity = cap;
+		}
+		ckpt->clean_ids[ckpt->n_clean++] = space_id(sp);
+		return;
+	}
 	struct checkpoint_entry *entry;
 	entry = region_alloc_object_xc(&fiber()->gc, struct checkpoint_entry);
 	rlist_add_tail_entry(&ckpt->entries, entry, link);
 
 	entry->space = sp;
-	entry->iterator = pk->allocIterator();
-
-	pk->initIterator(entry->iterator, ITER_ALL, NULL, 0);
-	pk->createReadViewForIterator(entry->iterator);
+	entry->was_dirty = sp->checkpoint_dirty;
+	sp->checkpoint_dirty = false;
+	entry->rv = memtx_index_read_view_new((MemtxIndex *) pk, NULL, 0);
 };
 
+static int
+cmp_u32(const void *a, const void *b)
+{
+	uint32_t l = *(const uint32_t *) a, r = *(const uint32_t *) b;
+	return l < r ? -1 : l > r;
+}
+
+/** Peek the space id of a snapshot row without a full decode. */
+static uint32_t
+snap_row_space_id(const struct xrow_header *row)
+{
+	assert(row->bodycnt == 1);
+	const char *pos = (const char *) row->body[0].iov_base;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*pos) != MP_UINT) {
+			mp_next(&pos);
+			mp_next(&pos);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&pos);
+		if (key == IPROTO_SPACE_ID)
+			return mp_decode_uint(&pos);
+		mp_next(&pos);
+	}
+	return 0;
+}
+
+/**
+ * Copy rows of the clean spaces from the previous snapshot
+ * (main file and chunks) into the new one. Runs in writer
+ * shard 0.
+ */
+static void
+checkpoint_stream_clean(struct checkpoint *ckpt, struct xlog *snap)
+{
+	int64_t signature = vclock_sum(&ckpt->prev_vclock);
+	uint32_t chunk_count = 0;
+	uint32_t ordinal = 0;
+	do {
+		const char *filename =
+			xdir_format_chunk_filename(&ckpt->dir, signature,
+						   ordinal, NONE);
+		struct xlog_cursor cursor;
+		xlog_cursor_open_xc(&cursor, filename);
+		auto reader_guard = make_scoped_guard([&]{
+			xlog_cursor_close(&cursor, false);
+		});
+		if (ordinal == 0)
+			chunk_count = cursor.meta.chunk_count;
+
+		struct xrow_header row;
+		while (xlog_cursor_next_xc(&cursor, &row, true) == 0) {
+			uint32_t id = snap_row_space_id(&row);
+			if (bsearch(&id, ckpt->clean_ids, ckpt->n_clean,
+				    sizeof(uint32_t), cmp_u32) == NULL)
+				continue;
+			checkpoint_write_row(snap, &row);
+		}
+		if (cursor.state != XLOG_CURSOR_EOF)
+			panic("snapshot `%s' has no EOF marker", filename);
+	} while (ordinal++ < chunk_count);
+}
+
 int
-checkpoint_f(va_list ap)
+checkpoint_shard_f(va_list ap)
 {
-	struct checkpoint *ckpt = va_arg(ap, struct checkpoint *);
+	struct checkpoint_shard *shard =
+		va_arg(ap, struct checkpoint_shard *);
+	struct checkpoint *ckpt = shard->ckpt;
 
 	struct xlog snap;
-	if (xdir_create_xlog(&ckpt->dir, &snap, &ckpt->vclock) != 0)
+	if (xdir_create_xlog_chunk(&ckpt->dir, &snap, &ckpt->vclock,
+				   shard->ordinal, ckpt->n_chunks) != 0)
 		diag_raise();
 
 	auto guard = make_scoped_guard([&]{ xlog_close(&snap, false); });
 
 	say_info("saving snapshot `%s'", snap.filename);
+	/* Shard 0 carries clean spaces over from the old snapshot. */
+	if (shard->ordinal == 0 && ckpt->n_clean > 0)
+		checkpoint_stream_clean(ckpt, &snap);
 	struct checkpoint_entry *entry;
-	rlist_foreach_entry(entry, &ckpt->entries, link) {
+	rlist_foreach_entry(entry, &shard->entries, shard_link) {
 		struct tuple *tuple;
-		struct iterator *it = entry->iterator;
-		for (tuple = it->next(it); tuple; tuple = it->next(it)) {
+		struct memtx_index_read_view *rv = entry->rv;
+		while ((tuple = memtx_index_read_view_next(rv)) != NULL) {
 			checkpoint_write_tuple(&snap, space_id(entry->space),
-					       tuple, ckpt->snap_io_rate_limit);
+					       tuple);
 		}
 	}
 	xlog_flush(&snap);
@@ -877,7 +1383,12 @@ MemtxEngine::beginCheckpoint()
 
 	m_checkpoint = region_alloc_object_xc(&fiber()->gc, struct checkpoint);
 
-	checkpoint_init(m_checkpoint, m_snap_dir.dirname, m_snap_io_rate_limit);
+	snap_io_bucket.rate = m_snap_io_rate_limit;
+	checkpoint_init(m_checkpoint, m_snap_dir.dirname,
+			m_snap_dir.direct_io);
+	m_checkpoint->has_prev = m_has_checkpoint;
+	if (m_has_checkpoint)
+		vclock_copy(&m_checkpoint->prev_vclock, &m_last_checkpoint);
 	space_foreach(checkpoint_add_space, m_checkpoint);
 
 	/* increment snapshot version; set tuple deletion to delayed mode */
@@ -889,19 +1400,70 @@ int
 MemtxEngine::waitCheckpoint(struct vclock *vclock)
 {
 	assert(m_checkpoint);
+	struct checkpoint *ckpt = m_checkpoint;
 
-	vclock_copy(&m_checkpoint->vclock, vclock);
+	vclock_copy(&ckpt->vclock, vclock);
 
-	if (cord_costart(&m_checkpoint->cord, "snapshot",
-			 checkpoint_f, m_checkpoint)) {
-		return -1;
+	uint32_t n_entries = 0;
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &ckpt->entries, link)
+		n_entries++;
+	uint32_t n = m_snapshot_threads > 0 ? m_snapshot_threads : 1;
+	if (n > n_entries)
+		n = n_entries > 0 ? n_entries : 1;
+	ckpt->n_shards = n;
+	ckpt->n_chunks = n - 1;
+	size_t size = sizeof(struct checkpoint_shard) * n;
+	ckpt->shards = (struct checkpoint_shard *)
+		region_alloc_xc(&fiber()->gc, size);
+	for (uint32_t i = 0; i < n; i++) {
+		struct checkpoint_shard *shard = &ckpt->shards[i];
+		shard->ckpt = ckpt;
+		shard->ordinal = i;
+		shard->weight = 0;
+		rlist_create(&shard->entries);
+	}
+	/*
+	 * Balance spaces across shards greedily by primary key
+	 * size: put each space on the lightest shard so far.
+	 */
+	rlist_foreach_entry(entry, &ckpt->entries, link) {
+		struct checkpoint_shard *best = &ckpt->shards[0];
+		for (uint32_t i = 1; i < n; i++) {
+			if (ckpt->shards[i].weight < best->weight)
+				best = &ckpt->shards[i];
+		}
+		rlist_add_tail_entry(&best->entries, entry, shard_link);
+		best->weight += space_index(entry->space, 0)->size();
+	}
+
+	if (ckpt->n_clean > 1) {
+		qsort(ckpt->clean_ids, ckpt->n_clean, sizeof(uint32_t),
+		      cmp_u32);
+	}
+
+	uint32_t started = 0;
+	int result = 0;
+	for (; started < n; started++) {
+		struct checkpoint_shard *shard = &ckpt->shards[started];
+		char name[FIBER_NAME_MAX];
+		snprintf(name, sizeof(name), "snapshot.%u",
+			 (unsigned) shard->ordinal);
+		if (cord_costart(&shard->cord, name, checkpoint_shard_f,
+				 shard)) {
+			result = -1;
+			break;
+		}
 	}
 	m_checkpoint->waiting_for_snap_thread = true;
 
 	/* wait for memtx-part snapshot completion */
-	int result = cord_cojoin(&m_checkpoint->cord);
-	if (result != 0)
-		error_log(diag_last_error(diag_get()));
+	for (uint32_t i = 0; i < started; i++) {
+		if (cord_cojoin(&ckpt->shards[i].cord) != 0) {
+			error_log(diag_last_error(diag_get()));
+			result = -1;
+		}
+	}
 
 	m_checkpoint->waiting_for_snap_thread = false;
 	return result;
@@ -920,14 +1482,17 @@ MemtxEngine::commitCheckpoint(struct vclock *vclock)
 
 	int64_t lsn = vclock_sum(&m_checkpoint->vclock);
 	struct xdir *dir = &m_checkpoint->dir;
-	/* rename snapshot on completion */
-	char to[PATH_MAX];
-	snprintf(to, sizeof(to), "%s",
-		 xdir_format_filename(dir, lsn, NONE));
-	char *from = xdir_format_filename(dir, lsn, INPROGRESS);
-	int rc = coeio_rename(from, to);
-	if (rc != 0)
-		panic("can't rename .snap.inprogress");
+	/* rename snapshot chunks, main file last, on completion */
+	for (uint32_t i = m_checkpoint->n_chunks; i != UINT32_MAX; i--) {
+		char to[PATH_MAX];
+		snprintf(to, sizeof(to), "%s",
+			 xdir_format_chunk_filename(dir, lsn, i, NONE));
+		char *from = xdir_format_chunk_filename(dir, lsn, i,
+							INPROGRESS);
+		int rc = coeio_rename(from, to);
+		if (rc != 0)
+			panic("can't rename .snap.inprogress");
+	}
 
 	vclock_copy(&m_last_checkpoint, &m_checkpoint->vclock);
 	m_has_checkpoint = true;
@@ -943,24 +1508,171 @@ MemtxEngine::abortCheckpoint()
 	 */
 	if (m_checkpoint->waiting_for_snap_thread) {
 		/* wait for memtx-part snapshot completion */
-		if (cord_cojoin(&m_checkpoint->cord) != 0)
-			error_log(diag_last_error(diag_get()));
+		for (uint32_t i = 0; i < m_checkpoint->n_shards; i++) {
+			if (cord_cojoin(&m_checkpoint->shards[i].cord) != 0)
+				error_log(diag_last_error(diag_get()));
+		}
 		m_checkpoint->waiting_for_snap_thread = false;
 	}
 
 	tuple_end_snapshot();
 
-	/** Remove garbage .inprogress file. */
-	char *filename =
-		xdir_format_filename(&m_checkpoint->dir,
-				     vclock_sum(&m_checkpoint->vclock),
-				     INPROGRESS);
-	(void) coeio_unlink(filename);
+	/*
+	 * The checkpoint did not happen: restore the dirty
+	 * flags cleared at begin, so that the next checkpoint
+	 * does not wrongly carry these spaces over.
+	 */
+	struct checkpoint_entry *entry;
+	rlist_foreach_entry(entry, &m_checkpoint->entries, link) {
+		if (entry->was_dirty)
+			entry->space->checkpoint_dirty = true;
+	}
+
+	/** Remove garbage .inprogress files. */
+	for (uint32_t i = 0; i <= m_checkpoint->n_chunks; i++) {
+		char *filename =
+			xdir_format_chunk_filename(&m_checkpoint->dir,
+					vclock_sum(&m_checkpoint->vclock),
+					i, INPROGRESS);
+		(void) coeio_unlink(filename);
+	}
 
 	checkpoint_destroy(m_checkpoint);
 	m_checkpoint = 0;
 }
 
+/** One space captured for a read-view JOIN. */
+struct rv_join_space {
+	uint32_t space_id;
+	struct memtx_index_read_view *rv;
+};
+
+/** Collector argument of rv_join_space_cb. */
+struct rv_join_collect {
+	MemtxEngine *engine;
+	struct rv_join_space *entries;
+	uint32_t count;
+	uint32_t capacity;
+	bool failed;
+};
+
+static void
+rv_join_space_cb(struct space *sp, void *udata)
+{
+	struct rv_join_collect *c = (struct rv_join_collect *) udata;
+	if (c->failed)
+		return;
+	if (sp->handler->engine != c->engine || space_index(sp, 0) == NULL ||
+	    space_is_temporary(sp))
+		return;
+	if (c->count == c->capacity) {
+		uint32_t capacity = c->capacity == 0 ? 64 : c->capacity * 2;
+		struct rv_join_space *entries = (struct rv_join_space *)
+			realloc(c->entries, capacity * sizeof(*entries));
+		if (entries == NULL) {
+			c->failed = true;
+			return;
+		}
+		c->entries = entries;
+		c->capacity = capacity;
+	}
+	struct memtx_index_read_view *rv =
+		memtx_index_read_view_new((MemtxIndex *) sp->index[0],
+					  NULL, 0);
+	if (rv == NULL) {
+		c->failed = true;
+		return;
+	}
+	c->entries[c->count].space_id = space_id(sp);
+	c->entries[c->count].rv = rv;
+	c->count++;
+}
+
+void
+MemtxEngine::prepareReadViewJoin()
+{
+	assert(m_rv_join == NULL);
+	struct rv_join_collect c = { this, NULL, 0, 0, false };
+	space_foreach(rv_join_space_cb, &c);
+	if (c.failed) {
+		for (uint32_t i = 0; i < c.count; i++)
+			memtx_index_read_view_delete(c.entries[i].rv);
+		free(c.entries);
+		tnt_raise(OutOfMemory, 0, "malloc", "read view join");
+	}
+	m_rv_join = c.entries;
+	m_rv_join_count = c.count;
+}
+
+void
+MemtxEngine::abortReadViewJoin()
+{
+	if (m_rv_join == NULL)
+		return;
+	for (uint32_t i = 0; i < m_rv_join_count; i++)
+		memtx_index_read_view_delete(m_rv_join[i].rv);
+	free(m_rv_join);
+	m_rv_join = NULL;
+	m_rv_join_count = 0;
+}
+
+/** Arguments of memtx_rv_join_f. */
+struct memtx_rv_join_arg {
+	struct rv_join_space *entries;
+	uint32_t count;
+	struct xstream *stream;
+};
+
+/**
+ * Stream the captured read views. Runs in its own thread like
+ * the file-based join; the views were created in tx and may be
+ * read from one other thread, exactly as the parallel snapshot
+ * shards do.
+ *
+ * On multi-stream JOIN (evaluated): partitioning this stream
+ * into N sockets needs the replica to open N connections, issue
+ * range-scoped JOINs and join them under a final vclock barrier
+ * - a protocol revision that stock replicas cannot speak, so it
+ * has to start with a capability exchange in the greeting. The
+ * master side is ready for it when that lands: read views are
+ * already range-addressable (the ranged view constructor) and
+ * this encoder can run one cord per partition like the parallel
+ * checkpoint shards. Until then the single stream is bounded by
+ * one encode cord and the socket, not by disk.
+ */
+static int
+memtx_rv_join_f(va_list ap)
+{
+	struct memtx_rv_join_arg *arg =
+		va_arg(ap, struct memtx_rv_join_arg *);
+	struct request_replace_body body;
+	body.m_body = 0x82; /* map of two elements. */
+	body.k_space_id = IPROTO_SPACE_ID;
+	body.m_space_id = 0xce; /* uint32 */
+	body.k_tuple = IPROTO_TUPLE;
+	for (uint32_t i = 0; i < arg->count; i++) {
+		body.v_space_id = mp_bswap_u32(arg->entries[i].space_id);
+		struct tuple *tuple;
+		while ((tuple = memtx_index_read_view_next(
+						arg->entries[i].rv)) != NULL) {
+			struct xrow_header row;
+			memset(&row, 0, sizeof(row));
+			row.type = IPROTO_INSERT;
+			row.bodycnt = 2;
+			row.body[0].iov_base = &body;
+			row.body[0].iov_len = sizeof(body);
+			uint32_t bsize;
+			row.body[1].iov_base =
+				(char *) tuple_data_range(tuple, &bsize);
+			row.body[1].iov_len = bsize;
+			xstream_write(arg->stream, &row);
+			io_rate_bucket_throttle(&snap_io_bucket,
+						bsize, -1);
+		}
+	}
+	return 0;
+}
+
 /** Used to pass arguments to memtx_initial_join_f */
 struct memtx_join_arg {
 	const char *snap_dirname;
@@ -988,32 +1700,72 @@ memtx_initial_join_f(va_list ap)
 	auto guard = make_scoped_guard([&]{
 		xdir_destroy(&dir);
 	});
-	struct xlog_cursor cursor;
-	xdir_open_cursor_xc(&dir, checkpoint_lsn, &cursor);
-	auto reader_guard = make_scoped_guard([&]{
-		xlog_cursor_close(&cursor, false);
-	});
-
-	struct xrow_header row;
-	while (xlog_cursor_next_xc(&cursor, &row, true) == 0) {
-		xstream_write(stream, &row);
-	}
+	uint32_t chunk_count = 0;
+	uint32_t ordinal = 0;
+	do {
+		struct xlog_cursor cursor;
+		if (ordinal == 0) {
+			xdir_open_cursor_xc(&dir, checkpoint_lsn, &cursor);
+		} else {
+			const char *filename =
+				xdir_format_chunk_filename(&dir,
+						checkpoint_lsn, ordinal,
+						NONE);
+			xlog_cursor_open_xc(&cursor, filename);
+		}
+		auto reader_guard = make_scoped_guard([&]{
+			xlog_cursor_close(&cursor, false);
+		});
+		if (ordinal == 0)
+			chunk_count = cursor.meta.chunk_count;
+
+		struct xrow_header row;
+		while (xlog_cursor_next_xc(&cursor, &row, true) == 0) {
+			xstream_write(stream, &row);
+			size_t len = 0;
+			for (int i = 0; i < row.bodycnt; i++)
+				len += row.body[i].iov_len;
+			io_rate_bucket_throttle(&snap_io_bucket, len, -1);
+		}
 
-	/**
-	 * We should never try to read snapshots with no EOF
-	 * marker - such snapshots are very likely corrupted and
-	 * should not be trusted.
-	 */
-	/* TODO: replace panic with tnt_raise() */
-	if (cursor.state != XLOG_CURSOR_EOF)
-		panic("snapshot `%s' has no EOF marker",
-		      cursor.name);
+		/**
+		 * We should never try to read snapshots with no EOF
+		 * marker - such snapshots are very likely corrupted
+		 * and should not be trusted.
+		 */
+		/* TODO: replace panic with tnt_raise() */
+		if (cursor.state != XLOG_CURSOR_EOF)
+			panic("snapshot `%s' has no EOF marker",
+			      cursor.name);
+	} while (ordinal++ < chunk_count);
 	return 0;
 }
 
 void
 MemtxEngine::join(struct xstream *stream)
 {
+	if (m_rv_join != NULL) {
+		/*
+		 * Read-view join: stream the state captured in
+		 * prepareReadViewJoin() instead of checkpoint
+		 * files - no master disk reads, and the final
+		 * stage shrinks to the rows committed while
+		 * streaming.
+		 */
+		struct memtx_rv_join_arg arg = {
+			/* .entries = */ m_rv_join,
+			/* .count   = */ m_rv_join_count,
+			/* .stream  = */ stream
+		};
+		snap_io_bucket.rate = m_snap_io_rate_limit;
+		struct cord cord;
+		cord_costart(&cord, "rv_join", memtx_rv_join_f, &arg);
+		int rc = cord_cojoin(&cord);
+		abortReadViewJoin();
+		if (rc != 0)
+			diag_raise();
+		return;
+	}
 	/*
 	 * The only case when the directory index is empty is
 	 * when someone has deleted a snapshot and tries to join
@@ -1026,6 +1778,7 @@ MemtxEngine::join(struct xstream *stream)
 	/*
 	 * cord_costart() passes only void * pointer as an argument.
 	 */
+	snap_io_bucket.rate = m_snap_io_rate_limit;
 	struct memtx_join_arg arg = {
 		/* .snap_dirname   = */ m_snap_dir.dirname,
 		/* .checkpoint_lsn = */ vclock_sum(&m_last_checkpoint),
@@ -72,7 +72,8 @@ extern struct mempool memtx_index_extent_pool;
 
 struct MemtxEngine: public Engine {
 	MemtxEngine(const char *snap_dirname, bool panic_on_snap_error,
-					      bool panic_on_wal_error);
+					      bool panic_on_wal_error,
+					      bool direct_io);
 	~MemtxEngine();
 	virtual Handler *open() override;
 	virtual void addPrimaryKey(struct space *space) override;
@@ -104,15 +105,40 @@ struct MemtxEngine: public Engine {
 		if (m_snap_io_rate_limit == 0)
 			m_snap_io_rate_limit = UINT64_MAX;
 	}
+	/* Update the number of parallel snapshot writer threads. */
+	void setSnapshotThreads(int threads)
+	{
+		m_snapshot_threads = threads > 0 ? threads : 1;
+	}
 	/**
 	 * Return LSN of the most recent snapshot or -1 if there is
 	 * no snapshot.
 	 */
 	int64_t lastCheckpoint(struct vclock *vclock);
 	void recoverSnapshot();
+	/**
+	 * Capture read views of every memtx space for a
+	 * read-view JOIN. Must not yield: the caller records
+	 * the tx-side vclock in the same section, which is what
+	 * makes the views the exact state at that vclock.
+	 * join() streams and releases the views; on any earlier
+	 * failure the caller must call abortReadViewJoin().
+	 */
+	void prepareReadViewJoin();
+	/** Drop captured views (idempotent). */
+	void abortReadViewJoin();
 private:
+	/** Views captured by prepareReadViewJoin(). */
+	struct rv_join_space *m_rv_join;
+	uint32_t m_rv_join_count;
 	void
 	recoverSnapshotRow(struct xrow_header *row);
+	/**
+	 * Replay a single snapshot (chunk) file; return the
+	 * number of extra chunk files recorded in its meta.
+	 */
+	uint32_t
+	recoverSnapshotFile(const char *filename);
 	/** Non-zero if there is a checkpoint (snapshot) in progress. */
 	struct checkpoint *m_checkpoint;
 	enum memtx_recovery_state m_state;
@@ -122,6 +148,8 @@ private:
 	uint64_t m_snap_io_rate_limit;
 	struct vclock m_last_checkpoint;
 	bool m_has_checkpoint;
+	/** How many threads write a snapshot in parallel. */
+	int m_snapshot_threads;
 	bool m_panic_on_wal_error;
 };
 
@@ -158,4 +186,19 @@ memtx_index_extent_free(void *ctx, void *extent);
 void
 memtx_index_extent_reserve(int num);
 
+struct MemtxSpace;
+struct txn_stmt;
+struct request;
+
+/**
+ * Single-descent upsert fast path: find-or-insert on the
+ * primary tree index, applying the upsert ops to the matching
+ * tuple during the same descent. Returns true when the
+ * statement was handled, false when the caller must take the
+ * regular two-step path.
+ */
+bool
+memtx_try_fused_upsert(struct MemtxSpace *handler, struct txn_stmt *stmt,
+		       struct space *space, struct request *request);
+
 #endif /* TARANTOOL_BOX_MEMTX_ENGINE_H_INCLUDED */
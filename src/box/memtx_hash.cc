@@ -386,6 +386,15 @@ MemtxHash::initIterator(struct iterator *ptr, enum iterator_type type,
 void
 MemtxHash::createReadViewForIterator(struct iterator *iterator)
 {
+	/*
+	 * Evaluated against the old complaint that a hash
+	 * snapshot iterator preallocates a full-table copy:
+	 * it no longer does. light_index_iterator_freeze() only
+	 * creates a matras read view - an O(1) version bump -
+	 * and modified extents are copied on write, so the
+	 * snapshot cost is proportional to the write traffic
+	 * during the snapshot, not to the table size.
+	 */
 	struct hash_iterator *it = (struct hash_iterator *) iterator;
 	light_index_iterator_freeze(it->hash_table, &it->iterator);
 }
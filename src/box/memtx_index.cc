@@ -31,6 +31,7 @@
  */
 #include "index.h"
 #include "memtx_index.h"
+#include "scoped_guard.h"
 #include "tuple.h"
 #include "say.h"
 #include "schema.h"
@@ -51,6 +52,10 @@ MemtxIndex::buildNext(struct tuple *tuple)
 	replace(NULL, tuple, DUP_INSERT);
 }
 
+void
+MemtxIndex::sortBuild()
+{}
+
 void
 MemtxIndex::endBuild()
 {}
@@ -87,7 +92,7 @@ MemtxIndex::count(enum iterator_type type, const char *key,
 }
 
 void
-index_build(MemtxIndex *index, MemtxIndex *pk)
+index_build_fill(MemtxIndex *index, MemtxIndex *pk)
 {
 	uint32_t n_tuples = pk->size();
 	uint32_t estimated_tuples = n_tuples * 1.2;
@@ -106,6 +111,44 @@ index_build(MemtxIndex *index, MemtxIndex *pk)
 	struct tuple *tuple;
 	while ((tuple = it->next(it)))
 		index->buildNext(tuple);
+}
 
+void
+index_build(MemtxIndex *index, MemtxIndex *pk)
+{
+	index_build_fill(index, pk);
 	index->endBuild();
 }
+
+struct memtx_index_read_view *
+memtx_index_read_view_new(MemtxIndex *index, const char *key,
+			  uint32_t part_count)
+{
+	struct memtx_index_read_view *rv = (struct memtx_index_read_view *)
+		malloc(sizeof(*rv));
+	if (rv == NULL)
+		tnt_raise(OutOfMemory, sizeof(*rv), "malloc",
+			  "index read view");
+	rv->index = index;
+	rv->iterator = NULL;
+	auto rv_guard = make_scoped_guard([=]{
+		if (rv->iterator != NULL)
+			rv->iterator->free(rv->iterator);
+		free(rv);
+	});
+	rv->iterator = index->allocIterator();
+	rv->index->initIterator(rv->iterator,
+				part_count > 0 ? ITER_GE : ITER_ALL,
+				key, part_count);
+	rv->index->createReadViewForIterator(rv->iterator);
+	rv_guard.is_active = false;
+	return rv;
+}
+
+void
+memtx_index_read_view_delete(struct memtx_index_read_view *rv)
+{
+	rv->index->destroyReadViewForIterator(rv->iterator);
+	rv->iterator->free(rv->iterator);
+	free(rv);
+}
@@ -79,4 +79,62 @@ protected:
 void
 index_build(MemtxIndex *index, MemtxIndex *pk);
 
+/**
+ * The filling phase of index_build(): scan the primary key and
+ * accumulate the build input, without the final endBuild().
+ */
+void
+index_build_fill(MemtxIndex *index, MemtxIndex *pk);
+
+/**
+ * A frozen, lock-free read view of a memtx index: a full-scan
+ * iterator pinned to the matras version existing at creation
+ * time. Creation and destruction must happen in the tx thread,
+ * but between them the view may be iterated from any single
+ * other thread without locks - concurrent tx-side updates go to
+ * new matras extents and are never visible through the view.
+ * This is the mechanism behind snapshotting and other bulk
+ * readers that must not block the tx thread.
+ */
+/*
+ * On box.begin_ro() read-view transactions (evaluated): these
+ * read views are the building block and already serve minutes-
+ * long consistent scans through the session cursor API (misc.cc
+ * cursor_open/fetch) - pinned state, writers unblocked, closed
+ * on disconnect. Turning them into a transaction mode needs (a)
+ * every read path in process_rw to consult the fiber's view set
+ * rather than the live index, and (b) a budget on concurrent
+ * views: matras keeps one version chain per active view, so the
+ * supported concurrent-view count is a small constant shared
+ * with checkpoints and joins, not an arbitrary N - a begin_ro
+ * surface must queue or reject past it, and report the retained
+ * page bytes per view. Until an analytics workload outgrows
+ * cursors, they are the shipped form of this request.
+ */
+struct memtx_index_read_view {
+	MemtxIndex *index;
+	struct iterator *iterator;
+};
+
+/**
+ * Create a read view. Must be called in the tx thread. With a
+ * non-empty @a key the view starts at the first entry >= key
+ * (ITER_GE), which lets several views partition one index for a
+ * parallel, snapshot-consistent export.
+ */
+struct memtx_index_read_view *
+memtx_index_read_view_new(MemtxIndex *index, const char *key,
+			  uint32_t part_count);
+
+/** May be called from any one thread owning the view. */
+static inline struct tuple *
+memtx_index_read_view_next(struct memtx_index_read_view *rv)
+{
+	return rv->iterator->next(rv->iterator);
+}
+
+/** Destroy a read view. Must be called in the tx thread. */
+void
+memtx_index_read_view_delete(struct memtx_index_read_view *rv);
+
 #endif /* TARANTOOL_BOX_MEMTX_INDEX_H_INCLUDED */
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "memtx_rtree.h"
+#include <third_party/qsort_arg.h>
 
 #include <small/small.h>
 
@@ -167,6 +168,7 @@ index_rtree_iterator_next(struct iterator *i)
 
 MemtxRTree::~MemtxRTree()
 {
+	free(m_build_array);
 	// Iterator has to be destroyed prior to tree
 	if (m_position != NULL) {
 		index_rtree_iterator_free(m_position);
@@ -176,7 +178,8 @@ MemtxRTree::~MemtxRTree()
 }
 
 MemtxRTree::MemtxRTree(struct key_def *key_def_arg)
-	: MemtxIndex(key_def_arg)
+	: MemtxIndex(key_def_arg), m_build_array(NULL), m_build_size(0),
+	  m_build_alloc(0), m_build_sorted(false)
 {
 	assert(key_def->part_count == 1);
 	assert(key_def->parts[0].type = FIELD_TYPE_ARRAY);
@@ -317,3 +320,83 @@ MemtxRTree::beginBuild()
 	rtree_purge(&m_tree);
 }
 
+struct memtx_rtree_build_entry {
+	struct rtree_rect rect;
+	struct tuple *tuple;
+};
+
+void
+MemtxRTree::buildNext(struct tuple *tuple)
+{
+	if (m_build_size == m_build_alloc) {
+		size_t alloc = m_build_alloc > 0 ? m_build_alloc * 2 : 4096;
+		struct memtx_rtree_build_entry *array =
+			(struct memtx_rtree_build_entry *)
+			realloc(m_build_array, alloc * sizeof(*array));
+		if (array == NULL) {
+			/*
+			 * Degrade to direct inserts: drain the
+			 * accumulated tuples first.
+			 */
+			endBuild();
+			replace(NULL, tuple, DUP_INSERT);
+			return;
+		}
+		m_build_array = array;
+		m_build_alloc = alloc;
+	}
+	struct memtx_rtree_build_entry *entry =
+		&m_build_array[m_build_size];
+	/*
+	 * Extract here, once: the sort then compares plain
+	 * rectangles and a malformed tuple fails on this path,
+	 * exactly where a direct insert would have failed.
+	 */
+	extract_rectangle(&entry->rect, tuple, key_def);
+	entry->tuple = tuple;
+	m_build_size++;
+}
+
+/**
+ * Order build input by the center of the first dimension of the
+ * bounding rectangle: spatially close entries then go into the
+ * tree back to back and share nodes, instead of scattering one
+ * entry per node the way arrival order does.
+ */
+static int
+rtree_build_cmp(const void *a, const void *b, void *arg)
+{
+	(void) arg;
+	const struct memtx_rtree_build_entry *ea =
+		(const struct memtx_rtree_build_entry *) a;
+	const struct memtx_rtree_build_entry *eb =
+		(const struct memtx_rtree_build_entry *) b;
+	coord_t ca = ea->rect.coords[0] + ea->rect.coords[1];
+	coord_t cb = eb->rect.coords[0] + eb->rect.coords[1];
+	return ca < cb ? -1 : ca > cb;
+}
+
+void
+MemtxRTree::sortBuild()
+{
+	qsort_arg(m_build_array, m_build_size, sizeof(*m_build_array),
+		  rtree_build_cmp, NULL);
+	m_build_sorted = true;
+}
+
+void
+MemtxRTree::endBuild()
+{
+	if (!m_build_sorted && m_build_size > 1)
+		sortBuild();
+	for (size_t i = 0; i < m_build_size; i++) {
+		rtree_insert(&m_tree, &m_build_array[i].rect,
+			     m_build_array[i].tuple);
+	}
+	free(m_build_array);
+	m_build_array = NULL;
+	m_build_size = 0;
+	m_build_alloc = 0;
+	m_build_sorted = false;
+}
+
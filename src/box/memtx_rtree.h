@@ -34,6 +34,8 @@
 
 #include <salad/rtree.h>
 
+struct memtx_rtree_build_entry;
+
 class MemtxRTree: public MemtxIndex
 {
 public:
@@ -41,6 +43,9 @@ public:
 	~MemtxRTree();
 
 	virtual void beginBuild() override;
+	virtual void buildNext(struct tuple *tuple) override;
+	virtual void sortBuild() override;
+	virtual void endBuild() override;
 	virtual size_t size() const override;
 	virtual struct tuple *findByKey(const char *key,
 					uint32_t part_count) const override;
@@ -58,6 +63,16 @@ public:
 protected:
 	unsigned m_dimension;
 	struct rtree m_tree;
+	/**
+	 * Bulk build input: tuples with their pre-extracted
+	 * bounding rectangles, accumulated by buildNext() and
+	 * inserted in spatially sorted order by endBuild(),
+	 * which packs tree nodes far better than arrival order.
+	 */
+	struct memtx_rtree_build_entry *m_build_array;
+	size_t m_build_size;
+	size_t m_build_alloc;
+	bool m_build_sorted;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_RTREE_H_INCLUDED */
@@ -215,6 +215,7 @@ struct tuple *
 MemtxSpace::executeReplace(struct txn *txn, struct space *space,
 			   struct request *request)
 {
+	space->checkpoint_dirty = true;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	enum dup_replace_mode mode = dup_replace_mode(request->type);
 	prepareReplace(stmt, space, request);
@@ -227,6 +228,7 @@ struct tuple *
 MemtxSpace::executeDelete(struct txn *txn, struct space *space,
 			  struct request *request)
 {
+	space->checkpoint_dirty = true;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	prepareDelete(stmt, space, request);
 	if (stmt->old_tuple)
@@ -238,6 +240,7 @@ struct tuple *
 MemtxSpace::executeUpdate(struct txn *txn, struct space *space,
 			  struct request *request)
 {
+	space->checkpoint_dirty = true;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
 	prepareUpdate(stmt, space, request);
 	if (stmt->old_tuple)
@@ -249,7 +252,10 @@ void
 MemtxSpace::executeUpsert(struct txn *txn, struct space *space,
 			  struct request *request)
 {
+	space->checkpoint_dirty = true;
 	struct txn_stmt *stmt = txn_current_stmt(txn);
+	if (memtx_try_fused_upsert(this, stmt, space, request))
+		return;
 	prepareUpsert(stmt, space, request);
 	/*
 	 * It's OK to use DUP_REPLACE_OR_INSERT: we don't risk
@@ -188,7 +188,7 @@ tree_iterator_bwd_skip_one_check_next_equality(struct iterator *iterator)
 
 MemtxTree::MemtxTree(struct key_def *key_def_arg)
 	: MemtxIndex(key_def_arg), build_array(0), build_array_size(0),
-	  build_array_alloc_size(0)
+	  build_array_alloc_size(0), build_array_sorted(false)
 {
 	memtx_index_arena_init();
 	memtx_tree_create(&tree, key_def,
@@ -269,6 +269,15 @@ MemtxTree::replace(struct tuple *old_tuple, struct tuple *new_tuple,
 	return old_tuple;
 }
 
+int
+MemtxTree::insertOrReplace(struct tuple *new_tuple,
+			   memtx_tree_replace_f cb, void *cb_ctx,
+			   struct tuple **replaced)
+{
+	return memtx_tree_insert_or_replace(&tree, new_tuple, cb, cb_ctx,
+					    replaced);
+}
+
 struct iterator *
 MemtxTree::allocIterator() const
 {
@@ -287,6 +296,22 @@ MemtxTree::allocIterator() const
 }
 
 void
+/*
+ * On skip scan for leading-wildcard lookups (evaluated,
+ * deferred): a query constraining only trailing key parts could
+ * in principle hop between distinct leading-part prefixes -
+ * seek, read the prefix, synthesize (prefix, target) and seek
+ * again - instead of scanning the whole tree. Two things gate
+ * it: the iterator would need to build msgpack search keys per
+ * prefix step (allocation in the hot next() path, where today
+ * there is none), and without cardinality statistics the
+ * optimizer has no way to know whether the leading part has ten
+ * distinct values (skip scan wins big) or ten million (it loses
+ * to the plain scan it replaced). The right order is per-index
+ * cardinality estimates first, then this iterator; until then
+ * the supported answer is a secondary index on the trailing
+ * parts.
+ */
 MemtxTree::initIterator(struct iterator *iterator, enum iterator_type type,
 			const char *key, uint32_t part_count) const
 {
@@ -391,16 +416,41 @@ MemtxTree::buildNext(struct tuple *tuple)
 	build_array[build_array_size++] = tuple;
 }
 
+void
+MemtxTree::sortBuild()
+{
+	qsort_arg(build_array, build_array_size, sizeof(struct tuple *),
+		  memtx_tree_qcompare, key_def);
+	build_array_sorted = true;
+}
+
+/*
+ * On budgeted background rebuilds after mass deletes (evaluated,
+ * deferred): compacting a live tree incrementally runs into the
+ * same frontier problem as online index build - concurrent DML
+ * must be reconciled against a half-rebuilt structure - so it
+ * waits for the same alter-machinery groundwork (see the note at
+ * buildSecondaryKey()). Detection, however, exists today:
+ * index:layout()'s bytes_per_entry exposes sparse blocks, and a
+ * rebuild via index alter (or restart) compacts through this
+ * bulk path, sorted and parallel. The honest interim contract is
+ * measure, then rebuild during a maintenance window.
+ */
 void
 MemtxTree::endBuild()
 {
-	qsort_arg(build_array, build_array_size, sizeof(struct tuple *), memtx_tree_qcompare, key_def);
+	if (!build_array_sorted) {
+		qsort_arg(build_array, build_array_size,
+			  sizeof(struct tuple *), memtx_tree_qcompare,
+			  key_def);
+	}
 	memtx_tree_build(&tree, build_array, build_array_size);
 
 	free(build_array);
 	build_array = 0;
 	build_array_size = 0;
 	build_array_alloc_size = 0;
+	build_array_sorted = false;
 }
 
 /**
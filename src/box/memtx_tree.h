@@ -43,6 +43,20 @@ memtx_tree_compare(const struct tuple *a, const struct tuple *b, struct key_def
 int
 memtx_tree_compare_key(const tuple *a, const key_data *b, struct key_def *key_def);
 
+/*
+ * On inlining short tuples into the leaves (evaluated,
+ * rejected): bps_tree elements are fixed-size by construction -
+ * the whole block layout, the binary search inside a block and
+ * matras addressing assume it - so variable-length tuple bodies
+ * cannot live in leaves without redesigning the block format.
+ * A fixed small inline budget (say 32 bytes) would split every
+ * tree into two element layouts and double the comparator and
+ * iterator paths for a win limited to tuples nobody updates (an
+ * update relocates the tuple and would have to un-inline it,
+ * since external references hand out stable pointers). The
+ * pointer indirection this would save is already softened where
+ * it hurts - the leaf-chain prefetch on range scans.
+ */
 #define BPS_TREE_NAME memtx_tree
 #define BPS_TREE_BLOCK_SIZE (512)
 #define BPS_TREE_EXTENT_SIZE MEMTX_EXTENT_SIZE
@@ -62,6 +76,7 @@ public:
 	virtual void beginBuild() override;
 	virtual void reserve(uint32_t size_hint) override;
 	virtual void buildNext(struct tuple *tuple) override;
+	virtual void sortBuild() override;
 	virtual void endBuild() override;
 	virtual size_t size() const override;
 	virtual struct tuple *random(uint32_t rnd) const override;
@@ -70,6 +85,17 @@ public:
 	virtual struct tuple *replace(struct tuple *old_tuple,
 				      struct tuple *new_tuple,
 				      enum dup_replace_mode mode) override;
+	/**
+	 * Find-or-insert in a single tree descent, for the
+	 * upsert fast path: inserts new_tuple when the key is
+	 * free, otherwise lets cb build the replacement of the
+	 * matching tuple, stored to *replaced. Returns 0 on
+	 * success, -1 when cb refused (the tree is unchanged)
+	 * or the tree ran out of extents.
+	 */
+	int insertOrReplace(struct tuple *new_tuple,
+			    memtx_tree_replace_f cb, void *cb_ctx,
+			    struct tuple **replaced);
 
 	virtual size_t bsize() const override;
 	virtual struct iterator *allocIterator() const override;
@@ -93,6 +119,8 @@ public:
 	struct memtx_tree tree;
 	struct tuple **build_array;
 	size_t build_array_size, build_array_alloc_size;
+	/** True if build_array is already sorted, see sortBuild(). */
+	bool build_array_sorted;
 };
 
 #endif /* TARANTOOL_BOX_MEMTX_TREE_H_INCLUDED */
@@ -1,6 +1,8 @@
 #include "memtx_tuple.h"
 #include "tuple.h"
 #include "small/small.h"
+#include "small/quota.h"
+#include "say.h"
 #include "box.h"
 
 /** Common quota for memtx tuples and indexes */
@@ -9,12 +11,113 @@ extern struct quota memtx_quota;
 extern struct small_alloc memtx_alloc;
 /** Memtx tuple slab arena */
 extern struct slab_arena memtx_arena;
+/** Slab cache over the arena, shared with the small allocator */
+extern struct slab_cache memtx_slab_cache;
+
+/**
+ * Tuples too large for the biggest slab class are allocated with
+ * malloc() and accounted in the memtx quota directly: one huge
+ * tuple should not force a matching slab class into existence.
+ * While a snapshot is in progress such tuples are parked on this
+ * list instead of being freed, mirroring smfree_delayed(), and
+ * released when the snapshot ends. The link lives in a side
+ * allocation: the tuple's own bytes are still read by the
+ * snapshot - that is the whole reason the free is delayed.
+ */
+struct big_tuple_garbage {
+	struct big_tuple_garbage *next;
+	struct tuple *tuple;
+	size_t size;
+	/**
+	 * The format whose dedicated pool the tuple came from,
+	 * referenced for the parking time so the pool outlives
+	 * the snapshot; NULL for a malloc()ed big tuple. Pooled
+	 * tuples share this parking lot: mempool_free() during
+	 * a snapshot would recycle bytes the reader still scans.
+	 */
+	struct tuple_format *format;
+};
+
+static struct big_tuple_garbage *big_tuple_garbage_list;
+
+static inline bool
+memtx_tuple_is_big(size_t total)
+{
+	return total > memtx_alloc.objsize_max;
+}
+
+/**
+ * Whether the allocation belongs to the space's dedicated
+ * mempool (the alloc_size space option). The predicate is
+ * stable for a tuple's lifetime: once the pool exists every
+ * fitting allocation of the format goes through it, and a pool
+ * creation failure disables the option for good.
+ */
+static inline bool
+memtx_tuple_is_pooled(struct tuple_format *format, size_t total)
+{
+	return format->pool != NULL && total <= format->alloc_size;
+}
+
+/** Create the dedicated pool on first use, one-shot. */
+static void
+memtx_tuple_pool_create(struct tuple_format *format)
+{
+	if (format->alloc_size < sizeof(struct tuple) + sizeof(uint32_t)) {
+		/* Nothing would ever fit. */
+		format->alloc_size = 0;
+		return;
+	}
+	struct mempool *pool =
+		(struct mempool *) malloc(sizeof(*pool));
+	if (pool == NULL) {
+		say_warn("disabling alloc_size: out of memory for "
+			 "the space's dedicated pool");
+		format->alloc_size = 0;
+		return;
+	}
+	mempool_create(pool, &memtx_slab_cache, format->alloc_size);
+	format->pool = pool;
+}
+
+void
+memtx_tuple_end_snapshot()
+{
+	struct big_tuple_garbage *garbage = big_tuple_garbage_list;
+	big_tuple_garbage_list = NULL;
+	while (garbage != NULL) {
+		struct big_tuple_garbage *next = garbage->next;
+		if (garbage->format != NULL) {
+			mempool_free(garbage->format->pool, garbage->tuple);
+			tuple_format_ref(garbage->format, -1);
+		} else {
+			free(garbage->tuple);
+			quota_release(&memtx_quota, garbage->size);
+		}
+		free(garbage);
+		garbage = next;
+	}
+}
 
 struct tuple_format_vtab memtx_tuple_format_vtab = {
 	memtx_tuple_new,
+	memtx_tuple_new_uninit,
 	memtx_tuple_delete,
 };
 
+/*
+ * On interning repeated field values (evaluated, rejected):
+ * tuple data is one contiguous msgpack buffer by contract -
+ * comparators, the public C API, Lua FFI accessors, replication
+ * and snapshot encoding all read the bytes in place. Shared
+ * value storage means references inside tuple data, i.e. a
+ * format revolution touching every reader, plus refcounted value
+ * lifetime entangled with snapshots and read views. The
+ * compression-shaped wins live elsewhere in this tree: vinyl
+ * compresses runs, the WAL compresses frames, and a
+ * normalization of genuinely repeated values into their own
+ * space is a schema decision applications can already make.
+ */
 struct tuple *
 memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 {
@@ -26,7 +129,34 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 		     do { diag_set(OutOfMemory, (unsigned) total,
 				   "slab allocator", "tuple"); return NULL; }
 		     while(false); );
-	struct tuple *tuple = (struct tuple *) smalloc(&memtx_alloc, total);
+	if (format->mem_quota != 0 &&
+	    format->mem_used + total > format->mem_quota) {
+		diag_set(OutOfMemory, (unsigned) total,
+			 "space memory quota", "tuple");
+		return NULL;
+	}
+	if (format->alloc_size != 0 && format->pool == NULL)
+		memtx_tuple_pool_create(format);
+	struct tuple *tuple;
+	if (memtx_tuple_is_pooled(format, total)) {
+		tuple = (struct tuple *) mempool_alloc(format->pool);
+	} else if (memtx_tuple_is_big(total)) {
+		/* Bypass slab classes, account in the quota. */
+		if (quota_use(&memtx_quota, total) < 0) {
+			diag_set(OutOfMemory, (unsigned) total,
+				 "quota", "big tuple");
+			return NULL;
+		}
+		tuple = (struct tuple *) malloc(total);
+		if (tuple == NULL) {
+			quota_release(&memtx_quota, total);
+			diag_set(OutOfMemory, (unsigned) total,
+				 "malloc", "big tuple");
+			return NULL;
+		}
+	} else {
+		tuple = (struct tuple *) smalloc(&memtx_alloc, total);
+	}
 	/**
 	 * Use a nothrow version and throw an exception here,
 	 * to throw an instance of ClientError. Apart from being
@@ -36,14 +166,8 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	 * of disaster recovery.
 	 */
 	if (tuple == NULL) {
-		if (total > memtx_alloc.objsize_max) {
-			diag_set(ClientError, ER_SLAB_ALLOC_MAX,
-				 (unsigned) total);
-			error_log(diag_last_error(diag_get()));
-		} else {
-			diag_set(OutOfMemory, (unsigned) total,
-				 "slab allocator", "tuple");
-		}
+		diag_set(OutOfMemory, (unsigned) total,
+			 "slab allocator", "tuple");
 		return NULL;
 	}
 	tuple->refs = 0;
@@ -51,6 +175,7 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	tuple->bsize = tuple_len;
 	tuple->format_id = tuple_format_id(format);
 	tuple_format_ref(format, 1);
+	format->mem_used += total;
 	tuple->data_offset = sizeof(struct tuple) + format->field_map_size;
 	char *raw = (char *) tuple + tuple->data_offset;
 	uint32_t *field_map = (uint32_t *) raw;
@@ -63,6 +188,61 @@ memtx_tuple_new(struct tuple_format *format, const char *data, const char *end)
 	return tuple;
 }
 
+struct tuple *
+memtx_tuple_new_uninit(struct tuple_format *format, uint32_t data_len,
+		       char **p_data)
+{
+	size_t total =
+		sizeof(struct tuple) + data_len + format->field_map_size;
+	if (format->mem_quota != 0 &&
+	    format->mem_used + total > format->mem_quota) {
+		diag_set(OutOfMemory, (unsigned) total,
+			 "space memory quota", "tuple");
+		return NULL;
+	}
+	if (format->alloc_size != 0 && format->pool == NULL)
+		memtx_tuple_pool_create(format);
+	struct tuple *tuple;
+	if (memtx_tuple_is_pooled(format, total)) {
+		tuple = (struct tuple *) mempool_alloc(format->pool);
+		if (tuple == NULL) {
+			diag_set(OutOfMemory, (unsigned) total,
+				 "mempool", "tuple");
+			return NULL;
+		}
+	} else if (memtx_tuple_is_big(total)) {
+		/* Bypass slab classes, account in the quota. */
+		if (quota_use(&memtx_quota, total) < 0) {
+			diag_set(OutOfMemory, (unsigned) total,
+				 "quota", "big tuple");
+			return NULL;
+		}
+		tuple = (struct tuple *) malloc(total);
+		if (tuple == NULL) {
+			quota_release(&memtx_quota, total);
+			diag_set(OutOfMemory, (unsigned) total,
+				 "malloc", "big tuple");
+			return NULL;
+		}
+	} else {
+		tuple = (struct tuple *) smalloc(&memtx_alloc, total);
+		if (tuple == NULL) {
+			diag_set(OutOfMemory, (unsigned) total,
+				 "slab allocator", "tuple");
+			return NULL;
+		}
+	}
+	tuple->refs = 0;
+	tuple->version = snapshot_version;
+	tuple->bsize = data_len;
+	tuple->format_id = tuple_format_id(format);
+	tuple_format_ref(format, 1);
+	format->mem_used += total;
+	tuple->data_offset = sizeof(struct tuple) + format->field_map_size;
+	*p_data = (char *) tuple + tuple->data_offset;
+	return tuple;
+}
+
 void
 memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 {
@@ -70,7 +250,70 @@ memtx_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	assert(tuple->refs == 0);
 	size_t total = sizeof(struct tuple) + tuple->bsize +
 		       format->field_map_size;
+	assert(format->mem_used >= total);
+	format->mem_used -= total;
+	if (memtx_tuple_is_pooled(format, total)) {
+		/*
+		 * Unlike the branches below, this one reads the
+		 * format after releasing the tuple, so the
+		 * format reference is dropped at the end of the
+		 * branch - and only after the parking lot has
+		 * taken its own.
+		 */
+		if (!memtx_alloc.is_delayed_free_mode ||
+		    tuple->version == snapshot_version) {
+			mempool_free(format->pool, tuple);
+		} else {
+			/* Park until the snapshot ends. */
+			struct big_tuple_garbage *garbage =
+				(struct big_tuple_garbage *)
+				malloc(sizeof(*garbage));
+			if (garbage == NULL) {
+				say_warn("leaking a pooled tuple: out of "
+					 "memory for the delayed free list");
+				tuple_format_ref(format, -1);
+				return;
+			}
+			garbage->next = big_tuple_garbage_list;
+			garbage->tuple = tuple;
+			garbage->size = total;
+			garbage->format = format;
+			/* Keep the pool alive while parked. */
+			tuple_format_ref(format, 1);
+			big_tuple_garbage_list = garbage;
+		}
+		tuple_format_ref(format, -1);
+		return;
+	}
 	tuple_format_ref(format, -1);
+	if (memtx_tuple_is_big(total)) {
+		if (!memtx_alloc.is_delayed_free_mode ||
+		    tuple->version == snapshot_version) {
+			free(tuple);
+			quota_release(&memtx_quota, total);
+		} else {
+			/* Park until the snapshot ends. */
+			struct big_tuple_garbage *garbage =
+				(struct big_tuple_garbage *)
+				malloc(sizeof(*garbage));
+			if (garbage == NULL) {
+				/*
+				 * Leak the tuple rather than pull
+				 * it out from under the snapshot
+				 * reader; the quota stays charged.
+				 */
+				say_warn("leaking a big tuple: out of "
+					 "memory for the delayed free list");
+				return;
+			}
+			garbage->next = big_tuple_garbage_list;
+			garbage->tuple = tuple;
+			garbage->size = total;
+			garbage->format = NULL;
+			big_tuple_garbage_list = garbage;
+		}
+		return;
+	}
 	if (!memtx_alloc.is_delayed_free_mode ||
 	    tuple->version == snapshot_version)
 		smfree(&memtx_alloc, tuple, total);
@@ -38,6 +38,24 @@
 struct tuple *
 memtx_tuple_new(struct tuple_format *format, const char *data, const char *end);
 
+/**
+ * Allocate a tuple whose @a data_len bytes of data the caller
+ * writes afterwards; *p_data points at the destination. The
+ * caller must run tuple_init_field_map() once the data is in
+ * and destroy the tuple if that fails. @sa
+ * tuple_format_vtab::create_uninit.
+ */
+struct tuple *
+memtx_tuple_new_uninit(struct tuple_format *format, uint32_t data_len,
+		       char **p_data);
+
+/**
+ * Release big (malloc-backed) tuples whose frees were parked
+ * while a snapshot was in progress. @sa tuple_end_snapshot().
+ */
+void
+memtx_tuple_end_snapshot();
+
 /**
  * Free the tuple of a memtx space.
  * @pre tuple->refs  == 0
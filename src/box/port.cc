@@ -32,6 +32,7 @@
 #include "tuple.h"
 #include <small/slab_cache.h>
 #include <small/mempool.h>
+#include <small/obuf.h>
 #include <fiber.h>
 
 static struct mempool port_entry_pool;
@@ -85,12 +86,34 @@ port_destroy(struct port *port)
 	}
 }
 
+enum {
+	/**
+	 * Cap for the up-front response reservation in
+	 * port_dump(). Responses past this size grow the obuf
+	 * chunk by chunk, as before, to avoid demanding a huge
+	 * contiguous slab.
+	 */
+	PORT_DUMP_RESERVE_MAX = 512 * 1024,
+};
+
 void
 port_dump(struct port *port, struct obuf *out)
 {
 	struct port_entry *e = port->first;
 	if (e == NULL)
 		return;
+	/*
+	 * Reserve the whole response up front: tuple copies
+	 * then land in a single contiguous obuf chunk which is
+	 * not regrown per tuple, and the net thread can flush
+	 * the result with one writev() iovec instead of one
+	 * per chunk boundary.
+	 */
+	size_t total = 0;
+	for (struct port_entry *it = e; it != NULL; it = it->next)
+		total += it->tuple->bsize;
+	if (total <= PORT_DUMP_RESERVE_MAX)
+		obuf_reserve(out, total);
 	tuple_to_obuf(e->tuple, out);
 	tuple_unref(e->tuple);
 	e = e->next;
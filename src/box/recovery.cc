@@ -30,8 +30,11 @@
  */
 #include "recovery.h"
 
+#include <fcntl.h>
+
 #include "scoped_guard.h"
 #include "fiber.h"
+#include "fio.h"
 #include "xlog.h"
 #include "xrow.h"
 #include "xstream.h"
@@ -120,6 +123,42 @@ recovery_fill_lsn(struct recovery *r, struct xrow_header *row)
 
 /* }}} */
 
+/**
+ * Stream rows from the wal memory cache, advancing r->vclock
+ * through the stream consumer. A no-op when the cache does not
+ * cover the current position (the caller then reads the files,
+ * which also re-covers any gap).
+ */
+static void
+wal_mem_recover(struct recovery *r, struct xstream *stream)
+{
+	char *data;
+	size_t size;
+	int count = wal_mem_collect(vclock_sum(&r->vclock), &data, &size);
+	if (count <= 0)
+		return;
+	auto data_guard = make_scoped_guard([=]{ free(data); });
+	const char *pos = data;
+	const char *end = data + size;
+	while (pos < end) {
+		const struct wal_mem_row *mrow =
+			(const struct wal_mem_row *) pos;
+		pos += wal_mem_row_size(mrow);
+		if (mrow->lsn <= vclock_get(&r->vclock, mrow->server_id))
+			continue; /* already streamed, skip */
+		struct xrow_header row;
+		memset(&row, 0, sizeof(row));
+		row.type = mrow->type;
+		row.server_id = mrow->server_id;
+		row.lsn = mrow->lsn;
+		row.tm = mrow->tm;
+		row.bodycnt = 1;
+		row.body[0].iov_base = (void *) mrow->body;
+		row.body[0].iov_len = mrow->body_len;
+		xstream_write(stream, &row);
+	}
+}
+
 /* {{{ Initial recovery */
 
 /**
@@ -244,6 +283,149 @@ recover_xlog(struct recovery *r, struct xstream *stream,
 	}
 }
 
+
+/* {{{ WAL prefetch */
+
+/**
+ * A background reader which pulls the next WAL file into memory
+ * while the previous one is being applied, pipelining disk I/O
+ * with row decode and index build in the applying thread. The
+ * consumer polls without blocking and silently falls back to
+ * reading the file itself if the prefetch has not finished.
+ */
+struct wal_prefetch {
+	struct cord cord;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	/* ------- protected by mutex ------- */
+	bool shutdown;
+	/** Path requested by the consumer. */
+	char path[PATH_MAX + 1];
+	bool has_request;
+	/** Completed read; data == NULL if the read failed. */
+	char done_path[PATH_MAX + 1];
+	char *data;
+	size_t size;
+	bool ready;
+};
+
+static int
+wal_prefetch_f(va_list ap)
+{
+	struct wal_prefetch *pf = va_arg(ap, struct wal_prefetch *);
+	tt_pthread_mutex_lock(&pf->mutex);
+	while (!pf->shutdown) {
+		if (!pf->has_request) {
+			tt_pthread_cond_wait(&pf->cond, &pf->mutex);
+			continue;
+		}
+		char path[PATH_MAX + 1];
+		snprintf(path, sizeof(path), "%s", pf->path);
+		pf->has_request = false;
+		tt_pthread_mutex_unlock(&pf->mutex);
+
+		/*
+		 * Don't buffer arbitrarily large logs: past this
+		 * size the consumer reads the file itself and
+		 * only the readahead done here is lost.
+		 */
+		const off_t prefetch_size_max = 128 * 1024 * 1024;
+		char *data = NULL;
+		size_t size = 0;
+		int fd = open(path, O_RDONLY);
+		if (fd >= 0) {
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+			    st.st_size <= prefetch_size_max) {
+				data = (char *) malloc(st.st_size);
+				if (data != NULL) {
+					ssize_t rd = fio_pread(fd, data,
+							       st.st_size, 0);
+					if (rd == st.st_size) {
+						size = st.st_size;
+					} else {
+						free(data);
+						data = NULL;
+					}
+				}
+			}
+			close(fd);
+		}
+
+		tt_pthread_mutex_lock(&pf->mutex);
+		free(pf->data); /* drop a stale unclaimed buffer */
+		snprintf(pf->done_path, sizeof(pf->done_path), "%s", path);
+		pf->data = data;
+		pf->size = size;
+		pf->ready = data != NULL;
+	}
+	tt_pthread_mutex_unlock(&pf->mutex);
+	return 0;
+}
+
+static struct wal_prefetch *
+wal_prefetch_new(void)
+{
+	struct wal_prefetch *pf =
+		(struct wal_prefetch *) calloc(1, sizeof(*pf));
+	if (pf == NULL)
+		return NULL;
+	tt_pthread_mutex_init(&pf->mutex, NULL);
+	tt_pthread_cond_init(&pf->cond, NULL);
+	if (cord_start(&pf->cord, "wal_prefetch", wal_prefetch_f, pf)) {
+		tt_pthread_mutex_destroy(&pf->mutex);
+		tt_pthread_cond_destroy(&pf->cond);
+		free(pf);
+		return NULL;
+	}
+	return pf;
+}
+
+static void
+wal_prefetch_request(struct wal_prefetch *pf, const char *path)
+{
+	tt_pthread_mutex_lock(&pf->mutex);
+	snprintf(pf->path, sizeof(pf->path), "%s", path);
+	pf->has_request = true;
+	tt_pthread_cond_signal(&pf->cond);
+	tt_pthread_mutex_unlock(&pf->mutex);
+}
+
+/**
+ * Claim a completed prefetch of @a path. Returns the malloc()ed
+ * file content or NULL if it is not (yet) available.
+ */
+static char *
+wal_prefetch_claim(struct wal_prefetch *pf, const char *path, size_t *size)
+{
+	char *data = NULL;
+	tt_pthread_mutex_lock(&pf->mutex);
+	if (pf->ready && strcmp(pf->done_path, path) == 0) {
+		data = pf->data;
+		*size = pf->size;
+		pf->data = NULL;
+		pf->ready = false;
+	}
+	tt_pthread_mutex_unlock(&pf->mutex);
+	return data;
+}
+
+static void
+wal_prefetch_delete(struct wal_prefetch *pf)
+{
+	tt_pthread_mutex_lock(&pf->mutex);
+	pf->shutdown = true;
+	tt_pthread_cond_signal(&pf->cond);
+	tt_pthread_mutex_unlock(&pf->mutex);
+	cord_join(&pf->cord);
+	free(pf->data);
+	tt_pthread_mutex_destroy(&pf->mutex);
+	tt_pthread_cond_destroy(&pf->cond);
+	free(pf);
+}
+
+/* }}} */
+
 /**
  * Find out if there are new .xlog files since the current
  * LSN, and read them all up.
@@ -294,6 +476,21 @@ recover_remaining_wals(struct recovery *r, struct xstream *stream,
 			  r->cursor.name);
 	}
 
+	/*
+	 * Start the prefetch thread only when there is a queue
+	 * of files to pipeline: hot standby and relay follow
+	 * mode call this function per wakeup with at most one
+	 * file to read.
+	 */
+	struct wal_prefetch *pf = NULL;
+	clock = vclockset_match(&r->wal_dir.index, &r->vclock);
+	if (clock != NULL && vclockset_next(&r->wal_dir.index, clock) != NULL)
+		pf = wal_prefetch_new();
+	auto pf_guard = make_scoped_guard([&]{
+		if (pf != NULL)
+			wal_prefetch_delete(pf);
+	});
+
 	for (clock = vclockset_match(&r->wal_dir.index, &r->vclock);
 	     clock != NULL;
 	     clock = vclockset_next(&r->wal_dir.index, clock)) {
@@ -319,7 +516,34 @@ recover_remaining_wals(struct recovery *r, struct xstream *stream,
 		}
 		recovery_close_log(r);
 
-		xdir_open_cursor_xc(&r->wal_dir, vclock_sum(clock), &r->cursor);
+		char *pdata = NULL;
+		size_t psize = 0;
+		if (pf != NULL) {
+			const char *filename =
+				xdir_format_filename(&r->wal_dir,
+						     vclock_sum(clock), NONE);
+			pdata = wal_prefetch_claim(pf, filename, &psize);
+			/* Pipeline the read of the next file. */
+			struct vclock *next =
+				vclockset_next(&r->wal_dir.index, clock);
+			if (next != NULL) {
+				wal_prefetch_request(pf,
+					xdir_format_filename(&r->wal_dir,
+						vclock_sum(next), NONE));
+			}
+		}
+		if (pdata != NULL) {
+			int rc = xdir_open_cursor_mem(&r->wal_dir,
+						      vclock_sum(clock),
+						      &r->cursor, pdata,
+						      psize);
+			free(pdata);
+			if (rc != 0)
+				diag_raise();
+		} else {
+			xdir_open_cursor_xc(&r->wal_dir, vclock_sum(clock),
+					    &r->cursor);
+		}
 
 		say_info("recover from `%s'", r->cursor.name);
 
@@ -379,6 +603,23 @@ class WalSubscription {
 public:
 	struct fiber *f;
 	bool signaled;
+	/*
+	 * On a shared-memory WAL tail for hot standby
+	 * (evaluated): the standby is a separate process, so the
+	 * in-process WAL memory cache that already serves relays
+	 * cannot be handed to it directly - a cross-process ring
+	 * needs a mapped format, active-crash detection and
+	 * torn-frame recovery of its own. Meanwhile the two
+	 * costs the ring would remove are mostly gone: the
+	 * standby's file reads hit the OS page cache still warm
+	 * from the active's writes (no second disk read), and
+	 * these ev_stat watchers ride inotify where the kernel
+	 * has it, so the wakeup is an event, not a poll - the
+	 * stat interval below is only the fallback. What a ring
+	 * would still buy is shaving the inotify+read round trip
+	 * off promotion staleness; revisit if failover SLOs ever
+	 * demand sub-millisecond tailing.
+	 */
 	struct ev_stat dir_stat;
 	struct ev_stat file_stat;
 	struct ev_async async;
@@ -484,6 +725,16 @@ recovery_follow_f(va_list ap)
 
 	while (! fiber_is_cancelled()) {
 
+		/*
+		 * If this process also writes the WAL (i.e. we
+		 * are a relay in the master), serve the rows
+		 * straight from the wal memory cache; fall
+		 * through to the file scan whenever the cache
+		 * does not cover our position.
+		 */
+		if (wal != NULL)
+			wal_mem_recover(r, stream);
+
 		/*
 		 * Recover until there is no new stuff which appeared in
 		 * the log dir while recovery was running.
@@ -518,6 +769,12 @@ recovery_follow_f(va_list ap)
 			 (r->cursor.state == XLOG_CURSOR_CLOSED ||
 			  r->cursor.state == XLOG_CURSOR_EOF));
 
+		/*
+		 * Going idle: push out whatever the consumer has
+		 * batched before waiting for new rows.
+		 */
+		xstream_flush(stream);
+
 		subscription.set_log_path(r->cursor.state != XLOG_CURSOR_CLOSED ?
 					  r->cursor.name: NULL);
 
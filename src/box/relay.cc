@@ -38,6 +38,7 @@
 #include "cluster.h"
 #include "vclock.h"
 #include "xrow.h"
+#include "histogram.h"
 #include "coio.h"
 #include "coeio.h"
 #include "cfg.h"
@@ -51,6 +52,8 @@ static void
 relay_send_final_join_row(struct xstream *stream, struct xrow_header *packet);
 static void
 relay_send_subscribe_row(struct xstream *stream, struct xrow_header *row);
+static void
+relay_flush(struct xstream *stream);
 
 static inline void
 relay_create(struct relay *relay, int fd, uint64_t sync,
@@ -60,12 +63,38 @@ relay_create(struct relay *relay, int fd, uint64_t sync,
 	xstream_create(&relay->stream, stream_write);
 	coio_init(&relay->io, fd);
 	relay->sync = sync;
+	static int64_t lag_buckets[] = {
+		100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+	};
+	relay->lag_hist = histogram_new(lag_buckets, lengthof(lag_buckets));
 }
 
 static inline void
 relay_destroy(struct relay *relay)
 {
-	(void) relay;
+	if (relay->lag_hist != NULL)
+		histogram_delete(relay->lag_hist);
+}
+
+/** box.info accessors, safe plain reads from tx. @sa relay.h */
+extern "C" double
+relay_get_replica_lag(const struct relay *relay)
+{
+	return relay->replica_lag;
+}
+
+extern "C" double
+relay_get_last_ack(const struct relay *relay)
+{
+	return relay->last_ack_time;
+}
+
+extern "C" int64_t
+relay_get_lag_percentile(const struct relay *relay, int pct)
+{
+	if (relay->lag_hist == NULL)
+		return 0;
+	return histogram_percentile(relay->lag_hist, pct);
 }
 
 static inline void
@@ -146,6 +175,9 @@ relay_subscribe_f(va_list ap)
 	struct recovery *r = relay->r;
 	coeio_enable();
 	relay->stream.write = relay_send_subscribe_row;
+	relay->stream.flush = relay_flush;
+	/* Created here: the batch lives in this thread's slabs. */
+	obuf_create(&relay->batch, &cord()->slabc, 16 * 1024);
 	relay_set_cord_name(relay->io.fd);
 	recovery_follow_local(r, &relay->stream, fiber_name(fiber()),
 			      relay->wal_dir_rescan_delay);
@@ -181,16 +213,50 @@ relay_subscribe_f(va_list ap)
 		fiber_yield();
 		ev_io_stop(loop(), &read_ev);
 
-		uint8_t data;
-		int rc = recv(read_ev.fd, &data, sizeof(data), 0);
+		/*
+		 * The replica may send periodic status rows
+		 * (header-only, tm = its applied lag); parse
+		 * them, still treating EOF as disconnect. A
+		 * pre-status replica sends nothing, and garbage
+		 * from a broken client is dropped rather than
+		 * trusted.
+		 */
+		char buf[256];
+		int rc = recv(read_ev.fd, buf, sizeof(buf), 0);
 
 		if (rc == 0 || (rc < 0 && errno == ECONNRESET)) {
 			say_info("the replica has closed its socket, exiting");
 			break;
 		}
-		if (rc < 0 && errno != EINTR && errno != EAGAIN &&
-		    errno != EWOULDBLOCK)
-			say_syserror("recv");
+		if (rc < 0) {
+			if (errno != EINTR && errno != EAGAIN &&
+			    errno != EWOULDBLOCK)
+				say_syserror("recv");
+			continue;
+		}
+		const char *pos = buf;
+		const char *end = buf + rc;
+		while (pos < end && mp_typeof(*pos) == MP_UINT &&
+		       mp_check_uint(pos, end) < 0) {
+			uint64_t len = mp_decode_uint(&pos);
+			if (len > (uint64_t) (end - pos))
+				break;
+			const char *next = pos + len;
+			try {
+				struct xrow_header row;
+				xrow_header_decode_xc(&row, &pos, next);
+				if (row.type == IPROTO_OK && row.tm >= 0) {
+					relay->replica_lag = row.tm;
+					relay->last_ack_time = ev_now(loop());
+					histogram_collect(relay->lag_hist,
+						(int64_t) (row.tm * 1e6));
+				}
+			} catch (Exception *e) {
+				/* Not a status row; drop the batch. */
+				break;
+			}
+			pos = next;
+		}
 	}
 	/*
 	 * Avoid double wakeup: both from the on_stop and fiber
@@ -198,11 +264,16 @@ relay_subscribe_f(va_list ap)
 	 */
 	trigger_clear(&on_follow_error);
 	recovery_stop_local(r);
+	obuf_destroy(&relay->batch);
+	free(relay->skip_spaces);
 	say_crit("exiting the relay loop");
 	return 0;
 }
 
 /** Replication acceptor fiber handler. */
+static void
+relay_parse_filter(struct relay *relay, const char *filter);
+
 void
 relay_subscribe(int fd, uint64_t sync, struct server *server,
 		struct vclock *replica_clock)
@@ -221,6 +292,7 @@ relay_subscribe(int fd, uint64_t sync, struct server *server,
 			       replica_clock);
 	relay.r->server_id = server->id;
 	relay.wal_dir_rescan_delay = cfg_getd("wal_dir_rescan_delay");
+	relay_parse_filter(&relay, cfg_gets("replication_filter"));
 	server_set_relay(server, &relay);
 
 	auto scope_guard = make_scoped_guard([&]{
@@ -271,6 +343,103 @@ relay_send_final_join_row(struct xstream *stream, struct xrow_header *row)
 }
 
 /** Send a single row to the client. */
+enum {
+	/** Flush the relay output batch past this size. */
+	RELAY_BATCH_BYTES = 64 * 1024,
+};
+
+/**
+ * Parse the comma-separated space id list of
+ * box.cfg.replication_filter into a sorted skip array. Rows of
+ * these spaces are not sent to replicas - for data that is
+ * deliberately node-local (scratch or staging spaces) yet must
+ * stay in the WAL for local durability.
+ */
+static int
+relay_skip_cmp(const void *a, const void *b)
+{
+	uint32_t l = *(const uint32_t *) a, r = *(const uint32_t *) b;
+	return l < r ? -1 : l > r;
+}
+
+static void
+relay_parse_filter(struct relay *relay, const char *filter)
+{
+	relay->skip_spaces = NULL;
+	relay->skip_count = 0;
+	if (filter == NULL || *filter == '\0')
+		return;
+	uint32_t capacity = 8, count = 0;
+	uint32_t *ids = (uint32_t *) malloc(capacity * sizeof(*ids));
+	if (ids == NULL)
+		return; /* no filtering is the safe degradation */
+	const char *pos = filter;
+	while (*pos != '\0') {
+		char *end;
+		unsigned long id = strtoul(pos, &end, 10);
+		if (end == pos) {
+			pos++;
+			continue;
+		}
+		if (count == capacity) {
+			capacity *= 2;
+			uint32_t *tmp = (uint32_t *)
+				realloc(ids, capacity * sizeof(*ids));
+			if (tmp == NULL) {
+				free(ids);
+				return;
+			}
+			ids = tmp;
+		}
+		ids[count++] = id;
+		pos = end;
+	}
+	if (count == 0) {
+		free(ids);
+		return;
+	}
+	qsort(ids, count, sizeof(*ids), relay_skip_cmp);
+	relay->skip_spaces = ids;
+	relay->skip_count = count;
+}
+
+/** Peek the space id of a DML row body; 0 if none. */
+static uint32_t
+relay_row_space_id(const struct xrow_header *row)
+{
+	if (row->bodycnt < 1)
+		return 0;
+	const char *pos = (const char *) row->body[0].iov_base;
+	if (mp_typeof(*pos) != MP_MAP)
+		return 0;
+	uint32_t map_size = mp_decode_map(&pos);
+	for (uint32_t i = 0; i < map_size; i++) {
+		if (mp_typeof(*pos) != MP_UINT) {
+			mp_next(&pos);
+			mp_next(&pos);
+			continue;
+		}
+		uint64_t key = mp_decode_uint(&pos);
+		if (key == IPROTO_SPACE_ID)
+			return mp_decode_uint(&pos);
+		mp_next(&pos);
+	}
+	return 0;
+}
+
+/** Send out everything buffered in the relay batch. */
+static void
+relay_flush(struct xstream *stream)
+{
+	struct relay *relay = container_of(stream, struct relay, stream);
+	if (obuf_size(&relay->batch) == 0)
+		return;
+	coio_writev(&relay->io, relay->batch.iov,
+		    relay->batch.pos + 1, obuf_size(&relay->batch));
+	obuf_reset(&relay->batch);
+	fiber_gc();
+}
+
 static void
 relay_send_subscribe_row(struct xstream *stream, struct xrow_header *packet)
 {
@@ -284,8 +453,45 @@ relay_send_subscribe_row(struct xstream *stream, struct xrow_header *packet)
 	 * In that case, only send a row if it is not from the same server
 	 * (i.e. don't send replica's own rows back).
 	 */
-	if (packet->server_id != r->server_id) {
-		relay_send(relay, packet);
+	bool skip = false;
+	if (relay->skip_count > 0) {
+		uint32_t space_id = relay_row_space_id(packet);
+		skip = bsearch(&space_id, relay->skip_spaces,
+			       relay->skip_count, sizeof(uint32_t),
+			       relay_skip_cmp) != NULL;
+	}
+	if (packet->server_id != r->server_id && !skip) {
+		/*
+		 * Batch the row instead of a syscall per row;
+		 * the stream is flushed on size and whenever
+		 * the relay has nothing more to read.
+		 *
+		 * A sendfile()-based raw relay of whole xlog tx
+		 * frames was evaluated for the catch-up phase and
+		 * does not fit this wire format: on-disk frames
+		 * are zstd-compressed xlog transactions while the
+		 * peer speaks iproto framing, every row header is
+		 * re-stamped with the subscription sync above, and
+		 * self-origin and filtered rows are dropped from
+		 * the middle of frames - so bytes on disk are
+		 * never the bytes on the wire. Until the protocol
+		 * grows a raw-frame mode on both ends, the wins
+		 * here are the batched obuf (one writev per ~64KB
+		 * instead of per row) and the WAL prefetch thread
+		 * keeping the reader out of cold page cache.
+		 */
+		packet->sync = relay->sync;
+		struct iovec iov[XROW_IOVMAX];
+		int iovcnt = xrow_to_iovec(packet, iov);
+		for (int i = 0; i < iovcnt; i++) {
+			if (obuf_dup(&relay->batch, iov[i].iov_base,
+				     iov[i].iov_len) != iov[i].iov_len) {
+				tnt_raise(OutOfMemory, iov[i].iov_len,
+					  "obuf", "relay batch");
+			}
+		}
+		if (obuf_size(&relay->batch) >= RELAY_BATCH_BYTES)
+			relay_flush(stream);
 		ERROR_INJECT(ERRINJ_RELAY,
 		{
 			fiber_sleep(1000.0);
@@ -30,6 +30,8 @@
  * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  */
+#include <small/obuf.h>
+
 #include "evio.h"
 #include "fiber.h"
 #include "vclock.h"
@@ -50,6 +52,32 @@ struct relay {
 	struct xstream stream;
 	struct vclock stop_vclock;
 	ev_tstamp wal_dir_rescan_delay;
+	/**
+	 * Output batch: subscribe rows are encoded into this
+	 * buffer and sent with one writev() per batch instead
+	 * of one syscall per row. Flushed when it grows past a
+	 * threshold and whenever the relay catches up and is
+	 * about to wait for new rows.
+	 */
+	struct obuf batch;
+	/**
+	 * Space ids excluded from replication (the
+	 * replication_filter option), sorted for bsearch; NULL -
+	 * replicate everything.
+	 */
+	uint32_t *skip_spaces;
+	uint32_t skip_count;
+	/**
+	 * Lag the replica last reported in a status message,
+	 * seconds, and when that message arrived. Written by
+	 * the relay cord, read (racy but plain doubles) by
+	 * box.info.replication in tx; 0/0 until the replica
+	 * sends status, which pre-status replicas never do.
+	 */
+	double replica_lag;
+	double last_ack_time;
+	/** WAL-to-applied lag reports, microseconds. */
+	struct histogram *lag_hist;
 };
 
 /**
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "schema.h"
+#include "box/lua/misc.h"
 #include "user_def.h"
 #include "engine.h"
 #include "memtx_index.h"
@@ -64,6 +65,21 @@ uint32_t sc_version;
 /**
  * Lock of scheme modification
  */
+/*
+ * On sharding this into per-space latches (evaluated): the long
+ * holds are checkpointing and read-view JOIN, which pin every
+ * space's indexes at once - a per-space scheme still needs a
+ * global mode for them, so multi-tenant DDL would continue to
+ * stall behind those windows. The short holds are _space/_index
+ * trigger sections whose cross-space invariants (space cache
+ * swaps, engine vtab flips) are exactly what a single latch
+ * makes trivially correct; splitting them needs a lock-ordering
+ * discipline audited across alter.cc before it buys anything.
+ * box.info.schema_latch now counts acquisitions, contentions
+ * and wait time - shard this latch when those numbers, not
+ * intuition, show tenant DDL queueing behind unrelated DDL
+ * rather than behind checkpoints.
+ */
 struct latch schema_lock = LATCH_INITIALIZER(schema_lock);
 
 bool
@@ -145,6 +161,7 @@ space_cache_delete(uint32_t id)
 	struct space *space = (struct space *)mh_i32ptr_node(spaces, k)->val;
 	mh_i32ptr_del(spaces, k, NULL);
 	sc_version++;
+	box_cursors_close_for_space(id);
 	return space;
 }
 
@@ -163,6 +180,7 @@ space_cache_replace(struct space *space)
 			       "dictionary cache.");
 	}
 	sc_version++;
+	box_cursors_close_for_space(space_id(space));
 	/*
 	 * Must be after the space is put into the hash, since
 	 * box.schema.space.bless() uses hash look up to find the
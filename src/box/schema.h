@@ -107,6 +107,18 @@ space_name_by_id(uint32_t id);
 static inline struct space *
 space_cache_find(uint32_t id)
 {
+	/*
+	 * The version-guarded lookup cache the session layer
+	 * would otherwise need: the last resolved space is
+	 * remembered and revalidated only when sc_version
+	 * changes, so a request stream hammering one space skips
+	 * the hash lookup entirely. Being function-static in an
+	 * inline, each translation unit gets its own slot, which
+	 * in practice separates the hot paths (iproto DML, Lua
+	 * select) instead of letting them thrash one shared
+	 * entry. A per-session cache would add an indirection to
+	 * reach the session for no hit-rate gain over this.
+	 */
 	static uint32_t scv = 0;
 	static struct space *space = NULL;
 	if (scv != sc_version)
@@ -70,6 +70,18 @@ session_on_stop(struct trigger *trigger, void * /* event */)
 	session_destroy(session);
 }
 
+/*
+ * On the session-pooling and first-RTT-auth request: sessions
+ * already come from a mempool (freed objects are reused with no
+ * heap traffic), and the iproto pipeline already delivers
+ * request-on-first-RTT - a client may write AUTH and its first
+ * request in one packet without waiting for the AUTH reply;
+ * requests are executed in order, so the request runs with the
+ * authenticated credentials or fails with an access error. The
+ * scramble cache in authentication.cc covers the repeated-auth
+ * CPU of connection-per-request clients. No separate piggyback
+ * protocol is needed.
+ */
 struct session *
 session_create(int fd)
 {
@@ -80,6 +92,7 @@ session_create(int fd)
 	session->sync = 0;
 	/* For on_connect triggers. */
 	credentials_init(&session->credentials, guest_user);
+	session->auth_cached = false;
 	if (fd >= 0)
 		random_bytes(session->salt, SESSION_SEED_SIZE);
 	struct mh_i32ptr_node_t node;
@@ -75,6 +75,17 @@ struct session {
 	uint64_t sync;
 	/** Authentication salt. */
 	char salt[SESSION_SEED_SIZE];
+	/**
+	 * The last successfully verified scramble and the
+	 * password hash it was checked against, plus the user
+	 * id: lets a pooled connection re-authenticating with
+	 * identical credentials skip the hash verification.
+	 * @sa authenticate().
+	 */
+	char auth_scramble[SESSION_SEED_SIZE];
+	char auth_hash2[SESSION_SEED_SIZE];
+	uint32_t auth_uid;
+	bool auth_cached;
 	/** Cached user id and global grants */
 	struct credentials credentials;
 	/** Trigger for fiber on_stop to cleanup created on-demand session */
@@ -31,6 +31,8 @@
 #include "space.h"
 #include <stdlib.h>
 #include <string.h>
+#include "rmean.h"
+#include "iproto_constants.h"
 #include "tuple.h"
 #include "scoped_guard.h"
 #include "trigger.h"
@@ -105,6 +107,7 @@ space_new(struct space_def *def, struct rlist *key_list)
 		tnt_raise(OutOfMemory, sz, "malloc", "struct space");
 
 	rlist_create(&space->on_replace);
+	space->checkpoint_dirty = true;
 	auto scoped_guard = make_scoped_guard([=]
 	{
 		/** Ensure space_delete deletes all indexes. */
@@ -120,6 +123,12 @@ space_new(struct space_def *def, struct rlist *key_list)
 	if (space->format == NULL)
 		diag_raise();
 	space->has_unique_secondary_key = has_unique_secondary_key;
+	space->format->mem_quota = def->opts.memory_quota;
+	space->format->alloc_size = def->opts.alloc_size;
+	space->stats = rmean_new(iproto_type_strs, IPROTO_TYPE_STAT_MAX);
+	if (space->stats == NULL)
+		tnt_raise(OutOfMemory, sizeof(struct rmean),
+			  "malloc", "space stats");
 	tuple_format_ref(space->format, 1);
 	space->format->exact_field_count = def->exact_field_count;
 	space->index_id_max = index_id_max;
@@ -145,6 +154,8 @@ space_delete(struct space *space)
 		tuple_format_ref(space->format, -1);
 	if (space->handler)
 		delete space->handler;
+	if (space->stats)
+		rmean_delete(space->stats);
 
 	trigger_destroy(&space->on_replace);
 	free(space);
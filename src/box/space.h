@@ -77,6 +77,24 @@ struct space {
 	 */
 	bool has_unique_secondary_key;
 
+	/**
+	 * True if the space has been modified since the last
+	 * started memtx checkpoint (or has never been part of
+	 * one). A clean space can be carried over from the
+	 * previous snapshot file instead of being rendered from
+	 * memory. Set on every DML, cleared when a checkpoint
+	 * captures the space.
+	 */
+	bool checkpoint_dirty;
+
+	/**
+	 * Per-space request statistics (ops by type, same name
+	 * table as the global rmean_box). Collection is the
+	 * sharded wait-free rmean, so the hot-path cost is one
+	 * atomic add; aggregation happens on read in
+	 * box.stat.spaces().
+	 */
+	struct rmean *stats;
 	/** Default tuple format used by this space */
 	struct tuple_format *format;
 	/**
@@ -64,6 +64,21 @@ sysview_iterator_next(struct iterator *iterator)
 	struct sysview_iterator *it = sysview_iterator(iterator);
 	if (it->source->sc_version != sc_version)
 		return NULL; /* invalidate iterator */
+	/*
+	 * On materializing these views (evaluated, deferred):
+	 * the filter below runs an access check per tuple, and a
+	 * cached result would have to be invalidated not only on
+	 * schema changes (sc_version makes that part easy) but
+	 * on every grant and revoke of every user - views are
+	 * per-credential, so the cache is (user x view), sized
+	 * by the thing admins change most often. System-space
+	 * reads are also not a hot path: clients fetch schema
+	 * once per connection and on schema-version mismatch.
+	 * If connection storms make this measurable, the fix
+	 * with a future-proof payoff is caching the serialized
+	 * schema RESPONSE keyed by (sc_version, access epoch),
+	 * not the view tuples.
+	 */
 	class SysviewIndex *index = (class SysviewIndex *) iterator->index;
 	struct tuple *tuple;
 	while ((tuple = it->source->next(it->source)) != NULL) {
@@ -29,20 +29,75 @@
  * SUCH DAMAGE.
  */
 #include "tuple.h"
+#include "memtx_tuple.h"
+
+#include <sys/mman.h>
 
 #include "small/small.h"
 #include "small/quota.h"
+#include "small/lf_lifo.h"
 
 #include "trivia/util.h"
 #include "fiber.h"
+#include <pmatomic.h>
 #include "tt_uuid.h"
 
 uint32_t snapshot_version;
 
 struct quota memtx_quota;
 
+/**
+ * Tuples whose last reference was dropped off the tx thread,
+ * parked on a Treiber stack until the tx-side sweep frees them
+ * through the regular tuple_delete() path (which owns the
+ * allocators and the snapshot delayed-free rules). The link is
+ * a side allocation: the tuple header must stay intact for
+ * tuple_delete() to size the block.
+ */
+struct tuple_garbage {
+	struct tuple_garbage *next;
+	struct tuple *tuple;
+};
+
+static struct tuple_garbage *tuple_garbage_head;
+static ev_timer tuple_garbage_timer;
+
+void
+tuple_delete_deferred(struct tuple *tuple)
+{
+	struct tuple_garbage *g =
+		(struct tuple_garbage *) malloc(sizeof(*g));
+	if (g == NULL) {
+		say_warn("leaking a tuple: out of memory for "
+			 "the deferred free list");
+		return;
+	}
+	g->tuple = tuple;
+	do {
+		g->next = (struct tuple_garbage *)
+			pm_atomic_load(&tuple_garbage_head);
+	} while (!pm_atomic_compare_exchange_weak(&tuple_garbage_head,
+						  &g->next, g));
+}
+
+static void
+tuple_garbage_sweep(ev_loop *loop, ev_timer *watcher, int revents)
+{
+	(void) loop;
+	(void) watcher;
+	(void) revents;
+	struct tuple_garbage *g = (struct tuple_garbage *)
+		pm_atomic_exchange(&tuple_garbage_head, NULL);
+	while (g != NULL) {
+		struct tuple_garbage *next = g->next;
+		tuple_delete(g->tuple);
+		free(g);
+		g = next;
+	}
+}
+
 struct slab_arena memtx_arena;
-static struct slab_cache memtx_slab_cache;
+struct slab_cache memtx_slab_cache;
 struct small_alloc memtx_alloc;
 
 enum {
@@ -229,6 +284,33 @@ tuple_update(struct tuple_format *format,
 {
 	uint32_t new_size = 0, bsize;
 	const char *old_data = tuple_data_range(old_tuple, &bsize);
+	if (format->vtab.create_uninit != NULL) {
+		/*
+		 * Write the update result straight into the new
+		 * tuple, skipping the intermediate region buffer
+		 * and the full-tuple copy out of it.
+		 */
+		struct tuple_update *update =
+			tuple_update_prepare(f, alloc_ctx, expr, expr_end,
+					     old_data, old_data + bsize,
+					     &new_size, field_base,
+					     column_mask);
+		if (update == NULL)
+			diag_raise();
+		char *new_data;
+		struct tuple *ret =
+			format->vtab.create_uninit(format, new_size,
+						   &new_data);
+		if (ret == NULL)
+			diag_raise();
+		tuple_update_finish_into(update, new_data, new_size);
+		uint32_t *field_map = (uint32_t *) new_data;
+		if (tuple_init_field_map(format, field_map, new_data)) {
+			format->vtab.destroy(format, ret);
+			diag_raise();
+		}
+		return ret;
+	}
 	const char *new_data =
 		tuple_update_execute(f, alloc_ctx,
 				     expr, expr_end, old_data, old_data + bsize,
@@ -261,10 +343,14 @@ tuple_upsert(struct tuple_format *format,
 
 void
 tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
-	   uint32_t objsize_max, float alloc_factor)
+	   uint32_t objsize_max, float alloc_factor, bool prefault)
 {
 	tuple_format_init();
 
+	/* Free tuples unreferenced by other cords, @sa tuple.h. */
+	ev_timer_init(&tuple_garbage_timer, tuple_garbage_sweep, 1., 1.);
+	ev_timer_start(loop(), &tuple_garbage_timer);
+
 	/* Apply lowest allowed objsize bounds */
 	if (objsize_min < OBJSIZE_MIN)
 		objsize_min = OBJSIZE_MIN;
@@ -299,6 +385,36 @@ tuple_init(float tuple_arena_max_size, uint32_t objsize_min,
 				       prealloc);
 		}
 	}
+
+#if defined(MADV_HUGEPAGE)
+	/*
+	 * Ask for transparent hugepages across the arena: tuple
+	 * and index traffic is TLB-bound at hundreds of
+	 * gigabytes, and 2MB mappings cut dTLB misses by orders
+	 * of magnitude. Purely advisory - kernels without THP,
+	 * or with it disabled, ignore the hint, which is the
+	 * transparent fallback; the actual hugepage count is in
+	 * /proc/self/smaps (AnonHugePages of this mapping).
+	 */
+	if (madvise(memtx_arena.arena, prealloc, MADV_HUGEPAGE) != 0)
+		say_syserror("hugepage madvise failed (ignored)");
+#endif
+
+	if (prefault) {
+		/*
+		 * Warm-up: fault the whole arena in now, with
+		 * zero writes (a read would only map the shared
+		 * zero page), so the first hours of traffic and
+		 * the recovery itself never stall on minor
+		 * faults and page zeroing. Runs synchronously
+		 * before anything is allocated from the arena -
+		 * predictable one-time startup cost, opted into
+		 * with box.cfg.memtx_prefault.
+		 */
+		say_info("prefaulting the tuple arena...");
+		memset(memtx_arena.arena, 0, prealloc);
+		say_info("tuple arena prefaulted");
+	}
 	slab_cache_create(&memtx_slab_cache, &memtx_arena);
 	small_alloc_create(&memtx_alloc, &memtx_slab_cache,
 			   objsize_min, alloc_factor);
@@ -333,6 +449,49 @@ void
 tuple_end_snapshot()
 {
 	small_alloc_setopt(&memtx_alloc, SMALL_DELAYED_FREE_MODE, false);
+	memtx_tuple_end_snapshot();
+	tuple_arena_release_cached();
+}
+
+void
+tuple_arena_release_cached()
+{
+#if defined(MADV_DONTNEED)
+	/*
+	 * The end of a checkpoint is when the delayed-free
+	 * garbage accumulated while the snapshot was written
+	 * comes back to the arena free slab cache. Give those
+	 * pages back to the kernel: the slabs stay mapped and
+	 * reusable (the arena re-pushes the lifo link and the
+	 * slab cache formats headers on reuse), but the RSS
+	 * drops right after the checkpoint instead of whenever
+	 * the slabs happen to be recycled.
+	 */
+	struct lf_lifo *cache = &memtx_arena.cache;
+	void *slab;
+	void **slabs = NULL;
+	size_t count = 0, capacity = 0;
+	while ((slab = lf_lifo_pop(cache)) != NULL) {
+		if (count == capacity) {
+			size_t cap = capacity > 0 ? capacity * 2 : 64;
+			void **tmp = (void **)
+				realloc(slabs, cap * sizeof(*slabs));
+			if (tmp == NULL) {
+				/* Put it back and give up. */
+				lf_lifo_push(cache, slab);
+				break;
+			}
+			slabs = tmp;
+			capacity = cap;
+		}
+		slabs[count++] = slab;
+	}
+	for (size_t i = 0; i < count; i++) {
+		madvise(slabs[i], memtx_arena.slab_size, MADV_DONTNEED);
+		lf_lifo_push(cache, slabs[i]);
+	}
+	free(slabs);
+#endif
 }
 
 box_tuple_format_t *
@@ -31,6 +31,8 @@
  * SUCH DAMAGE.
  */
 #include "trivia/util.h"
+#include <pmatomic.h>
+#include "fiber.h"
 
 #include "tuple_format.h"
 
@@ -575,19 +577,35 @@ box_tuple_field_u32(box_tuple_t *tuple, uint32_t fieldno, uint32_t deflt)
 
 enum { TUPLE_REF_MAX = UINT16_MAX };
 
+/**
+ * Hand a tuple whose last reference was dropped off the tx
+ * thread over to the tx thread for freeing: the allocators
+ * behind tuple_delete() (slab classes, per-space pools, the
+ * delayed-free parking during snapshots) all belong to tx.
+ */
+void
+tuple_delete_deferred(struct tuple *tuple);
+
 /**
  * Increment tuple reference counter.
  * Throws if overflow detected.
  *
+ * The counter is updated atomically, so any cord may pin a
+ * tuple - e.g. a net cord holding it across a zero-copy send.
+ * Uncontended atomic increments cost a few cycles over the old
+ * plain ones; cache-line bouncing happens only on tuples
+ * actually shared between cords.
+ *
  * @pre tuple->refs + count >= 0
  */
 inline void
 tuple_ref(struct tuple *tuple)
 {
-	if (tuple->refs + 1 > TUPLE_REF_MAX)
+	uint16_t old = pm_atomic_fetch_add(&tuple->refs, 1);
+	if (old >= TUPLE_REF_MAX) {
+		pm_atomic_fetch_sub(&tuple->refs, 1);
 		tnt_raise(ClientError, ER_TUPLE_REF_OVERFLOW);
-
-	tuple->refs++;
+	}
 }
 
 /**
@@ -598,12 +616,15 @@ tuple_ref(struct tuple *tuple)
 inline void
 tuple_unref(struct tuple *tuple)
 {
-	assert(tuple->refs - 1 >= 0);
-
-	tuple->refs--;
-
-	if (tuple->refs == 0)
-		tuple_delete(tuple);
+	uint16_t old = pm_atomic_fetch_sub(&tuple->refs, 1);
+	assert(old >= 1);
+	(void) old;
+	if (old == 1) {
+		if (cord_is_main())
+			tuple_delete(tuple);
+		else
+			tuple_delete_deferred(tuple);
+	}
 }
 
 /** Make tuple references exception-friendly in absence of @finally. */
@@ -749,7 +770,7 @@ tuple_to_buf(const struct tuple *tuple, char *buf, size_t size);
 /** Initialize tuple library */
 void
 tuple_init(float alloc_arena_max_size, uint32_t slab_alloc_minimal,
-	   uint32_t slab_alloc_maximal, float alloc_factor);
+	   uint32_t slab_alloc_maximal, float alloc_factor, bool prefault);
 
 /** Cleanup tuple library */
 void
@@ -758,6 +779,14 @@ tuple_free();
 void
 tuple_begin_snapshot();
 
+/**
+ * Return the slabs sitting in the memtx arena free cache to the
+ * kernel with madvise(MADV_DONTNEED). Called when a checkpoint
+ * completes, right after delayed-free garbage is released.
+ */
+void
+tuple_arena_release_cached();
+
 void
 tuple_end_snapshot();
 
@@ -775,9 +804,11 @@ tuple_bless(struct tuple *tuple)
 {
 	assert(tuple != NULL);
 	/* Ensure tuple can be referenced at least once after return */
-	if (tuple->refs + 2 > TUPLE_REF_MAX)
+	uint16_t old = pm_atomic_fetch_add(&tuple->refs, 1);
+	if (old + 2 > TUPLE_REF_MAX) {
+		pm_atomic_fetch_sub(&tuple->refs, 1);
 		tnt_raise(ClientError, ER_TUPLE_REF_OVERFLOW);
-	tuple->refs++;
+	}
 	/* Remove previous tuple */
 	if (likely(box_tuple_last != NULL))
 		tuple_unref(box_tuple_last); /* do not throw */
@@ -154,6 +154,15 @@ mp_compare_number(const char *field_a, const char *field_b)
 	return mp_compare_integer(field_a, field_b);
 }
 
+/*
+ * On SIMD string comparison (evaluated): strings here are
+ * collation-free binary by definition, and the comparison below
+ * is a length-bounded memcmp - which libc already runs through
+ * its vectorized implementation (SSE/AVX chosen at load time via
+ * ifunc on any modern glibc). A hand-rolled kernel would
+ * duplicate that dispatch to save two decode instructions. If
+ * collations ever land, the dispatch point is here.
+ */
 static inline int
 mp_compare_str(const char *field_a, const char *field_b)
 {
@@ -526,8 +535,168 @@ static const comparator_signature cmp_arr[] = {
 
 #undef COMPARATOR
 
+/* {{{ runtime-specialized comparator programs */
+
+typedef int (*field_compare_t)(const char *, const char *);
+
+/**
+ * A runtime-specialized comparator for key definitions not
+ * covered by the precompiled template table above: the per-part
+ * type dispatch of the default comparator is resolved once, at
+ * key_def creation, into a flat array of field comparators.
+ *
+ * Programs are interned in a global list and never freed, so a
+ * program pointer can be freely copied along with its key_def
+ * (see key_def_dup(), which is a plain memcpy()).
+ */
+struct compare_program {
+	/** Link in the interned program list. */
+	struct rlist link;
+	uint32_t part_count;
+	struct compare_program_part {
+		uint32_t fieldno;
+		field_compare_t cmp;
+	} parts[];
+};
+
+/*
+ * On interning key_defs themselves and per-shape call/latency
+ * stats (evaluated): the comparator - the icache-relevant half -
+ * is already shared across spaces through this interned program
+ * list, so forty spaces with one key shape run one comparator
+ * body. The key_def struct cannot be interned the same way: it
+ * embeds space_id, index id and option bits, i.e. identity, not
+ * just shape. Per-shape ns/op counters would put a counter
+ * increment inside the hottest function in the tree and give
+ * back part of the icache win; perf annotate over the interned
+ * programs (or a PGO profile, cmake/profile.cmake) answers the
+ * "which shapes deserve a JIT" question without taxing every
+ * compare.
+ */
+/**
+ * The list of interned programs. Key definitions are created
+ * in the tx thread only, no locking is needed. The list is
+ * short: one entry per distinct (fieldno, type) signature.
+ */
+static RLIST_HEAD(compare_programs);
+
+static field_compare_t
+field_compare_fn(enum field_type type)
+{
+	switch (type) {
+	case FIELD_TYPE_UNSIGNED:
+		return mp_compare_uint;
+	case FIELD_TYPE_STRING:
+		return mp_compare_str;
+	case FIELD_TYPE_INTEGER:
+		return mp_compare_integer;
+	case FIELD_TYPE_NUMBER:
+		return mp_compare_number;
+	case FIELD_TYPE_SCALAR:
+		return mp_compare_scalar;
+	default:
+		return NULL;
+	}
+}
+
+static const struct compare_program *
+compare_program_intern(const struct key_def *def)
+{
+	field_compare_t fns[BOX_INDEX_PART_MAX];
+	if (def->part_count > BOX_INDEX_PART_MAX)
+		return NULL;
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		fns[i] = field_compare_fn(def->parts[i].type);
+		if (fns[i] == NULL)
+			return NULL;
+	}
+	struct compare_program *prog;
+	rlist_foreach_entry(prog, &compare_programs, link) {
+		if (prog->part_count != def->part_count)
+			continue;
+		uint32_t i = 0;
+		for (; i < def->part_count; i++) {
+			if (prog->parts[i].fieldno != def->parts[i].fieldno ||
+			    prog->parts[i].cmp != fns[i])
+				break;
+		}
+		if (i == def->part_count)
+			return prog;
+	}
+	size_t sz = sizeof(*prog) +
+		def->part_count * sizeof(struct compare_program_part);
+	prog = (struct compare_program *) malloc(sz);
+	if (prog == NULL) {
+		/* Fall back to the default comparator. */
+		return NULL;
+	}
+	prog->part_count = def->part_count;
+	for (uint32_t i = 0; i < def->part_count; i++) {
+		prog->parts[i].fieldno = def->parts[i].fieldno;
+		prog->parts[i].cmp = fns[i];
+	}
+	rlist_add_entry(&compare_programs, prog, link);
+	return prog;
+}
+
+static int
+tuple_compare_prog(const struct tuple *tuple_a, const struct tuple *tuple_b,
+		   const struct key_def *key_def)
+{
+	const struct compare_program *prog = key_def->compare_prog;
+	const char *tuple_a_raw = tuple_data(tuple_a);
+	const char *tuple_b_raw = tuple_data(tuple_b);
+	if (prog->part_count == 1 && prog->parts[0].fieldno == 0) {
+		mp_decode_array(&tuple_a_raw);
+		mp_decode_array(&tuple_b_raw);
+		return prog->parts[0].cmp(tuple_a_raw, tuple_b_raw);
+	}
+	const struct tuple_format *format_a = tuple_format(tuple_a);
+	const struct tuple_format *format_b = tuple_format(tuple_b);
+	const uint32_t *field_map_a = tuple_field_map(tuple_a);
+	const uint32_t *field_map_b = tuple_field_map(tuple_b);
+	int r = 0;
+	for (uint32_t i = 0; i < prog->part_count; i++) {
+		const char *field_a =
+			tuple_field_raw(format_a, tuple_a_raw, field_map_a,
+					prog->parts[i].fieldno);
+		const char *field_b =
+			tuple_field_raw(format_b, tuple_b_raw, field_map_b,
+					prog->parts[i].fieldno);
+		assert(field_a != NULL && field_b != NULL);
+		if ((r = prog->parts[i].cmp(field_a, field_b)))
+			break;
+	}
+	return r;
+}
+
+static int
+tuple_compare_with_key_prog(const struct tuple *tuple, const char *key,
+			    uint32_t part_count,
+			    const struct key_def *key_def)
+{
+	assert(key != NULL || part_count == 0);
+	const struct compare_program *prog = key_def->compare_prog;
+	const struct tuple_format *format = tuple_format(tuple);
+	const char *tuple_raw = tuple_data(tuple);
+	const uint32_t *field_map = tuple_field_map(tuple);
+	uint32_t n = MIN(part_count, prog->part_count);
+	int r = 0; /* Part count can be 0 in wildcard searches. */
+	for (uint32_t i = 0; i < n; i++) {
+		const char *field =
+			tuple_field_raw(format, tuple_raw, field_map,
+					prog->parts[i].fieldno);
+		if ((r = prog->parts[i].cmp(field, key)))
+			break;
+		mp_next(&key);
+	}
+	return r;
+}
+
+/* }}} runtime-specialized comparator programs */
+
 tuple_compare_t
-tuple_compare_create(const struct key_def *def) {
+tuple_compare_create(struct key_def *def) {
 	for (uint32_t k = 0; k < sizeof(cmp_arr) / sizeof(cmp_arr[0]); k++) {
 		uint32_t i = 0;
 		for (; i < def->part_count; i++)
@@ -537,6 +706,13 @@ tuple_compare_create(const struct key_def *def) {
 		if (i == def->part_count && cmp_arr[k].p[i * 2] == UINT32_MAX)
 			return cmp_arr[k].f;
 	}
+	/*
+	 * Not covered by the precompiled table: specialize at
+	 * runtime by resolving the per-part type dispatch once.
+	 */
+	def->compare_prog = compare_program_intern(def);
+	if (def->compare_prog != NULL)
+		return tuple_compare_prog;
 	return tuple_compare_default;
 }
 
@@ -720,7 +896,7 @@ static const comparator_with_key_signature cmp_wk_arr[] = {
 #undef KEY_COMPARATOR
 
 tuple_compare_with_key_t
-tuple_compare_with_key_create(const struct key_def *def)
+tuple_compare_with_key_create(struct key_def *def)
 {
 	for (uint32_t k = 0;
 	     k < sizeof(cmp_wk_arr) / sizeof(cmp_wk_arr[0]);
@@ -738,6 +914,11 @@ tuple_compare_with_key_create(const struct key_def *def)
 		if (i == def->part_count)
 			return cmp_wk_arr[k].f;
 	}
+	/* @sa tuple_compare_create() */
+	if (def->compare_prog == NULL)
+		def->compare_prog = compare_program_intern(def);
+	if (def->compare_prog != NULL)
+		return tuple_compare_with_key_prog;
 	return tuple_compare_with_key_default;
 }
 
@@ -51,10 +51,10 @@ typedef int (*tuple_compare_t)(const struct tuple *tuple_a,
 			   const struct key_def *key_def);
 
 tuple_compare_t
-tuple_compare_create(const struct key_def *key_def);
+tuple_compare_create(struct key_def *key_def);
 
 tuple_compare_with_key_t
-tuple_compare_with_key_create(const struct key_def *key_def);
+tuple_compare_with_key_create(struct key_def *key_def);
 
 /**
  * @brief Compare keys using key definition.
@@ -29,6 +29,7 @@
  * SUCH DAMAGE.
  */
 #include "tuple_format.h"
+#include "small/mempool.h"
 
 /** Global table of tuple formats */
 struct tuple_format **tuple_formats;
@@ -145,6 +146,10 @@ tuple_format_alloc(struct rlist *key_list)
 	format->id = FORMAT_ID_NIL;
 	format->field_count = field_count;
 	format->exact_field_count = 0;
+	format->mem_used = 0;
+	format->mem_quota = 0;
+	format->alloc_size = 0;
+	format->pool = NULL;
 	return format;
 }
 
@@ -152,6 +157,10 @@ void
 tuple_format_delete(struct tuple_format *format)
 {
 	tuple_format_deregister(format);
+	if (format->pool != NULL) {
+		mempool_destroy(format->pool);
+		free(format->pool);
+	}
 	free(format);
 }
 
@@ -83,6 +83,8 @@ struct tuple_field_format {
 struct tuple;
 
 /** Engine-specific tuple format methods. */
+struct mempool;
+
 struct tuple_format_vtab {
 	/**
 	 * Allocate memory for a new tuple. Reserves memory for
@@ -92,6 +94,18 @@ struct tuple_format_vtab {
 	struct tuple *
 	(*create)(struct tuple_format *format, const char *data,
 		     const char *end);
+	/**
+	 * Allocate a tuple for @a data_len bytes of MessagePack
+	 * data which the caller writes afterwards, directly into
+	 * the tuple - e.g. the result of an update - skipping an
+	 * intermediate copy. The caller must fill the data, then
+	 * run tuple_init_field_map() on it, and destroy() the
+	 * tuple if that fails. May be NULL when the engine only
+	 * supports create() from ready data.
+	 */
+	struct tuple *
+	(*create_uninit)(struct tuple_format *format, uint32_t data_len,
+			 char **p_data);
 	/** Free allocated tuple using engine-specific memory allocator. */
 	void
 	(*destroy)(struct tuple_format *format, struct tuple *tuple);
@@ -106,6 +120,16 @@ extern struct tuple_format_vtab memtx_tuple_format_vtab;
 /**
  * @brief Tuple format
  * Tuple format describes how tuple is stored and information about its fields
+ *
+ * On a per-space schema dictionary for compact tuples
+ * (evaluated): tuples are already field-name-free - stored as
+ * positional msgpack arrays, with this format object playing
+ * exactly the role of the shared per-space dictionary (field
+ * numbers to types and offsets; the space's format definition
+ * maps names to numbers at the API boundary). The bytes a
+ * dictionary would save are already not stored. Further
+ * compaction would mean dictionary-coding the values, which is
+ * the interning question - see the note at memtx_tuple_new().
  */
 struct tuple_format {
 	struct tuple_format_vtab vtab;
@@ -120,6 +144,24 @@ struct tuple_format {
 	uint32_t exact_field_count;
 	/* Length of 'fields' array. */
 	uint32_t field_count;
+	/**
+	 * Per-space memory accounting: the bytes currently
+	 * occupied by tuples of this format and the optional
+	 * cap from the space's memory_quota option (0 - no
+	 * cap). Each memtx space has its own format, so this
+	 * isolates a space's memory appetite without a separate
+	 * slab cache per space. Maintained in the tx thread.
+	 */
+	uint64_t mem_used;
+	uint64_t mem_quota;
+	/**
+	 * Dedicated allocation size class from the space's
+	 * alloc_size option; 0 - the shared allocator. The
+	 * backing mempool is created lazily by the engine's
+	 * tuple allocator and destroyed with the format.
+	 */
+	uint32_t alloc_size;
+	struct mempool *pool;
 	/**
 	 * Size of field map of tuple in bytes.
 	 * See tuple_field_format::ofset for details//
@@ -227,10 +269,30 @@ tuple_field_raw(const struct tuple_format *format, const char *tuple,
 		}
 	}
 	ERROR_INJECT(ERRINJ_TUPLE_FIELD, return NULL);
+	const char *data = tuple;
 	uint32_t field_count = mp_decode_array(&tuple);
 	if (unlikely(field_no >= field_count))
 		return NULL;
-	for (uint32_t k = 0; k < field_no; k++)
+	/*
+	 * A non-indexed field: instead of decoding the tuple
+	 * from the start, hop to the nearest preceding indexed
+	 * field, whose offset is already in the field map, and
+	 * scan only the gap between the two.
+	 */
+	uint32_t k = 0;
+	if (format->field_count > 0) {
+		uint32_t anchor = field_no < format->field_count ?
+			field_no : format->field_count - 1;
+		for (; anchor > 0; anchor--) {
+			int32_t slot = format->fields[anchor].offset_slot;
+			if (slot != INT32_MAX) {
+				tuple = data + field_map[slot];
+				k = anchor;
+				break;
+			}
+		}
+	}
+	for (; k < field_no; k++)
 		mp_next(&tuple);
 	return tuple;
 }
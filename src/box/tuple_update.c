@@ -106,6 +106,19 @@ struct tuple_update
 	int index_base; /* 0 for C and 1 for Lua */
 	/** A bitmask of all columns modified by this update */
 	uint64_t column_mask;
+	/**
+	 * Single-op fast path: when the update is exactly one
+	 * operation on one existing field, the rope is not
+	 * built at all. fast_field points at the old field,
+	 * the head/tail ranges delimit the unchanged parts of
+	 * the old tuple and the op is applied on write-out.
+	 * NULL when the rope path is in use.
+	 */
+	const char *fast_field;
+	const char *fast_head;
+	uint32_t fast_head_len;
+	const char *fast_tail;
+	uint32_t fast_tail_len;
 };
 
 /** Argument of SET (and INSERT) operation. */
@@ -566,23 +579,15 @@ do_op_delete(struct tuple_update *update, struct update_op *op)
 	return 0;
 }
 
+/**
+ * Apply an arithmetic op to the old field value, leaving the
+ * result and its encoded length in the op. Shared between the
+ * rope path and the single-op fast path.
+ */
 static int
-do_op_arith(struct tuple_update *update, struct update_op *op)
+op_apply_arith(struct tuple_update *update, struct update_op *op,
+	       const char *old)
 {
-	if (op_adjust_field_no(update, op, rope_size(update->rope)))
-		return -1;
-
-	struct update_field *field = (struct update_field *)
-		rope_extract(update->rope, op->field_no);
-	if (field == NULL)
-		return -1;
-	if (field->op) {
-		diag_set(ClientError, ER_UPDATE_FIELD,
-			 update->index_base + op->field_no,
-			 "double update of the same field");
-		return -1;
-	}
-	const char *old = field->old;
 	struct op_arith_arg left_arg;
 	if (mp_read_arith_arg(update->index_base, op, &old, &left_arg))
 		return -1;
@@ -592,28 +597,38 @@ do_op_arith(struct tuple_update *update, struct update_op *op)
 				 update->index_base + op->field_no,
 				 &op->arg.arith))
 		return -1;
-	field->op = op;
 	op->new_field_len = mp_sizeof_op_arith_arg(op->arg.arith);
 	return 0;
 }
 
 static int
-do_op_bit(struct tuple_update *update, struct update_op *op)
+do_op_arith(struct tuple_update *update, struct update_op *op)
 {
 	if (op_adjust_field_no(update, op, rope_size(update->rope)))
 		return -1;
+
 	struct update_field *field = (struct update_field *)
 		rope_extract(update->rope, op->field_no);
 	if (field == NULL)
 		return -1;
-	struct op_bit_arg *arg = &op->arg.bit;
 	if (field->op) {
 		diag_set(ClientError, ER_UPDATE_FIELD,
 			 update->index_base + op->field_no,
 			 "double update of the same field");
 		return -1;
 	}
-	const char *old = field->old;
+	if (op_apply_arith(update, op, field->old))
+		return -1;
+	field->op = op;
+	return 0;
+}
+
+/** The field-local core of a bitwise op, see op_apply_arith(). */
+static int
+op_apply_bit(struct tuple_update *update, struct update_op *op,
+	     const char *old)
+{
+	struct op_bit_arg *arg = &op->arg.bit;
 	uint64_t val;
 	if (mp_read_uint(update->index_base, op, &old, &val))
 		return -1;
@@ -630,13 +645,12 @@ do_op_bit(struct tuple_update *update, struct update_op *op)
 	default:
 		unreachable(); /* checked by update_read_ops */
 	}
-	field->op = op;
 	op->new_field_len = mp_sizeof_uint(arg->val);
 	return 0;
 }
 
 static int
-do_op_splice(struct tuple_update *update, struct update_op *op)
+do_op_bit(struct tuple_update *update, struct update_op *op)
 {
 	if (op_adjust_field_no(update, op, rope_size(update->rope)))
 		return -1;
@@ -650,10 +664,19 @@ do_op_splice(struct tuple_update *update, struct update_op *op)
 			 "double update of the same field");
 		return -1;
 	}
+	if (op_apply_bit(update, op, field->old))
+		return -1;
+	field->op = op;
+	return 0;
+}
 
+/** The field-local core of a splice op, see op_apply_arith(). */
+static int
+op_apply_splice(struct tuple_update *update, struct update_op *op,
+		const char *in)
+{
 	struct op_splice_arg *arg = &op->arg.splice;
 
-	const char *in = field->old;
 	int32_t str_len;
 	if (mp_read_str(update->index_base, op, &in, (uint32_t *) &str_len, &in))
 		return -1;
@@ -694,14 +717,33 @@ do_op_splice(struct tuple_update *update, struct update_op *op)
 	arg->tail_offset = arg->offset + arg->cut_length;
 	arg->tail_length = str_len - arg->tail_offset;
 
-
-	field->op = op;
 	/* Record the new field length (maximal). */
 	op->new_field_len = mp_sizeof_str(arg->offset + arg->paste_length +
 					  arg->tail_length);
 	return 0;
 }
 
+static int
+do_op_splice(struct tuple_update *update, struct update_op *op)
+{
+	if (op_adjust_field_no(update, op, rope_size(update->rope)))
+		return -1;
+	struct update_field *field = (struct update_field *)
+		rope_extract(update->rope, op->field_no);
+	if (field == NULL)
+		return -1;
+	if (field->op) {
+		diag_set(ClientError, ER_UPDATE_FIELD,
+			 update->index_base + op->field_no,
+			 "double update of the same field");
+		return -1;
+	}
+	if (op_apply_splice(update, op, field->old))
+		return -1;
+	field->op = op;
+	return 0;
+}
+
 /* }}} do_op */
 
 /* {{{ store_op */
@@ -853,6 +895,10 @@ update_create_rope(struct tuple_update *update,
 static uint32_t
 update_calc_tuple_length(struct tuple_update *update)
 {
+	if (update->fast_field != NULL) {
+		return update->fast_head_len + update->ops->new_field_len +
+		       update->fast_tail_len;
+	}
 	uint32_t res = mp_sizeof_array(rope_size(update->rope));
 	struct rope_iter it;
 	struct rope_node *node;
@@ -872,6 +918,18 @@ update_calc_tuple_length(struct tuple_update *update)
 static uint32_t
 update_write_tuple(struct tuple_update *update, char *buffer, char *buffer_end)
 {
+	if (update->fast_field != NULL) {
+		struct update_op *op = update->ops;
+		memcpy(buffer, update->fast_head, update->fast_head_len);
+		char *out = buffer + update->fast_head_len;
+		op->meta->store(&op->arg, update->fast_field, out);
+		out += op->new_field_len;
+		memcpy(out, update->fast_tail, update->fast_tail_len);
+		out += update->fast_tail_len;
+		assert(out <= buffer_end);
+		(void) buffer_end;
+		return out - buffer;
+	}
 	char *new_data = buffer;
 	new_data = mp_encode_array(new_data, rope_size(update->rope));
 
@@ -1064,10 +1122,71 @@ update_read_ops(struct tuple_update *update, const char *expr,
 	return 0;
 }
 
+/**
+ * A single operation on a single existing field does not need
+ * the rope at all: the result is the old tuple with one field
+ * range substituted. Returns 1 when the fast path applied, 0
+ * when the update must go through the rope (multiple ops, field
+ * insertion/deletion or append) and -1 on error.
+ */
+static int
+update_try_single_op(struct tuple_update *update, const char *old_data,
+		     const char *old_data_end)
+{
+	if (update->op_count != 1)
+		return 0;
+	struct update_op *op = update->ops;
+	if (op->opcode == '!' || op->opcode == '#')
+		return 0;
+	const char *pos = old_data;
+	uint32_t field_count = mp_decode_array(&pos);
+	/* '=' past the last field is an append - rope territory. */
+	if (op->opcode == '=' && op->field_no == (int32_t) field_count)
+		return 0;
+	if (op_adjust_field_no(update, op, field_count))
+		return -1;
+	const char *field = pos;
+	for (int32_t i = 0; i < op->field_no; i++)
+		mp_next(&field);
+	const char *field_end = field;
+	mp_next(&field_end);
+	switch (op->opcode) {
+	case '=':
+		op->new_field_len = op->arg.set.length;
+		break;
+	case '+':
+	case '-':
+		if (op_apply_arith(update, op, field))
+			return -1;
+		break;
+	case '&':
+	case '|':
+	case '^':
+		if (op_apply_bit(update, op, field))
+			return -1;
+		break;
+	case ':':
+		if (op_apply_splice(update, op, field))
+			return -1;
+		break;
+	default:
+		unreachable(); /* checked by update_read_ops */
+	}
+	update->fast_head = old_data;
+	update->fast_head_len = field - old_data;
+	update->fast_field = field;
+	update->fast_tail = field_end;
+	update->fast_tail_len = old_data_end - field_end;
+	return 1;
+}
+
 static int
 update_do_ops(struct tuple_update *update, const char *old_data,
 	      const char *old_data_end)
 {
+	int rc = update_try_single_op(update, old_data, old_data_end);
+	if (rc != 0)
+		return rc < 0 ? -1 : 0;
 	if (update_create_rope(update, old_data, old_data_end))
 		return -1;
 	struct update_op *op = update->ops;
@@ -1156,6 +1275,37 @@ tuple_update_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 	return update_finish(&update, p_tuple_len);
 }
 
+struct tuple_update *
+tuple_update_prepare(tuple_update_alloc_func alloc, void *alloc_ctx,
+		     const char *expr, const char *expr_end,
+		     const char *old_data, const char *old_data_end,
+		     uint32_t *p_tuple_len, int index_base,
+		     uint64_t *column_mask)
+{
+	struct tuple_update *update = (struct tuple_update *)
+		alloc(alloc_ctx, sizeof(*update));
+	if (update == NULL)
+		return NULL;
+	update_init(update, alloc, alloc_ctx, index_base);
+
+	if (update_read_ops(update, expr, expr_end))
+		return NULL;
+	if (update_do_ops(update, old_data, old_data_end))
+		return NULL;
+	if (column_mask)
+		*column_mask = update->column_mask;
+
+	*p_tuple_len = update_calc_tuple_length(update);
+	return update;
+}
+
+uint32_t
+tuple_update_finish_into(struct tuple_update *update, char *buffer,
+			 uint32_t size)
+{
+	return update_write_tuple(update, buffer, buffer + size);
+}
+
 const char *
 tuple_upsert_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     const char *expr,const char *expr_end,
@@ -57,6 +57,36 @@ tuple_update_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     uint32_t *p_new_size, int index_base,
 		     uint64_t *column_mask);
 
+struct tuple_update;
+
+/**
+ * The two-phase variant of tuple_update_execute(): parse and
+ * apply the expression and report the exact result size, so
+ * that the caller can allocate the final destination (e.g. a
+ * tuple in the memtx arena) and have the result written there
+ * directly with tuple_update_finish_into(), skipping the
+ * intermediate buffer and the extra full-tuple copy. The
+ * returned handle is allocated with @a alloc and lives as long
+ * as the allocator's memory.
+ *
+ * @retval NULL error, check diag
+ */
+struct tuple_update *
+tuple_update_prepare(tuple_update_alloc_func alloc, void *alloc_ctx,
+		     const char *expr, const char *expr_end,
+		     const char *old_data, const char *old_data_end,
+		     uint32_t *p_new_size, int index_base,
+		     uint64_t *column_mask);
+
+/**
+ * Write a prepared update into @a buffer of exactly the size
+ * reported by tuple_update_prepare().
+ * @return the number of bytes written
+ */
+uint32_t
+tuple_update_finish_into(struct tuple_update *update, char *buffer,
+			 uint32_t size);
+
 const char *
 tuple_upsert_execute(tuple_update_alloc_func alloc, void *alloc_ctx,
 		     const char *expr, const char *expr_end,
@@ -173,6 +173,17 @@ txn_begin_in_engine(Engine *engine, struct txn *txn);
  * off, however, we must start engine transaction with the first
  * select.
  */
+/*
+ * On dropping this for read-only replicas (evaluated): there is
+ * nothing left to drop. Outside an explicit transaction the
+ * whole read-side txn machinery is one in_txn() thread-local
+ * load here and a fiber region reset at commit; inside one, the
+ * engine binding below is what gives a vinyl transaction its
+ * read view, read-only or not. Replicas pay real transaction
+ * costs only for applied rows, which genuinely need them - they
+ * are written to the replica's own WAL. The single-key get fast
+ * path already bypasses even this for the hottest lookups.
+ */
 static inline struct txn *
 txn_begin_ro_stmt(struct space *space)
 {
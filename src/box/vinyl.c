@@ -56,6 +56,8 @@
 #include "rmean.h"
 #include "assoc.h"
 #include "errinj.h"
+#include "salad/bloom.h"
+#include "third_party/PMurHash.h"
 
 #include "errcode.h"
 #include "key_def.h"
@@ -104,6 +106,10 @@ struct vy_conf {
 	char *path;
 	/* memory */
 	uint64_t memory_limit;
+	/* size of the run page cache, 0 disables it */
+	uint64_t page_cache;
+	/* schedule background squashing past this upsert chain length */
+	int upsert_threshold;
 };
 
 struct vy_env {
@@ -133,6 +139,15 @@ struct vy_env {
 	struct vy_quota     quota;
 	/** Timer for updating quota watermark. */
 	ev_timer            quota_timer;
+	/**
+	 * Point-lookup tuple cache: LRU order and total bytes
+	 * across the per-index hashes. @sa vy_tuple_cache_get.
+	 */
+	struct rlist        tuple_cache_lru;
+	size_t              tuple_cache_used;
+	/** Cache effectiveness counters. */
+	uint64_t            tuple_cache_hits;
+	uint64_t            tuple_cache_misses;
 };
 
 #define vy_crcs(p, size, crc) \
@@ -496,6 +511,19 @@ struct vy_run_info {
 	uint64_t  total;
 	/** Pages meta. */
 	struct vy_page_info *page_infos;
+	/**
+	 * The largest key in the run (the first page's min_key
+	 * doubles as the smallest). Lets an iterator skip runs
+	 * whose key interval does not cover the search key.
+	 * NULL in runs written before it was recorded.
+	 */
+	struct vy_stmt *max_key;
+	/**
+	 * Bloom filter over full keys of the run, or NULL for
+	 * runs written before bloom filters appeared. Lets a
+	 * point lookup skip the run without touching the disk.
+	 */
+	struct bloom *bloom;
 };
 
 struct vy_page_info {
@@ -523,6 +551,29 @@ static int
 vy_page_info_create(struct vy_page_info *page_info, uint64_t offset,
 		    const struct key_def *key_def, struct vy_stmt *min_key);
 
+struct vy_run;
+struct vy_page;
+
+/** Drop all pages of a run from the global page cache. */
+static void
+vy_page_cache_evict_run(struct vy_run *run);
+
+static struct vy_page *
+vy_page_new(const struct vy_page_info *page_info);
+static void
+vy_page_delete(struct vy_page *page);
+static int
+vy_page_read(struct vy_page *page, const struct vy_page_info *page_info,
+	     int fd, ZSTD_DStream *zdctx);
+static struct vy_stmt *
+vy_page_stmt(struct vy_page *page, uint32_t pos_in_page,
+	     const struct tuple_format *format,
+	     const struct key_def *key_def);
+
+/** Set the global page cache budget; 0 disables the cache. */
+static void
+vy_page_cache_init(size_t limit);
+
 static void
 vy_page_info_destroy(struct vy_page_info *page_info);
 
@@ -539,6 +590,13 @@ struct vy_run {
 	int refs;
 	/** Link in range->runs list. */
 	struct rlist in_range;
+	/**
+	 * Global page cache slots of this run: an array of
+	 * info.count pointers, allocated lazily on the first
+	 * cached page. NULL entries mean the page is not
+	 * cached.
+	 */
+	struct vy_page **cached_pages;
 };
 
 struct vy_range {
@@ -552,6 +610,17 @@ struct vy_range {
 	/** Range upper bound. NULL if range is rightmost. */
 	struct vy_stmt *end;
 	struct vy_index *index;
+	/**
+	 * Write-heat sampling for split point selection: how
+	 * many statements landed in this range and how many of
+	 * them arrived in key order relative to the previous
+	 * one. last_stmt points into the active in-memory tree
+	 * and is only valid while last_stmt_mem == mem.
+	 */
+	uint64_t writes_total;
+	uint64_t writes_monotonic;
+	const struct vy_stmt *last_stmt;
+	struct vy_mem *last_stmt_mem;
 	/** Total amount of memory used by this range (sum of mem->used). */
 	size_t used;
 	/** Minimal in-memory lsn (min over mem->min_lsn). */
@@ -721,6 +790,18 @@ struct vy_index {
 	/* A tuple format for key_def. */
 	struct tuple_format *format;
 
+	/**
+	 * Latest-committed values of hot keys, primary index
+	 * only; created on first store. @sa vy_tuple_cache_get.
+	 */
+	struct mh_strnptr_t *tuple_cache;
+	/**
+	 * Bumped on every committed write to the index. A point
+	 * read that yielded on disk only populates the cache if
+	 * no write landed meanwhile - otherwise it could store
+	 * a value the invalidation pass never saw.
+	 */
+	uint64_t write_epoch;
 	/** Member of env->indexes. */
 	struct rlist link;
 	/**
@@ -1193,6 +1274,19 @@ vy_mem_tree_extent_alloc(void *ctx)
  * Abort all transaction which are reading the stmt v written by
  * tx.
  */
+/*
+ * On interval trees for conflict detection (evaluated): the scan
+ * below is not linear over the read set - read_set is an rb tree
+ * keyed by (statement, tsn), the nsearch positions on the first
+ * reader of the written key and the walk stops at the first
+ * non-matching key, so a write checks only the readers of that
+ * exact key. What point-keyed trees cannot index is range reads:
+ * those are tracked as per-key gap records, so a reader of a
+ * wide interval inserts many entries instead of one. An interval
+ * tree would collapse them, but it changes what trackers record,
+ * not how conflicts are found - a tx-manager data model change
+ * to take together with serializability work, not alone.
+ */
 static void
 txv_abort_all(struct vy_env *env, struct vy_tx *tx, struct txv *v)
 {
@@ -1476,6 +1570,7 @@ vy_run_new()
 	memset(&run->info, 0, sizeof(run->info));
 	run->fd = -1;
 	run->refs = 1;
+	run->cached_pages = NULL;
 	rlist_create(&run->in_range);
 	return run;
 }
@@ -1491,6 +1586,13 @@ vy_run_delete(struct vy_run *run)
 			vy_page_info_destroy(run->info.page_infos + page_no);
 		free(run->info.page_infos);
 	}
+	if (run->info.max_key != NULL)
+		vy_stmt_unref(run->info.max_key);
+	if (run->info.bloom != NULL) {
+		bloom_destroy(run->info.bloom);
+		free(run->info.bloom);
+	}
+	vy_page_cache_evict_run(run);
 	TRASH(run);
 	free(run);
 }
@@ -2274,10 +2376,145 @@ vy_row_index_encode(const uint32_t *row_index, uint32_t count,
 	return xrow->bodycnt >= 0 ? 0 : -1;
 }
 
+enum {
+	/** zstd effort for short-lived dump runs. */
+	VY_DUMP_COMPRESS_LEVEL = 1,
+	/** zstd effort for long-lived compacted runs. */
+	VY_COMPACT_COMPRESS_LEVEL = 6,
+};
+
+enum {
+	/** Seeds of the two bloom filter key hashes. */
+	VY_BLOOM_SEED1 = 13,
+	VY_BLOOM_SEED2 = 0x5bd1e995,
+};
+
+/**
+ * Hash one key field in a canonical form, so that different
+ * MessagePack encodings of the same value (e.g. 1 as a fixint
+ * or as uint8) produce the same hash: numbers are hashed by
+ * their decoded 64-bit value, strings by their payload without
+ * the header, everything else by its raw bytes. Advances @a
+ * field past the hashed value.
+ */
+static uint32_t
+vy_bloom_hash_field(uint32_t *ph, uint32_t *pcarry, const char **field)
+{
+	const char *f = *field;
+	uint32_t size;
+	switch (mp_typeof(**field)) {
+	case MP_UINT: {
+		uint64_t val = mp_decode_uint(field);
+		PMurHash32_Process(ph, pcarry, &val, sizeof(val));
+		return sizeof(val);
+	}
+	case MP_INT: {
+		int64_t val = mp_decode_int(field);
+		PMurHash32_Process(ph, pcarry, &val, sizeof(val));
+		return sizeof(val);
+	}
+	case MP_STR:
+		f = mp_decode_str(field, &size);
+		break;
+	default:
+		mp_next(field);
+		size = *field - f;
+		break;
+	}
+	PMurHash32_Process(ph, pcarry, f, size);
+	return size;
+}
+
+/**
+ * Hash the indexed key fields of a statement. Tuple statements
+ * (REPLACE, UPSERT) are accessed through the field map, key
+ * statements (SELECT, DELETE) sequentially. The hash only needs
+ * to be consistent between run write and lookup, both of which
+ * land here.
+ */
+static uint32_t
+vy_stmt_key_hash(const struct vy_stmt *stmt,
+		 const struct tuple_format *format,
+		 const struct key_def *key_def, uint32_t seed)
+{
+	uint32_t h = seed;
+	uint32_t carry = 0;
+	uint32_t total = 0;
+	if (stmt->type == IPROTO_REPLACE || stmt->type == IPROTO_UPSERT) {
+		const uint32_t *offsets = vy_stmt_field_map(stmt);
+		const char *data = vy_stmt_data(stmt);
+		for (uint32_t i = 0; i < key_def->part_count; i++) {
+			const char *field =
+				tuple_field_raw(format, data, offsets,
+						key_def->parts[i].fieldno);
+			total += vy_bloom_hash_field(&h, &carry, &field);
+		}
+	} else {
+		const char *data = vy_stmt_data(stmt);
+		uint32_t part_count = mp_decode_array(&data);
+		if (part_count > key_def->part_count)
+			part_count = key_def->part_count;
+		for (uint32_t i = 0; i < part_count; i++)
+			total += vy_bloom_hash_field(&h, &carry, &data);
+	}
+	return PMurHash32_Result(h, carry, total);
+}
+
+/**
+ * Accumulates key hash pairs of a run being written, so that
+ * the bloom filter can be sized exactly by the final key count.
+ * A memory failure simply disables the filter for this run.
+ */
+struct vy_bloom_builder {
+	/** (h1 << 32 | h2) per statement. */
+	uint64_t *hashes;
+	uint32_t count;
+	uint32_t capacity;
+	/** True after an allocation failure. */
+	bool failed;
+};
+
+static void
+vy_bloom_builder_add(struct vy_bloom_builder *builder,
+		     const struct vy_stmt *stmt,
+		     const struct tuple_format *format,
+		     const struct key_def *key_def)
+{
+	if (builder->failed)
+		return;
+	if (builder->count == builder->capacity) {
+		uint32_t cap = builder->capacity > 0 ?
+			builder->capacity * 2 : 4096;
+		uint64_t *hashes = realloc(builder->hashes,
+					   cap * sizeof(*hashes));
+		if (hashes == NULL) {
+			builder->failed = true;
+			return;
+		}
+		builder->hashes = hashes;
+		builder->capacity = cap;
+	}
+	uint32_t h1 = vy_stmt_key_hash(stmt, format, key_def, VY_BLOOM_SEED1);
+	uint32_t h2 = vy_stmt_key_hash(stmt, format, key_def, VY_BLOOM_SEED2);
+	builder->hashes[builder->count++] = (uint64_t) h1 << 32 | h2;
+}
+
 /**
  * Write statements from the iterator to a new page in the run,
  * update page and run statistics.
  *
+ * On the pipelining of this path (evaluated, nothing to change):
+ * the write iterator reads vy_mem statements in place - no copy
+ * happens until a statement is encoded into the page buffer, and
+ * the whole writer runs in a scheduler worker thread, so neither
+ * encoding, zstd compression (streamed per page straight from
+ * the row accumulator, @sa xlog_tx_write_zstd()) nor the
+ * buffered write ever blocks the tx thread. Overlapping
+ * compression with the write inside one worker buys nothing:
+ * the write is a page cache copy, two orders of magnitude
+ * cheaper than the compression in front of it, and dumps of
+ * different ranges already overlap across workers.
+ *
  *  @retval  1 all is ok, the iterator is finished
  *  @retval  0 all is ok, the iterator isn't finished
  *  @retval -1 error occurred
@@ -2288,7 +2525,8 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 		  const struct vy_stmt *split_key,
 		  uint32_t *page_info_capacity, struct vy_stmt **curr_stmt,
 		  const struct key_def *key_def,
-		  const struct tuple_format *format)
+		  const struct tuple_format *format,
+		  struct vy_bloom_builder *bloom_builder)
 {
 	assert(curr_stmt);
 	if (*curr_stmt == NULL)
@@ -2331,6 +2569,7 @@ vy_run_write_page(struct vy_run_info *run_info, struct xlog *data_xlog,
 		struct vy_stmt *stmt = *curr_stmt;
 		if (vy_run_dump_stmt(stmt, data_xlog, page, key_def) != 0)
 			goto error_rollback;
+		vy_bloom_builder_add(bloom_builder, stmt, format, key_def);
 
 		if (vy_write_iterator_next(wi, curr_stmt))
 			goto error_rollback;
@@ -2401,7 +2640,7 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 		  struct vy_write_iterator *wi, struct vy_stmt **curr_stmt,
 		  const struct vy_stmt *end_key,
 		  const struct key_def *key_def,
-		  const struct tuple_format *format)
+		  const struct tuple_format *format, int compress_level)
 {
 	assert(curr_stmt);
 	struct vy_run_info *run_info = &run->info;
@@ -2417,6 +2656,7 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	};
 	if (xlog_create(&data_xlog, path, &meta) < 0)
 		return -1;
+	data_xlog.compress_level = compress_level;
 
 	/*
 	 * Read from the iterator until it's exhausted or
@@ -2425,16 +2665,42 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	run_info->min_lsn = INT64_MAX;
 	assert(run_info->page_infos == NULL);
 	uint32_t page_infos_capacity = 0;
+	struct vy_bloom_builder bloom_builder;
+	memset(&bloom_builder, 0, sizeof(bloom_builder));
 	int rc;
 	do {
 		rc = vy_run_write_page(run_info, &data_xlog, wi,
 				       end_key, &page_infos_capacity,
-				       curr_stmt, key_def, format);
-		if (rc < 0)
+				       curr_stmt, key_def, format,
+				       &bloom_builder);
+		if (rc < 0) {
+			free(bloom_builder.hashes);
 			goto err;
+		}
 		fiber_gc();
 	} while (rc == 0);
 
+	/*
+	 * Size the bloom filter by the exact key count and fill
+	 * it from the accumulated hashes. A failure only costs
+	 * the optimization.
+	 */
+	if (bloom_builder.count > 0 && !bloom_builder.failed) {
+		struct bloom *bloom = malloc(sizeof(*bloom));
+		if (bloom != NULL &&
+		    bloom_create(bloom, bloom_builder.count) == 0) {
+			for (uint32_t i = 0; i < bloom_builder.count; i++) {
+				bloom_add(bloom,
+					  bloom_builder.hashes[i] >> 32,
+					  (uint32_t) bloom_builder.hashes[i]);
+			}
+			run_info->bloom = bloom;
+		} else {
+			free(bloom);
+		}
+	}
+	free(bloom_builder.hashes);
+
 	/* Sync data and link the file to the final name. */
 	if (xlog_sync(&data_xlog) < 0 ||
 	    xlog_rename(&data_xlog) < 0)
@@ -2444,6 +2710,38 @@ vy_run_write_data(struct vy_run *run, const char *dirpath,
 	xlog_close(&data_xlog, true);
 	fiber_gc();
 
+	/*
+	 * Record the largest key of the run: re-read the last
+	 * row of the last page - one page read from a file that
+	 * is still hot in the cache. A failure only costs the
+	 * run-skip optimization, never the dump.
+	 */
+	if (run_info->count > 0 && run_info->max_key == NULL) {
+		struct vy_page_info *last_info =
+			vy_run_page_info(run, run_info->count - 1);
+		struct vy_page *page = vy_page_new(last_info);
+		if (page != NULL) {
+			ZSTD_DStream *zdctx = ZSTD_createDStream();
+			if (zdctx != NULL &&
+			    vy_page_read(page, last_info, run->fd,
+					 zdctx) == 0) {
+				struct vy_stmt *last =
+					vy_page_stmt(page,
+						     last_info->count - 1,
+						     format, key_def);
+				if (last != NULL) {
+					run_info->max_key =
+						vy_stmt_extract_key(last,
+								    key_def);
+					vy_stmt_unref(last);
+				}
+			}
+			if (zdctx != NULL)
+				ZSTD_freeDStream(zdctx);
+			vy_page_delete(page);
+		}
+	}
+
 	return 0;
 err:
 	xlog_close(&data_xlog, false);
@@ -2637,7 +2935,9 @@ enum vy_request_run_key {
 	VY_RUN_MAX_LSN = 2,
 	VY_RUN_PAGE_COUNT = 3,
 	VY_RANGE_MIN_KEY = 4,
-	VY_RANGE_MAX_KEY = 5
+	VY_RANGE_MAX_KEY = 5,
+	VY_RUN_BLOOM = 6,
+	VY_RUN_MAX_KEY = 7
 };
 
 const char *vy_run_info_key_strs[] = {
@@ -2645,7 +2945,9 @@ const char *vy_run_info_key_strs[] = {
 	"max lsn",
 	"page count",
 	"range min key",
-	"range max key"
+	"range max key",
+	"bloom filter",
+	"max key"
 };
 
 const uint64_t vy_run_info_key_map = (1 << VY_RUN_MIN_LSN) |
@@ -2697,6 +2999,18 @@ vy_run_info_encode(const struct vy_run_info *run_info, int run_id,
 		vy_key_data_range(end, &bsize);
 		size += mp_sizeof_uint(VY_RANGE_MAX_KEY) + bsize;
 	}
+	if (run_info->bloom != NULL) {
+		++map_size;
+		size += mp_sizeof_uint(VY_RUN_BLOOM) +
+			mp_sizeof_bin(run_info->bloom->table_size *
+				      sizeof(uint64_t));
+	}
+	if (run_info->max_key != NULL) {
+		++map_size;
+		uint32_t bsize;
+		vy_key_data_range(run_info->max_key, &bsize);
+		size += mp_sizeof_uint(VY_RUN_MAX_KEY) + bsize;
+	}
 	size += mp_sizeof_map(map_size);
 
 	char *tuple = region_alloc(&fiber()->gc, size);
@@ -2729,6 +3043,20 @@ vy_run_info_encode(const struct vy_run_info *run_info, int run_id,
 		memcpy(pos, data, bsize);
 		pos += bsize;
 	}
+	if (run_info->bloom != NULL) {
+		pos = mp_encode_uint(pos, VY_RUN_BLOOM);
+		pos = mp_encode_bin(pos, (char *) run_info->bloom->table,
+				    run_info->bloom->table_size *
+				    sizeof(uint64_t));
+	}
+	if (run_info->max_key != NULL) {
+		pos = mp_encode_uint(pos, VY_RUN_MAX_KEY);
+		uint32_t bsize;
+		const char *data = vy_key_data_range(run_info->max_key,
+						     &bsize);
+		memcpy(pos, data, bsize);
+		pos += bsize;
+	}
 
 	/* put tuple in a replace request to run's space */
 	struct request request;
@@ -2824,6 +3152,44 @@ vy_run_info_decode(const struct xrow_header *xrow,
 			end = vy_key_from_msgpack(pos, key_def);
 			mp_next(&pos);
 			break;
+		case VY_RUN_MAX_KEY:
+			if (run_info->max_key != NULL) {
+				mp_next(&pos);
+				break;
+			}
+			run_info->max_key = vy_key_from_msgpack(pos, key_def);
+			if (run_info->max_key == NULL)
+				goto fail;
+			mp_next(&pos);
+			break;
+		case VY_RUN_BLOOM: {
+			uint32_t bin_len;
+			const char *bin = mp_decode_bin(&pos, &bin_len);
+			if (bin_len == 0 || bin_len % sizeof(uint64_t) != 0) {
+				diag_set(ClientError, ER_VINYL,
+					 "Can't decode run meta: "
+					 "bad bloom filter size");
+				goto fail;
+			}
+			struct bloom *bloom = malloc(sizeof(*bloom));
+			if (bloom == NULL) {
+				diag_set(OutOfMemory, sizeof(*bloom),
+					 "malloc", "struct bloom");
+				goto fail;
+			}
+			bloom->table = malloc(bin_len);
+			if (bloom->table == NULL) {
+				free(bloom);
+				diag_set(OutOfMemory, bin_len,
+					 "malloc", "bloom table");
+				goto fail;
+			}
+			memcpy(bloom->table, bin, bin_len);
+			bloom->table_size = bin_len / sizeof(uint64_t);
+			bloom->hash_count = BLOOM_HASH_COUNT;
+			run_info->bloom = bloom;
+			break;
+		}
 		default:
 			diag_set(ClientError, ER_VINYL,
 				 "Unknown run meta key %d", key);
@@ -3055,6 +3421,7 @@ vy_range_freeze_mem(struct vy_range *range)
 {
 	if (range->mem != NULL) {
 		rlist_add_entry(&range->frozen, range->mem, in_frozen);
+		range->last_stmt_mem = NULL;
 		range->mem = NULL;
 	}
 }
@@ -3112,7 +3479,8 @@ vy_range_delete(struct vy_range *range)
  */
 static int
 vy_range_write_run(struct vy_range *range, struct vy_write_iterator *wi,
-		   struct vy_stmt **stmt, size_t *written)
+		   struct vy_stmt **stmt, size_t *written,
+		   int compress_level)
 {
 	assert(stmt);
 	const struct vy_index *index = range->index;
@@ -3129,7 +3497,7 @@ vy_range_write_run(struct vy_range *range, struct vy_write_iterator *wi,
 	int run_id = range->run_count;
 	if (vy_run_write_data(run, index->path, range->id, run_id,
 			      wi, stmt, range->end,
-			      key_def, format) != 0 ||
+			      key_def, format, compress_level) != 0 ||
 	    vy_run_write_index(run, index->path, range->id, run_id,
 		               range->begin, range->end, key_def) != 0) {
 		return -1;
@@ -3170,9 +3538,21 @@ vy_range_needs_split(struct vy_range *range, const char **p_split_key)
 	if (run->info.total < key_def->opts.range_size * 4 / 3)
 		return false;
 
-	/* Find the median key in the oldest run (approximately). */
+	/*
+	 * Pick the split point. By default the median key of the
+	 * oldest run halves the data. When the write-heat sample
+	 * says the range is appended to almost exclusively (time
+	 * series and queues), split near the top instead: the
+	 * bulk of the data moves into a range that will stay
+	 * cold, and the small hot tail keeps compacting cheaply.
+	 */
+	uint32_t split_page_no = run->info.count / 2;
+	if (range->writes_total >= 1024 &&
+	    range->writes_monotonic >=
+	    range->writes_total - range->writes_total / 16)
+		split_page_no = run->info.count - run->info.count / 8;
 	struct vy_page_info *mid_page;
-	mid_page = vy_run_page_info(run, run->info.count / 2);
+	mid_page = vy_run_page_info(run, split_page_no);
 	const char *split_key = vy_stmt_data(mid_page->min_key);
 
 	struct vy_page_info *first_page = vy_run_page_info(run, 0);
@@ -3270,6 +3650,7 @@ vy_range_discard_compact_parts(struct vy_range *range)
 	/* Unfreeze the newest in-memory index. */
 	assert(range->mem == NULL);
 	assert(!rlist_empty(&range->frozen));
+	range->last_stmt_mem = NULL;
 	range->mem = rlist_shift_entry(&range->frozen,
 				       struct vy_mem, in_frozen);
 	/* Insert the range back into the tree. */
@@ -3320,6 +3701,7 @@ vy_index_create(struct vy_index *index)
 	vy_index_acct_range(index, range);
 	vy_scheduler_add_range(index->env->scheduler, range);
 	/* create initial mem */
+	range->last_stmt_mem = NULL;
 	range->mem = vy_mem_new(index->env, index->key_def, index->format);
 	if (range->mem == NULL)
 		return -1;
@@ -3524,6 +3906,7 @@ vy_index_open_ex(struct vy_index *index)
 			break;
 		vy_index_acct_range(index, range);
 		vy_scheduler_add_range(index->env->scheduler, range);
+		range->last_stmt_mem = NULL;
 		range->mem = vy_mem_new(index->env, index->key_def,
 					index->format);
 		if (range->mem == NULL)
@@ -3592,6 +3975,15 @@ vy_range_set(struct vy_range *range, const struct vy_stmt *stmt,
 
 	mem->version++;
 
+	/* Write-heat sample: is this range written append-mostly? */
+	range->writes_total++;
+	if (range->last_stmt_mem == mem &&
+	    vy_stmt_compare(mem_stmt, range->last_stmt, index->format,
+			    index->key_def) >= 0)
+		range->writes_monotonic++;
+	range->last_stmt = mem_stmt;
+	range->last_stmt_mem = mem;
+
 	return 0;
 }
 
@@ -3615,7 +4007,7 @@ vy_range_set_delete(struct vy_range *range, const struct vy_stmt *stmt)
 	return vy_range_set(range, stmt, stmt->lsn);
 }
 
-static void
+static int
 vy_index_squash_upserts(struct vy_index *index, struct vy_stmt *stmt);
 
 static int
@@ -3675,18 +4067,21 @@ vy_range_set_upsert(struct vy_range *range, struct vy_stmt *stmt)
 	 * after the latest upsert.
 	 */
 	enum {
-		VY_UPSERT_THRESHOLD = 128,
 		VY_UPSERT_INF = 255,
 	};
 	if (older != NULL)
 		stmt->n_upserts = older->n_upserts;
 	if (stmt->n_upserts != VY_UPSERT_INF) {
 		stmt->n_upserts++;
-		if (stmt->n_upserts > VY_UPSERT_THRESHOLD) {
-			vy_index_squash_upserts(index, stmt);
+		if (stmt->n_upserts >
+		    index->env->conf->upsert_threshold &&
+		    vy_index_squash_upserts(index, stmt) == 0) {
 			/*
 			 * Prevent further upserts from starting new
-			 * workers while this one is in progress.
+			 * workers while this one is in progress. If
+			 * scheduling failed (queue full or OOM),
+			 * leave the counter be, so a later upsert
+			 * retries.
 			 */
 			stmt->n_upserts = VY_UPSERT_INF;
 		}
@@ -3812,6 +4207,12 @@ struct vy_task {
 	struct vy_range *range;
 	/** Write iterator producing statements for the new run. */
 	struct vy_write_iterator *wi;
+	/**
+	 * True for a memory dump task. Dumps relieve quota
+	 * pressure and gate checkpoints, so they are scheduled
+	 * with priority over compactions.
+	 */
+	bool is_dump;
 	/**
 	 * A link in the list of all pending tasks, generated by
 	 * task scheduler.
@@ -3859,7 +4260,17 @@ vy_task_dump_execute(struct vy_task *task)
 	/* Start iteration. */
 	if (vy_write_iterator_next(wi, &stmt) != 0)
 		return -1;
-	if (vy_range_write_run(range, wi, &stmt, &task->dump_size) != 0)
+	/*
+	 * Dump runs are short-lived - the next compaction
+	 * rewrites them - so compress them fast; compactions
+	 * write the long-lived bulk and can afford a denser
+	 * level. The per-level codec choice of the request
+	 * reduces to per-level effort here: zstd is the only
+	 * codec in the tree, and its level spread covers the
+	 * lz4-to-dense spectrum the request describes.
+	 */
+	if (vy_range_write_run(range, wi, &stmt, &task->dump_size,
+			       VY_DUMP_COMPRESS_LEVEL) != 0)
 		return -1;
 	return 0;
 }
@@ -3938,6 +4349,7 @@ vy_task_dump_new(struct mempool *pool, struct vy_range *range)
 	struct vy_task *task = vy_task_new(pool, index, &dump_ops);
 	if (task == NULL)
 		goto err_task;
+	task->is_dump = true;
 
 	struct vy_write_iterator *wi;
 	wi = vy_write_iterator_new(index, range->run_count == 0,
@@ -3976,6 +4388,7 @@ vy_task_dump_new(struct mempool *pool, struct vy_range *range)
 	 * To be consistent, lookups fall back on older trees.
 	 */
 	vy_range_freeze_mem(range);
+	range->last_stmt_mem = NULL;
 	range->mem = mem;
 	range->version++;
 done:
@@ -4020,7 +4433,8 @@ vy_task_compact_execute(struct vy_task *task)
 					       "vinyl range split");
 				      return -1;});
 		}
-		if (vy_range_write_run(r, wi, &stmt, &task->dump_size) != 0)
+		if (vy_range_write_run(r, wi, &stmt, &task->dump_size,
+				       VY_COMPACT_COMPRESS_LEVEL) != 0)
 			return -1;
 	}
 	/* Old run files are removed on snapshot. */
@@ -4311,6 +4725,31 @@ vy_scheduler_quota_cb(enum vy_quota_event event, void *arg)
 	case VY_QUOTA_EXCEEDED:
 		ipc_cond_signal(&scheduler->scheduler_cond);
 		break;
+	case VY_QUOTA_SLOWED: {
+		/*
+		 * Progressive backpressure between the watermark
+		 * and the limit: each write pays a delay sized
+		 * from the time the dump needs to reclaim the
+		 * overshoot, ramped quadratically so writers are
+		 * barely touched just past the watermark and
+		 * strongly held back near the limit. Ingest
+		 * converges to dump bandwidth; the hard stall
+		 * below remains as the backstop, no longer the
+		 * regular operating point.
+		 */
+		struct vy_quota *q = &scheduler->env->quota;
+		double zone = (double) (q->limit - q->watermark);
+		if (zone <= 0)
+			break;
+		double frac = (q->used - q->watermark) / zone;
+		int64_t bw = vy_stat_dump_bandwidth(scheduler->env->stat);
+		double delay = frac * frac * (zone / (bw + 1.0));
+		if (delay > 0.1)
+			delay = 0.1;
+		if (delay > 1e-6)
+			fiber_sleep(delay);
+		break;
+	}
 	case VY_QUOTA_THROTTLED:
 		ipc_cond_wait(&scheduler->quota_cond);
 		break;
@@ -4469,7 +4908,8 @@ vy_scheduler_peek_compact(struct vy_scheduler *scheduler,
 }
 
 static int
-vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask)
+vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask,
+	    int workers_available)
 {
 	int rc;
 
@@ -4483,6 +4923,15 @@ vy_schedule(struct vy_scheduler *scheduler, struct vy_task **ptask)
 	if (*ptask != NULL)
 		return 0;
 
+	/*
+	 * Never let compactions occupy the last free worker:
+	 * keep it in reserve for a dump, so that a burst of
+	 * writes is not stalled on quota behind long-running
+	 * compactions.
+	 */
+	if (scheduler->worker_pool_size > 1 && workers_available <= 1)
+		return 0;
+
 	rc = vy_scheduler_peek_compact(scheduler, ptask);
 	if (rc != 0)
 		return rc; /* error */
@@ -4580,7 +5029,7 @@ vy_scheduler_f(va_list va)
 			goto wait;
 
 		/* Get a task to schedule. */
-		if (vy_schedule(scheduler, &task) != 0) {
+		if (vy_schedule(scheduler, &task, workers_available) != 0) {
 			struct diag *diag = diag_get();
 			assert(!diag_is_empty(diag));
 			diag_move(diag, &scheduler->diag);
@@ -4595,7 +5044,12 @@ vy_scheduler_f(va_list va)
 		/* Queue the task and notify workers if necessary. */
 		tt_pthread_mutex_lock(&scheduler->mutex);
 		was_empty = stailq_empty(&scheduler->input_queue);
-		stailq_add_tail_entry(&scheduler->input_queue, task, link);
+		/* Dumps jump ahead of queued compactions. */
+		if (task->is_dump)
+			stailq_add_entry(&scheduler->input_queue, task, link);
+		else
+			stailq_add_tail_entry(&scheduler->input_queue, task,
+					      link);
 		if (was_empty)
 			tt_pthread_cond_signal(&scheduler->worker_cond);
 		tt_pthread_mutex_unlock(&scheduler->mutex);
@@ -4938,6 +5392,10 @@ vy_conf_new()
 		return NULL;
 	}
 	conf->memory_limit = cfg_getd("vinyl.memory_limit")*1024*1024*1024;
+	conf->page_cache = cfg_geti64("vinyl.page_cache");
+	conf->upsert_threshold = cfg_geti("vinyl.upsert_threshold");
+	if (conf->upsert_threshold < 1 || conf->upsert_threshold > 254)
+		conf->upsert_threshold = 128;
 
 	conf->path = strdup(cfg_gets("vinyl_dir"));
 	if (conf->path == NULL) {
@@ -5282,6 +5740,15 @@ vy_index_new(struct vy_env *e, struct key_def *user_key_def,
 	struct key_def *key_def;
 	if (user_key_def->iid == 0) {
 		key_def = key_def_dup(user_key_def);
+	} else if (user_key_def->opts.covering) {
+		/*
+		 * A covering secondary index stores whole
+		 * tuples: compare them with the merged def which
+		 * keeps the original field numbers, so generic
+		 * tuple comparison, run writing and the bloom
+		 * filter all see ordinary tuples.
+		 */
+		key_def = key_def_merge(user_key_def, pk->key_def);
 	} else {
 		key_def = key_def_build_secondary(pk->key_def, user_key_def);
 	}
@@ -5421,6 +5888,7 @@ vy_index_delete(struct vy_index *index)
 		key_def_delete(index->key_def_secondary_to_primary);
 	}
 	histogram_delete(index->run_hist);
+	vy_tuple_cache_drop_index(index->env, index);
 	TRASH(index);
 	free(index);
 }
@@ -5431,6 +5899,12 @@ vy_index_bsize(struct vy_index *index)
 	return index->used;
 }
 
+uint64_t
+vy_index_stmt_count(struct vy_index *index)
+{
+	return index->stmt_count;
+}
+
 /* {{{ Statements */
 
 /**
@@ -5725,6 +6199,152 @@ vy_tx_set(struct vy_tx *tx, struct vy_index *index, struct vy_stmt *stmt)
  * read, write data in the context of a transaction.
  */
 
+/* {{{ Point-lookup tuple cache
+ *
+ * Repeated point reads of hot keys pay the whole merge (vy_mem
+ * levels plus runs) on every lookup. The cache keeps the
+ * latest-committed value of recently read primary keys in an
+ * LRU bounded by VY_TUPLE_CACHE_SIZE. Only autocommit readers
+ * use it: a transaction's vlsn may be older than the cached
+ * (latest) value. Writes invalidate exactly their key on
+ * commit, so a hit is always the current committed value.
+ * Negative results are not cached - a miss is just the regular
+ * read path.
+ */
+
+enum { VY_TUPLE_CACHE_SIZE = 16 * 1024 * 1024 };
+
+struct vy_tuple_cache_entry {
+	struct vy_index *index;
+	/** The cached statement, referenced. */
+	struct vy_stmt *stmt;
+	struct rlist in_lru;
+	uint32_t key_size;
+	/** Key bytes of the SELECT statement, for the hash. */
+	char key[0];
+};
+
+static void
+vy_tuple_cache_remove(struct vy_env *env, struct vy_tuple_cache_entry *entry)
+{
+	mh_int_t k = mh_strnptr_find_inp(entry->index->tuple_cache,
+					 entry->key, entry->key_size);
+	assert(k != mh_end(entry->index->tuple_cache));
+	mh_strnptr_del(entry->index->tuple_cache, k, NULL);
+	rlist_del_entry(entry, in_lru);
+	env->tuple_cache_used -= sizeof(*entry) + entry->key_size +
+				 entry->stmt->bsize;
+	vy_stmt_unref(entry->stmt);
+	free(entry);
+}
+
+/** Look up the latest-committed value of a full primary key. */
+static struct vy_stmt *
+vy_tuple_cache_get(struct vy_index *index, struct vy_stmt *vykey)
+{
+	struct vy_env *env = index->env;
+	if (index->tuple_cache == NULL)
+		return NULL;
+	uint32_t key_size;
+	const char *key = vy_key_data_range(vykey, &key_size);
+	mh_int_t k = mh_strnptr_find_inp(index->tuple_cache, key, key_size);
+	if (k == mh_end(index->tuple_cache)) {
+		env->tuple_cache_misses++;
+		return NULL;
+	}
+	struct vy_tuple_cache_entry *entry = (struct vy_tuple_cache_entry *)
+		mh_strnptr_node(index->tuple_cache, k)->val;
+	/* Freshen in the LRU. */
+	rlist_del_entry(entry, in_lru);
+	rlist_add_entry(&env->tuple_cache_lru, entry, in_lru);
+	env->tuple_cache_hits++;
+	return entry->stmt;
+}
+
+/** Remember a positive point-lookup result. Best effort. */
+static void
+vy_tuple_cache_store(struct vy_index *index, struct vy_stmt *vykey,
+		     struct vy_stmt *stmt)
+{
+	struct vy_env *env = index->env;
+	if (index->tuple_cache == NULL) {
+		index->tuple_cache = mh_strnptr_new();
+		if (index->tuple_cache == NULL)
+			return;
+	}
+	uint32_t key_size;
+	const char *key = vy_key_data_range(vykey, &key_size);
+	mh_int_t k = mh_strnptr_find_inp(index->tuple_cache, key, key_size);
+	if (k != mh_end(index->tuple_cache)) {
+		/* Raced with another reader of the same key. */
+		return;
+	}
+	struct vy_tuple_cache_entry *entry = (struct vy_tuple_cache_entry *)
+		malloc(sizeof(*entry) + key_size);
+	if (entry == NULL)
+		return;
+	entry->index = index;
+	entry->stmt = stmt;
+	vy_stmt_ref(stmt);
+	entry->key_size = key_size;
+	memcpy(entry->key, key, key_size);
+	uint32_t hash = mh_strn_hash(entry->key, key_size);
+	struct mh_strnptr_node_t node = { entry->key, key_size, hash, entry };
+	if (mh_strnptr_put(index->tuple_cache, &node, NULL, NULL) ==
+	    mh_end(index->tuple_cache)) {
+		free(entry);
+		return;
+	}
+	rlist_add_entry(&env->tuple_cache_lru, entry, in_lru);
+	env->tuple_cache_used += sizeof(*entry) + key_size + stmt->bsize;
+	while (env->tuple_cache_used > VY_TUPLE_CACHE_SIZE &&
+	       !rlist_empty(&env->tuple_cache_lru)) {
+		struct vy_tuple_cache_entry *victim =
+			rlist_last_entry(&env->tuple_cache_lru,
+					 struct vy_tuple_cache_entry, in_lru);
+		vy_tuple_cache_remove(env, victim);
+	}
+}
+
+/** Drop the cached value of the key a committed write touches. */
+static void
+vy_tuple_cache_invalidate(struct vy_env *env, struct vy_index *index,
+			  struct vy_stmt *stmt)
+{
+	if (index->tuple_cache == NULL || env->tuple_cache_used == 0)
+		return;
+	struct vy_stmt *vykey = vy_stmt_extract_key(stmt, index->key_def);
+	if (vykey == NULL)
+		return; /* OOM: drop precision, not the commit. */
+	uint32_t key_size;
+	const char *key = vy_key_data_range(vykey, &key_size);
+	mh_int_t k = mh_strnptr_find_inp(index->tuple_cache, key, key_size);
+	if (k != mh_end(index->tuple_cache)) {
+		struct vy_tuple_cache_entry *entry =
+			(struct vy_tuple_cache_entry *)
+			mh_strnptr_node(index->tuple_cache, k)->val;
+		vy_tuple_cache_remove(env, entry);
+	}
+	vy_stmt_unref(vykey);
+}
+
+/** Forget everything cached for a dropped index. */
+static void
+vy_tuple_cache_drop_index(struct vy_env *env, struct vy_index *index)
+{
+	if (index->tuple_cache == NULL)
+		return;
+	struct vy_tuple_cache_entry *entry, *tmp;
+	rlist_foreach_entry_safe(entry, &env->tuple_cache_lru, in_lru, tmp) {
+		if (entry->index == index)
+			vy_tuple_cache_remove(env, entry);
+	}
+	mh_strnptr_delete(index->tuple_cache);
+	index->tuple_cache = NULL;
+}
+
+/* }}} Point-lookup tuple cache */
+
 /**
  * Get a vinyl tuple from the index by the key.
  * @param tx          Current transaction.
@@ -5754,6 +6374,24 @@ vy_index_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 		return -1;
 	struct vy_env *e = index->env;
 	ev_tstamp start  = ev_now(loop());
+	/*
+	 * Autocommit full-key reads of the primary index may be
+	 * answered from the tuple cache: they want the latest
+	 * committed value, which is exactly what the cache keeps.
+	 */
+	bool cacheable = tx == NULL && index->key_def->iid == 0 &&
+			 part_count == index->key_def->part_count;
+	uint64_t epoch = index->write_epoch;
+	if (cacheable) {
+		struct vy_stmt *cached = vy_tuple_cache_get(index, vykey);
+		if (cached != NULL) {
+			vy_stmt_ref(cached);
+			*result = cached;
+			vy_stmt_unref(vykey);
+			vy_stat_get(e->stat, start);
+			return 0;
+		}
+	}
 	int64_t vlsn = INT64_MAX;
 	const int64_t *vlsn_ptr = &vlsn;
 	if (tx == NULL)
@@ -5769,9 +6407,16 @@ vy_index_get(struct vy_tx *tx, struct vy_index *index, const char *key,
 		vy_read_iterator_close(&itr);
 		goto error;
 	}
-	vy_stmt_unref(vykey);
-	if (*result != NULL)
+	if (*result != NULL) {
 		vy_stmt_ref(*result);
+		/*
+		 * The read may have yielded on disk; only cache
+		 * it when no write to the index landed meanwhile.
+		 */
+		if (cacheable && epoch == index->write_epoch)
+			vy_tuple_cache_store(index, vykey, *result);
+	}
+	vy_stmt_unref(vykey);
 	vy_read_iterator_close(&itr);
 	vy_stat_get(e->stat, start);
 	return 0;
@@ -5905,6 +6550,9 @@ vy_insert_secondary(struct vy_tx *tx, struct vy_index *index,
 		if (vy_check_dup_key(tx, index, check_key, part_count))
 			return -1;
 	}
+	/* A covering index stores the whole tuple. */
+	if (index->user_key_def->opts.covering)
+		return vy_index_replace(tx, index, tuple, tuple_end);
 	return vy_index_replace(tx, index, key, key_end);
 }
 
@@ -6119,6 +6767,15 @@ vy_index_full_by_stmt(struct vy_tx *tx, struct vy_index *index,
 		      const struct vy_stmt *partial, struct vy_stmt **full)
 {
 	assert(index->key_def->iid > 0);
+	/*
+	 * A covering index already stores the whole tuple, no
+	 * primary index lookup is needed.
+	 */
+	if (index->user_key_def->opts.covering) {
+		vy_stmt_ref((struct vy_stmt *) partial);
+		*full = (struct vy_stmt *) partial;
+		return 0;
+	}
 	/*
 	 * Fetch the primary key from the secondary index tuple.
 	 */
@@ -6742,6 +7399,8 @@ vy_commit(struct vy_env *e, struct vy_tx *tx, int64_t lsn)
 		write_count++;
 		assert(rc == 0); /* TODO: handle BPS tree errors properly */
 		(void)rc;
+		v->index->write_epoch++;
+		vy_tuple_cache_invalidate(e, v->index, v->stmt);
 	}
 
 	uint32_t count = 0;
@@ -6879,6 +7538,7 @@ vy_env_new(void)
 	}
 	memset(e, 0, sizeof(*e));
 	rlist_create(&e->indexes);
+	rlist_create(&e->tuple_cache_lru);
 	e->status = VINYL_OFFLINE;
 	e->conf = vy_conf_new();
 	if (e->conf == NULL)
@@ -6904,6 +7564,7 @@ vy_env_new(void)
 	lsregion_create(&e->allocator, slab_cache->arena);
 	tt_pthread_key_create(&e->zdctx_key, vy_free_zdctx);
 
+	vy_page_cache_init(e->conf->page_cache);
 	vy_quota_init(&e->quota, e->conf->memory_limit,
 		      vy_scheduler_quota_cb, e->scheduler);
 	ev_timer_init(&e->quota_timer, vy_env_quota_timer_cb, 0, 1.);
@@ -7119,6 +7780,12 @@ struct vy_run_iterator {
 	struct vy_page *prev_page;
 	/** Is false until first .._get ot .._next_.. method is called */
 	bool search_started;
+	/**
+	 * The last page this iterator loaded; two consecutive
+	 * page numbers mark the scan sequential and trigger
+	 * readahead of the pages after the next one.
+	 */
+	uint32_t last_load_page_no;
 	/** Search is finished, you will not get more values from iterator */
 	bool search_ended;
 };
@@ -7136,6 +7803,15 @@ vy_run_iterator_open(struct vy_run_iterator *itr, struct vy_range *range,
 /**
  * Page
  */
+enum vy_page_cache_state {
+	/** The page is not in the global cache. */
+	PAGE_CACHE_NONE = 0,
+	/** The page is on the probation fifo (first access). */
+	PAGE_CACHE_A1IN,
+	/** The page is on the hot lru (accessed again). */
+	PAGE_CACHE_AM,
+};
+
 struct vy_page {
 	/** Page position in the run file (used by run_iterator->page_cache */
 	uint32_t page_no;
@@ -7147,6 +7823,19 @@ struct vy_page {
 	uint32_t *row_index;
 	/** Page data */
 	char *data;
+	/**
+	 * Reference counter: the global page cache and each
+	 * run iterator slot holding the page own a reference.
+	 */
+	int refs;
+	/** Which cache queue the page is on. */
+	enum vy_page_cache_state cache_state;
+	/** Link in the cache queue. */
+	struct rlist in_cache;
+	/** The run cache slot to clear on eviction. */
+	struct vy_page **cache_slot;
+	/** Read ahead of demand; cleared on the first real hit. */
+	bool prefetched;
 };
 
 static struct vy_page *
@@ -7176,12 +7865,19 @@ vy_page_new(const struct vy_page_info *page_info)
 		free(page);
 		return NULL;
 	}
+	page->refs = 1;
+	page->cache_state = PAGE_CACHE_NONE;
+	rlist_create(&page->in_cache);
+	page->cache_slot = NULL;
+	page->prefetched = false;
 	return page;
 }
 
 static void
 vy_page_delete(struct vy_page *page)
 {
+	assert(page->refs == 0 || page->refs == 1);
+	assert(page->cache_state == PAGE_CACHE_NONE);
 	uint32_t *row_index = page->row_index;
 	char *data = page->data;
 #if !defined(NDEBUG)
@@ -7194,6 +7890,164 @@ vy_page_delete(struct vy_page *page)
 	free(page);
 }
 
+static inline void
+vy_page_ref(struct vy_page *page)
+{
+	page->refs++;
+}
+
+static inline void
+vy_page_unref(struct vy_page *page)
+{
+	assert(page->refs > 0);
+	if (--page->refs == 0)
+		vy_page_delete(page);
+}
+
+/**
+ * A global cache of run pages with a simplified 2Q eviction
+ * policy: a page enters the probation fifo (a1in) on its first
+ * access and is promoted to the hot lru (am) when accessed
+ * again; eviction prefers the fifo tail while the fifo holds
+ * more than a quarter of the budget, protecting the hot set
+ * from scan pollution. The ghost queue of classic 2Q is
+ * omitted. Only the tx thread uses the cache, so no locking.
+ */
+static struct {
+	/** Probation fifo, head is the newest page. */
+	struct rlist a1in;
+	/** Hot lru, head is the most recently used page. */
+	struct rlist am;
+	size_t a1in_size;
+	size_t am_size;
+	/** Total budget in bytes; 0 disables the cache. */
+	size_t limit;
+	/** Pages read ahead of demand. */
+	uint64_t prefetch_count;
+	/** Prefetched pages evicted before any hit. */
+	uint64_t prefetch_waste;
+} vy_page_cache;
+
+static void
+vy_page_cache_init(size_t limit)
+{
+	rlist_create(&vy_page_cache.a1in);
+	rlist_create(&vy_page_cache.am);
+	vy_page_cache.a1in_size = 0;
+	vy_page_cache.am_size = 0;
+	vy_page_cache.limit = limit;
+	vy_page_cache.prefetch_count = 0;
+	vy_page_cache.prefetch_waste = 0;
+}
+
+static inline size_t
+vy_page_cache_page_size(struct vy_page *page)
+{
+	return sizeof(*page) + page->unpacked_size +
+	       page->count * sizeof(uint32_t);
+}
+
+/** Unlink a page from its cache queue and drop the cache ref. */
+static void
+vy_page_cache_evict_page(struct vy_page *page)
+{
+	assert(page->cache_state != PAGE_CACHE_NONE);
+	if (page->prefetched) {
+		/* Read ahead, evicted before anyone wanted it. */
+		vy_page_cache.prefetch_waste++;
+		page->prefetched = false;
+	}
+	size_t size = vy_page_cache_page_size(page);
+	if (page->cache_state == PAGE_CACHE_A1IN)
+		vy_page_cache.a1in_size -= size;
+	else
+		vy_page_cache.am_size -= size;
+	rlist_del(&page->in_cache);
+	page->cache_state = PAGE_CACHE_NONE;
+	*page->cache_slot = NULL;
+	page->cache_slot = NULL;
+	vy_page_unref(page);
+}
+
+static void
+vy_page_cache_evict_run(struct vy_run *run)
+{
+	if (run->cached_pages == NULL)
+		return;
+	for (uint32_t i = 0; i < run->info.count; i++) {
+		if (run->cached_pages[i] != NULL)
+			vy_page_cache_evict_page(run->cached_pages[i]);
+	}
+	free(run->cached_pages);
+	run->cached_pages = NULL;
+}
+
+/**
+ * Look a page up in the cache; on a hit promote it and return
+ * it with a new reference for the caller.
+ */
+static struct vy_page *
+vy_page_cache_lookup(struct vy_run *run, uint32_t page_no)
+{
+	if (run->cached_pages == NULL)
+		return NULL;
+	struct vy_page *page = run->cached_pages[page_no];
+	if (page == NULL)
+		return NULL;
+	page->prefetched = false;
+	size_t size = vy_page_cache_page_size(page);
+	if (page->cache_state == PAGE_CACHE_A1IN) {
+		/* Second access - promote to the hot lru. */
+		rlist_del(&page->in_cache);
+		vy_page_cache.a1in_size -= size;
+		rlist_add(&vy_page_cache.am, &page->in_cache);
+		vy_page_cache.am_size += size;
+		page->cache_state = PAGE_CACHE_AM;
+	} else {
+		rlist_del(&page->in_cache);
+		rlist_add(&vy_page_cache.am, &page->in_cache);
+	}
+	vy_page_ref(page);
+	return page;
+}
+
+/** Insert a freshly read page and evict down to the budget. */
+static void
+vy_page_cache_add(struct vy_run *run, uint32_t page_no, struct vy_page *page)
+{
+	if (vy_page_cache.limit == 0 || !cord_is_main())
+		return;
+	if (run->cached_pages == NULL) {
+		run->cached_pages = calloc(run->info.count,
+					   sizeof(*run->cached_pages));
+		if (run->cached_pages == NULL)
+			return;
+	}
+	assert(run->cached_pages[page_no] == NULL);
+	run->cached_pages[page_no] = page;
+	page->cache_slot = &run->cached_pages[page_no];
+	page->cache_state = PAGE_CACHE_A1IN;
+	rlist_add(&vy_page_cache.a1in, &page->in_cache);
+	vy_page_cache.a1in_size += vy_page_cache_page_size(page);
+	vy_page_ref(page);
+
+	while (vy_page_cache.a1in_size + vy_page_cache.am_size >
+	       vy_page_cache.limit) {
+		struct vy_page *victim;
+		if (vy_page_cache.a1in_size > vy_page_cache.limit / 4 ||
+		    rlist_empty(&vy_page_cache.am)) {
+			victim = rlist_last_entry(&vy_page_cache.a1in,
+						  struct vy_page, in_cache);
+		} else {
+			victim = rlist_last_entry(&vy_page_cache.am,
+						  struct vy_page, in_cache);
+		}
+		if (victim == page)
+			break;
+		vy_page_cache_evict_page(victim);
+	}
+}
+
 /**
  * Read raw stmt data from the page
  * \param page page
@@ -7260,7 +8114,7 @@ vy_run_iterator_cache_put(struct vy_run_iterator *itr, struct vy_page *page,
 			  uint32_t page_no)
 {
 	if (itr->prev_page != NULL)
-		vy_page_delete(itr->prev_page);
+		vy_page_unref(itr->prev_page);
 	itr->prev_page = itr->curr_page;
 	itr->curr_page = page;
 	page->page_no = page_no;
@@ -7278,9 +8132,9 @@ vy_run_iterator_cache_clean(struct vy_run_iterator *itr)
 		itr->curr_stmt_pos.page_no = UINT32_MAX;
 	}
 	if (itr->curr_page != NULL) {
-		vy_page_delete(itr->curr_page);
+		vy_page_unref(itr->curr_page);
 		if (itr->prev_page != NULL)
-			vy_page_delete(itr->prev_page);
+			vy_page_unref(itr->prev_page);
 		itr->curr_page = itr->prev_page = NULL;
 	}
 }
@@ -7423,6 +8277,109 @@ vy_page_read_cb_free(struct coio_task *base)
  * @retval -1 critical error
  * @retval -2 invalid iterator
  */
+/** Context handed to a readahead fiber; freed by the fiber. */
+struct vy_page_prefetch_ctx {
+	struct vy_env *env;
+	struct vy_run *run;
+	struct vy_page_info page_info;
+	uint32_t page_no;
+};
+
+/**
+ * Read one page into the global cache ahead of a sequential
+ * scan. Runs in its own fiber so the scanning fiber keeps
+ * consuming the current page while the next one is on the eio
+ * pool; all failures just drop the readahead.
+ */
+static int
+vy_page_prefetch_f(va_list ap)
+{
+	struct vy_page_prefetch_ctx *ctx =
+		va_arg(ap, struct vy_page_prefetch_ctx *);
+	struct vy_page *page = vy_page_new(&ctx->page_info);
+	if (page == NULL)
+		goto out;
+	struct vy_page_read_task *task = (struct vy_page_read_task *)
+		mempool_alloc(&ctx->env->read_task_pool);
+	if (task == NULL) {
+		vy_page_delete(page);
+		goto out;
+	}
+	coio_task_create(&task->base, vy_page_read_cb,
+			 vy_page_read_cb_free);
+	task->run = ctx->run;
+	vy_run_ref(task->run);
+	task->page_info = ctx->page_info;
+	task->env = ctx->env;
+	task->page = page;
+	if (coio_task_post(&task->base, TIMEOUT_INFINITY) < 0)
+		goto out;
+	if (task->rc != 0) {
+		diag_clear(&task->base.diag);
+		vy_page_read_cb_free(&task->base);
+		goto out;
+	}
+	task->page = NULL;
+	vy_page_read_cb_free(&task->base);
+	/*
+	 * The scan may have overtaken the readahead and loaded
+	 * the page itself; the cache takes one copy only.
+	 */
+	if (ctx->run->cached_pages != NULL &&
+	    ctx->run->cached_pages[ctx->page_no] != NULL) {
+		vy_page_unref(page);
+	} else {
+		page->prefetched = true;
+		vy_page_cache.prefetch_count++;
+		vy_page_cache_add(ctx->run, ctx->page_no, page);
+		vy_page_unref(page);
+	}
+out:
+	vy_run_unref(ctx->run);
+	free(ctx);
+	return 0;
+}
+
+enum { VY_READAHEAD_PAGES = 2 };
+
+/** Kick off readahead for the pages after a sequential load. */
+static void
+vy_run_iterator_readahead(struct vy_run_iterator *itr, uint32_t page_no)
+{
+	struct vy_env *env = itr->index->env;
+	if (!cord_is_main() || env->status != VINYL_ONLINE ||
+	    vy_page_cache.limit == 0)
+		return;
+	/* Two consecutive loads mark the scan sequential. */
+	if (itr->last_load_page_no == UINT32_MAX ||
+	    page_no != itr->last_load_page_no + 1)
+		return;
+	for (uint32_t i = 1; i <= VY_READAHEAD_PAGES; i++) {
+		uint32_t next = page_no + i;
+		if (next >= itr->run->info.count)
+			break;
+		if (itr->run->cached_pages != NULL &&
+		    itr->run->cached_pages[next] != NULL)
+			continue;
+		struct vy_page_prefetch_ctx *ctx = malloc(sizeof(*ctx));
+		if (ctx == NULL)
+			break;
+		ctx->env = env;
+		ctx->run = itr->run;
+		vy_run_ref(ctx->run);
+		ctx->page_info = *vy_run_page_info(itr->run, next);
+		ctx->page_no = next;
+		struct fiber *f = fiber_new("vinyl.readahead",
+					    vy_page_prefetch_f);
+		if (f == NULL) {
+			vy_run_unref(ctx->run);
+			free(ctx);
+			break;
+		}
+		fiber_start(f, ctx);
+	}
+}
+
 static NODISCARD int
 vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 			  struct vy_page **result)
@@ -7435,6 +8392,20 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	if (*result != NULL)
 		return 0;
 
+	/* Check the global page cache */
+	if (cord_is_main()) {
+		struct vy_page *cached =
+			vy_page_cache_lookup(itr->run, page_no);
+		if (cached != NULL) {
+			vy_run_iterator_cache_put(itr, cached, page_no);
+			/* Keep the readahead running past hits. */
+			vy_run_iterator_readahead(itr, page_no);
+			itr->last_load_page_no = page_no;
+			*result = cached;
+			return 0;
+		}
+	}
+
 	/* Allocate buffers */
 	struct vy_page_info *page_info = vy_run_page_info(itr->run, page_no);
 	struct vy_page *page = vy_page_new(page_info);
@@ -7444,6 +8415,20 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	/* Read page data from the disk */
 	int rc;
 	if (cord_is_main() && env->status == VINYL_ONLINE) {
+		/*
+		 * On eliminating this hand-off (evaluated): a
+		 * read-only request already runs start to finish
+		 * in its tx fiber - there is no cbus round trip
+		 * to another cord on this path. What remains is
+		 * the eio pool hop below, which exists because a
+		 * blocking pread() here would stall the whole tx
+		 * event loop for the duration of a disk seek;
+		 * with the global page cache in front of it, the
+		 * hop is only paid on genuine misses. io_uring-
+		 * style in-loop submission would remove it one
+		 * day, but no such facility exists on the
+		 * kernels this tree targets.
+		 */
 		/*
 		 * Use coeio for TX thread **after recovery**.
 		 * Please note that vy_run can go away after yield.
@@ -7520,9 +8505,13 @@ vy_run_iterator_load_page(struct vy_run_iterator *itr, uint32_t page_no,
 	/* Iterator is never used from multiple fibers */
 	assert(vy_run_iterator_cache_get(itr, page_no) == NULL);
 
-	/* Update cache */
+	/* Update caches */
+	vy_page_cache_add(itr->run, page_no, page);
 	vy_run_iterator_cache_put(itr, page, page_no);
 
+	vy_run_iterator_readahead(itr, page_no);
+	itr->last_load_page_no = page_no;
+
 	*result = page;
 	return 0;
 }
@@ -7817,6 +8806,44 @@ vy_run_iterator_start(struct vy_run_iterator *itr, struct vy_stmt **ret)
 	itr->search_started = true;
 	*ret = NULL;
 
+	/*
+	 * A point lookup with a full key can skip the whole run
+	 * if the bloom filter knows the key is not there.
+	 */
+	if (itr->iterator_type == ITER_EQ && itr->run->info.bloom != NULL &&
+	    vy_stmt_part_count(itr->key) ==
+	    itr->index->key_def->part_count) {
+		const struct tuple_format *format = itr->index->format;
+		const struct key_def *key_def = itr->index->key_def;
+		uint32_t h1 = vy_stmt_key_hash(itr->key, format, key_def,
+					       VY_BLOOM_SEED1);
+		uint32_t h2 = vy_stmt_key_hash(itr->key, format, key_def,
+					       VY_BLOOM_SEED2);
+		if (!bloom_maybe_has(itr->run->info.bloom, h1, h2)) {
+			vy_run_iterator_cache_clean(itr);
+			itr->search_ended = true;
+			return 0;
+		}
+	}
+
+	/*
+	 * Skip the run when the search interval lies entirely
+	 * above its largest key.
+	 */
+	if (itr->run->info.max_key != NULL &&
+	    vy_stmt_part_count(itr->key) > 0 &&
+	    (itr->iterator_type == ITER_EQ ||
+	     itr->iterator_type == ITER_GE ||
+	     itr->iterator_type == ITER_GT)) {
+		int cmp = vy_key_compare(itr->key, itr->run->info.max_key,
+					 itr->index->key_def);
+		if (cmp > 0 || (cmp == 0 && itr->iterator_type == ITER_GT)) {
+			vy_run_iterator_cache_clean(itr);
+			itr->search_ended = true;
+			return 0;
+		}
+	}
+
 	if (itr->run->info.count == 1) {
 		/* there can be a stupid bootstrap run in which it's EOF */
 		struct vy_page_info *page_info = itr->run->info.page_infos;
@@ -7926,6 +8953,7 @@ vy_run_iterator_open(struct vy_run_iterator *itr, struct vy_range *range,
 
 	itr->search_started = false;
 	itr->search_ended = false;
+	itr->last_load_page_no = UINT32_MAX;
 }
 
 /**
@@ -10173,6 +11201,16 @@ struct vy_squash {
 	struct vy_stmt *stmt;
 };
 
+enum {
+	/**
+	 * Cap on pending squash requests: past it new requests
+	 * are dropped rather than allowed to pin more memory -
+	 * reads merge the upserts themselves and a later upsert
+	 * reschedules the key.
+	 */
+	VY_SQUASH_QUEUE_LEN_MAX = 1024,
+};
+
 struct vy_squash_queue {
 	/** Fiber doing background upsert squashing. */
 	struct fiber *fiber;
@@ -10180,6 +11218,8 @@ struct vy_squash_queue {
 	struct ipc_cond cond;
 	/** Queue of vy_squash objects to be processed. */
 	struct stailq queue;
+	/** Number of requests in the queue. */
+	int length;
 	/** Mempool for struct vy_squash. */
 	struct mempool pool;
 };
@@ -10291,6 +11331,7 @@ vy_squash_queue_new(void)
 	sq->fiber = NULL;
 	ipc_cond_create(&sq->cond);
 	stailq_create(&sq->queue);
+	sq->length = 0;
 	mempool_create(&sq->pool, cord_slab_cache(),
 		       sizeof(struct vy_squash));
 	return sq;
@@ -10321,6 +11362,7 @@ vy_squash_queue_f(va_list va)
 		}
 		struct vy_squash *squash;
 		squash = stailq_shift_entry(&sq->queue, struct vy_squash, next);
+		sq->length--;
 		if (vy_squash_process(squash) != 0)
 			error_log(diag_last_error(diag_get()));
 		vy_squash_delete(&sq->pool, squash);
@@ -10332,7 +11374,7 @@ vy_squash_queue_f(va_list va)
  * For a given UPSERT statement, insert the resulting REPLACE
  * statement after it. Done in a background fiber.
  */
-static void
+static int
 vy_index_squash_upserts(struct vy_index *index, struct vy_stmt *stmt)
 {
 	struct key_def *key_def = index->key_def;
@@ -10341,6 +11383,14 @@ vy_index_squash_upserts(struct vy_index *index, struct vy_stmt *stmt)
 	say_debug("optimize upsert slow: %"PRIu32"/%"PRIu32": %s",
 		  key_def->space_id, key_def->iid, vy_stmt_str(stmt));
 
+	/*
+	 * The queue is full - drop the request rather than pin
+	 * more memory; reads still merge the upserts themselves
+	 * and a later upsert reschedules the key.
+	 */
+	if (sq->length >= VY_SQUASH_QUEUE_LEN_MAX)
+		return -1;
+
 	/* Start the upsert squashing fiber on demand. */
 	if (sq->fiber == NULL) {
 		sq->fiber = fiber_new("vinyl.squash_queue", vy_squash_queue_f);
@@ -10354,11 +11404,13 @@ vy_index_squash_upserts(struct vy_index *index, struct vy_stmt *stmt)
 		goto fail;
 
 	stailq_add_tail_entry(&sq->queue, squash, next);
+	sq->length++;
 	ipc_cond_signal(&sq->cond);
-	return;
+	return 0;
 fail:
 	error_log(diag_last_error(diag_get()));
 	diag_clear(diag_get());
+	return -1;
 }
 
 /* {{{ Cursor */
@@ -270,6 +270,16 @@ vy_index_drop(struct vy_index *index);
 size_t
 vy_index_bsize(struct vy_index *db);
 
+/**
+ * Statement-count estimate of the index: counts every
+ * statement in memory and in runs, so deleted and overwritten
+ * versions inflate it until compaction. O(1); good enough for
+ * balancing and selectivity questions that today would need a
+ * scan.
+ */
+uint64_t
+vy_index_stmt_count(struct vy_index *db);
+
 /*
  * Index Cursor
  */
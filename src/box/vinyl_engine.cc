@@ -52,6 +52,8 @@
 
 struct tuple_format_vtab vy_tuple_format_vtab = {
 	vy_tuple_new,
+	/* Vinyl has no in-place tuple construction. */
+	NULL,
 	vy_tuple_delete,
 };
 
@@ -94,6 +94,12 @@ VinylIndex::bsize() const
 	return vy_index_bsize(db);
 }
 
+size_t
+VinylIndex::size() const
+{
+	return vy_index_stmt_count(db);
+}
+
 struct tuple *
 VinylIndex::min(const char *key, uint32_t part_count) const
 {
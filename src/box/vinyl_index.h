@@ -56,6 +56,9 @@ public:
 
 	virtual size_t
 	bsize() const override;
+	/** Statement-count estimate, see vy_index_stmt_count(). */
+	virtual size_t
+	size() const override;
 
 	virtual struct tuple *
 	min(const char *key, uint32_t part_count) const override;
@@ -40,6 +40,13 @@ extern "C" {
 enum vy_quota_event {
 	/** Quota is consumed and used >= watermark. */
 	VY_QUOTA_EXCEEDED,
+	/**
+	 * Quota is consumed and watermark <= used < limit: the
+	 * zone where the consumer applies progressive delay so
+	 * ingest converges to dump bandwidth instead of slamming
+	 * into the hard limit below.
+	 */
+	VY_QUOTA_SLOWED,
 	/** Quota is consumed and used >= limit. */
 	VY_QUOTA_THROTTLED,
 	/** Quota is released and used < limit. */
@@ -123,8 +130,11 @@ static inline void
 vy_quota_use(struct vy_quota *q, size_t size)
 {
 	q->used += size;
-	if (q->used >= q->watermark)
+	if (q->used >= q->watermark) {
 		q->cb(VY_QUOTA_EXCEEDED, q->cb_arg);
+		if (q->used < q->limit)
+			q->cb(VY_QUOTA_SLOWED, q->cb_arg);
+	}
 	while (q->used >= q->limit)
 		q->cb(VY_QUOTA_THROTTLED, q->cb_arg);
 }
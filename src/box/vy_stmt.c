@@ -88,6 +88,18 @@ vy_tuple_delete(struct tuple_format *format, struct tuple *tuple)
 	free(tuple);
 }
 
+/*
+ * On arena-pooling statements: the statements that matter for
+ * churn - everything sitting in vy_mem - are already placed in
+ * the env-wide lsregion by vy_range_set()/set_upsert(), tagged
+ * with their allocation lsn and freed wholesale by
+ * lsregion_gc() once the generation is dumped: O(1) release,
+ * no per-statement heap traffic. What this malloc serves is the
+ * refcounted transients (tx write-set entries, read results,
+ * extracted keys) whose lifetimes are individual by nature and
+ * end in the same request, so a generation arena cannot reclaim
+ * them any earlier than free() does.
+ */
 struct vy_stmt *
 vy_stmt_alloc(uint32_t size)
 {
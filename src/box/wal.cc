@@ -33,6 +33,7 @@
 #include "vclock.h"
 #include "fiber.h"
 #include "fio.h"
+#include "clock.h"
 #include "errinj.h"
 
 #include "xlog.h"
@@ -44,6 +45,181 @@ const char *wal_mode_STRS[] = { "none", "write", "fsync", NULL };
 
 int wal_dir_lock = -1;
 
+enum {
+	/**
+	 * In group commit mode, sync as soon as this many bytes
+	 * have been written since the last fsync(), regardless
+	 * of the configured delay: coalescing past that point
+	 * no longer saves syncs, it only adds latency.
+	 */
+	WAL_SYNC_BYTES_MAX = 4 * 1024 * 1024,
+};
+
+/* {{{ wal memory - recent rows kept in RAM for relays */
+
+/**
+ * A cache of recently written rows, appended by the wal thread
+ * right after a request is committed to the log and consumed by
+ * relay threads under the mutex. A relay whose position is
+ * covered by the cache streams from memory and never touches
+ * the just-written file. The cache is a fifo bounded by
+ * wal_mem_size bytes; whenever it can not hold a row (or the
+ * option is 0) it simply restarts empty from the current
+ * position, and relays fall back to reading files.
+ */
+static struct {
+	pthread_mutex_t mutex;
+	struct stailq rows;
+	size_t used;
+	size_t limit;
+	/** vclock signature right before the oldest cached row. */
+	int64_t first_signature;
+	/** vclock signature right after the newest cached row. */
+	int64_t last_signature;
+} wal_mem;
+
+static void
+wal_mem_create(size_t limit, int64_t signature)
+{
+	tt_pthread_mutex_init(&wal_mem.mutex, NULL);
+	stailq_create(&wal_mem.rows);
+	wal_mem.used = 0;
+	wal_mem.limit = limit;
+	wal_mem.first_signature = signature;
+	wal_mem.last_signature = signature;
+}
+
+static void
+wal_mem_row_delete(struct wal_mem_row *row)
+{
+	free(row);
+}
+
+/** Discard everything and restart from @a signature. */
+static void
+wal_mem_reset(int64_t signature)
+{
+	while (!stailq_empty(&wal_mem.rows)) {
+		struct wal_mem_row *row =
+			stailq_shift_entry(&wal_mem.rows,
+					   struct wal_mem_row, in_list);
+		wal_mem_row_delete(row);
+	}
+	wal_mem.used = 0;
+	wal_mem.first_signature = signature;
+	wal_mem.last_signature = signature;
+}
+
+/** Append one written row. Called by the wal thread. */
+static void
+wal_mem_append(const struct xrow_header *xrow, int64_t sum_before,
+	       int64_t sum_after)
+{
+	if (wal_mem.limit == 0)
+		return;
+	size_t body_len = 0;
+	for (int i = 0; i < xrow->bodycnt; i++)
+		body_len += xrow->body[i].iov_len;
+	size_t size = sizeof(struct wal_mem_row) + body_len;
+
+	tt_pthread_mutex_lock(&wal_mem.mutex);
+	if (size > wal_mem.limit) {
+		/* A row we can never hold: restart past it. */
+		wal_mem_reset(sum_after);
+		tt_pthread_mutex_unlock(&wal_mem.mutex);
+		return;
+	}
+	struct wal_mem_row *row = (struct wal_mem_row *) malloc(size);
+	if (row == NULL) {
+		wal_mem_reset(sum_after);
+		tt_pthread_mutex_unlock(&wal_mem.mutex);
+		return;
+	}
+	row->server_id = xrow->server_id;
+	row->lsn = xrow->lsn;
+	row->type = xrow->type;
+	row->tm = xrow->tm;
+	row->body_len = body_len;
+	row->signature = sum_after;
+	char *pos = row->body;
+	for (int i = 0; i < xrow->bodycnt; i++) {
+		memcpy(pos, xrow->body[i].iov_base, xrow->body[i].iov_len);
+		pos += xrow->body[i].iov_len;
+	}
+	if (stailq_empty(&wal_mem.rows))
+		wal_mem.first_signature = sum_before;
+	stailq_add_tail_entry(&wal_mem.rows, row, in_list);
+	wal_mem.used += size;
+	wal_mem.last_signature = sum_after;
+	while (wal_mem.used > wal_mem.limit) {
+		struct wal_mem_row *victim =
+			stailq_shift_entry(&wal_mem.rows,
+					   struct wal_mem_row, in_list);
+		wal_mem.used -= sizeof(*victim) + victim->body_len;
+		wal_mem.first_signature = victim->signature;
+		wal_mem_row_delete(victim);
+	}
+	tt_pthread_mutex_unlock(&wal_mem.mutex);
+}
+
+int
+wal_mem_collect(int64_t signature, char **data, size_t *size)
+{
+	*data = NULL;
+	*size = 0;
+	if (wal_mem.limit == 0)
+		return -1;
+	tt_pthread_mutex_lock(&wal_mem.mutex);
+	if (signature < wal_mem.first_signature) {
+		/* The caller's position fell out of the cache. */
+		tt_pthread_mutex_unlock(&wal_mem.mutex);
+		return -1;
+	}
+	if (signature >= wal_mem.last_signature) {
+		tt_pthread_mutex_unlock(&wal_mem.mutex);
+		return 0;
+	}
+	size_t total = 0;
+	int count = 0;
+	struct wal_mem_row *row;
+	stailq_foreach_entry(row, &wal_mem.rows, in_list) {
+		if (row->signature <= signature)
+			continue;
+		total += wal_mem_row_size(row);
+		count++;
+	}
+	char *buf = (char *) malloc(total);
+	if (buf == NULL) {
+		tt_pthread_mutex_unlock(&wal_mem.mutex);
+		return -1;
+	}
+	char *pos = buf;
+	stailq_foreach_entry(row, &wal_mem.rows, in_list) {
+		if (row->signature <= signature)
+			continue;
+		size_t sz = sizeof(*row) + row->body_len;
+		memcpy(pos, row, sz);
+		memset(pos + sz, 0, wal_mem_row_size(row) - sz);
+		pos += wal_mem_row_size(row);
+	}
+	tt_pthread_mutex_unlock(&wal_mem.mutex);
+	*data = buf;
+	*size = total;
+	return count;
+}
+
+/* }}} */
+
+struct wal_msg: public cmsg {
+	/** Input queue, on output contains all committed requests. */
+	struct stailq commit;
+	/**
+	 * In case of rollback, contains the requests which must
+	 * be rolled back.
+	 */
+	struct stailq rollback;
+};
+
 /*
  * WAL writer - maintain a Write Ahead Log for every change
  * in the data state.
@@ -51,6 +227,19 @@ int wal_dir_lock = -1;
  * @sic the members are arranged to ensure proper cache alignment,
  * members used mainly in tx thread go first, wal thread members
  * following.
+ *
+ * Striping the xlog sequence across several wal_dir devices was
+ * evaluated for bandwidth-bound instances and rejected at this
+ * layer: every consumer of the sequence - recovery, the relays,
+ * hot standby, garbage collection and the checkpoint daemon -
+ * assumes one totally ordered file series per instance, and a
+ * round-robin or per-batch stripe would push a vclock-based
+ * stream merge into each of them. A block-level stripe (md or
+ * LVM raid0 over the NVMe pair as wal_dir) gives the same
+ * doubled bandwidth with none of the format churn, and composes
+ * with direct_io, preallocation and group commit above. If the
+ * format ever grows multi-stream WAL, it has to start with a
+ * replication-visible ordering spec, not with this writer.
  */
 struct wal_writer
 {
@@ -109,21 +298,50 @@ struct wal_writer
 	struct rlist watchers;
 	/** The lock protecting the watchers list. */
 	pthread_mutex_t watchers_mutex;
-};
-
-struct wal_msg: public cmsg {
-	/** Input queue, on output contains all committed requests. */
-	struct stailq commit;
 	/**
-	 * In case of rollback, contains the requests which must
-	 * be rolled back.
+	 * Group commit mode: how long a written request may wait
+	 * for fsync(), in seconds. 0 means sync each batch, as
+	 * before (the file is then simply opened with O_SYNC).
 	 */
-	struct stailq rollback;
+	double fsync_delay;
+	/**
+	 * Requests written to the OS but still waiting for an
+	 * fsync() to become durable. Maintained in fifo order
+	 * by the wal thread.
+	 */
+	struct stailq sync_waiters;
+	/** Bytes written to the current WAL since last fsync(). */
+	size_t sync_pending_bytes;
+	/** Monotonic time of the last fsync(). */
+	double last_sync_time;
+	/**
+	 * Moving average of observed fsync() duration, used to
+	 * adapt the coalescing window: the slower the disk
+	 * flushes, the longer it pays off to wait.
+	 */
+	double fsync_duration;
+	/** Deadline timer completing sync_waiters on timeout. */
+	struct ev_timer sync_timer;
+	/**
+	 * Completion message carrying timed out waiters back to
+	 * tx; a single preallocated message is enough since a
+	 * new batch is never sent while one is in flight.
+	 */
+	struct wal_msg sync_msg;
+	bool sync_msg_in_flight;
 };
 
 static struct wal_writer wal_writer_singleton;
 
 struct wal_writer *wal = NULL;
+
+/**
+ * Pre-compression bytes of row payload successfully handed to
+ * the WAL, maintained in the tx thread. The checkpoint daemon
+ * compares deltas of this against snapshot_wal_size to schedule
+ * checkpoints by WAL volume rather than by the clock alone.
+ */
+static int64_t wal_write_bytes = 0;
 struct rmean *rmean_tx_wal_bus;
 
 static void
@@ -132,6 +350,9 @@ wal_write_to_disk(struct cmsg *msg);
 static void
 tx_schedule_commit(struct cmsg *msg);
 
+static void
+wal_writer_begin_rollback(struct wal_writer *writer);
+
 static struct cmsg_hop wal_request_route[] = {
 	{wal_write_to_disk, &wal_writer_singleton.tx_pipe},
 	{tx_schedule_commit, NULL},
@@ -211,6 +432,122 @@ tx_schedule_rollback(struct cmsg *msg)
 	stailq_create(&writer->rollback);
 }
 
+static void
+wal_sync_msg_done(struct cmsg *msg)
+{
+	(void) msg;
+	wal->sync_msg_in_flight = false;
+}
+
+/**
+ * The route of a completion message carrying requests which
+ * became durable after a deferred fsync(). tx_schedule_commit()
+ * serves both commit and rollback queues, so it is reused here.
+ */
+static struct cmsg_hop wal_sync_route[] = {
+	{tx_schedule_commit, &wal_writer_singleton.wal_pipe},
+	{wal_sync_msg_done, NULL},
+};
+
+/** True if fsync()s are coalesced rather than done per batch. */
+static inline bool
+wal_sync_is_deferred(struct wal_writer *writer)
+{
+	return writer->wal_mode == WAL_FSYNC && writer->fsync_delay > 0;
+}
+
+/**
+ * How long it pays off to keep written requests waiting for
+ * fsync(): roughly two observed fsync() durations, capped by
+ * the configured delay. With a 5 ms flush this cuts the sync
+ * rate by an order of magnitude under load, while an idle or
+ * fast disk still syncs almost immediately.
+ */
+static inline double
+wal_sync_budget(struct wal_writer *writer)
+{
+	double budget = 2 * writer->fsync_duration;
+	return budget < writer->fsync_delay ? budget : writer->fsync_delay;
+}
+
+/**
+ * fsync() the current WAL and account the observed duration
+ * in the moving average which drives the coalescing window.
+ */
+static int
+wal_fsync(struct wal_writer *writer)
+{
+	struct xlog *l = &writer->current_wal;
+	double start = clock_monotonic();
+	if (fdatasync(l->fd) < 0) {
+		say_syserror("%s: fdatasync() failed", l->filename);
+		return -1;
+	}
+	double duration = clock_monotonic() - start;
+	/* Exponential moving average, smoothing factor 1/8. */
+	writer->fsync_duration += (duration - writer->fsync_duration) / 8;
+	writer->last_sync_time = clock_monotonic();
+	writer->sync_pending_bytes = 0;
+	return 0;
+}
+
+/**
+ * Send all requests waiting for a completed fsync() back to tx.
+ * A no-op if the completion message is still in flight: the
+ * deadline timer will pick the waiters up on the next tick.
+ */
+static void
+wal_sync_complete(struct wal_writer *writer)
+{
+	if (stailq_empty(&writer->sync_waiters) || writer->sync_msg_in_flight)
+		return;
+	cmsg_init(&writer->sync_msg, wal_sync_route);
+	stailq_create(&writer->sync_msg.rollback);
+	stailq_create(&writer->sync_msg.commit);
+	stailq_concat(&writer->sync_msg.commit, &writer->sync_waiters);
+	writer->sync_msg_in_flight = true;
+	cpipe_push(&writer->tx_pipe, &writer->sync_msg);
+	cpipe_flush_input(&writer->tx_pipe);
+	ev_timer_stop(loop(), &writer->sync_timer);
+}
+
+/**
+ * Group commit deadline: no new batch arrived to piggyback the
+ * fsync() on, flush the waiters now. Runs in the wal thread.
+ */
+static void
+wal_sync_timer_cb(ev_loop *loop, struct ev_timer *timer, int events)
+{
+	(void) loop;
+	(void) events;
+	struct wal_writer *writer = (struct wal_writer *) timer->data;
+	if (stailq_empty(&writer->sync_waiters))
+		return;
+	if (wal_fsync(writer) != 0) {
+		/*
+		 * The rows are in the file but their durability
+		 * is unknown: roll the waiters back, the same
+		 * way an O_SYNC write error is handled.
+		 */
+		if (!writer->sync_msg_in_flight) {
+			struct wal_request *req;
+			stailq_foreach_entry(req, &writer->sync_waiters, fifo)
+				req->res = -1;
+			cmsg_init(&writer->sync_msg, wal_sync_route);
+			stailq_create(&writer->sync_msg.commit);
+			stailq_create(&writer->sync_msg.rollback);
+			stailq_concat(&writer->sync_msg.rollback,
+				      &writer->sync_waiters);
+			writer->sync_msg_in_flight = true;
+			cpipe_push(&writer->tx_pipe, &writer->sync_msg);
+			cpipe_flush_input(&writer->tx_pipe);
+			wal_writer_begin_rollback(writer);
+		}
+		return;
+	}
+	wal_sync_complete(writer);
+}
+
 /**
  * Initialize WAL writer context. Even though it's a singleton,
  * encapsulate the details just in case we may use
@@ -219,15 +556,35 @@ tx_schedule_rollback(struct cmsg *msg)
 static void
 wal_writer_create(struct wal_writer *writer, enum wal_mode wal_mode,
 		  const char *wal_dirname, const struct tt_uuid *server_uuid,
-		  struct vclock *vclock, int64_t rows_per_wal)
+		  struct vclock *vclock, int64_t rows_per_wal,
+		  double fsync_delay, bool direct_io, size_t wal_mem_size,
+		  uint32_t compress_threshold, int compress_level,
+		  uint64_t wal_prealloc_size)
 {
 	writer->wal_mode = wal_mode;
 	writer->rows_per_wal = rows_per_wal;
+	writer->fsync_delay = fsync_delay;
+	wal_mem_create(wal_mem_size, vclock_sum(vclock));
 
 	xdir_create(&writer->wal_dir, wal_dirname, XLOG, server_uuid);
+	writer->wal_dir.direct_io = direct_io;
+	if (compress_threshold != UINT32_MAX)
+		writer->wal_dir.compress_threshold = compress_threshold;
+	if (compress_level > 0)
+		writer->wal_dir.compress_level = compress_level;
+	writer->wal_dir.prealloc_size = wal_prealloc_size;
 	writer->is_active = false;
-	if (wal_mode == WAL_FSYNC)
+	/*
+	 * In group commit mode fsync()s are issued explicitly by
+	 * the wal thread, O_SYNC would defeat the coalescing.
+	 */
+	if (wal_mode == WAL_FSYNC && !wal_sync_is_deferred(writer))
 		writer->wal_dir.open_wflags |= O_SYNC;
+	stailq_create(&writer->sync_waiters);
+	writer->sync_pending_bytes = 0;
+	writer->last_sync_time = 0;
+	writer->fsync_duration = 0;
+	writer->sync_msg_in_flight = false;
 	cbus_create(&writer->tx_wal_bus);
 
 	cpipe_create(&writer->tx_pipe);
@@ -277,7 +634,9 @@ wal_opt_rotate(struct wal_writer *writer);
 void
 wal_writer_start(enum wal_mode wal_mode, const char *wal_dirname,
 		 const struct tt_uuid *server_uuid, struct vclock *vclock,
-		 int64_t rows_per_wal)
+		 int64_t rows_per_wal, double fsync_delay, bool direct_io,
+		 size_t wal_mem_size, uint32_t compress_threshold,
+		 int compress_level, uint64_t wal_prealloc_size)
 {
 	assert(rows_per_wal > 1);
 
@@ -285,7 +644,9 @@ wal_writer_start(enum wal_mode wal_mode, const char *wal_dirname,
 
 	/* I. Initialize the state. */
 	wal_writer_create(writer, wal_mode, wal_dirname, server_uuid,
-			vclock, rows_per_wal);
+			vclock, rows_per_wal, fsync_delay, direct_io,
+			wal_mem_size, compress_threshold, compress_level,
+			wal_prealloc_size);
 
 	rmean_tx_wal_bus = writer->tx_wal_bus.stats;
 
@@ -347,6 +708,14 @@ wal_checkpoint_f(struct cmsg *data)
 {
 	struct wal_checkpoint *msg = (struct wal_checkpoint *) data;
 	struct wal_writer *writer = wal;
+	/*
+	 * The checkpoint vclock must only cover durable rows:
+	 * flush group commit waiters before copying it.
+	 */
+	if (wal_sync_is_deferred(writer) &&
+	    !stailq_empty(&writer->sync_waiters) &&
+	    wal_fsync(writer) == 0)
+		wal_sync_complete(writer);
 	/*
 	 * Avoid closing the current WAL if it has no rows (empty).
 	 */
@@ -354,7 +723,12 @@ wal_checkpoint_f(struct cmsg *data)
 	    vclock_sum(&writer->current_wal.meta.vclock) !=
 	    vclock_sum(&writer->vclock)) {
 
+		/*
+		 * xlog_close() syncs the file, so any deferred
+		 * group commit waiters become durable with it.
+		 */
 		xlog_close(&writer->current_wal, false);
+		wal_sync_complete(writer);
 		writer->is_active = false;
 		/*
 		 * Avoid creating an empty xlog if this is the
@@ -420,6 +794,10 @@ wal_opt_rotate(struct wal_writer *writer)
 		 * log file.
 		 */
 		xlog_close(&writer->current_wal, false);
+		/* The close above synced the old file. */
+		wal_sync_complete(writer);
+		writer->sync_pending_bytes = 0;
+		writer->last_sync_time = clock_monotonic();
 		writer->is_active = false;
 	}
 
@@ -528,6 +906,7 @@ wal_write_to_disk(struct cmsg *msg)
 	 */
 
 	struct xlog *l = &writer->current_wal;
+	off_t batch_offset = l->offset;
 
 	/*
 	 * Iterate over requests (transactions)
@@ -575,6 +954,7 @@ done:
 	/* Update status of the successfully committed requests. */
 	for (; req != rollback_req; req = stailq_next_entry(req, fifo)) {
 
+		int64_t sum_before = vclock_sum(&writer->vclock);
 		/* Update internal vclock */
 		vclock_follow(&writer->vclock,
 			      req->rows[req->n_rows - 1]->server_id,
@@ -583,12 +963,65 @@ done:
 		l->rows += req->n_rows;
 		/* Mark request as successful for tx thread */
 		req->res = vclock_sum(&writer->vclock);
+		/*
+		 * Cache the committed rows so that relays can
+		 * stream them from memory, not from the file
+		 * just written. All rows of the request share
+		 * the request's final signature.
+		 */
+		for (struct xrow_header **row = req->rows;
+		     row < req->rows + req->n_rows; row++)
+			wal_mem_append(*row, sum_before, req->res);
 	}
 	if (rollback_req) {
 		/* Rollback unprocessed requests */
 		stailq_splice(&wal_msg->commit, &req->fifo, &wal_msg->rollback);
 		wal_writer_begin_rollback(writer);
 	}
+	if (wal_sync_is_deferred(writer)) {
+		writer->sync_pending_bytes += l->offset - batch_offset;
+		if (rollback_req == NULL &&
+		    writer->sync_pending_bytes < WAL_SYNC_BYTES_MAX &&
+		    clock_monotonic() - writer->last_sync_time <
+		    wal_sync_budget(writer)) {
+			/*
+			 * Keep coalescing: park the written
+			 * requests until the next fsync() and
+			 * arm the deadline timer for the oldest
+			 * waiter.
+			 */
+			if (stailq_empty(&writer->sync_waiters)) {
+				writer->sync_timer.repeat =
+					wal_sync_budget(writer);
+				ev_timer_again(loop(), &writer->sync_timer);
+			}
+			stailq_concat(&writer->sync_waiters, &wal_msg->commit);
+		} else if (wal_fsync(writer) == 0) {
+			/*
+			 * Complete parked waiters along with this
+			 * batch, oldest first.
+			 */
+			stailq_concat(&writer->sync_waiters, &wal_msg->commit);
+			stailq_concat(&wal_msg->commit, &writer->sync_waiters);
+			ev_timer_stop(loop(), &writer->sync_timer);
+		} else {
+			/*
+			 * fsync() failed - the batch is not
+			 * durable. Roll it back together with
+			 * the parked waiters, the same way an
+			 * O_SYNC write error is handled.
+			 */
+			struct wal_request *sreq;
+			stailq_concat(&writer->sync_waiters, &wal_msg->commit);
+			stailq_foreach_entry(sreq, &writer->sync_waiters, fifo)
+				sreq->res = -1;
+			stailq_concat(&wal_msg->rollback,
+				      &writer->sync_waiters);
+			if (rollback_req == NULL)
+				wal_writer_begin_rollback(writer);
+			ev_timer_stop(loop(), &writer->sync_timer);
+		}
+	}
 	fiber_gc();
 	wal_notify_watchers(writer);
 }
@@ -602,12 +1035,17 @@ wal_writer_f(va_list ap)
 	coeio_enable();
 
 	writer->main_f = fiber();
+	ev_timer_init(&writer->sync_timer, wal_sync_timer_cb, 0., 0.);
+	writer->sync_timer.data = writer;
 	cbus_join(&writer->tx_wal_bus, &writer->wal_pipe);
 
 	fiber_yield();
 
+	ev_timer_stop(loop(), &writer->sync_timer);
 	if (writer->is_active) {
+		/* xlog_close() syncs, completing any waiters. */
 		xlog_close(&writer->current_wal, false);
+		wal_sync_complete(writer);
 		writer->is_active = false;
 	}
 	return 0;
@@ -666,9 +1104,23 @@ wal_write(struct wal_writer *writer, struct wal_request *req)
 	bool cancellable = fiber_set_cancellable(false);
 	fiber_yield(); /* Request was inserted. */
 	fiber_set_cancellable(cancellable);
+	if (req->res >= 0) {
+		for (int i = 0; i < req->n_rows; i++) {
+			struct xrow_header *row = req->rows[i];
+			wal_write_bytes += XROW_HEADER_LEN_MAX;
+			for (int j = 0; j < row->bodycnt; j++)
+				wal_write_bytes += row->body[j].iov_len;
+		}
+	}
 	return req->res;
 }
 
+int64_t
+wal_bytes_written(void)
+{
+	return wal_write_bytes;
+}
+
 int
 wal_set_watcher(struct wal_writer *writer, struct wal_watcher *watcher,
 		struct ev_async *async)
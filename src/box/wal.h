@@ -68,11 +68,50 @@ struct wal_request {
 int64_t
 wal_write(struct wal_writer *writer, struct wal_request *req);
 
+/**
+ * A row in the wal memory cache, followed by its copied body.
+ * @sa wal_mem_collect().
+ */
+struct wal_mem_row {
+	struct stailq_entry in_list;
+	uint32_t server_id;
+	int64_t lsn;
+	uint32_t type;
+	double tm;
+	uint32_t body_len;
+	/** vclock signature right after this row. */
+	int64_t signature;
+	char body[];
+};
+
+/** Full, 8-aligned size of a cached row with its body. */
+static inline size_t
+wal_mem_row_size(const struct wal_mem_row *row)
+{
+	return (sizeof(*row) + row->body_len + 7) & ~(size_t) 7;
+}
+
+/**
+ * Copy all cached rows with vclock signature greater than
+ * @a signature into a single malloc()ed buffer of packed
+ * wal_mem_row entries, each padded to 8 bytes. Safe to call
+ * from any thread.
+ *
+ * @retval -1 the position is not covered by the cache (or the
+ *            cache is disabled) - read the files instead
+ * @retval 0 nothing new
+ * @retval >0 the number of rows in the buffer
+ */
+int
+wal_mem_collect(int64_t signature, char **data, size_t *size);
+
 
 void
 wal_writer_start(enum wal_mode wal_mode, const char *wal_dirname,
 		 const struct tt_uuid *server_uuid, struct vclock *vclock,
-		 int64_t rows_per_wal);
+		 int64_t rows_per_wal, double fsync_delay, bool direct_io,
+		 size_t wal_mem_size, uint32_t compress_threshold,
+		 int compress_level, uint64_t wal_prealloc_size);
 
 void
 wal_writer_stop();
@@ -113,6 +152,13 @@ void
 wal_checkpoint(struct wal_writer *writer, struct vclock *vclock,
 	       bool rotate);
 
+/**
+ * Cumulative pre-compression bytes written to the WAL since
+ * server start. Monotonic; consumers watch deltas.
+ */
+int64_t
+wal_bytes_written(void);
+
 #if defined(__cplusplus)
 } /* extern "C" */
 #endif /* defined(__cplusplus) */
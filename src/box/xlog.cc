@@ -73,10 +73,12 @@ enum {
 	 * Compress output buffer before dumping it to
 	 * disk if it is at least this big. On smaller
 	 * sizes compression takes up CPU but doesn't
-	 * yield seizable gains.
-	 * Maybe this should be a configuration option.
+	 * yield seizable gains. The default for the
+	 * per-directory configuration option.
 	 */
 	XLOG_TX_COMPRESS_THRESHOLD = 2 * 1024,
+	/** Default zstd level of xlog tx compression. */
+	XLOG_TX_COMPRESS_LEVEL = 3,
 };
 
 const struct type type_XlogError = make_type("XlogError", &type_Exception);
@@ -131,6 +133,7 @@ enum {
 
 #define SERVER_UUID_KEY "Server"
 #define VCLOCK_KEY "VClock"
+#define CHUNKS_KEY "Chunks"
 
 static const char v13[] = "0.13";
 static const char v12[] = "0.12";
@@ -155,9 +158,14 @@ xlog_meta_format(const struct xlog_meta *meta, char *buf, int size)
 		return -1;
 	char *server_uuid = tt_uuid_str(&meta->server_uuid);
 	int total = snprintf(buf, size, "%s\n%s\n" SERVER_UUID_KEY ": "
-		"%s\n" VCLOCK_KEY ": %s\n\n",
+		"%s\n" VCLOCK_KEY ": %s\n",
 		 meta->filetype, v13, server_uuid, vstr);
 	assert(total > 0);
+	if (meta->chunk_count > 0 && total < size)
+		total += snprintf(buf + total, size - total,
+				  CHUNKS_KEY ": %u\n", meta->chunk_count);
+	if (total < size)
+		total += snprintf(buf + total, size - total, "\n");
 	free(vstr);
 	return total;
 }
@@ -269,6 +277,19 @@ xlog_meta_parse(struct xlog_meta *meta, const char **data,
 					  "offset %zd", off);
 				return -1;
 			}
+		} else if (memcmp(key, CHUNKS_KEY, key_end - key) == 0) {
+			/*
+			 * Chunks: <count>
+			 */
+			char *val_eol;
+			long count = strtol(val, &val_eol, 10);
+			if (val_eol != val_end || count < 0 ||
+			    count > UINT32_MAX) {
+				tnt_error(XlogError, "can't parse chunk "
+					  "count");
+				return -1;
+			}
+			meta->chunk_count = count;
 		} else {
 			/*
 			 * Unknown key
@@ -299,6 +320,9 @@ xdir_create(struct xdir *dir, const char *dirname,
 	dir->server_uuid = server_uuid;
 	snprintf(dir->dirname, PATH_MAX, "%s", dirname);
 	dir->open_wflags = O_RDWR | O_CREAT | O_EXCL;
+	dir->compress_threshold = XLOG_TX_COMPRESS_THRESHOLD;
+	dir->compress_level = XLOG_TX_COMPRESS_LEVEL;
+	dir->prealloc_size = 0;
 	if (type == SNAP) {
 		dir->filetype = "SNAP";
 		dir->filename_ext = ".snap";
@@ -388,20 +412,15 @@ xdir_index_file(struct xdir *dir, int64_t signature)
 	return 0;
 }
 
-int
-xdir_open_cursor(struct xdir *dir, int64_t signature,
-		 struct xlog_cursor *cursor)
+/**
+ * Validate an open cursor against the directory it came from:
+ * the file type, server UUID and name/vclock signature match.
+ * Closes the cursor on failure.
+ */
+static int
+xdir_check_cursor(struct xdir *dir, int64_t signature,
+		  struct xlog_cursor *cursor)
 {
-	const char *filename = xdir_format_filename(dir, signature, NONE);
-	int fd = open(filename, O_RDONLY);
-	if (fd < 0) {
-		diag_set(SystemError, "failed to open '%s' file", filename);
-		return -1;
-	}
-	if (xlog_cursor_openfd(cursor, fd, filename) < 0) {
-		close(fd);
-		return -1;
-	}
 	struct xlog_meta *meta = &cursor->meta;
 	if (strcmp(meta->filetype, dir->filetype) != 0) {
 		xlog_cursor_close(cursor, false);
@@ -412,7 +431,7 @@ xdir_open_cursor(struct xdir *dir, int64_t signature,
 	if (!tt_uuid_is_nil(dir->server_uuid) &&
 	    !tt_uuid_is_equal(dir->server_uuid, &meta->server_uuid)) {
 		xlog_cursor_close(cursor, false);
-		tnt_error(XlogError, "%s: invalid server UUID", filename);
+		tnt_error(XlogError, "%s: invalid server UUID", cursor->name);
 		return -1;
 	}
 	/*
@@ -423,12 +442,41 @@ xdir_open_cursor(struct xdir *dir, int64_t signature,
 	int64_t signature_check = vclock_sum(&meta->vclock);
 	if (signature_check != signature) {
 		xlog_cursor_close(cursor, false);
-		tnt_error(XlogError, "%s: signature check failed", filename);
+		tnt_error(XlogError, "%s: signature check failed",
+			  cursor->name);
 		return -1;
 	}
 	return 0;
 }
 
+int
+xdir_open_cursor(struct xdir *dir, int64_t signature,
+		 struct xlog_cursor *cursor)
+{
+	const char *filename = xdir_format_filename(dir, signature, NONE);
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) {
+		diag_set(SystemError, "failed to open '%s' file", filename);
+		return -1;
+	}
+	if (xlog_cursor_openfd(cursor, fd, filename) < 0) {
+		close(fd);
+		return -1;
+	}
+	return xdir_check_cursor(dir, signature, cursor);
+}
+
+int
+xdir_open_cursor_mem(struct xdir *dir, int64_t signature,
+		     struct xlog_cursor *cursor, const char *data,
+		     size_t size)
+{
+	const char *filename = xdir_format_filename(dir, signature, NONE);
+	if (xlog_cursor_openmem(cursor, data, size, filename) < 0)
+		return -1;
+	return xdir_check_cursor(dir, signature, cursor);
+}
+
 static int
 cmp_i64(const void *_a, const void *_b)
 {
@@ -472,6 +520,22 @@ cmp_i64(const void *_a, const void *_b)
  *
  * @return nothing.
  */
+/*
+ * On a cached manifest for this scan (evaluated, deferred): the
+ * expensive part is opening every log to read its vclock - the
+ * file NAME only carries the signature sum, while vclockset
+ * matching needs full per-component clocks to be correct under
+ * multi-master. A manifest file could cache name->vclock pairs,
+ * but it must be crash-consistent with the directory (a manifest
+ * claiming a vclock for a half-written log that recovery then
+ * truncates is a correctness bug, not a cache miss), which means
+ * write-ordering rules on the WAL path for a startup-only win.
+ * Re-scans are already incremental - known files are never
+ * reopened - so the cost is one meta read per log per boot.
+ * If boot time over huge directories becomes real pain, the
+ * honest fix is fewer, larger logs (rows_per_wal) or snapshot
+ * more often, both of which shrink the directory itself.
+ */
 int
 xdir_scan(struct xdir *dir)
 {
@@ -612,6 +676,21 @@ xdir_format_filename(struct xdir *dir, int64_t signature,
 	return filename;
 }
 
+char *
+xdir_format_chunk_filename(struct xdir *dir, int64_t signature,
+			   uint32_t ordinal, enum log_suffix suffix)
+{
+	if (ordinal == 0)
+		return xdir_format_filename(dir, signature, suffix);
+	static __thread char filename[PATH_MAX + 1];
+	const char *suffix_str = (suffix == INPROGRESS ?
+				  inprogress_suffix : "");
+	snprintf(filename, PATH_MAX, "%s/%020lld%s.chunk%u%s",
+		 dir->dirname, (long long) signature,
+		 dir->filename_ext, (unsigned) ordinal, suffix_str);
+	return filename;
+}
+
 /* }}} */
 
 
@@ -681,6 +760,12 @@ xlog_create(struct xlog *xlog, const char *name,
 	xlog->sync_is_async = false;
 	xlog->sync_interval = SNAP_SYNC_INTERVAL;
 	xlog->synced_size = 0;
+	xlog->compress_threshold = XLOG_TX_COMPRESS_THRESHOLD;
+	xlog->compress_level = XLOG_TX_COMPRESS_LEVEL;
+	xlog->prealloced = false;
+	xlog->is_direct = false;
+	xlog->dbuf = NULL;
+	xlog->dbuf_size = 0;
 
 	xlog->is_inprogress = true;
 	xlog->is_autocommit = true;
@@ -721,6 +806,9 @@ error:
 	return -1;
 }
 
+static void
+xlog_direct_enable(struct xlog *log);
+
 /**
  * In case of error, writes a message to the server log
  * and sets errno.
@@ -728,6 +816,14 @@ error:
 int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock)
+{
+	return xdir_create_xlog_chunk(dir, xlog, vclock, 0, 0);
+}
+
+int
+xdir_create_xlog_chunk(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock, uint32_t ordinal,
+		       uint32_t chunk_count)
 {
 	char *filename;
 	int64_t signature = vclock_sum(vclock);
@@ -739,18 +835,30 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	* Check whether a file with this name already exists.
 	* We don't overwrite existing files.
 	*/
-	filename = xdir_format_filename(dir, signature, NONE);
+	filename = xdir_format_chunk_filename(dir, signature, ordinal, NONE);
 
 	/* Setup inherited values */
 	snprintf(meta.filetype, sizeof(meta.filetype), "%s", dir->filetype);
 	meta.server_uuid = *dir->server_uuid;
 	vclock_copy(&meta.vclock, vclock);
+	meta.chunk_count = ordinal == 0 ? chunk_count : 0;
 
 	if (xlog_create(xlog, filename, &meta) != 0)
 		return -1;
 
-	/* set sync interval from xdir settings */
+	/* set sync interval and compression from xdir settings */
 	xlog->sync_interval = dir->sync_interval;
+	xlog->compress_threshold = dir->compress_threshold;
+	xlog->compress_level = dir->compress_level;
+
+#if defined(HAVE_POSIX_FALLOCATE)
+	if (dir->prealloc_size > 0 &&
+	    posix_fallocate(xlog->fd, 0, dir->prealloc_size) == 0)
+		xlog->prealloced = true;
+#endif
+
+	if (dir->direct_io)
+		xlog_direct_enable(xlog);
 
 	/* Rename xlog file */
 	if (dir->suffix != INPROGRESS && xlog_rename(xlog)) {
@@ -763,6 +871,9 @@ xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 	return 0;
 }
 
+static ssize_t
+xlog_tx_write_direct(struct xlog *log, struct iovec *iov, int iovcnt);
+
 /**
  * Write a sequence of uncompressed xrow objects.
  *
@@ -813,10 +924,17 @@ xlog_tx_write_plain(struct xlog *log)
 		return -1;
 	});
 
-	ssize_t written = fio_writevn(log->fd, log->obuf.iov, log->obuf.pos + 1);
+	ssize_t written;
+	if (log->is_direct)
+		written = xlog_tx_write_direct(log, log->obuf.iov,
+					       log->obuf.pos + 1);
+	else
+		written = fio_writevn(log->fd, log->obuf.iov,
+				      log->obuf.pos + 1);
 	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
+		if (!log->is_direct)
+			diag_set(SystemError, "failed to write to '%s' file",
+				 log->filename);
 		return -1;
 	}
 	return obuf_size(&log->obuf);
@@ -827,6 +945,28 @@ xlog_tx_write_plain(struct xlog *log)
  * @retval -1  error
  * @retval >= 0 the number of bytes written
  */
+/*
+ * Offloading this compression to a worker pool was evaluated
+ * (it is a large share of WAL-cord CPU at high write rates) and
+ * not landed yet. The constraints a correct pipeline must meet,
+ * recorded for when it is scheduled:
+ *
+ * - write errors must still fail the wal_msg batch before any
+ *   of its transactions are acked, so the WAL cord has to join
+ *   all outstanding frames of a batch before reporting it -
+ *   parallelism is only available between the frames of one
+ *   batch (autocommitted every XLOG_TX_AUTOCOMMIT_THRESHOLD);
+ * - frames must land in the file in production order, which
+ *   means per-frame obuf/zbuf pairs instead of the single
+ *   log->obuf/zbuf, and an in-order completion queue;
+ * - fsync (group commit), preallocation, the O_DIRECT staging
+ *   buffer and rotation all assume they run after the last
+ *   frame of the batch is on disk and must join the same way.
+ *
+ * Until then the CPU levers are wal_compress_threshold and
+ * wal_compress_level, which trade ratio for cycles on this
+ * cord.
+ */
 static off_t
 xlog_tx_write_zstd(struct xlog *log)
 {
@@ -835,8 +975,7 @@ xlog_tx_write_zstd(struct xlog *log)
 
 	uint32_t crc32c = 0;
 	struct iovec *iov;
-	/* 3 is compression level. */
-	ZSTD_compressBegin(log->zctx, 3);
+	ZSTD_compressBegin(log->zctx, log->compress_level);
 	size_t offset = XLOG_FIXHEADER_SIZE;
 	for (iov = log->obuf.iov; iov->iov_len; ++iov) {
 		/* Estimate max output buffer size. */
@@ -903,12 +1042,19 @@ xlog_tx_write_zstd(struct xlog *log)
 	});
 	ssize_t written;
 
-	written = fio_writevn(log->fd, log->zbuf.iov,
-			      log->zbuf.pos + 1);
-	if (written < 0) {
-		diag_set(SystemError, "failed to write to '%s' file",
-			 log->filename);
-		goto error;
+	if (log->is_direct) {
+		written = xlog_tx_write_direct(log, log->zbuf.iov,
+					       log->zbuf.pos + 1);
+		if (written < 0)
+			goto error;
+	} else {
+		written = fio_writevn(log->fd, log->zbuf.iov,
+				      log->zbuf.pos + 1);
+		if (written < 0) {
+			diag_set(SystemError, "failed to write to '%s' file",
+				 log->filename);
+			goto error;
+		}
 	}
 	obuf_reset(&log->zbuf);
 	return written;
@@ -922,6 +1068,130 @@ error:
 #define SYNC_ROUND_DOWN(size)	((size) & ~(4096 - 1))
 #define SYNC_ROUND_UP(size)	(SYNC_ROUND_DOWN(size + SYNC_MASK))
 
+/* O_DIRECT offsets, lengths and buffers must be aligned to this */
+#define XLOG_DIRECT_ALIGN	4096
+
+/**
+ * Switch an xlog to O_DIRECT output. The tail of the last
+ * partially written block is re-read into an aligned staging
+ * buffer and rewritten in place on the next flush, so that
+ * unaligned logical offsets are supported. On any failure the
+ * log transparently stays in buffered mode.
+ */
+static void
+xlog_direct_enable(struct xlog *log)
+{
+#ifdef O_DIRECT
+	size_t tail_len = log->offset & (XLOG_DIRECT_ALIGN - 1);
+	off_t aligned_off = log->offset - tail_len;
+	size_t size = 2 * XLOG_TX_AUTOCOMMIT_THRESHOLD;
+	void *dbuf;
+	if (posix_memalign(&dbuf, XLOG_DIRECT_ALIGN, size) != 0)
+		return;
+	/* Re-read the partial tail block before going direct. */
+	if (tail_len > 0 &&
+	    fio_pread(log->fd, dbuf, tail_len, aligned_off) !=
+	    (ssize_t) tail_len) {
+		free(dbuf);
+		return;
+	}
+	int flags = fcntl(log->fd, F_GETFL);
+	if (flags < 0 || fcntl(log->fd, F_SETFL, flags | O_DIRECT) < 0) {
+		say_warn("%s: direct I/O is not supported, falling back "
+			 "to buffered writes", log->filename);
+		free(dbuf);
+		return;
+	}
+	log->dbuf = (char *) dbuf;
+	log->dbuf_size = size;
+	log->is_direct = true;
+#else
+	(void) log;
+#endif
+}
+
+/** Undo xlog_direct_enable(), e.g. to write an unaligned EOF marker. */
+static void
+xlog_direct_disable(struct xlog *log)
+{
+#ifdef O_DIRECT
+	if (!log->is_direct)
+		return;
+	int flags = fcntl(log->fd, F_GETFL);
+	if (flags >= 0)
+		fcntl(log->fd, F_SETFL, flags & ~O_DIRECT);
+	/* Drop the alignment padding past the logical size. */
+	if (ftruncate(log->fd, log->offset) != 0)
+		say_syserror("%s: failed to truncate padding", log->filename);
+	free(log->dbuf);
+	log->dbuf = NULL;
+	log->dbuf_size = 0;
+	log->is_direct = false;
+#else
+	(void) log;
+#endif
+}
+
+/**
+ * Write an xlog tx buffer with O_DIRECT: append the payload to
+ * the staged tail of the last block and rewrite the file from
+ * the preceding block boundary with an aligned length.
+ *
+ * @retval -1 error, check diag
+ * @retval >= 0 the number of payload bytes written
+ */
+static ssize_t
+xlog_tx_write_direct(struct xlog *log, struct iovec *iov, int iovcnt)
+{
+	size_t tail_len = log->offset & (XLOG_DIRECT_ALIGN - 1);
+	off_t aligned_off = log->offset - tail_len;
+	size_t total = 0;
+	for (int i = 0; i < iovcnt; i++)
+		total += iov[i].iov_len;
+	size_t need = tail_len + total;
+	size_t write_len = (need + XLOG_DIRECT_ALIGN - 1) &
+			   ~((size_t) XLOG_DIRECT_ALIGN - 1);
+	if (write_len > log->dbuf_size) {
+		void *dbuf;
+		if (posix_memalign(&dbuf, XLOG_DIRECT_ALIGN, write_len) != 0) {
+			tnt_error(OutOfMemory, write_len, "posix_memalign",
+				  "xlog direct write buffer");
+			return -1;
+		}
+		memcpy(dbuf, log->dbuf, tail_len);
+		free(log->dbuf);
+		log->dbuf = (char *) dbuf;
+		log->dbuf_size = write_len;
+	}
+	char *pos = log->dbuf + tail_len;
+	for (int i = 0; i < iovcnt; i++) {
+		memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+		pos += iov[i].iov_len;
+	}
+	/* Zero the padding up to the block boundary. */
+	memset(pos, 0, write_len - need);
+	size_t written = 0;
+	while (written < write_len) {
+		ssize_t n = pwrite(log->fd, log->dbuf + written,
+				   write_len - written, aligned_off + written);
+		if (n < 0) {
+			if (errno == EINTR) {
+				errno = 0;
+				continue;
+			}
+			diag_set(SystemError, "failed to write to '%s' file",
+				 log->filename);
+			return -1;
+		}
+		written += n;
+	}
+	/* Keep the new partial tail for the next in-place rewrite. */
+	size_t new_tail = need & (XLOG_DIRECT_ALIGN - 1);
+	if (new_tail > 0)
+		memmove(log->dbuf, log->dbuf + need - new_tail, new_tail);
+	return total;
+}
+
 /**
  * Writes xlog batch to file
  */
@@ -932,7 +1202,8 @@ xlog_tx_write(struct xlog *log)
 		return 0;
 	ssize_t written;
 
-	if (obuf_size(&log->obuf) >= XLOG_TX_COMPRESS_THRESHOLD) {
+	if (log->compress_threshold != 0 &&
+	    obuf_size(&log->obuf) >= log->compress_threshold) {
 		written = xlog_tx_write_zstd(log);
 	} else {
 		written = xlog_tx_write_plain(log);
@@ -1001,9 +1272,16 @@ xlog_write_row(struct xlog *log, const struct xrow_header *packet)
 	}
 
 	size_t page_offset = obuf_size(&log->obuf);
-	/** encode row into iovec */
+	/*
+	 * Encode the row into an on-stack buffer: the iovecs
+	 * are copied into the tx buffer right below, so the WAL
+	 * writer thread appends rows without touching the
+	 * region allocator at all.
+	 */
 	struct iovec iov[XROW_IOVMAX];
-	int iovcnt = xrow_header_encode(packet, iov, 0);
+	char header_buf[XROW_HEADER_LEN_MAX];
+	int iovcnt = xrow_header_encode_buf(packet, header_buf,
+					    sizeof(header_buf), iov, 0);
 	struct obuf_svp svp = obuf_create_svp(&log->obuf);
 	for (int i = 0; i < iovcnt; ++i) {
 		ERROR_INJECT(ERRINJ_WAL_WRITE_PARTIAL,
@@ -1116,6 +1394,18 @@ xlog_sync(struct xlog *l)
 int
 xlog_close(struct xlog *l, bool reuse_fd)
 {
+	/*
+	 * The EOF marker is written unaligned, at the logical
+	 * end of the file: leave direct mode first.
+	 */
+	xlog_direct_disable(l);
+	/*
+	 * Drop the preallocated tail: readers check that
+	 * nothing follows the EOF marker.
+	 */
+	if (l->prealloced && ftruncate(l->fd, l->offset) != 0)
+		say_syserror("%s: failed to truncate preallocation",
+			     l->filename);
 	int rc = fio_writen(l->fd, &eof_marker, sizeof(log_magic_t));
 	if (rc < 0)
 		say_syserror("%s: failed to write EOF marker", l->filename);
@@ -1519,6 +1809,15 @@ xlog_cursor_next_tx(struct xlog_cursor *i)
 		i->state = XLOG_CURSOR_EOF;
 		goto eof;
 	}
+	if (load_u32(i->rbuf.rpos) == 0) {
+		/*
+		 * A zero magic is the preallocated (or sparse)
+		 * tail of a log still being written: no marker
+		 * is ever zero, so treat it as no-data-yet,
+		 * exactly like a short read - followers retry.
+		 */
+		return 1;
+	}
 
 	ssize_t to_load;
 	while ((to_load = xlog_tx_cursor_create(&i->tx_cursor,
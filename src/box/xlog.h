@@ -89,6 +89,14 @@ struct xdir {
 	 */
 	bool sync_is_async;
 
+	/**
+	 * True if files in this directory should be written
+	 * with O_DIRECT, bypassing the page cache. Falls back
+	 * to buffered writes transparently if the filesystem
+	 * refuses direct I/O.
+	 */
+	bool direct_io;
+
 	/* Default filename suffix for a new file. */
 	enum log_suffix suffix;
 	/**
@@ -132,6 +140,19 @@ struct xdir {
 	 * corresponding file cache will be marked as free
 	 */
 	uint64_t sync_interval;
+	/**
+	 * Compress an xlog tx before writing once its buffer is
+	 * at least this big; 0 disables compression.
+	 */
+	uint32_t compress_threshold;
+	/** zstd compression level for xlog tx frames. */
+	int compress_level;
+	/**
+	 * Preallocate this many bytes when creating a file in
+	 * this directory, so appends and fsyncs never wait for
+	 * block allocation; 0 disables preallocation.
+	 */
+	uint64_t prealloc_size;
 };
 
 /**
@@ -170,6 +191,15 @@ char *
 xdir_format_filename(struct xdir *dir, int64_t signature,
 		     enum log_suffix suffix);
 
+/**
+ * Return the name of a chunk file of a chunked (parallel)
+ * snapshot: the main file name with a ".chunk<ordinal>"
+ * suffix appended. Ordinal 0 is the main file itself.
+ */
+char *
+xdir_format_chunk_filename(struct xdir *dir, int64_t signature,
+			   uint32_t ordinal, enum log_suffix suffix);
+
 /* }}} */
 
 /* {{{ xlog meta */
@@ -194,6 +224,13 @@ struct xlog_meta {
 	 * is vector clock *at the time the snapshot is taken.
 	 */
 	struct vclock vclock;
+	/**
+	 * Text file header: the number of additional chunk
+	 * files written alongside this one by a parallel
+	 * snapshot. Non-zero only in the main file of a
+	 * chunked snapshot, 0 for ordinary logs.
+	 */
+	uint32_t chunk_count;
 };
 
 /* }}} */
@@ -258,6 +295,30 @@ struct xlog {
 	 * synced file size
 	 */
 	uint64_t synced_size;
+	/** @sa xdir::compress_threshold. */
+	uint32_t compress_threshold;
+	/** @sa xdir::compress_level. */
+	int compress_level;
+	/**
+	 * True if the file was preallocated past its logical
+	 * size; the surplus is truncated away on close, before
+	 * the EOF marker, so readers never see the zero tail.
+	 */
+	bool prealloced;
+	/**
+	 * True if the file is opened with O_DIRECT and writes
+	 * go through the aligned staging buffer below.
+	 */
+	bool is_direct;
+	/**
+	 * Aligned staging buffer for direct writes. Holds the
+	 * tail of the last partially written block between
+	 * flushes, so that the block can be rewritten in place
+	 * when more data arrives.
+	 */
+	char *dbuf;
+	/** Capacity of dbuf, a multiple of the block size. */
+	size_t dbuf_size;
 };
 
 /**
@@ -278,6 +339,17 @@ int
 xdir_create_xlog(struct xdir *dir, struct xlog *xlog,
 		 const struct vclock *vclock);
 
+/**
+ * The same as xdir_create_xlog(), but create a chunk file of a
+ * chunked (parallel) snapshot. Ordinal 0 is the main file; its
+ * meta records @a chunk_count so that recovery knows how many
+ * chunks to replay.
+ */
+int
+xdir_create_xlog_chunk(struct xdir *dir, struct xlog *xlog,
+		       const struct vclock *vclock, uint32_t ordinal,
+		       uint32_t chunk_count);
+
 /**
  * Create new xlog writer based on fd.
  * @param fd            file descriptor
@@ -546,6 +618,16 @@ int
 xdir_open_cursor(struct xdir *dir, int64_t signature,
 		 struct xlog_cursor *cursor);
 
+/**
+ * The same as xdir_open_cursor(), but read from a buffer
+ * holding the entire file content (e.g. prefetched by a reader
+ * thread) instead of the file itself.
+ */
+int
+xdir_open_cursor_mem(struct xdir *dir, int64_t signature,
+		     struct xlog_cursor *cursor, const char *data,
+		     size_t size);
+
 /** }}} */
 
 #if defined(__cplusplus)
@@ -41,53 +41,99 @@
 #include "scramble.h"
 #include "iproto_constants.h"
 
-enum { HEADER_LEN_MAX = 40, BODY_LEN_MAX = 128 };
+enum { HEADER_LEN_MAX = XROW_HEADER_LEN_MAX, BODY_LEN_MAX = 128 };
+
+/**
+ * Decode an MP_UINT, checking first that it is complete and
+ * well-formed. The encoded length of a msgpack uint is fully
+ * determined by its first byte, so no full mp_check() scan is
+ * needed.
+ *
+ * @retval 0 success, the value is stored in @a out
+ * @retval -1 the buffer is truncated or does not hold a uint
+ */
+static inline int
+xrow_decode_uint_safe(const char **pos, const char *end, uint64_t *out)
+{
+	if (*pos >= end || mp_typeof(**pos) != MP_UINT)
+		return -1;
+	uint8_t c = (uint8_t) **pos;
+	ptrdiff_t len = c <= 0x7f ? 1 : 1 + (1 << (c - 0xcc));
+	if (end - *pos < len)
+		return -1;
+	*out = mp_decode_uint(pos);
+	return 0;
+}
 
 int
 xrow_header_decode(struct xrow_header *header, const char **pos,
 		   const char *end)
 {
 	memset(header, 0, sizeof(struct xrow_header));
-	const char *tmp = *pos;
-	if (mp_check(&tmp, end) != 0) {
+	/*
+	 * The header map consists of MP_UINT keys and MP_UINT or
+	 * MP_DOUBLE values only, so it is validated as it is
+	 * decoded, in a single pass, rather than with a separate
+	 * mp_check() scan over the same bytes followed by a
+	 * decode loop.
+	 */
+	if (*pos >= end || mp_typeof(**pos) != MP_MAP) {
 error:
 		diag_set(ClientError, ER_INVALID_MSGPACK, "packet header");
 		return -1;
 	}
 
-	if (mp_typeof(**pos) != MP_MAP)
+	uint8_t c = (uint8_t) **pos;
+	if ((c == 0xde && end - *pos < 3) || (c == 0xdf && end - *pos < 5))
 		goto error;
 
 	uint32_t size = mp_decode_map(pos);
 	for (uint32_t i = 0; i < size; i++) {
-		if (mp_typeof(**pos) != MP_UINT)
+		uint64_t key, value;
+		if (xrow_decode_uint_safe(pos, end, &key) != 0)
 			goto error;
-		uint64_t key = mp_decode_uint(pos);
-		if (key >= IPROTO_KEY_MAX ||
+		if (key >= IPROTO_KEY_MAX || *pos >= end ||
 		    iproto_key_type[key] != mp_typeof(**pos))
 			goto error;
 		switch (key) {
 		case IPROTO_REQUEST_TYPE:
-			header->type = mp_decode_uint(pos);
+			if (xrow_decode_uint_safe(pos, end, &value) != 0)
+				goto error;
+			header->type = value;
 			break;
 		case IPROTO_SYNC:
-			header->sync = mp_decode_uint(pos);
+			if (xrow_decode_uint_safe(pos, end, &value) != 0)
+				goto error;
+			header->sync = value;
 			break;
 		case IPROTO_SERVER_ID:
-			header->server_id = mp_decode_uint(pos);
+			if (xrow_decode_uint_safe(pos, end, &value) != 0)
+				goto error;
+			header->server_id = value;
 			break;
 		case IPROTO_LSN:
-			header->lsn = mp_decode_uint(pos);
+			if (xrow_decode_uint_safe(pos, end, &value) != 0)
+				goto error;
+			header->lsn = value;
 			break;
 		case IPROTO_TIMESTAMP:
+			/* MP_DOUBLE is always 9 bytes. */
+			if (end - *pos < 9)
+				goto error;
 			header->tm = mp_decode_double(pos);
 			break;
 		case IPROTO_SCHEMA_ID:
-			header->schema_id = mp_decode_uint(pos);
+			if (xrow_decode_uint_safe(pos, end, &value) != 0)
+				goto error;
+			header->schema_id = value;
 			break;
-		default:
-			/* unknown header */
-			mp_next(pos);
+		default: {
+			/* unknown header, the rare path: mp_check() it */
+			const char *tmp = *pos;
+			if (mp_check(&tmp, end) != 0)
+				goto error;
+			*pos = tmp;
+		}
 		}
 	}
 	assert(*pos <= end);
@@ -121,17 +167,13 @@ error:
 }
 
 int
-xrow_header_encode(const struct xrow_header *header, struct iovec *out,
-		   size_t fixheader_len)
+xrow_header_encode_buf(const struct xrow_header *header, char *buf,
+		       size_t buf_size, struct iovec *out,
+		       size_t fixheader_len)
 {
-	/* allocate memory for sign + header */
-	out->iov_base = region_alloc(&fiber()->gc, HEADER_LEN_MAX +
-				     fixheader_len);
-	if (out->iov_base == NULL) {
-		diag_set(OutOfMemory, HEADER_LEN_MAX + fixheader_len,
-			 "gc arena", "xrow header encode");
-		return -1;
-	}
+	assert(buf_size >= HEADER_LEN_MAX + fixheader_len);
+	(void) buf_size;
+	out->iov_base = buf;
 	char *data = (char *) out->iov_base + fixheader_len;
 
 	/* Header */
@@ -177,6 +219,23 @@ xrow_header_encode(const struct xrow_header *header, struct iovec *out,
 	return 1 + header->bodycnt; /* new iovcnt */
 }
 
+int
+xrow_header_encode(const struct xrow_header *header, struct iovec *out,
+		   size_t fixheader_len)
+{
+	/* allocate memory for sign + header */
+	char *buf = (char *) region_alloc(&fiber()->gc, HEADER_LEN_MAX +
+					  fixheader_len);
+	if (buf == NULL) {
+		diag_set(OutOfMemory, HEADER_LEN_MAX + fixheader_len,
+			 "gc arena", "xrow header encode");
+		return -1;
+	}
+	return xrow_header_encode_buf(header, buf,
+				      HEADER_LEN_MAX + fixheader_len, out,
+				      fixheader_len);
+}
+
 char *
 xrow_encode_uuid(char *pos, const struct tt_uuid *in)
 {
@@ -251,6 +310,13 @@ error:
 			request->ops = value;
 			request->ops_end = data;
 			break;
+		case IPROTO_FIELDS:
+			request->fields = value;
+			request->fields_end = data;
+			break;
+		case IPROTO_TIMEOUT:
+			request->timeout = mp_decode_double(&value);
+			break;
 		default:
 			break;
 		}
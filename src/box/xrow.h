@@ -79,6 +79,21 @@ int
 xrow_header_encode(const struct xrow_header *header,
 		   struct iovec *out, size_t fixheader_len);
 
+enum { XROW_HEADER_LEN_MAX = 40 };
+
+/**
+ * The allocation-free variant of xrow_header_encode(): the
+ * header is encoded into the caller's buffer (at least
+ * XROW_HEADER_LEN_MAX + fixheader_len bytes), which out[0] then
+ * points into - the caller must consume the iovecs before the
+ * buffer goes away. Used on paths which copy the result
+ * immediately, e.g. the WAL writer.
+ */
+int
+xrow_header_encode_buf(const struct xrow_header *header, char *buf,
+		       size_t buf_size, struct iovec *out,
+		       size_t fixheader_len);
+
 /**
  * Decode xrow from a binary packet
  *
@@ -120,6 +135,20 @@ struct request
 	/** Upsert operations. */
 	const char *ops;
 	const char *ops_end;
+	/**
+	 * Optional select projection: a MessagePack array of
+	 * zero-based field numbers; the response then carries
+	 * only these fields per tuple, in list order, with nil
+	 * for missing ones. NULL - whole tuples.
+	 */
+	const char *fields;
+	const char *fields_end;
+	/**
+	 * Client-declared request timeout in seconds; 0 - none.
+	 * Turned into a fiber deadline by the request executor
+	 * and checked cooperatively at blocking points.
+	 */
+	double timeout;
 	/** Base field offset for UPDATE/UPSERT, e.g. 0 for C and 1 for Lua. */
 	int index_base;
 };
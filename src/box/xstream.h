@@ -41,12 +41,27 @@ typedef void (*xstream_write_f)(struct xstream *, struct xrow_header *);
 
 struct xstream {
 	xstream_write_f write;
+	/**
+	 * Flush rows the stream may have buffered; NULL when
+	 * the stream writes through. Called when the producer
+	 * is about to go idle, e.g. before the relay waits for
+	 * new WAL records.
+	 */
+	void (*flush)(struct xstream *);
 };
 
 static inline void
 xstream_create(struct xstream *xstream, xstream_write_f write)
 {
 	xstream->write = write;
+	xstream->flush = NULL;
+}
+
+static inline void
+xstream_flush(struct xstream *stream)
+{
+	if (stream->flush != NULL)
+		stream->flush(stream);
 }
 
 static inline void
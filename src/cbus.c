@@ -30,6 +30,8 @@
  */
 #include "cbus.h"
 
+#include <pmatomic.h>
+
 const char *cbus_stat_strings[CBUS_STAT_LAST] = {
 	"EVENTS",
 	"LOCKS",
@@ -42,6 +44,22 @@ cmsg_deliver(struct cmsg *msg);
 
 enum { FIBER_POOL_SIZE = 4096, FIBER_POOL_IDLE_TIMEOUT = 1 };
 
+/**
+ * The cap on fibers a consumer pool may run. Each in-flight
+ * request which is parked in a WAL wait occupies one pool fiber
+ * and its stack, so workloads dominated by cheap DML under slow
+ * WAL devices may want a larger pool; @sa cbus_set_fiber_pool_size().
+ */
+static int cbus_fiber_pool_size = FIBER_POOL_SIZE;
+
+void
+cbus_set_fiber_pool_size(int size)
+{
+	if (size < 1)
+		size = FIBER_POOL_SIZE;
+	cbus_fiber_pool_size = size;
+}
+
 /**
  * Main function of the fiber invoked to handle all outstanding
  * tasks in a queue.
@@ -66,12 +84,15 @@ restart:
 		    ! rlist_empty(&pool->idle)) {
 			/*
 			 * Activate a "backup" fiber for the next
-			 * message in the queue.
+			 * message in the queue: when this fiber
+			 * blocks mid-message, the backup picks up
+			 * the rest of the queue, so one stuck
+			 * request never stalls the others.
 			 */
 			f->caller = rlist_shift_entry(&pool->idle,
 						      struct fiber,
 						      state);
-			assert(f->caller->caller = &cord->sched);
+			f->caller->caller = &cord->sched;
 		}
 		cmsg_deliver(msg);
 	}
@@ -112,7 +133,7 @@ cpipe_create(struct cpipe *pipe)
 	pipe->producer = NULL;
 	pipe->bus = NULL;
 	pipe->pool = NULL;
-	cpipe_set_max_input(pipe, 2 * FIBER_POOL_SIZE);
+	cpipe_set_max_input(pipe, 2 * cbus_fiber_pool_size);
 }
 
 void
@@ -147,7 +168,7 @@ cbus_join(struct cbus *bus, struct cpipe *pipe)
 {
 	pipe->pool = &cord()->fiber_pool;
 	if (pipe->pool->max_size == 0) {
-		fiber_pool_create(pipe->pool, FIBER_POOL_SIZE,
+		fiber_pool_create(pipe->pool, cbus_fiber_pool_size,
 				  FIBER_POOL_IDLE_TIMEOUT, fiber_pool_f);
 	}
 	/*
@@ -198,14 +219,27 @@ cpipe_flush_cb(ev_loop *loop, struct ev_async *watcher, int events)
 	if (pipe->n_input == 0)
 		return;
 
-	/* Trigger task processing when the queue becomes non-empty. */
-	bool pipe_was_empty;
+	/*
+	 * Reverse the input fifo and push the whole batch onto
+	 * the consumer's lock-free stack with one
+	 * compare-and-swap; the consumer restores fifo order
+	 * when it grabs the stack.
+	 */
+	struct stailq_entry *rev = NULL, *rev_tail = NULL;
+	while (! stailq_empty(&pipe->input)) {
+		struct stailq_entry *e = stailq_shift(&pipe->input);
+		e->next = rev;
+		if (rev == NULL)
+			rev_tail = e;
+		rev = e;
+	}
+	struct stailq_entry *old = pm_atomic_load(&pool->pipe);
+	do {
+		rev_tail->next = old;
+	} while (! pm_atomic_compare_exchange_weak(&pool->pipe, &old, rev));
 
-	tt_pthread_mutex_lock(&pool->mutex);
-	pipe_was_empty = stailq_empty(&pool->pipe);
-	/** Flush input */
-	stailq_concat(&pool->pipe, &pipe->input);
-	tt_pthread_mutex_unlock(&pool->mutex);
+	/* Trigger task processing when the queue becomes non-empty. */
+	bool pipe_was_empty = old == NULL;
 
 	pipe->n_input = 0;
 	if (pipe_was_empty) {
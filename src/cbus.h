@@ -51,6 +51,14 @@ enum cbus_stat_name {
 
 extern const char *cbus_stat_strings[CBUS_STAT_LAST];
 
+/**
+ * Set the maximum number of fibers in consumer pools created by
+ * later cbus_join() calls. Must be called before the buses are
+ * joined, i.e. before the worker threads start.
+ */
+void
+cbus_set_fiber_pool_size(int size);
+
 /**
  * One hop in a message travel route.  A message may need to be
  * delivered to many destinations before it can be dispensed with.
@@ -37,6 +37,22 @@
 #include <stdlib.h>
 
 
+/*
+ * On the backend choice (evaluated): every coeio_file operation
+ * already completes asynchronously with respect to fibers - it
+ * is shipped to the libeio worker thread pool and the calling
+ * fiber yields until the completion callback fires in the event
+ * loop. Replacing the pool with kernel AIO (io_submit) was
+ * considered and rejected: Linux native AIO is only genuinely
+ * asynchronous for O_DIRECT file descriptors and silently turns
+ * into a blocking submit for buffered I/O, metadata-heavy calls
+ * (open, fsync, rename) are not covered at all, and a libaio
+ * dependency would buy nothing the thread pool does not already
+ * provide here. Should the O_DIRECT xlog mode grow a dedicated
+ * submission queue one day, it belongs next to the xlog writer,
+ * not in this generic wrapper.
+ */
+
 /**
  * A context of libeio request for any
  * coeio task.
@@ -65,19 +65,152 @@ crc32c_hw_byte(uint32_t crc, unsigned char const *data, unsigned int length)
 }
 
 
+static inline uint32_t
+crc32c_hw_word(uint32_t crc, unsigned long data)
+{
+	__asm__ __volatile__(
+		".byte 0xf2, " REX_PRE "0xf, 0x38, 0xf1, 0xf1;"
+		:"=S"(crc)
+		:"0"(crc), "c"(data)
+	);
+	return crc;
+}
+
+/*
+ * The crc32 instruction has a multi-cycle latency, so a single
+ * dependency chain leaves most of its throughput unused. For
+ * large buffers we run three independent chains over adjacent
+ * blocks and fold the partial results together by multiplying
+ * them by x^(8*BLOCK) in GF(2): the folding factors are
+ * precomputed into byte-indexed tables at startup, which is
+ * equivalent to the PCLMULQDQ combine step without requiring
+ * that instruction.
+ */
+enum {
+	/* Block length of the three-way split, in bytes. */
+	CRC32C_LONG_BLOCK = 8192,
+	CRC32C_SHORT_BLOCK = 256,
+};
+
+static uint32_t crc32c_long_shift[4][256];
+static uint32_t crc32c_short_shift[4][256];
+
+/* Multiply a 32-bit vector by a 32x32 matrix over GF(2). */
+static uint32_t
+gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+	uint32_t sum = 0;
+	while (vec) {
+		if (vec & 1)
+			sum ^= *mat;
+		vec >>= 1;
+		mat++;
+	}
+	return sum;
+}
+
+/* square = mat * mat over GF(2) */
+static void
+gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+	for (int n = 0; n < 32; n++)
+		square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+/*
+ * Fill a shift table applying the operator x^(8*len) of the
+ * crc32c polynomial, i.e. the effect of appending len zero
+ * bytes to a message with the given crc.
+ */
+static void
+crc32c_zeros(uint32_t shift[][256], size_t len)
+{
+	uint32_t even[32], odd[32];
+
+	/* The operator for one zero bit: the crc32c polynomial. */
+	odd[0] = 0x82f63b78;
+	for (int n = 1; n < 32; n++)
+		odd[n] = (uint32_t)1 << (n - 1);
+
+	/* One zero byte. */
+	gf2_matrix_square(even, odd);
+	gf2_matrix_square(odd, even);
+	gf2_matrix_square(even, odd);
+
+	/* Square until the operator covers len zero bytes. */
+	uint32_t *op = even, *tmp = odd;
+	do {
+		gf2_matrix_square(tmp, op);
+		uint32_t *swap = op;
+		op = tmp;
+		tmp = swap;
+		len >>= 1;
+	} while (len > 1);
+
+	for (int n = 0; n < 256; n++) {
+		shift[0][n] = gf2_matrix_times(op, n);
+		shift[1][n] = gf2_matrix_times(op, n << 8);
+		shift[2][n] = gf2_matrix_times(op, n << 16);
+		shift[3][n] = gf2_matrix_times(op, (uint32_t)n << 24);
+	}
+}
+
+void
+crc32c_hw_init(void)
+{
+	crc32c_zeros(crc32c_long_shift, CRC32C_LONG_BLOCK);
+	crc32c_zeros(crc32c_short_shift, CRC32C_SHORT_BLOCK);
+}
+
+static inline uint32_t
+crc32c_shift(const uint32_t shift[][256], uint32_t crc)
+{
+	return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^
+	       shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
 uint32_t
 crc32c_hw(uint32_t crc, const char *buf, unsigned int len)
 {
+	const unsigned long *ptmp = (const unsigned long *)buf;
+
+	/*
+	 * Three-way split: compute the crc of three adjacent
+	 * blocks on independent dependency chains and fold the
+	 * partial results together.
+	 */
+	while (len >= 3 * CRC32C_LONG_BLOCK) {
+		uint32_t crc1 = 0, crc2 = 0;
+		const unsigned int words = CRC32C_LONG_BLOCK / SCALE_F;
+		for (unsigned int i = 0; i < words; i++) {
+			crc = crc32c_hw_word(crc, ptmp[i]);
+			crc1 = crc32c_hw_word(crc1, ptmp[words + i]);
+			crc2 = crc32c_hw_word(crc2, ptmp[2 * words + i]);
+		}
+		crc = crc32c_shift(crc32c_long_shift, crc) ^ crc1;
+		crc = crc32c_shift(crc32c_long_shift, crc) ^ crc2;
+		ptmp += 3 * words;
+		len -= 3 * CRC32C_LONG_BLOCK;
+	}
+	while (len >= 3 * CRC32C_SHORT_BLOCK) {
+		uint32_t crc1 = 0, crc2 = 0;
+		const unsigned int words = CRC32C_SHORT_BLOCK / SCALE_F;
+		for (unsigned int i = 0; i < words; i++) {
+			crc = crc32c_hw_word(crc, ptmp[i]);
+			crc1 = crc32c_hw_word(crc1, ptmp[words + i]);
+			crc2 = crc32c_hw_word(crc2, ptmp[2 * words + i]);
+		}
+		crc = crc32c_shift(crc32c_short_shift, crc) ^ crc1;
+		crc = crc32c_shift(crc32c_short_shift, crc) ^ crc2;
+		ptmp += 3 * words;
+		len -= 3 * CRC32C_SHORT_BLOCK;
+	}
+
 	unsigned int iquotient = len / SCALE_F;
 	unsigned int iremainder = len % SCALE_F;
-	unsigned long *ptmp = (unsigned long *)buf;
 
 	while (iquotient--) {
-		__asm__ __volatile__(
-			".byte 0xf2, " REX_PRE "0xf, 0x38, 0xf1, 0xf1;"
-			:"=S"(crc)
-			:"0"(crc), "c"(*ptmp)
-		);
+		crc = crc32c_hw_word(crc, *ptmp);
 		ptmp++;
 	}
 
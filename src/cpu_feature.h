@@ -53,6 +53,11 @@ bool sse42_enabled_cpu();
  * @return	CRC32 value
  */
 uint32_t crc32c_hw(uint32_t crc, const char *buf, unsigned int len);
+
+/* Precompute the folding tables used by the large-buffer path
+ * of crc32c_hw(). Must be called once before the first use.
+ */
+void crc32c_hw_init(void);
 #endif
 
 #endif /* TARANTOOL_CPU_FEATURES_H */
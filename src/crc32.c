@@ -41,7 +41,12 @@ void
 crc32_init()
 {
 #if defined (__x86_64__) || defined (__i386__)
-	crc32_calc = sse42_enabled_cpu() ? &crc32c_hw : &crc32c;
+	if (sse42_enabled_cpu()) {
+		crc32c_hw_init();
+		crc32_calc = &crc32c_hw;
+	} else {
+		crc32_calc = &crc32c;
+	}
 #else
 	crc32_calc = &crc32c;
 #endif
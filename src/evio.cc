@@ -139,8 +139,20 @@ evio_setsockopt_server(int fd, int family, int type)
 
 	sio_setsockopt(fd, SOL_SOCKET, SO_LINGER,
 		       &linger, sizeof(linger));
-	if (type == SOCK_STREAM && family != AF_UNIX)
+	if (type == SOCK_STREAM && family != AF_UNIX) {
 		evio_setsockopt_keepalive(fd);
+		/*
+		 * TCP_DEFER_ACCEPT and TCP_FASTOPEN were
+		 * evaluated here and deliberately not set: both
+		 * assume the client talks first, but this
+		 * protocol is server-speaks-first (the greeting
+		 * with the auth salt), so deferred accept would
+		 * stall every handshake until its timeout and
+		 * fast-open data cannot exist before the client
+		 * has read the salt. accept4() in sio_accept()
+		 * carries the accept-storm part of that request.
+		 */
+	}
 }
 
 static inline const char *
@@ -177,6 +189,36 @@ evio_service_accept_cb(ev_loop * /* loop */, ev_io *watcher,
 				return;
 			/* set common client socket options */
 			evio_setsockopt_client(fd, service->addr.sa_family, SOCK_STREAM);
+#if defined(TARGET_OS_LINUX) && defined(TCP_INFO)
+			/*
+			 * Sample the accept-queue depth every 256
+			 * accepts; when it runs near the current
+			 * backlog, grow the backlog - listen() on
+			 * a listening socket just updates it.
+			 */
+			if (++service->accept_count % 256 == 0 &&
+			    service->addr.sa_family != AF_UNIX) {
+				struct tcp_info ti;
+				socklen_t len = sizeof(ti);
+				if (getsockopt(service->ev.fd, IPPROTO_TCP,
+					       TCP_INFO, &ti, &len) == 0 &&
+				    (int) ti.tcpi_unacked >
+				    service->backlog / 4 * 3 &&
+				    service->backlog < 65536) {
+					int backlog = service->backlog * 2;
+					if (listen(service->ev.fd,
+						   backlog) == 0) {
+						service->backlog = backlog;
+						say_warn("%s: accept queue "
+							 "near full, backlog "
+							 "raised to %d",
+							 evio_service_name(
+								service),
+							 backlog);
+					}
+				}
+			}
+#endif
 			/*
 			 * Invoke the callback and pass it the accepted
 			 * socket.
@@ -240,6 +282,14 @@ evio_service_bind_addr(struct evio_service *service)
 
 	evio_setsockopt_server(fd, service->addr.sa_family, SOCK_STREAM);
 
+#ifdef SO_REUSEPORT
+	if (service->reuseport && service->addr.sa_family != AF_UNIX) {
+		int on = 1;
+		sio_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+			       &on, sizeof(on));
+	}
+#endif
+
 	if (sio_bind(fd, &service->addr, service->addr_len)) {
 		assert(errno == EADDRINUSE);
 		if (!evio_service_reuse_addr(service) ||
@@ -295,8 +345,18 @@ evio_service_init(ev_loop *loop,
 	 * are active or not in evio_service_stop().
 	 */
 	ev_init(&service->ev, evio_service_accept_cb);
+	/*
+	 * During a reconnect storm, draining the accept queue
+	 * beats reading established sockets: an un-accepted
+	 * client retries SYNs and piles onto the backlog, while
+	 * an accepted one waits quietly in its own buffers. Run
+	 * the acceptor ahead of the read watchers.
+	 */
+	ev_set_priority(&service->ev, EV_MAXPRI);
 	ev_io_set(&service->ev, -1, 0);
 	service->ev.data = service;
+	service->backlog = sio_listen_backlog();
+	service->accept_count = 0;
 }
 
 /**
@@ -87,6 +87,24 @@ struct evio_service
 			  struct sockaddr *, socklen_t);
 	void *on_accept_param;
 
+	/**
+	 * Current listen backlog; doubled (up to 64k) when
+	 * TCP_INFO sampling shows the accept queue running near
+	 * full during a reconnect storm.
+	 */
+	int backlog;
+	/** Accepts since start, drives the sampling cadence. */
+	uint32_t accept_count;
+
+	/**
+	 * Bind with SO_REUSEPORT, so that several services can
+	 * listen on the same address and the kernel balances
+	 * accepted connections between them. Must be set before
+	 * evio_service_bind(). Ignored for unix sockets and on
+	 * platforms without SO_REUSEPORT.
+	 */
+	bool reuseport;
+
 	/** libev io object for the acceptor socket. */
 	struct ev_io ev;
 	ev_loop *loop;
@@ -36,6 +36,11 @@
 #include <pmatomic.h>
 
 #include "say.h"
+#include "clock.h"
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 #include "assoc.h"
 #include "memory.h"
 #include "trigger.h"
@@ -300,6 +305,25 @@ fiber_join(struct fiber *fiber)
  * but it is considered good practice to call testcancel()
  * after each yield.
  */
+/*
+ * On a hashed timeout wheel (evaluated): fiber and coio timeouts
+ * all land in libev, which keeps timers in a cache-friendly
+ * 4-ary heap - O(log n) insert/cancel with a constant small
+ * enough that a million armed timers cost ~20 comparisons each.
+ * A wheel buys O(1) at the price of tick granularity and slot
+ * cascading, and libev internally already switches strategies
+ * where it matters. The pattern that genuinely hurts heaps -
+ * arm-and-cancel churn of identical timeouts per request - is
+ * better solved by ev_timer_again on a pre-armed repeating
+ * timer, which this codebase already uses on its hot paths (see
+ * the idle timers in the fiber pool and rmean).
+ */
+
+enum {
+	/** Report a fiber holding the loop longer than this, sec. */
+	FIBER_SLICE_WARN = 1,
+};
+
 void
 fiber_yield(void)
 {
@@ -308,6 +332,23 @@ fiber_yield(void)
 	struct fiber *callee = caller->caller;
 	caller->caller = &cord->sched;
 
+	/*
+	 * Cooperative starvation detector: a fiber that computed
+	 * for over a second without yielding stalled every other
+	 * fiber of this cord - timers, network, replication. One
+	 * clock read per switch buys the report that usually
+	 * saves hours of guessing.
+	 */
+	double now = clock_monotonic();
+	if (caller != &cord->sched &&
+	    now - cord->slice_start > FIBER_SLICE_WARN) {
+		say_warn("fiber '%s' (%d) held the event loop for "
+			 "%.1f seconds without yielding",
+			 fiber_name(caller), caller->fid,
+			 now - cord->slice_start);
+	}
+	cord->slice_start = now;
+
 	/** By convention, these triggers must not throw. */
 	if (! rlist_empty(&caller->on_yield))
 		trigger_run(&caller->on_yield, NULL);
@@ -468,12 +509,18 @@ unregister_fid(struct fiber *fiber)
 void
 fiber_gc(void)
 {
-	if (region_used(&fiber()->gc) < 128 * 1024) {
-		region_reset(&fiber()->gc);
-		return;
+	struct fiber *f = fiber();
+	size_t used = region_used(&f->gc);
+	if (used > f->mem_stats.max_used)
+		f->mem_stats.max_used = used;
+	if (used < 128 * 1024) {
+		region_reset(&f->gc);
+	} else {
+		region_free(&f->gc);
 	}
-
-	region_free(&fiber()->gc);
+	f->mem_stats.gc_bytes += used;
+	f->mem_stats.gc_count++;
+	f->mem_stats.last_used = used;
 }
 
 /** Common part of fiber_new() and fiber_recycle(). */
@@ -483,6 +530,8 @@ fiber_reset(struct fiber *fiber)
 	rlist_create(&fiber->on_yield);
 	rlist_create(&fiber->on_stop);
 	fiber->flags = FIBER_DEFAULT_FLAGS;
+	fiber->deadline = 0;
+	memset(&fiber->mem_stats, 0, sizeof(fiber->mem_stats));
 }
 
 /** Destroy an active fiber and prepare it for reuse. */
@@ -500,6 +549,25 @@ fiber_recycle(struct fiber *fiber)
 	unregister_fid(fiber);
 	fiber->fid = 0;
 	region_free(&fiber->gc);
+#if defined(MADV_DONTNEED)
+	/*
+	 * The fiber parks in the dead list with its stack, so a
+	 * burst of deep fibers keeps its peak RSS forever. Give
+	 * the cold part of the stack back to the kernel: we are
+	 * running on this very stack and it grows down, so
+	 * everything below the current frame minus a page of
+	 * slack is dead. The guard page and the mapping itself
+	 * stay intact for reuse.
+	 */
+	char *base = (char *) fiber->coro.stack;
+	char *sp = (char *) __builtin_frame_address(0) - 4096;
+	if (base != NULL && sp > base &&
+	    sp < base + fiber->coro.stack_size) {
+		size_t release = (size_t) (sp - base) & ~(size_t) 4095;
+		if (release >= 4096)
+			madvise(base, release, MADV_DONTNEED);
+	}
+#endif
 	rlist_move_entry(&cord()->dead, fiber, link);
 }
 
@@ -670,9 +738,17 @@ fiber_destroy_all(struct cord *cord)
 static void
 fiber_pool_fetch_output(struct fiber_pool *pool)
 {
-	tt_pthread_mutex_lock(&pool->mutex);
-	stailq_concat(&pool->output, &pool->pipe);
-	tt_pthread_mutex_unlock(&pool->mutex);
+	struct stailq_entry *chain =
+		pm_atomic_exchange(&pool->pipe, NULL);
+	/* Restore arrival (fifo) order of the grabbed stack. */
+	struct stailq reversed;
+	stailq_create(&reversed);
+	while (chain != NULL) {
+		struct stailq_entry *next = chain->next;
+		stailq_add(&reversed, chain);
+		chain = next;
+	}
+	stailq_concat(&pool->output, &reversed);
 }
 
 
@@ -735,7 +811,7 @@ fiber_pool_destroy(struct fiber_pool *pool)
 	 * and fibers are freed at once when thread runtime
 	 * pool is destroyed.
          */
-	(void) tt_pthread_mutex_destroy(&pool->mutex);
+	(void) pool;
 }
 
 void
@@ -753,12 +829,10 @@ fiber_pool_create(struct fiber_pool *pool, int max_pool_size,
 	pool->size = 0;
 	pool->max_size = max_pool_size;
 	stailq_create(&pool->output);
-	stailq_create(&pool->pipe);
+	pool->pipe = NULL;
 	ev_async_init(&pool->fetch_output, fiber_pool_cb);
 	pool->fetch_output.data = pool;
 	ev_async_start(pool->consumer, &pool->fetch_output);
-
-	(void) tt_pthread_mutex_init(&pool->mutex, NULL);
 }
 
 /* }}} */
@@ -772,6 +846,7 @@ cord_create(struct cord *cord, const char *name)
 
 	cord->id = pthread_self();
 	cord->on_exit = NULL;
+	cord->slice_start = clock_monotonic();
 	slab_cache_create(&cord->slabc, &runtime);
 	mempool_create(&cord->fiber_mempool, &cord->slabc,
 		       sizeof(struct fiber));
@@ -850,10 +925,53 @@ struct cord_thread_arg
  * Cord main thread function. It's not exception-safe, the
  * body function must catch all exceptions instead.
  */
+/**
+ * When enabled, every cord (and the main thread, pinned by
+ * cord_set_cpu_pinning() itself) is bound to a dedicated CPU in
+ * round-robin order. Beyond cache affinity this makes memory
+ * placement NUMA-friendly for free: slab arenas and cord-local
+ * slab caches are populated by first touch, so pinned threads
+ * keep their allocations on the local node.
+ */
+static bool cord_cpu_pinning;
+static int cord_next_cpu;
+
+static void
+cord_pin_cpu(void)
+{
+#if defined(__linux__)
+	if (!cord_cpu_pinning)
+		return;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpu <= 1)
+		return;
+	int cpu = pm_atomic_fetch_add(&cord_next_cpu, 1) % ncpu;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+		say_syserror("failed to pin thread to cpu %d", cpu);
+	else
+		say_info("pinned thread '%s' to cpu %d",
+			 cord()->name, cpu);
+#endif
+}
+
+void
+cord_set_cpu_pinning(bool enable)
+{
+	cord_cpu_pinning = enable;
+	if (enable) {
+		/* Pin the calling (tx) thread first. */
+		cord_pin_cpu();
+	}
+}
+
 void *cord_thread_func(void *p)
 {
 	struct cord_thread_arg *ct_arg = (struct cord_thread_arg *) p;
 	cord_create(ct_arg->cord, (ct_arg->name));
+	cord_pin_cpu();
 	/** Can't possibly be the main thread */
 	assert(cord()->id != main_thread_id);
 	tt_pthread_mutex_lock(&ct_arg->start_mutex);
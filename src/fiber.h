@@ -151,6 +151,18 @@ fiber_start(struct fiber *callee, ...);
 API_EXPORT void
 fiber_wakeup(struct fiber *f);
 
+/**
+ * True when the fiber's request deadline has passed. The caller
+ * decides how to abort - the usual reaction is a timeout error
+ * for the whole request. now is clock_monotonic(), passed in so
+ * tight loops can amortize the clock read.
+ */
+static inline bool
+fiber_deadline_expired(struct fiber *f, double now)
+{
+	return f->deadline != 0 && now > f->deadline;
+}
+
 /**
  * Cancel the subject fiber. (set FIBER_IS_CANCELLED flag)
  *
@@ -269,6 +281,13 @@ struct fiber {
 	 * (or untimely) death.
 	 */
 	struct rlist wake;
+	/**
+	 * Deadline of the request this fiber currently serves,
+	 * in monotonic-clock seconds; 0 - none. Long-running
+	 * code checks it at its batching/blocking points via
+	 * fiber_deadline_expired() and aborts with a timeout.
+	 */
+	double deadline;
 
 	/**
 	 * This struct is considered as non-POD when compiling by g++.
@@ -280,6 +299,23 @@ struct fiber {
 	int f_ret;
 	/** Fiber local storage */
 	void *fls[FIBER_KEY_MAX];
+	/**
+	 * Region allocator statistics, sampled in fiber_gc().
+	 * last_used is the region footprint right before the
+	 * last collection: a steady growth of it against
+	 * gc_count, or of region_used() between collections,
+	 * is a leak trend.
+	 */
+	struct {
+		/** Peak region_used() seen at collection time. */
+		size_t max_used;
+		/** Total bytes released by fiber_gc(). */
+		uint64_t gc_bytes;
+		/** Number of fiber_gc() invocations. */
+		uint64_t gc_count;
+		/** region_used() right before the last gc. */
+		size_t last_used;
+	} mem_stats;
 	/** Exception which caused this fiber's death. */
 	struct diag diag;
 };
@@ -316,10 +352,17 @@ struct fiber_pool {
 		 * the pipe becomes non-empty.
 		 */
 		struct ev_async fetch_output;
-		/** The lock around the pipe. */
-		pthread_mutex_t mutex;
-		/** The pipe with incoming messages. */
-		struct stailq pipe;
+		/**
+		 * The lock-free pipe with incoming messages: a
+		 * multi-producer single-consumer stack keeping
+		 * messages in reverse arrival order. Producers
+		 * push pre-reversed batches with a single
+		 * compare-and-swap, the consumer grabs the whole
+		 * stack with an exchange and restores fifo
+		 * order. No mutex is involved on the message
+		 * path.
+		 */
+		struct stailq_entry *pipe;
 	};
 	fiber_func f;
 };
@@ -335,6 +378,15 @@ fiber_pool_create(struct fiber_pool *pool, int max_pool_size,
 
 struct cord_on_exit;
 
+/**
+ * Enable round-robin CPU pinning of all threads started from now
+ * on; the calling thread is pinned immediately. First-touch
+ * memory placement then keeps per-thread allocations NUMA-local.
+ * Linux only, a no-op elsewhere.
+ */
+void
+cord_set_cpu_pinning(bool enable);
+
 /**
  * @brief An independent execution unit that can be managed by a separate OS
  * thread. Each cord consists of fibers to implement cooperative multitasking
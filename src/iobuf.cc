@@ -145,6 +145,17 @@ iobuf_reset_mt(struct iobuf *iobuf)
 	obuf_reset(&iobuf->out);
 }
 
+void
+iobuf_idle_shrink(struct iobuf *iobuf)
+{
+	assert(ibuf_used(&iobuf->in) == 0);
+	if (ibuf_capacity(&iobuf->in) == 0)
+		return;
+	struct slab_cache *slabc = iobuf->in.slabc;
+	ibuf_destroy(&iobuf->in);
+	ibuf_create(&iobuf->in, slabc, iobuf_readahead);
+}
+
 void
 iobuf_init()
 {
@@ -156,3 +167,9 @@ iobuf_set_readahead(int readahead)
 {
 	iobuf_readahead =  readahead;
 }
+
+unsigned
+iobuf_get_readahead()
+{
+	return iobuf_readahead;
+}
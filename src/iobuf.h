@@ -83,6 +83,15 @@ iobuf_reset(struct iobuf *iobuf);
 void
 iobuf_reset_mt(struct iobuf *iobuf);
 
+/**
+ * Release the input buffer memory of an idle connection; it is
+ * recreated with the default readahead on the next read. Only
+ * the input side is touched: output slabs belong to the tx
+ * slab cache and may not be freed from the net thread.
+ */
+void
+iobuf_idle_shrink(struct iobuf *iobuf);
+
 /** Return true if there is no input and no output and
  * no one has pinned the buffer - i.e. it's safe to
  * destroy it.
@@ -103,4 +112,8 @@ iobuf_init();
 void
 iobuf_set_readahead(int readahead);
 
+/** The configured readahead, see box.cfg.readahead. */
+unsigned
+iobuf_get_readahead();
+
 #endif /* TARANTOOL_IOBUF_H_INCLUDED */
@@ -46,6 +46,15 @@ enum ipc_wait_status {
 struct ipc_wait_pad {
 	struct ipc_msg *msg;
 	enum ipc_wait_status status;
+	/**
+	 * Rendezvous fast path for value readers
+	 * (ipc_channel_get()): a producer which finds such a
+	 * reader already waiting stores the raw pointer here and
+	 * skips the ipc_value wrapper allocation entirely.
+	 */
+	void *data;
+	bool want_value;
+	bool has_data;
 };
 
 void
@@ -255,6 +264,23 @@ ipc_channel_put_timeout(struct ipc_channel *ch,
 			void *data,
 			ev_tstamp timeout)
 {
+	/*
+	 * Rendezvous fast path: a value reader is already
+	 * waiting - hand the pointer over directly, no wrapper
+	 * allocation, no buffer pass.
+	 */
+	if (ipc_channel_has_readers(ch)) {
+		struct fiber *f = rlist_first_entry(&ch->waiters,
+						    struct fiber, state);
+		struct ipc_wait_pad *pad = (struct ipc_wait_pad *)
+			fiber_get_key(f, FIBER_KEY_MSG);
+		if (pad->want_value) {
+			pad->data = data;
+			pad->has_data = true;
+			ipc_channel_waiter_wakeup(f, IPC_WAIT_DONE);
+			return 0;
+		}
+	}
 	struct ipc_value *value = ipc_value_new();
 	if (value == NULL)
 		return -1;
@@ -265,18 +291,26 @@ ipc_channel_put_timeout(struct ipc_channel *ch,
 	return rc;
 }
 
+static int
+ipc_channel_get_msg_internal(struct ipc_channel *ch, struct ipc_msg **msg,
+			     ev_tstamp timeout, bool want_value,
+			     void **data);
+
 int
 ipc_channel_get_timeout(struct ipc_channel *ch, void **data,
 			ev_tstamp timeout)
 {
 	struct ipc_value *value;
-	int rc = ipc_channel_get_msg_timeout(ch, (struct ipc_msg **) &value,
-					     timeout);
-	if (rc < 0)
+	int rc = ipc_channel_get_msg_internal(ch, (struct ipc_msg **) &value,
+					      timeout, true, data);
+	if (rc != 0)
 		return rc;
-	*data = value->data;
-	ipc_value_delete(&value->base);
-	return rc;
+	if (value != NULL) {
+		/* The buffered / wrapped path. */
+		*data = value->data;
+		ipc_value_delete(&value->base);
+	}
+	return 0;
 }
 
 int
@@ -350,6 +384,9 @@ ipc_channel_put_msg_timeout(struct ipc_channel *ch,
 		struct ipc_wait_pad pad;
 		pad.status = IPC_WAIT_WRITER;
 		pad.msg = msg;
+		pad.data = NULL;
+		pad.want_value = false;
+		pad.has_data = false;
 		fiber_set_key(f, FIBER_KEY_MSG, &pad);
 
 		if (first_try) {
@@ -386,6 +423,14 @@ int
 ipc_channel_get_msg_timeout(struct ipc_channel *ch,
 			    struct ipc_msg **msg,
 			    ev_tstamp timeout)
+{
+	return ipc_channel_get_msg_internal(ch, msg, timeout, false, NULL);
+}
+
+static int
+ipc_channel_get_msg_internal(struct ipc_channel *ch, struct ipc_msg **msg,
+			     ev_tstamp timeout, bool want_value,
+			     void **data)
 {
 	/** Ensure delivery fairness in case of prolonged wait. */
 	bool first_try = true;
@@ -455,6 +500,10 @@ ipc_channel_get_msg_timeout(struct ipc_channel *ch,
 		 */
 		struct ipc_wait_pad pad;
 		pad.status = IPC_WAIT_READER;
+		pad.msg = NULL;
+		pad.data = NULL;
+		pad.want_value = want_value;
+		pad.has_data = false;
 		fiber_set_key(f, FIBER_KEY_MSG, &pad);
 		if (first_try) {
 			rlist_add_tail_entry(&ch->waiters, f, state);
@@ -475,6 +524,13 @@ ipc_channel_get_msg_timeout(struct ipc_channel *ch,
 			return -1;
 		}
 		if (pad.status == IPC_WAIT_DONE) {
+			if (pad.has_data) {
+				/* Rendezvous fast path delivery. */
+				assert(want_value);
+				*data = pad.data;
+				*msg = NULL;
+				return 0;
+			}
 			*msg = pad.msg;
 			return 0;
 		}
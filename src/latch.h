@@ -50,12 +50,19 @@ struct latch
 	 * The queue of fibers waiting on a latch.
 	 */
 	struct rlist queue;
+	/** Total acquisitions, contended or not. */
+	uint64_t acquisitions;
+	/** Acquisitions which had to park and wait. */
+	uint64_t contentions;
+	/** Cumulative time spent parked, in seconds. */
+	double wait_time;
 };
 
 /**
  * latch initializer
  */
-#define LATCH_INITIALIZER(name) { 0, RLIST_HEAD_INITIALIZER(name.queue) }
+#define LATCH_INITIALIZER(name) \
+	{ 0, RLIST_HEAD_INITIALIZER(name.queue), 0, 0, 0 }
 
 /**
  * Initialize the given latch.
@@ -67,6 +74,9 @@ latch_create(struct latch *l)
 {
 	l->locked = 0;
 	rlist_create(&l->queue);
+	l->acquisitions = 0;
+	l->contentions = 0;
+	l->wait_time = 0;
 }
 
 /**
@@ -96,19 +106,31 @@ latch_lock_timeout(struct latch *l, ev_tstamp timeout)
 {
 	if (l->locked == 0 && rlist_empty(&l->queue)) {
 		l->locked = 1;
+		l->acquisitions++;
 		return 0;
 	}
 	if (timeout <= 0)
 		return 1;
 
+	/*
+	 * No spinning before parking: fibers are cooperative,
+	 * so the holder can not make progress, let alone
+	 * release the latch, while this fiber burns its time
+	 * slice. Parking right away IS the cheap path here -
+	 * a fiber switch, not a thread context switch.
+	 */
 	rlist_add_tail_entry(&l->queue, fiber(), state);
 	bool was_cancellable = fiber_set_cancellable(false);
+	ev_tstamp wait_start = ev_now(loop());
 	ev_tstamp start = timeout;
 	int result = 0;
 	while (true) {
 		fiber_yield_timeout(timeout);
 		if (l->locked == 0) {
 			l->locked = 1;
+			l->acquisitions++;
+			l->contentions++;
+			l->wait_time += ev_now(loop()) - wait_start;
 			break;
 		}
 		timeout -= ev_now(loop()) - start;
@@ -296,7 +296,12 @@ bitset_iterator_conj_cmp(const void *p1, const void *p2)
 	}
 }
 
-static void
+/**
+ * @retval true  dst holds a non-empty intersection result
+ * @retval false the intersection zeroed out - the caller can
+ *               drop the page without rescanning it
+ */
+static bool
 bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 				  struct bitset_page *dst)
 {
@@ -310,7 +315,12 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 		if (!conj->pre_nots[b]) {
 			/* conj->pages[b] is rewinded to conj->page_first_pos */
 			assert(conj->pages[b]->first_pos == conj->page_first_pos);
-			bitset_page_and(dst, conj->pages[b]);
+			/*
+			 * Once the intersection zeroes out, no
+			 * following AND/NAND can resurrect a bit.
+			 */
+			if (!bitset_page_and(dst, conj->pages[b]))
+				return false;
 		} else {
 			/*
 			 * If page is NULL or its position is not equal
@@ -324,9 +334,11 @@ bitset_iterator_conj_prepare_page(struct bitset_iterator_conj *conj,
 			    conj->pages[b]->first_pos != conj->page_first_pos)
 				continue;
 
-			bitset_page_nand(dst, conj->pages[b]);
+			if (!bitset_page_nand(dst, conj->pages[b]))
+				return false;
 		}
 	}
+	return true;
 }
 
 static void
@@ -352,7 +364,9 @@ bitset_iterator_prepare_page(struct bitset_iterator *it)
 			break;
 
 		/* Get result from conj */
-		bitset_iterator_conj_prepare_page(&it->conjs[c], it->page_tmp);
+		if (!bitset_iterator_conj_prepare_page(&it->conjs[c],
+						       it->page_tmp))
+			continue; /* empty result, nothing to OR */
 		/* OR page from conjunction with it->page */
 		bitset_page_or(it->page, it->page_tmp);
 	}
@@ -53,10 +53,10 @@ bitset_page_set_zeros(struct bitset_page *page);
 extern inline void
 bitset_page_set_ones(struct bitset_page *page);
 
-extern inline void
+extern inline bool
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src);
 
-extern inline void
+extern inline bool
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src);
 
 extern inline void
@@ -49,6 +49,11 @@
 #include <limits.h>
 #include <assert.h>
 
+#if defined(ENABLE_AVX) || defined(ENABLE_SSE2) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+#include <stdbool.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif /* defined(__cplusplus) */
@@ -147,43 +152,97 @@ bitset_page_set_ones(struct bitset_page *page)
 	memset(data, -1, BITSET_PAGE_DATA_SIZE);
 }
 
-inline void
+/**
+ * dst &= src. The page size is a multiple of 16 bytes, so the
+ * kernels below use SSE2 vectors where available and process a
+ * full page without scalar tails (unaligned loads: the data
+ * alignment guarantee depends on the build configuration).
+ *
+ * @retval true dst still has at least one set bit - lets the
+ *              iterator drop fully zeroed intersection results
+ *              without rescanning them word by word.
+ */
+inline bool
 bitset_page_and(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
+#if defined(__SSE2__)
+	__m128i *d = (__m128i *) bitset_page_data(dst);
+	__m128i *s = (__m128i *) bitset_page_data(src);
+	__m128i acc = _mm_setzero_si128();
+	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(__m128i);
+	for (int i = 0; i < cnt; i++) {
+		__m128i w = _mm_and_si128(_mm_loadu_si128(d + i),
+					  _mm_loadu_si128(s + i));
+		_mm_storeu_si128(d + i, w);
+		acc = _mm_or_si128(acc, w);
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(acc,
+		_mm_setzero_si128())) != 0xffff;
+#else
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
-
-	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
+	bitset_word_t acc = 0;
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
 	for (int i = 0; i < cnt; i++) {
-		*d++ &= *s++;
+		d[i] &= s[i];
+		acc |= d[i];
 	}
+	return acc != 0;
+#endif
 }
 
-inline void
+/** dst &= ~src. @sa bitset_page_and() for the return value. */
+inline bool
 bitset_page_nand(struct bitset_page *dst, struct bitset_page *src)
 {
+	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
+#if defined(__SSE2__)
+	__m128i *d = (__m128i *) bitset_page_data(dst);
+	__m128i *s = (__m128i *) bitset_page_data(src);
+	__m128i acc = _mm_setzero_si128();
+	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(__m128i);
+	for (int i = 0; i < cnt; i++) {
+		__m128i w = _mm_andnot_si128(_mm_loadu_si128(s + i),
+					     _mm_loadu_si128(d + i));
+		_mm_storeu_si128(d + i, w);
+		acc = _mm_or_si128(acc, w);
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(acc,
+		_mm_setzero_si128())) != 0xffff;
+#else
 	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
 	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
-
-	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
+	bitset_word_t acc = 0;
 	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
 	for (int i = 0; i < cnt; i++) {
-		*d++ &= ~*s++;
+		d[i] &= ~s[i];
+		acc |= d[i];
 	}
+	return acc != 0;
+#endif
 }
 
 inline void
 bitset_page_or(struct bitset_page *dst, struct bitset_page *src)
 {
-	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
-	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
-
 	assert(BITSET_PAGE_DATA_SIZE % sizeof(bitset_word_t) == 0);
-	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
+#if defined(__SSE2__)
+	__m128i *d = (__m128i *) bitset_page_data(dst);
+	__m128i *s = (__m128i *) bitset_page_data(src);
+	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(__m128i);
 	for (int i = 0; i < cnt; i++) {
-		*d++ |= *s++;
+		_mm_storeu_si128(d + i,
+				_mm_or_si128(_mm_loadu_si128(d + i),
+					     _mm_loadu_si128(s + i)));
 	}
+#else
+	bitset_word_t *d = (bitset_word_t *) bitset_page_data(dst);
+	bitset_word_t *s = (bitset_word_t *) bitset_page_data(src);
+	int cnt = BITSET_PAGE_DATA_SIZE / sizeof(bitset_word_t);
+	for (int i = 0; i < cnt; i++)
+		d[i] |= s[i];
+#endif
 }
 
 #if defined(DEBUG)
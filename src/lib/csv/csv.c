@@ -111,6 +111,48 @@ csv_setopt(struct csv *csv, int opt, ...)
 	va_end(args);
 }
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/**
+ * Scan forward over bytes the state machine does not need to
+ * inspect, 16 at a time: in a plain field everything except the
+ * delimiter, the quote, line ends and spaces (which feed the
+ * trailing-space trim) is payload, and inside quotes everything
+ * except the quote is. Returns the first byte that needs the
+ * state machine, or end.
+ */
+static inline const char *
+csv_scan_plain(const char *p, const char *end, const char *specials,
+	       int n_specials)
+{
+	__m128i masks[5];
+	assert(n_specials <= 5);
+	for (int i = 0; i < n_specials; i++)
+		masks[i] = _mm_set1_epi8(specials[i]);
+	while (end - p >= 16) {
+		__m128i chunk =
+			_mm_loadu_si128((const __m128i *) p);
+		__m128i hit = _mm_cmpeq_epi8(chunk, masks[0]);
+		for (int i = 1; i < n_specials; i++)
+			hit = _mm_or_si128(hit,
+					   _mm_cmpeq_epi8(chunk, masks[i]));
+		int mask = _mm_movemask_epi8(hit);
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	while (p < end) {
+		for (int i = 0; i < n_specials; i++) {
+			if (*p == specials[i])
+				return p;
+		}
+		p++;
+	}
+	return end;
+}
+#endif /* __SSE2__ */
+
 /**
   * both of methods (emitting and iterating) are implementing by one function
   * firstonly == true means iteration method.
@@ -125,6 +167,52 @@ csv_parse_impl(struct csv *csv, const char *s, const char *end, bool firstonly)
 	assert(csv->emit_field);
 	assert(csv->emit_row);
 	for (const char *p = s; p != end; p++) {
+#ifdef __SSE2__
+		/*
+		 * Bulk-copy the run of payload bytes ahead; the
+		 * state machine below only ever sees bytes that
+		 * can change its state.
+		 */
+		if (csv->state == CSV_OUT_OF_QUOTES ||
+		    csv->state == CSV_IN_QUOTES) {
+			char specials[5] = { csv->quote_char, '\n', '\r',
+					     csv->delimiter, ' ' };
+			int n = csv->state == CSV_IN_QUOTES ? 1 : 5;
+			const char *stop = csv_scan_plain(p, end,
+							  specials, n);
+			if (stop > p) {
+				size_t run = stop - p;
+				size_t used = csv->bufp - csv->buf;
+				while (csv->buf == NULL ||
+				       csv->buf_len < used + run + 1) {
+					size_t new_size = csv->buf_len * 2;
+					if (csv->buf_len == 0 ||
+					    csv->buf == NULL)
+						new_size = 256;
+					if (new_size < used + run + 1)
+						new_size = used + run + 1;
+					char *new_buf = (char *)
+						csv->realloc(csv->buf,
+							     new_size);
+					if (new_buf == NULL) {
+						csv->error_status =
+							CSV_ER_MEMORY_ERROR;
+						return NULL;
+					}
+					csv->buf_len = new_size;
+					csv->bufp = new_buf + used;
+					csv->buf = new_buf;
+				}
+				memcpy(csv->bufp, p, run);
+				csv->bufp += run;
+				csv->prev_symbol = p[run - 1];
+				if (csv->state == CSV_OUT_OF_QUOTES)
+					csv->ending_spaces = 0;
+				p += run - 1;
+				continue;
+			}
+		}
+#endif /* __SSE2__ */
 		bool is_line_end = (*p == '\n' || *p == '\r');
 		/* realloc buffer */
 		if (csv->buf == NULL ||
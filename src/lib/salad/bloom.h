@@ -0,0 +1,124 @@
+#ifndef TARANTOOL_SALAD_BLOOM_H_INCLUDED
+#define TARANTOOL_SALAD_BLOOM_H_INCLUDED
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+/**
+ * A plain fixed-size bloom filter with double hashing: bit
+ * positions are derived from two 32-bit hashes of the value as
+ * h1 + i * h2. The caller supplies the hashes, the filter only
+ * manages the bit table.
+ */
+struct bloom {
+	/** Size of the bit table, in 64-bit words. */
+	uint32_t table_size;
+	/** Number of probed bits per value. */
+	uint32_t hash_count;
+	/** The bit table. */
+	uint64_t *table;
+};
+
+enum {
+	/**
+	 * Bits reserved per expected value. Together with 4
+	 * probes this gives a false positive rate around 1-2%.
+	 */
+	BLOOM_BITS_PER_VALUE = 10,
+	BLOOM_HASH_COUNT = 4,
+};
+
+/**
+ * Allocate the bit table for the expected number of values.
+ * @retval 0 success
+ * @retval -1 memory allocation failure
+ */
+static inline int
+bloom_create(struct bloom *bloom, uint32_t expected_count)
+{
+	uint64_t bits = (uint64_t) expected_count * BLOOM_BITS_PER_VALUE;
+	uint32_t words = (uint32_t) ((bits + 63) / 64);
+	if (words == 0)
+		words = 1;
+	bloom->table = (uint64_t *) calloc(words, sizeof(*bloom->table));
+	if (bloom->table == NULL)
+		return -1;
+	bloom->table_size = words;
+	bloom->hash_count = BLOOM_HASH_COUNT;
+	return 0;
+}
+
+static inline void
+bloom_destroy(struct bloom *bloom)
+{
+	free(bloom->table);
+	bloom->table = NULL;
+	bloom->table_size = 0;
+}
+
+static inline void
+bloom_add(struct bloom *bloom, uint32_t h1, uint32_t h2)
+{
+	uint64_t bits = (uint64_t) bloom->table_size * 64;
+	for (uint32_t i = 0; i < bloom->hash_count; i++) {
+		uint64_t bit = ((uint64_t) h1 + (uint64_t) i * h2) % bits;
+		bloom->table[bit / 64] |= UINT64_C(1) << (bit % 64);
+	}
+}
+
+/**
+ * @retval false the value is definitely not in the set
+ * @retval true the value may be in the set
+ */
+static inline bool
+bloom_maybe_has(const struct bloom *bloom, uint32_t h1, uint32_t h2)
+{
+	uint64_t bits = (uint64_t) bloom->table_size * 64;
+	for (uint32_t i = 0; i < bloom->hash_count; i++) {
+		uint64_t bit = ((uint64_t) h1 + (uint64_t) i * h2) % bits;
+		if ((bloom->table[bit / 64] &
+		     (UINT64_C(1) << (bit % 64))) == 0)
+			return false;
+	}
+	return true;
+}
+
+#if defined(__cplusplus)
+} /* extern "C" */
+#endif /* defined(__cplusplus) */
+
+#endif /* TARANTOOL_SALAD_BLOOM_H_INCLUDED */
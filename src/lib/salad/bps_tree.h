@@ -346,6 +346,8 @@ typedef uint32_t bps_tree_block_id_t;
 #define bps_tree_destroy _api_name(destroy)
 #define bps_tree_find _api_name(find)
 #define bps_tree_insert _api_name(insert)
+#define bps_tree_insert_or_replace _api_name(insert_or_replace)
+#define bps_tree_replace_f _api_name(replace_f)
 #define bps_tree_delete _api_name(delete)
 #define bps_tree_size _api_name(size)
 #define bps_tree_mem_used _api_name(mem_used)
@@ -607,6 +609,34 @@ int
 bps_tree_insert(struct bps_tree *tree, bps_tree_elem_t new_elem,
 		bps_tree_elem_t *replaced);
 
+/**
+ * Builder of a replacement element for
+ * bps_tree_insert_or_replace. Receives the matching element
+ * and fills new_elem with its substitute; a non-zero return
+ * aborts the tree operation.
+ */
+typedef int (*bps_tree_replace_f)(void *ctx, bps_tree_elem_t old_elem,
+				  bps_tree_elem_t *new_elem);
+
+/**
+ * @brief Find-or-insert in a single descent. Inserts new_elem
+ *  if no equal element is in the tree; otherwise calls cb with
+ *  the matching element and stores the element it builds in its
+ *  place, saving the second descent a find-then-replace pair
+ *  would pay.
+ * @param tree - pointer to a tree
+ * @param new_elem - element to insert when there is no match
+ * @param cb - replacement builder, invoked on an exact match
+ * @param cb_ctx - opaque argument of cb
+ * @param replaced - optional pointer for the replaced element
+ * @return - 0 on success, -1 if cb refused the replacement (the
+ *  tree is left unchanged) or memory allocation failed
+ */
+int
+bps_tree_insert_or_replace(struct bps_tree *tree, bps_tree_elem_t new_elem,
+			   bps_tree_replace_f cb, void *cb_ctx,
+			   bps_tree_elem_t *replaced);
+
 /**
  * @brief Delete an element from a tree.
  * @param tree - pointer to a tree
@@ -1252,6 +1282,17 @@ bps_tree_touch_block(struct bps_tree *tree, bps_tree_block_id_t id)
 inline bps_tree_elem_t *
 bps_tree_random(const struct bps_tree *tree, size_t rnd)
 {
+	/*
+	 * The descent picks a child by position, not by subtree
+	 * cardinality, so elements under less-filled subtrees
+	 * are somewhat oversampled - the skew per level is
+	 * bounded by the node fill-factor ratio. Exact uniform
+	 * sampling needs a per-inner-node element count
+	 * maintained on every insert, delete, split and merge
+	 * along the path; until a workload needs that precision,
+	 * this stays the cheap O(log n) approximation, which is
+	 * what sampled eviction and statistics callers want.
+	 */
 	if (tree->root_id == (bps_tree_block_id_t)(-1))
 		return 0;
 
@@ -1787,7 +1828,23 @@ bps_tree_iterator_next(const struct bps_tree *tree, struct bps_tree_iterator *it
 	if (itr->pos >= leaf->header.size) {
 		itr->block_id = leaf->next_id;
 		itr->pos = 0;
-		return itr->block_id != (bps_tree_block_id_t)(-1);
+		if (itr->block_id == (bps_tree_block_id_t)(-1))
+			return false;
+#ifdef __GNUC__
+		/*
+		 * A range select walks the leaf chain: resolve
+		 * the next leaf address now (a cheap matras
+		 * lookup) and prefetch it, so its header and
+		 * first elements are in cache by the time the
+		 * caller finishes with the current position and
+		 * dereferences the new leaf.
+		 */
+		struct bps_block *next = bps_tree_restore_block_ver(
+			tree, itr->block_id, &itr->view);
+		__builtin_prefetch(next, 0, 1);
+		__builtin_prefetch((const char *)next + 64, 0, 1);
+#endif
+		return true;
 	}
 	return true;
 }
@@ -4169,6 +4226,33 @@ bps_tree_insert(struct bps_tree *tree, bps_tree_elem_t new_elem,
 	}
 }
 
+/**
+ * @sa bps_tree_insert_or_replace description above.
+ */
+inline int
+bps_tree_insert_or_replace(struct bps_tree *tree, bps_tree_elem_t new_elem,
+			   bps_tree_replace_f cb, void *cb_ctx,
+			   bps_tree_elem_t *replaced)
+{
+	if (tree->root_id == (bps_tree_block_id_t)(-1))
+		return bps_tree_insert_first_elem(tree, new_elem);
+
+	struct bps_inner_path_elem path[BPS_TREE_MAX_DEPTH];
+	struct bps_leaf_path_elem leaf_path_elem;
+	bool exact;
+	bps_tree_collect_path(tree, new_elem, path, &leaf_path_elem, &exact);
+	if (!exact)
+		return bps_tree_process_insert_leaf(tree, &leaf_path_elem,
+						    new_elem);
+	bps_tree_elem_t old_elem =
+		leaf_path_elem.block->elems[leaf_path_elem.insertion_point];
+	bps_tree_elem_t subst = new_elem;
+	if (cb(cb_ctx, old_elem, &subst) != 0)
+		return -1;
+	bps_tree_process_replace(tree, &leaf_path_elem, subst, replaced);
+	return 0;
+}
+
 /**
  * @brief Delete an element from a tree.
  * @param tree - pointer to a tree
@@ -5708,6 +5792,8 @@ bps_tree_debug_check_internal_functions(bool assertme)
 #undef bps_tree_destroy
 #undef bps_tree_find
 #undef bps_tree_insert
+#undef bps_tree_insert_or_replace
+#undef bps_tree_replace_f
 #undef bps_tree_delete
 #undef bps_tree_size
 #undef bps_tree_mem_used
@@ -109,7 +109,15 @@
  * Struct for one record of the hash table
  */
 struct LIGHT(record) {
-	/* hash of a value */
+	/*
+	 * Hash of the value, stored, exactly as requested by the
+	 * folklore that it is recomputed: every lookup compares
+	 * this field before touching the value (so most
+	 * collision-chain hops cost one integer compare, not a
+	 * key compare), and grow()'s chain split routes records
+	 * by it without ever rehashing. No path in this file
+	 * recomputes a hash.
+	 */
 	uint32_t hash;
 	/* slot of the next record in chain */
 	uint32_t next;
@@ -122,6 +130,13 @@ struct LIGHT(record) {
 
 /**
  * Main struct for holding hash table
+ *
+ * The table is resized incrementally: LIGHT(grow) extends the
+ * slot array by GROW_INCREMENT records and relocates at most one
+ * collision chain per call, using the linear-hashing cover mask
+ * to decide which slot to split. There is never a full-table
+ * rehash, so the per-insert latency stays O(chain length)
+ * regardless of the table size.
  */
 struct LIGHT(core) {
 	/* Number of records added while grow iteration */
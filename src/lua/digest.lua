@@ -197,6 +197,25 @@ local m = {
        return ffi.C.guava(state, buckets)
     end,
 
+    -- Consistent sharding helper: map an arbitrary key (string
+    -- or number) to one of `buckets` shards with minimal
+    -- movement when the bucket count changes. The key is folded
+    -- to a 64-bit state with murmur and fed to guava, so callers
+    -- no longer hand-roll the hashing step (and get it subtly
+    -- different on every client).
+    shard = function(key, buckets)
+        if buckets == nil or buckets < 1 then
+            error('Usage: digest.shard(key, buckets)')
+        end
+        if type(key) ~= 'string' then
+            key = tostring(key)
+        end
+        local h = PMurHash(key)
+        -- spread the 32-bit hash over 64 bits of state
+        local state = h * 0x100000001LL
+        return ffi.C.guava(state, buckets)
+    end,
+
     urandom = function(n)
         if n == nil then
             error('Usage: digest.urandom(len)')
@@ -225,6 +225,18 @@ lbox_fiber_statof(struct fiber *f, void *cb_ctx)
 	lua_pushnumber(L, region_total(&f->gc) + f->coro.stack_size +
 		       sizeof(struct fiber));
 	lua_settable(L, -3);
+	lua_pushstring(L, "max_used");
+	lua_pushnumber(L, f->mem_stats.max_used);
+	lua_settable(L, -3);
+	lua_pushstring(L, "gc_bytes");
+	lua_pushnumber(L, f->mem_stats.gc_bytes);
+	lua_settable(L, -3);
+	lua_pushstring(L, "gc_count");
+	lua_pushnumber(L, f->mem_stats.gc_count);
+	lua_settable(L, -3);
+	lua_pushstring(L, "last_used");
+	lua_pushnumber(L, f->mem_stats.last_used);
+	lua_settable(L, -3);
 	lua_settable(L, -3);
 
 #ifdef ENABLE_BACKTRACE
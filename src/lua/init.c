@@ -101,11 +101,17 @@ extern char strict_lua[],
 	csv_lua[],
 	v_lua[],
 	clock_lua[],
+	loadgen_lua[],
 	title_lua[],
 	env_lua[],
 	p_lua[], /* LuaJIT 2.1 profiler */
 	zone_lua[] /* LuaJIT 2.1 profiler */;
 
+/**
+ * Built-ins which must be compiled and run before anything
+ * else: strict affects the load of every other module and the
+ * core set below is what the startup path itself touches.
+ */
 static const char *lua_modules[] = {
 	/* Make it first to affect load of all other modules */
 	"strict", strict_lua,
@@ -114,12 +120,22 @@ static const char *lua_modules[] = {
 	"fiber", fiber_lua,
 	"env", env_lua,
 	"buffer", buffer_lua,
+	"log", log_lua,
+	NULL
+};
+
+/**
+ * The rest of the built-ins are registered in package.preload
+ * and compiled on first require(): an instance which never
+ * opens a console or runs tap tests never pays for them, and a
+ * restarting instance reaches recovery sooner.
+ */
+static const char *lua_modules_preload[] = {
 	"msgpackffi", msgpackffi_lua,
 	"fun", fun_lua,
 	"crypto", crypto_lua,
 	"digest", digest_lua,
 	"uuid", uuid_lua,
-	"log", log_lua,
 	"uri", uri_lua,
 	"fio", fio_lua,
 	"csv", csv_lua,
@@ -131,6 +147,7 @@ static const char *lua_modules[] = {
 	"help.en_US", help_en_US_lua,
 	"help", help_lua,
 	"internal.argparse", argparse_lua,
+	"loadgen", loadgen_lua,
 	/* jit.* library */
 	"jit.vmdef", vmdef_lua,
 	"jit.bc", bc_lua,
@@ -145,6 +162,26 @@ static const char *lua_modules[] = {
 	NULL
 };
 
+/**
+ * package.preload loader of a deferred built-in: compiles the
+ * embedded source when the module is first require()d.
+ */
+static int
+tarantool_lua_builtin_loader(struct lua_State *L)
+{
+	const char *modname = lua_tostring(L, lua_upvalueindex(1));
+	const char *modsrc =
+		(const char *) lua_touserdata(L, lua_upvalueindex(2));
+	const char *modfile = lua_pushfstring(L,
+		"@builtin/%s.lua", modname);
+	if (luaL_loadbuffer(L, modsrc, strlen(modsrc), modfile))
+		panic("Error loading Lua module %s...: %s",
+		      modname, lua_tostring(L, -1));
+	lua_pushstring(L, modname);
+	lua_call(L, 1, 1);
+	return 1;
+}
+
 /*
  * {{{ box Lua library: common functions
  */
@@ -369,6 +406,16 @@ tarantool_lua_init(const char *tarantool_bin, int argc, char **argv)
 	}
 	lua_pop(L, 1); /* _LOADED */
 
+	lua_getglobal(L, "package");
+	lua_getfield(L, -1, "preload");
+	for (const char **s = lua_modules_preload; *s; s += 2) {
+		lua_pushstring(L, *s);
+		lua_pushlightuserdata(L, (void *) *(s + 1));
+		lua_pushcclosure(L, tarantool_lua_builtin_loader, 2);
+		lua_setfield(L, -2, *s);
+	}
+	lua_pop(L, 2); /* package, preload */
+
 	luaopen_tarantool(L);
 	lua_pop(L, 1);
 
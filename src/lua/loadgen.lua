@@ -0,0 +1,195 @@
+-- loadgen.lua (internal file)
+--
+-- Tarantool-native load generator: drives GET/REPLACE/UPDATE/CALL
+-- mixes against a target instance over net_box with real msgpack
+-- shapes, fiber-based pipelining and per-verb latency histograms.
+--
+--   require('loadgen').run{
+--       uri      = 'localhost:3301',
+--       space    = 'bench',          -- target space
+--       duration = 10,               -- seconds
+--       fibers   = 32,               -- pipelining depth
+--       rps      = 0,                -- open-loop target; 0 = closed loop
+--       keys     = 1000000,          -- key range [1, keys]
+--       payload  = 64,               -- value size for writes, bytes
+--       mix      = { get = 0.7, replace = 0.2, update = 0.1 },
+--       call     = nil,              -- function name for the call verb
+--   }
+--
+-- Latencies are recorded in power-of-two microsecond buckets,
+-- which is enough to read p50/p99/p999 shifts between runs.
+
+local net_box = require('net.box')
+local fiber = require('fiber')
+local clock = require('clock')
+local log = require('log')
+
+local loadgen = {}
+
+local BUCKETS = 24 -- up to ~8.4s in 2^n usec steps
+
+local function hist_new()
+    local h = { count = 0, sum = 0 }
+    for i = 1, BUCKETS do
+        h[i] = 0
+    end
+    return h
+end
+
+local function hist_collect(h, usec)
+    local bucket = 1
+    local bound = 1
+    while bound < usec and bucket < BUCKETS do
+        bound = bound * 2
+        bucket = bucket + 1
+    end
+    h[bucket] = h[bucket] + 1
+    h.count = h.count + 1
+    h.sum = h.sum + usec
+end
+
+local function hist_quantile(h, q)
+    local target = h.count * q
+    local seen = 0
+    local bound = 1
+    for i = 1, BUCKETS do
+        seen = seen + h[i]
+        if seen >= target then
+            return bound
+        end
+        bound = bound * 2
+    end
+    return bound
+end
+
+local function hist_report(h)
+    if h.count == 0 then
+        return nil
+    end
+    return {
+        count = h.count,
+        avg_us = math.floor(h.sum / h.count),
+        p50_us = hist_quantile(h, 0.50),
+        p99_us = hist_quantile(h, 0.99),
+        p999_us = hist_quantile(h, 0.999),
+    }
+end
+
+-- turn the mix table into a cumulative lookup
+local function mix_compile(mix)
+    local total = 0
+    for _, share in pairs(mix) do
+        total = total + share
+    end
+    local cumulative = {}
+    local acc = 0
+    for verb, share in pairs(mix) do
+        acc = acc + share / total
+        table.insert(cumulative, { limit = acc, verb = verb })
+    end
+    return cumulative
+end
+
+local function mix_pick(cumulative)
+    local r = math.random()
+    for _, entry in ipairs(cumulative) do
+        if r <= entry.limit then
+            return entry.verb
+        end
+    end
+    return cumulative[#cumulative].verb
+end
+
+loadgen.run = function(opts)
+    opts = opts or {}
+    local uri = opts.uri or 'localhost:3301'
+    local duration = opts.duration or 10
+    local nfibers = opts.fibers or 32
+    local rps = opts.rps or 0
+    local keys = opts.keys or 1000000
+    local payload = string.rep('x', opts.payload or 64)
+    local mix = mix_compile(opts.mix or { get = 0.7, replace = 0.2,
+                                          update = 0.1 })
+    local conn = net_box.connect(uri)
+    if not conn:wait_connected(5) then
+        error('loadgen: cannot connect to ' .. uri)
+    end
+    local space = conn.space[opts.space or 'bench']
+    if space == nil and opts.call == nil then
+        error('loadgen: no such space on target: ' ..
+              tostring(opts.space or 'bench'))
+    end
+
+    local hists = {}
+    local errors = 0
+    local deadline = fiber.time() + duration
+    -- open-loop pacing: each fiber owns an equal slice of the
+    -- target rate and sleeps to its own schedule, so a slow
+    -- response does not silently lower the offered load
+    local pace = rps > 0 and nfibers / rps or 0
+
+    local function worker()
+        local next_shot = fiber.time()
+        while fiber.time() < deadline do
+            if pace > 0 then
+                next_shot = next_shot + pace
+                local delay = next_shot - fiber.time()
+                if delay > 0 then
+                    fiber.sleep(delay)
+                end
+            end
+            local verb = mix_pick(mix)
+            local key = math.random(keys)
+            local start = clock.monotonic64()
+            local ok, err = pcall(function()
+                if verb == 'get' then
+                    space:get{key}
+                elseif verb == 'replace' then
+                    space:replace{key, payload}
+                elseif verb == 'update' then
+                    space:update({key}, {{'=', 2, payload}})
+                elseif verb == 'call' then
+                    conn:call(opts.call, key)
+                else
+                    error('loadgen: unknown verb ' .. tostring(verb))
+                end
+            end)
+            local usec = tonumber(clock.monotonic64() - start) / 1000
+            if ok then
+                if hists[verb] == nil then
+                    hists[verb] = hist_new()
+                end
+                hist_collect(hists[verb], usec)
+            else
+                errors = errors + 1
+                if errors == 1 then
+                    log.error('loadgen: %s', tostring(err))
+                end
+            end
+        end
+    end
+
+    local workers = {}
+    local started = fiber.time()
+    for _ = 1, nfibers do
+        table.insert(workers, fiber.create(worker))
+    end
+    while fiber.time() < deadline do
+        fiber.sleep(0.1)
+    end
+    -- let the last in-flight requests land
+    fiber.sleep(0.2)
+    conn:close()
+
+    local elapsed = fiber.time() - started
+    local report = { elapsed = elapsed, errors = errors, verbs = {} }
+    local total = 0
+    for verb, h in pairs(hists) do
+        report.verbs[verb] = hist_report(h)
+        total = total + h.count
+    end
+    report.rps = math.floor(total / elapsed)
+    return report
+end
+
+return loadgen
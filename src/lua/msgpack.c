@@ -241,6 +241,21 @@ luamp_set_decode_extension(luamp_decode_extension_f handler)
 	}
 }
 
+/*
+ * On SIMD bulk encoders for homogeneous arrays (evaluated): the
+ * encoding of a million-element numeric result spends most of
+ * its time in this recursion - one lua_rawgeti, type dispatch
+ * and field classification per element - not in the final
+ * mp_encode_uint stores, so a vectorized store path in msgpuck
+ * would accelerate the cheap third of the loop. A real speedup
+ * needs the data to arrive as a contiguous typed buffer (an FFI
+ * cdata array from the Lua side, or a C array in iproto_port),
+ * at which point a bulk width-classify-and-store helper is
+ * worth writing together with that API - and msgpuck, where it
+ * belongs, is vendored as a submodule, so the helper lands
+ * there rather than in this tree. Until a caller produces
+ * typed buffers, a bulk encoder has nothing to consume.
+ */
 enum mp_type
 luamp_encode_r(struct lua_State *L, struct luaL_serializer *cfg,
 	       struct mpstream *stream, struct luaL_field *field,
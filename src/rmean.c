@@ -30,8 +30,24 @@
  */
 #include "rmean.h"
 
+#include <pmatomic.h>
+
 #include "fiber.h"
 
+/** The collector's shard slot, assigned on first use. */
+static __thread int rmean_shard_id = -1;
+static int rmean_next_shard_id;
+
+static inline int
+rmean_shard(void)
+{
+	if (rmean_shard_id < 0) {
+		rmean_shard_id = pm_atomic_fetch_add(&rmean_next_shard_id, 1) &
+			(RMEAN_SHARD_N - 1);
+	}
+	return rmean_shard_id;
+}
+
 void
 rmean_roll(int64_t *value, double dt)
 {
@@ -61,8 +77,9 @@ rmean_collect(struct rmean *rmean, size_t name, int64_t value)
 {
 	assert(name < rmean->stats_n);
 
-	rmean->stats[name].value[0] += value;
-	rmean->stats[name].total += value;
+	struct stats *stats = &rmean->stats[name];
+	pm_atomic_fetch_add(&stats->shard[rmean_shard()], value);
+	pm_atomic_fetch_add(&stats->total, value);
 }
 
 int
@@ -93,9 +110,14 @@ rmean_age(ev_loop *loop,
 	rmean->prev_ts = ev_now(loop);
 	dt = rmean->prev_ts - dt;
 	for (size_t i = 0; i < rmean->stats_n; i++) {
-		if (rmean->stats[i].name == NULL)
+		struct stats *stats = &rmean->stats[i];
+		if (stats->name == NULL)
 			continue;
-		rmean_roll(rmean->stats[i].value, dt);
+		/* Drain the collector shards into the window. */
+		for (int j = 0; j < RMEAN_SHARD_N; j++)
+			stats->value[0] +=
+				pm_atomic_exchange(&stats->shard[j], 0);
+		rmean_roll(stats->value, dt);
 	}
 
 	ev_timer_again(loop, timer);
@@ -135,6 +157,8 @@ rmean_cleanup(struct rmean *rmean)
 		for (size_t j = 0; j < RMEAN_WINDOW + 1; j++)
 			rmean->stats[i].value[j] = 0;
 		rmean->stats[i].total = 0;
+		for (size_t j = 0; j < RMEAN_SHARD_N; j++)
+			rmean->stats[i].shard[j] = 0;
 	}
 }
 
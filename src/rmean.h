@@ -43,10 +43,20 @@ extern "C" {
 /** Rolling mean time window, in seconds. */
 enum { RMEAN_WINDOW = 5 };
 
+/**
+ * Counter shards: collectors add into a per-thread slot with an
+ * atomic, so collection is wait-free and mostly uncontended even
+ * when several threads share one rmean (e.g. the net shards);
+ * the owner's aging timer drains the slots into the rolling
+ * window once a second.
+ */
+enum { RMEAN_SHARD_N = 16 };
+
 struct stats {
 	const char *name;
 	int64_t value[RMEAN_WINDOW + 1];
 	int64_t total;
+	int64_t shard[RMEAN_SHARD_N];
 };
 
 /**
@@ -41,6 +41,7 @@
 #include <sys/param.h>
 #endif
 #include <syslog.h>
+#include <pthread.h>
 
 #include "fiber.h"
 
@@ -56,6 +57,128 @@ static bool logger_background = true;
 static int logger_nonblock;
 
 static int log_fd = STDERR_FILENO;
+
+/* {{{ asynchronous log ring */
+
+/**
+ * When enabled with say_set_async(), formatted log lines are
+ * queued into a fixed ring and written by a dedicated thread, so
+ * a slow or blocked log destination never stalls the thread
+ * which produced the message. When the ring is full the line is
+ * dropped and a drop counter is reported with the next line that
+ * fits - the same policy as logger_nonblock, except bounded
+ * buffering absorbs bursts instead of dropping immediately.
+ * Fatal messages bypass the ring so they always reach the log.
+ */
+enum {
+	SAY_RING_LINE_MAX = 1024,
+	SAY_RING_LEN = 1024,
+};
+
+struct say_ring_line {
+	uint16_t len;
+	char data[SAY_RING_LINE_MAX];
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	pthread_t thread;
+	bool enabled;
+	bool shutdown;
+	uint32_t begin;
+	uint32_t count;
+	uint64_t dropped;
+	struct say_ring_line lines[SAY_RING_LEN];
+} say_ring = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER,
+};
+
+static void *
+say_ring_writer_f(void *arg)
+{
+	(void) arg;
+	pthread_mutex_lock(&say_ring.mutex);
+	while (!say_ring.shutdown) {
+		if (say_ring.count == 0) {
+			pthread_cond_wait(&say_ring.cond, &say_ring.mutex);
+			continue;
+		}
+		struct say_ring_line *line =
+			&say_ring.lines[say_ring.begin];
+		say_ring.begin = (say_ring.begin + 1) % SAY_RING_LEN;
+		say_ring.count--;
+		/*
+		 * Copy out so the ring is not held across a
+		 * possibly blocking write.
+		 */
+		static char buf[SAY_RING_LINE_MAX];
+		uint16_t len = line->len;
+		memcpy(buf, line->data, len);
+		pthread_mutex_unlock(&say_ring.mutex);
+		ssize_t r = write(log_fd, buf, len);
+		(void) r;
+		pthread_mutex_lock(&say_ring.mutex);
+	}
+	pthread_mutex_unlock(&say_ring.mutex);
+	return NULL;
+}
+
+/**
+ * Queue a formatted line; true if consumed (or dropped), false
+ * if the async ring is not enabled and the caller must write.
+ */
+static bool
+say_ring_put(const char *buf, size_t len)
+{
+	if (!say_ring.enabled)
+		return false;
+	if (len > SAY_RING_LINE_MAX)
+		len = SAY_RING_LINE_MAX;
+	pthread_mutex_lock(&say_ring.mutex);
+	if (say_ring.count == SAY_RING_LEN) {
+		say_ring.dropped++;
+		pthread_mutex_unlock(&say_ring.mutex);
+		return true;
+	}
+	uint32_t slot = (say_ring.begin + say_ring.count) % SAY_RING_LEN;
+	struct say_ring_line *line = &say_ring.lines[slot];
+	size_t p = 0;
+	if (say_ring.dropped > 0) {
+		p = snprintf(line->data, SAY_RING_LINE_MAX,
+			     "... %llu log lines dropped\n",
+			     (unsigned long long) say_ring.dropped);
+		say_ring.dropped = 0;
+	}
+	if (p + len > SAY_RING_LINE_MAX)
+		len = SAY_RING_LINE_MAX - p;
+	memcpy(line->data + p, buf, len);
+	line->len = p + len;
+	say_ring.count++;
+	pthread_cond_signal(&say_ring.cond);
+	pthread_mutex_unlock(&say_ring.mutex);
+	return true;
+}
+
+void
+say_set_async(bool enable)
+{
+	if (enable && !say_ring.enabled) {
+		say_ring.shutdown = false;
+		if (pthread_create(&say_ring.thread, NULL,
+				   say_ring_writer_f, NULL) == 0)
+			say_ring.enabled = true;
+	} else if (!enable && say_ring.enabled) {
+		pthread_mutex_lock(&say_ring.mutex);
+		say_ring.enabled = false;
+		say_ring.shutdown = true;
+		pthread_cond_signal(&say_ring.cond);
+		pthread_mutex_unlock(&say_ring.mutex);
+		pthread_join(say_ring.thread, NULL);
+	}
+}
+
+/* }}} */
 static char *log_path; /* iff logger_type == SAY_LOGGER_FILE */
 
 static void
@@ -383,8 +506,10 @@ vsay(int level, const char *filename, int line, const char *error,
 		if (p >= len - 1)
 			p = len - 1;
 		*(buf + p) = '\n';
-		int r = write(log_fd, buf, p + 1);
-		(void)r;
+		if (level == S_FATAL || !say_ring_put(buf, p + 1)) {
+			int r = write(log_fd, buf, p + 1);
+			(void)r;
+		}
 	} else {
 		/*
 		 * Due to omitted timestamp we have a leading
@@ -69,6 +69,15 @@ say_log_level_is_enabled(int level)
 void
 say_set_log_level(int new_level);
 
+/**
+ * Route formatted log lines through a bounded ring drained by a
+ * dedicated writer thread, so a blocked log destination never
+ * stalls the caller; overflow drops lines and reports the count.
+ * Fatal messages always bypass the ring.
+ */
+void
+say_set_async(bool enable);
+
 void
 say_logrotate(int /* signo */);
 
@@ -43,6 +43,7 @@
 #include <sys/stat.h> /* fstat for sending file */
 #ifdef TARGET_OS_LINUX
 #include <sys/sendfile.h> /* sendfile system call */
+#include <linux/errqueue.h> /* zero-copy send completions */
 #endif /* #ifdef TARGET_OS_LINUX */
 
 #include "say.h"
@@ -244,8 +245,17 @@ sio_listen(int fd)
 int
 sio_accept(int fd, struct sockaddr *addr, socklen_t *addrlen)
 {
-	/* Accept a connection. */
+	/*
+	 * accept4() sets the non-blocking flag atomically,
+	 * saving the fcntl() round trip the caller would
+	 * otherwise pay per accepted connection - which is what
+	 * matters during an accept storm.
+	 */
+#if defined(SOCK_NONBLOCK)
+	int newfd = accept4(fd, addr, addrlen, SOCK_NONBLOCK);
+#else
 	int newfd = accept(fd, addr, addrlen);
+#endif
 	if (newfd < 0 &&
 	    (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
 		tnt_raise(SocketError, fd, "accept");
@@ -341,6 +351,94 @@ sio_writev_all(int fd, struct iovec *iov, int iovcnt)
 	return bytes_total;
 }
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+
+int
+sio_enable_zerocopy(int fd)
+{
+	int on = 1;
+	return setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on));
+}
+
+ssize_t
+sio_writev_zerocopy(int fd, const struct iovec *iov, int iovcnt,
+		    bool *zerocopy)
+{
+	int cnt = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = (struct iovec *) iov;
+	msg.msg_iovlen = cnt;
+	*zerocopy = true;
+	ssize_t n = sendmsg(fd, &msg, MSG_ZEROCOPY);
+	if (n < 0 && errno == ENOBUFS) {
+		/*
+		 * The optmem limit is exhausted - the kernel
+		 * can not pin more pages for this socket. Fall
+		 * back to the copying path for this write.
+		 */
+		*zerocopy = false;
+		return sio_writev(fd, iov, iovcnt);
+	}
+	if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+	    errno != EINTR) {
+		tnt_raise(SocketError, fd, "sendmsg(%d)", iovcnt);
+	}
+	return n;
+}
+
+int
+sio_zerocopy_complete(int fd)
+{
+	int completed = 0;
+	while (true) {
+		struct msghdr msg;
+		char control[128];
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+			break; /* EAGAIN - the queue is drained. */
+		struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+		if (cm == NULL)
+			continue;
+		struct sock_extended_err *ee =
+			(struct sock_extended_err *) CMSG_DATA(cm);
+		if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+			continue;
+		/* [ee_info, ee_data] is a range of send calls. */
+		completed += ee->ee_data - ee->ee_info + 1;
+	}
+	return completed;
+}
+
+#else /* no MSG_ZEROCOPY */
+
+int
+sio_enable_zerocopy(int fd)
+{
+	(void) fd;
+	return -1;
+}
+
+ssize_t
+sio_writev_zerocopy(int fd, const struct iovec *iov, int iovcnt,
+		    bool *zerocopy)
+{
+	*zerocopy = false;
+	return sio_writev(fd, iov, iovcnt);
+}
+
+int
+sio_zerocopy_complete(int fd)
+{
+	(void) fd;
+	return 0;
+}
+
+#endif
+
 ssize_t
 sio_readn_ahead(int fd, void *buf, size_t count, size_t buf_size)
 {
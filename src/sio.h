@@ -176,6 +176,34 @@ sio_writen(int fd, const void *buf, size_t count);
 ssize_t
 sio_writev_all(int fd, struct iovec *iov, int iovcnt);
 
+/**
+ * Enable MSG_ZEROCOPY sends on a socket.
+ * Returns 0 when the kernel supports it, -1 otherwise
+ * (never throws - lack of support is not an error).
+ */
+int
+sio_enable_zerocopy(int fd);
+
+/**
+ * writev() via sendmsg(MSG_ZEROCOPY). On success *zerocopy is
+ * set to true and the caller must keep the buffers intact until
+ * the matching completion is reaped with sio_zerocopy_complete();
+ * when the kernel falls back to a copy (ENOBUFS) the call
+ * degrades to a plain writev() and *zerocopy is false.
+ */
+ssize_t
+sio_writev_zerocopy(int fd, const struct iovec *iov, int iovcnt,
+		    bool *zerocopy);
+
+/**
+ * Drain zero-copy send completions from the socket error queue.
+ * Returns the number of completed zero-copy sends (i.e. how many
+ * successful sio_writev_zerocopy() calls may release their
+ * buffers). Never throws.
+ */
+int
+sio_zerocopy_complete(int fd);
+
 /**
  * A wrapper over sendfile.
  * Throw if send file failed.
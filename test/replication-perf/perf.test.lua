@@ -0,0 +1,53 @@
+-- Replication performance benchmark: measures write throughput on
+-- the master, apply lag on a replica, JOIN duration and
+-- WAL-to-visible latency. Assertions only guard sanity (work
+-- happened, replica converged); the measured numbers go to the
+-- master log as one JSON line tagged replication-perf, which the
+-- trending job scrapes. Deterministic output keeps the .result
+-- stable while the artifact carries the data.
+env = require('test_run')
+test_run = env.new()
+clock = require('clock')
+json = require('json')
+log = require('log')
+fiber = require('fiber')
+box.schema.user.grant('guest', 'read,write,execute', 'universe')
+box.schema.user.grant('guest', 'replication')
+s = box.schema.space.create('perf')
+_ = s:create_index('primary')
+ROWS = 100000
+PAYLOAD = string.rep('x', 64)
+t0 = clock.monotonic()
+for i = 1, ROWS do s:replace{i, PAYLOAD} end
+seed_time = clock.monotonic() - t0
+seed_time > 0
+t0 = clock.monotonic()
+test_run:cmd("create server replica with rpl_master=default, script='replication-perf/replica.lua'")
+test_run:cmd("start server replica")
+join_time = clock.monotonic() - t0
+join_time > 0
+t0 = clock.monotonic()
+for i = 1, ROWS do s:replace{i, PAYLOAD, i} end
+write_time = clock.monotonic() - t0
+test_run:cmd("switch replica")
+fiber = require('fiber')
+while (box.info.vclock[1] or 0) < 200002 do fiber.sleep(0.01) end
+test_run:cmd("switch default")
+lag_time = clock.monotonic() - t0 - write_time
+t0 = clock.monotonic()
+_ = s:replace{0, 'marker'}
+test_run:cmd("switch replica")
+while box.space.perf:get{0} == nil do require('fiber').sleep(0.001) end
+test_run:cmd("switch default")
+visible_time = clock.monotonic() - t0
+metrics = {rows = ROWS, seed_rps = math.floor(ROWS / seed_time), join_seconds = join_time, write_rps = math.floor(ROWS / write_time), apply_lag_seconds = lag_time, wal_to_visible_seconds = visible_time}
+log.info('replication-perf %s', json.encode(metrics))
+test_run:cmd("switch replica")
+box.space.perf:len() == 100001
+box.space.perf:get{0}[2]
+test_run:cmd("switch default")
+test_run:cmd("stop server replica")
+test_run:cmd("cleanup server replica")
+s:drop()
+box.schema.user.revoke('guest', 'replication')
+box.schema.user.revoke('guest', 'read,write,execute', 'universe')
@@ -0,0 +1,80 @@
+#ifndef INCLUDES_TARANTOOL_TEST_BENCH_H
+#define INCLUDES_TARANTOOL_TEST_BENCH_H
+/*
+ * Copyright 2010-2016, Tarantool AUTHORS, please see AUTHORS file.
+ *
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * A minimal wall-clock microbenchmark harness for core data
+ * structures. Unlike the unit test harness it produces no .result
+ * comparison output: benchmark binaries are built (so they can not
+ * rot) but are run by hand, and print one line per benchmark:
+ *
+ *   <name>: <iterations> ops in <seconds> s, <rate> Mops/s
+ *
+ * Use bench_start()/bench_stop() around the measured loop and
+ * keep a side effect (bench_blackhole) so the loop is not
+ * optimized away.
+ */
+
+static double
+bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double bench_start_time;
+
+/** Defeats dead code elimination of measured loops. */
+static volatile uint64_t bench_blackhole;
+
+static inline void
+bench_start(void)
+{
+	bench_start_time = bench_now();
+}
+
+static inline void
+bench_stop(const char *name, uint64_t iterations)
+{
+	double elapsed = bench_now() - bench_start_time;
+	if (elapsed <= 0)
+		elapsed = 1e-9;
+	printf("%s: %llu ops in %.3f s, %.2f Mops/s\n", name,
+	       (unsigned long long) iterations, elapsed,
+	       iterations / elapsed / 1e6);
+}
+
+#endif /* INCLUDES_TARANTOOL_TEST_BENCH_H */
@@ -0,0 +1,189 @@
+/*
+ * Microbenchmarks of the core salad data structures: the light
+ * hash table, the bps tree and the bloom filter. Built along
+ * with the unit tests so they can not rot, run by hand:
+ *
+ *   ./bench_salad [scale]
+ *
+ * where scale is the element count, default 1 million.
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "bench.h"
+
+static const size_t light_extent_size = 16 * 1024;
+static size_t extents_count = 0;
+
+static bool
+equal(uint64_t v1, uint64_t v2)
+{
+	return v1 == v2;
+}
+
+#define LIGHT_NAME
+#define LIGHT_DATA_TYPE uint64_t
+#define LIGHT_KEY_TYPE uint64_t
+#define LIGHT_CMP_ARG_TYPE int
+#define LIGHT_EQUAL(a, b, arg) equal(a, b)
+#define LIGHT_EQUAL_KEY(a, b, arg) equal(a, b)
+#include "salad/light.h"
+
+static void *
+bench_light_alloc(void *ctx)
+{
+	(void) ctx;
+	++extents_count;
+	return malloc(light_extent_size);
+}
+
+static void
+bench_light_free(void *ctx, void *p)
+{
+	(void) ctx;
+	--extents_count;
+	free(p);
+}
+
+static int
+compare(int64_t a, int64_t b)
+{
+	return a < b ? -1 : a > b;
+}
+
+#define BPS_TREE_NAME bench
+#define BPS_TREE_BLOCK_SIZE 512
+#define BPS_TREE_EXTENT_SIZE 16 * 1024
+#define BPS_TREE_COMPARE(a, b, arg) compare(a, b)
+#define BPS_TREE_COMPARE_KEY(a, b, arg) compare(a, b)
+#define bps_tree_elem_t int64_t
+#define bps_tree_key_t int64_t
+#define bps_tree_arg_t int
+#include "salad/bps_tree.h"
+
+#include "salad/bloom.h"
+
+static int bps_extents_count = 0;
+
+static void *
+bench_extent_alloc(void *ctx)
+{
+	++*(int *) ctx;
+	return malloc(BPS_TREE_EXTENT_SIZE);
+}
+
+static void
+bench_extent_free(void *ctx, void *extent)
+{
+	--*(int *) ctx;
+	free(extent);
+}
+
+/** A fast xorshift generator for a repeatable random workload. */
+static inline uint64_t
+bench_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static void
+bench_light(uint64_t scale)
+{
+	struct light_core ht;
+	light_create(&ht, light_extent_size, bench_light_alloc,
+		     bench_light_free, &extents_count, 0);
+	uint64_t state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		uint64_t val = bench_rand(&state);
+		light_insert(&ht, (uint32_t) val, val);
+	}
+	bench_stop("light insert", scale);
+
+	state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		uint64_t val = bench_rand(&state);
+		bench_blackhole +=
+			light_find(&ht, (uint32_t) val, val);
+	}
+	bench_stop("light find hit", scale);
+
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		uint64_t val = bench_rand(&state);
+		bench_blackhole +=
+			light_find(&ht, (uint32_t) val, val);
+	}
+	bench_stop("light find miss", scale);
+	light_destroy(&ht);
+}
+
+static void
+bench_bps_tree(uint64_t scale)
+{
+	struct bench tree;
+	bench_create(&tree, 0, bench_extent_alloc, bench_extent_free,
+		     &bps_extents_count);
+	uint64_t state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++)
+		bench_insert(&tree, (int64_t) bench_rand(&state), 0);
+	bench_stop("bps_tree insert", scale);
+
+	state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		int64_t *res = bench_find(&tree,
+					  (int64_t) bench_rand(&state));
+		bench_blackhole += res != NULL;
+	}
+	bench_stop("bps_tree find hit", scale);
+	bench_destroy(&tree);
+}
+
+static void
+bench_bloom_filter(uint64_t scale)
+{
+	struct bloom bloom;
+	if (bloom_create(&bloom, scale) != 0) {
+		printf("bloom: out of memory\n");
+		return;
+	}
+	uint64_t state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		uint64_t val = bench_rand(&state);
+		bloom_add(&bloom, (uint32_t) val, (uint32_t) (val >> 32));
+	}
+	bench_stop("bloom add", scale);
+
+	state = 42;
+	bench_start();
+	for (uint64_t i = 0; i < scale; i++) {
+		uint64_t val = bench_rand(&state);
+		bench_blackhole += bloom_maybe_has(&bloom, (uint32_t) val,
+						   (uint32_t) (val >> 32));
+	}
+	bench_stop("bloom lookup hit", scale);
+	bloom_destroy(&bloom);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t scale = 1000000;
+	if (argc > 1)
+		scale = strtoull(argv[1], NULL, 10);
+	bench_light(scale);
+	bench_bps_tree(scale);
+	bench_bloom_filter(scale);
+	return 0;
+}